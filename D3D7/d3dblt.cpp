@@ -8,52 +8,6 @@
 
 #include "d3drv.h"
 
-/*-----------------------------------------------------------------------------
-    Name        : d3d_blt_COLORINDEX
-    Description : copies a GL colorindexed image to a D3D surface
-    Inputs      : surf - the surface to blit onto
-                  data - the GL texture to blit from
-                  width, height - dimensions
-    Outputs     :
-    Return      : TRUE or FALSE
-----------------------------------------------------------------------------*/
-GLboolean d3d_blt_COLORINDEX(
-    LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
-{
-    BYTE* psurfBase;
-    GLint y, pitch;
-
-    HRESULT hr;
-    DDSURFACEDESC2 ddsd;
-
-    ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
-    ddsd.dwSize = sizeof(DDSURFACEDESC2);
-    hr = surf->Lock(NULL, &ddsd, DDLOCK_WAIT, NULL);
-    if (FAILED(hr))
-    {
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    if (pitch == width)
-    {
-        MEMCPY(psurfBase, data, width * height);
-    }
-    else
-    {
-        for (y = 0; y < height; y++)
-        {
-            MEMCPY(psurfBase + y*pitch, data + y*width, width);
-        }
-    }
-
-    surf->Unlock(NULL);
-
-    return GL_TRUE;
-}
-
 /*-----------------------------------------------------------------------------
     Name        : d3d_blt_setup
     Description :
@@ -77,30 +31,28 @@ static void d3d_blt_setup(DDPIXELFORMAT* ddpf, GLint dColorBits[], GLint dColorS
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : d3d_blt_RGBA_generic
-    Description : copies a GL RGBA image to a D3D surface
+    Name        : d3d_blt_convert
+    Description : locks a surface and converts a GL image onto it
     Inputs      : surf - the surface to blit onto
+                  dformat - surface format (PIX_), or PIX_FORMATS to take it
+                            from the surface's pixelformat masks
+                  sformat - PIX_RGBA, PIX_ARGB4444 or PIX_INDEX8
                   data - the GL texture to blit from
                   width, height - dimensions
     Outputs     :
     Return      : TRUE or FALSE
 ----------------------------------------------------------------------------*/
-GLboolean d3d_blt_RGBA_generic(
-    LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
+static GLboolean d3d_blt_convert(
+    LPDIRECTDRAWSURFACE4 surf, GLuint dformat,
+    GLuint sformat, GLubyte* data, GLsizei width, GLsizei height)
 {
-    GLint i, bytesPerPixel, sPos, dPos;
-    GLint dColor[4], sColor[4];
     GLint dColorBits[4];
     GLint dColorShift[4];
-    GLushort* dShort;
-    GLuint* dLong;
-
-    BYTE* psurfBase;
-    GLint x, y, pitch;
+    GLint spitch;
+    GLboolean result;
 
     HRESULT hr;
     DDSURFACEDESC2 ddsd;
-    DDPIXELFORMAT* ddpf;
 
     ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
     ddsd.dwSize = sizeof(DDSURFACEDESC2);
@@ -110,65 +62,54 @@ GLboolean d3d_blt_RGBA_generic(
         return GL_FALSE;
     }
 
-    ddpf = &ddsd.ddpfPixelFormat;
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    bytesPerPixel = ddpf->dwRGBBitCount >> 3;
-
-    d3d_blt_setup(ddpf, dColorBits, dColorShift);
+    spitch = width * pix_bytes(sformat);
 
-    for (y = 0; y < height; y++)
+    if (dformat == PIX_FORMATS)
     {
-        dPos = y * pitch;
-        sPos = 4 * y * width;
-
-        for (x = 0; x < width; x++, dPos += bytesPerPixel, sPos += 4)
-        {
-            sColor[0] = data[sPos + 0]; //red
-            sColor[1] = data[sPos + 1]; //green
-            sColor[2] = data[sPos + 2]; //blue
-            sColor[3] = data[sPos + 3]; //alpha
-
-            for (i = 0; i < 4; i++)
-            {
-                if (dColorBits[i] == 8)
-                {
-                    dColor[i] = sColor[i];
-                }
-                else if (dColorBits[i] < 8)
-                {
-                    dColor[i] = sColor[i] >> (8 - dColorBits[i]);
-                }
-                else
-                {
-                    dColor[i] = sColor[i] << (dColorBits[i] - 8);
-                }
-            }
-
-            switch (bytesPerPixel)
-            {
-            case 2:
-                dShort = (GLushort*)(psurfBase + dPos);
-                *dShort = (dColor[0] << dColorShift[0]) | (dColor[1] << dColorShift[1])
-                        | (dColor[2] << dColorShift[2]) | (dColor[3] << dColorShift[3]);
-                break;
-
-            case 4:
-                dLong = (GLuint*)(psurfBase + dPos);
-                *dLong = (dColor[0] << dColorShift[0]) | (dColor[1] << dColorShift[1])
-                       | (dColor[2] << dColorShift[2]) | (dColor[3] << dColorShift[3]);
-                break;
-
-            default:
-                ;//FIXME: do something about this error
-            }
-        }
+        d3d_blt_setup(&ddsd.ddpfPixelFormat, dColorBits, dColorShift);
+        result = pix_convert_masks(
+            ddsd.lpSurface, ddsd.lPitch, ddsd.ddpfPixelFormat.dwRGBBitCount >> 3,
+            dColorBits, dColorShift, sformat, data, spitch, width, height);
+    }
+    else
+    {
+        result = pix_convert(
+            dformat, ddsd.lpSurface, ddsd.lPitch, sformat, data, spitch, width, height);
     }
 
     surf->Unlock(NULL);
 
-    return GL_TRUE;
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : d3d_blt_COLORINDEX
+    Description : copies a GL colorindexed image to a D3D surface
+    Inputs      : surf - the surface to blit onto
+                  data - the GL texture to blit from
+                  width, height - dimensions
+    Outputs     :
+    Return      : TRUE or FALSE
+----------------------------------------------------------------------------*/
+GLboolean d3d_blt_COLORINDEX(
+    LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
+{
+    return d3d_blt_convert(surf, PIX_INDEX8, PIX_INDEX8, data, width, height);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : d3d_blt_RGBA_generic
+    Description : copies a GL RGBA image to a D3D surface
+    Inputs      : surf - the surface to blit onto
+                  data - the GL texture to blit from
+                  width, height - dimensions
+    Outputs     :
+    Return      : TRUE or FALSE
+----------------------------------------------------------------------------*/
+GLboolean d3d_blt_RGBA_generic(
+    LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
+{
+    return d3d_blt_convert(surf, PIX_FORMATS, PIX_RGBA, data, width, height);
 }
 
 /*-----------------------------------------------------------------------------
@@ -183,325 +124,49 @@ GLboolean d3d_blt_RGBA_generic(
 GLboolean d3d_blt_RGBA16_generic(
     LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    GLint i, bytesPerPixel, sPos, dPos;
-    GLint dColor[4], sColor[4];
-    GLint dColorBits[4];
-    GLint dColorShift[4];
-    GLushort* dShort;
-    GLushort* sShort;
-    GLuint* dLong;
-
-    BYTE* psurfBase;
-    GLint x, y, pitch;
-
-    HRESULT hr;
-    DDSURFACEDESC2 ddsd;
-    DDPIXELFORMAT* ddpf;
-
-    ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
-    ddsd.dwSize = sizeof(DDSURFACEDESC2);
-    hr = surf->Lock(NULL, &ddsd, DDLOCK_WAIT, NULL);
-    if (FAILED(hr))
-    {
-        return GL_FALSE;
-    }
-
-    ddpf = &ddsd.ddpfPixelFormat;
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    bytesPerPixel = ddpf->dwRGBBitCount >> 3;
-
-    d3d_blt_setup(ddpf, dColorBits, dColorShift);
-
-    for (y = 0; y < height; y++)
-    {
-        dPos = y * pitch;
-        sPos = 2 * y * width;
-
-        sShort = (GLushort*)(data + sPos);
-
-        for (x = 0; x < width; x++, dPos += bytesPerPixel, sShort++)
-        {
-            sColor[0] = ((*sShort) & 0x0F00) >> 8;  //red
-            sColor[1] = ((*sShort) & 0x00F0) >> 4;  //green
-            sColor[2] =  (*sShort) & 0x000F;        //blue
-            sColor[3] = ((*sShort) & 0xF000) >> 12; //alpha
-
-            for (i = 0; i < 4; i++)
-            {
-                if (dColorBits[i] == 4)
-                {
-                    dColor[i] = sColor[i];
-                }
-                else if (dColorBits[i] < 4)
-                {
-                    dColor[i] = sColor[i] >> (4 - dColorBits[i]);
-                }
-                else
-                {
-                    dColor[i] = sColor[i] << (dColorBits[i] - 4);
-                }
-            }
-
-            switch (bytesPerPixel)
-            {
-            case 2:
-                dShort = (GLushort*)(psurfBase + dPos);
-                *dShort = (dColor[0] << dColorShift[0]) | (dColor[1] << dColorShift[1])
-                        | (dColor[2] << dColorShift[2]) | (dColor[3] << dColorShift[3]);
-                break;
-
-            case 4:
-                dLong = (GLuint*)(psurfBase + dPos);
-                *dLong = (dColor[0] << dColorShift[0]) | (dColor[1] << dColorShift[1])
-                       | (dColor[2] << dColorShift[2]) | (dColor[3] << dColorShift[3]);
-                break;
-
-            default:
-                ;//FIXME: do something about this error
-            }
-        }
-    }
-
-    surf->Unlock(NULL);
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, PIX_FORMATS, PIX_ARGB4444, data, width, height);
 }
 
 //special-case blitter
 GLboolean d3d_blt_RGBA_0565(
     LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    BYTE* psurfBase;
-    WORD* psurf;
-    GLint x, y, pitch;
-    GLubyte* dp;
-
-    HRESULT hr;
-    DDSURFACEDESC2 ddsd;
-
-    ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
-    ddsd.dwSize = sizeof(DDSURFACEDESC2);
-    hr = surf->Lock(NULL, &ddsd, DDLOCK_WAIT, NULL);
-    if (FAILED(hr))
-    {
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    for (y = 0, dp = data; y < height; y++)
-    {
-        psurf = (WORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp += 4, psurf++)
-        {
-            *psurf = FORM_RGB565(dp[0],dp[1],dp[2]);
-        }
-    }
-
-    surf->Unlock(NULL);
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, PIX_RGB565, PIX_RGBA, data, width, height);
 }
 
 //special-case blitter
 GLboolean d3d_blt_RGBA_0555(
     LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    BYTE* psurfBase;
-    WORD* psurf;
-    GLint x, y, pitch;
-    GLubyte* dp;
-
-    HRESULT hr;
-    DDSURFACEDESC2 ddsd;
-
-    ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
-    ddsd.dwSize = sizeof(DDSURFACEDESC2);
-    hr = surf->Lock(NULL, &ddsd, DDLOCK_WAIT, NULL);
-    if (FAILED(hr))
-    {
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    for (y = 0, dp = data; y < height; y++)
-    {
-        psurf = (WORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp += 4, psurf++)
-        {
-            *psurf = FORM_RGB555(dp[0],dp[1],dp[2]);
-        }
-    }
-
-    surf->Unlock(NULL);
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, PIX_XRGB1555, PIX_RGBA, data, width, height);
 }
 
 //special-case blitter
 GLboolean d3d_blt_RGBA_8888(
     LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    BYTE* psurfBase;
-    DWORD* psurf;
-    GLint x, y, pitch;
-    GLubyte* dp;
-
-    HRESULT hr;
-    DDSURFACEDESC2 ddsd;
-
-    ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
-    ddsd.dwSize = sizeof(DDSURFACEDESC2);
-    hr = surf->Lock(NULL, &ddsd, DDLOCK_WAIT, NULL);
-    if (FAILED(hr))
-    {
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    for (y = 0, dp = data; y < height; y++)
-    {
-        psurf = (DWORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp += 4, psurf++)
-        {
-            *psurf = RGBA_MAKE(dp[0],dp[1],dp[2],dp[3]);
-        }
-    }
-
-    surf->Unlock(NULL);
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, PIX_ARGB8888, PIX_RGBA, data, width, height);
 }
 
 //special-case blitter
 GLboolean d3d_blt_RGBA_4444(
     LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    BYTE* psurfBase;
-    WORD* psurf;
-    GLint x, y, pitch;
-    GLubyte* dp;
-
-    HRESULT hr;
-    DDSURFACEDESC2 ddsd;
-
-    ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
-    ddsd.dwSize = sizeof(DDSURFACEDESC2);
-    hr = surf->Lock(NULL, &ddsd, DDLOCK_WAIT, NULL);
-    if (FAILED(hr))
-    {
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    for (y = 0, dp = data; y < height; y++)
-    {
-        psurf = (WORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp += 4, psurf++)
-        {
-            *psurf = ((dp[3] & 0xF0) << 8) |    //a
-                     ((dp[0] & 0xF0) << 4) |    //r
-                      (dp[1] & 0xF0) |          //g
-                     ((dp[2] & 0xF0) >> 4);     //b
-        }
-    }
-
-    surf->Unlock(NULL);
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, PIX_ARGB4444, PIX_RGBA, data, width, height);
 }
 
 //special-case blitter
 GLboolean d3d_blt_RGBA16_4444(
     LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    BYTE* psurfBase;
-    GLint y, pitch;
-
-    HRESULT hr;
-    DDSURFACEDESC2 ddsd;
-
-    ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
-    ddsd.dwSize = sizeof(DDSURFACEDESC2);
-    hr = surf->Lock(NULL, &ddsd, DDLOCK_WAIT, NULL);
-    if (FAILED(hr))
-    {
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    if (pitch == 2*width)
-    {
-        MEMCPY(psurfBase, data, 2 * width * height);
-    }
-    else
-    {
-        for (y = 0; y < height; y++)
-        {
-            MEMCPY(psurfBase + y*pitch, data + y*2*width, 2 * width);
-        }
-    }
-
-    surf->Unlock(NULL);
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, PIX_ARGB4444, PIX_ARGB4444, data, width, height);
 }
 
 //special-case blitter
 GLboolean d3d_blt_RGBA16_8888(
     LPDIRECTDRAWSURFACE4 surf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    BYTE* psurfBase;
-    DWORD* psurf;
-    GLint x, y, pitch;
-    GLushort* dp;
-    WORD r, g, b, a;
-
-    HRESULT hr;
-    DDSURFACEDESC2 ddsd;
-
-    ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
-    ddsd.dwSize = sizeof(DDSURFACEDESC2);
-    hr = surf->Lock(NULL, &ddsd, DDLOCK_WAIT, NULL);
-    if (FAILED(hr))
-    {
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)ddsd.lpSurface;
-    pitch = ddsd.lPitch;
-
-    for (y = 0, dp = (GLushort*)data; y < height; y++)
-    {
-        psurf = (DWORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp++, psurf++)
-        {
-            a = ((*dp) & 0xF000) >> 12;
-            r = ((*dp) & 0x0F00) >> 8;
-            g = ((*dp) & 0x00F0) >> 4;
-            b =  (*dp) & 0x000F;
-            a <<= 4;
-            r <<= 4;
-            g <<= 4;
-            b <<= 4;
-            *psurf = RGBA_MAKE(r, g, b, a);
-        }
-    }
-
-    surf->Unlock(NULL);
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, PIX_ARGB8888, PIX_ARGB4444, data, width, height);
 }
 
 void d3d_shot_setup(DDPIXELFORMAT* ddpf, GLint dColorBits[], GLint dColorShift[])
@@ -539,6 +539,10 @@ GLboolean init_d3d(d3d_context* d3d)
         d3d->maxTexWidth  = MIN_P2(caps->dwMaxTextureWidth);
         d3d->maxTexHeight = MIN_P2(caps->dwMaxTextureHeight);
 
+        //vertices go with D3DDP_DONOTCLIP, so rglGuardBand is held to this
+        gl_driver_guard_band(CTX, caps->dvGuardBandLeft, caps->dvGuardBandTop,
+                             caps->dvGuardBandRight, caps->dvGuardBandBottom);
+
         //tricaps are valid
         D3DPRIMCAPS* tri = &caps->dpcTriCaps;
 
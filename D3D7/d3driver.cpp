@@ -1781,6 +1781,12 @@ static void flush_batch(void)
 ----------------------------------------------------------------------------*/
 static void draw_triangle(GLuint vl[], GLuint pv)
 {
+    if (gVertexNumber + 3 > MAX_VERTS)
+    {
+        flush_batch();
+        gVertexNumber = 0;
+    }
+
     SETUP(vl, gVertexNumber, 3, pv);
     gVertexNumber += 3;
 }
@@ -1851,7 +1857,14 @@ static void draw_point(GLuint first, GLuint last)
 {
     vertex_buffer* VB = CTX->VB;
     GLuint i, n;
-    GLuint vl[VB_SIZE];
+    GLuint vl[MAX_VERTS];
+
+    //the setup arrays hold MAX_VERTS, a bigger VB goes in pieces
+    while (last - first + 1 > MAX_VERTS)
+    {
+        draw_point(first, first + MAX_VERTS - 1);
+        first += MAX_VERTS;
+    }
 
     for (i = first, n = 0; i <= last; i++)
     {
@@ -2321,8 +2334,9 @@ static void bind_texture()
     Name        : teximg
     Description : glTexImage2D handler
     Inputs      : tex - GL texture object
-                  level - mipmap level, totally ignored
-                  internalFormat - also totally ignored
+                  level - mipmap level.  only 0 is used, the surfaces
+                          here are single level
+                  internalFormat - totally ignored
     Outputs     : old texture is deleted if neces, new texture is created,
                   the shared palette is bound if UsingSharedPalette
     Return      :
@@ -2340,6 +2354,11 @@ void teximg(gl_texture_object* tex, GLint level, GLint internalFormat)
 
     t3d = (d3d_texobj*)tex->DriverData;
 
+    if (level > 0)
+    {
+        return;
+    }
+
     if (t3d->valid)
     {
         d3d_free_texture(t3d);
@@ -2599,6 +2618,10 @@ extern "C" DLL GLboolean init_driver(GLcontext* ctx)
     ctx->DR.tex_palette = (VoidFunc)texpalette;
     ctx->DR.tex_img = (VoidFunc)teximg;
     ctx->DR.tex_env = NULL;
+    //d3d_load_all_textures reads tex->Data again, so the GL keeps it
+    ctx->DR.tex_retain = NULL;
+    //no shared device textures here; RGL_TEXTURE_SHARE still shares tex->Data
+    ctx->DR.tex_share = NULL;
 
     ctx->DR.deactivate = deactivate;
     ctx->DR.activate = activate;
@@ -21,6 +21,7 @@
 
 extern "C" {
 #include "kgl.h"
+#include "pixconv.h"
 }
 
 #define PAGE_FLIPPING           1
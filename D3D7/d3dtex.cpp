@@ -354,93 +354,9 @@ GLboolean d3d_match_texture_formats(d3d_context* d3d)
     return GL_TRUE;
 }
 
-void d3d_rescale_scanline(GLsizei bytes, GLubyte* dData, GLsizei dWidth, GLubyte* sData, GLsizei sWidth)
-{
-    GLint dup, skip;
-    GLint sx, dx;
-    GLint i, j;
-
-    if (dWidth > sWidth)
-    {
-        //dup x
-        dup = dWidth / sWidth;
-        for (sx = dx = 0; sx < bytes*sWidth; sx += bytes)
-        {
-            for (j = 0; j < dup; j++, dx += bytes)
-            {
-                for (i = 0; i < bytes; i++)
-                {
-                    dData[dx+i] = sData[sx+i];
-                }
-            }
-        }
-    }
-    else if (sWidth > dWidth)
-    {
-        //skip x
-        skip = sWidth / dWidth;
-        for (sx = dx = 0; sx < bytes*sWidth; sx += bytes*skip, dx += bytes)
-        {
-            for (i = 0; i < bytes; i++)
-            {
-                dData[dx+i] = sData[sx+i];
-            }
-        }
-    }
-    else
-    {
-        //same x
-        MEMCPY(dData, sData, bytes*dWidth);
-    }
-}
-
-void d3d_rescale_generic(
-    GLsizei bytes,
-    GLubyte* dData, GLsizei dWidth, GLsizei dHeight,
-    GLubyte* sData, GLsizei sWidth, GLsizei sHeight)
-{
-    GLubyte* pd;
-    GLubyte* ps;
-    GLint dy, sy;
-    GLint dup, skip;
-    GLint i;
-
-    if (dHeight > sHeight)
-    {
-        //dup y
-        dup = dHeight / sHeight;
-        for (sy = dy = 0; sy < sHeight; sy++)
-        {
-            ps = sData + bytes*sy*sWidth;
-            for (i = 0; i < dup; i++, dy++)
-            {
-                pd = dData + bytes*dy*dWidth;
-                d3d_rescale_scanline(bytes, pd, dWidth, ps, sWidth);
-            }
-        }
-    }
-    else if (sHeight > dHeight)
-    {
-        //skip y
-        skip = sHeight / dHeight;
-        for (sy = dy = 0; sy < sHeight; sy += skip, dy++)
-        {
-            pd = dData + bytes*dy*dWidth;
-            ps = sData + bytes*sy*sWidth;
-            d3d_rescale_scanline(bytes, pd, dWidth, ps, sWidth);
-        }
-    }
-    else
-    {
-        //same y
-        for (sy = 0; sy < sHeight; sy++)
-        {
-            pd = dData + bytes*sy*dWidth;
-            ps = sData + bytes*sy*sWidth;
-            d3d_rescale_scanline(bytes, pd, dWidth, ps, sWidth);
-        }
-    }
-}
+//scratch for aspect-corrected uploads, kept between them
+static pix_arena rescaleData;
+static pix_arena rescaleScratch;
 
 /*-----------------------------------------------------------------------------
     Name        : d3d_blt_texture
@@ -454,8 +370,8 @@ GLboolean d3d_blt_texture(gl_texture_object* tex, DDPIXELFORMAT* ddpf)
 {
     d3d_texobj* t3d = (d3d_texobj*)tex->DriverData;
     GLubyte* data;
-    GLubyte* tempData;
-    GLsizei width, height, bytes;
+    GLsizei width, height;
+    GLuint format;
     GLboolean result;
 
 #if !ONLY_GENERIC_BLITTERS
@@ -465,8 +381,6 @@ GLboolean d3d_blt_texture(gl_texture_object* tex, DDPIXELFORMAT* ddpf)
                   GetNumberOfBits(ddpf->dwBBitMask);
 #endif
 
-    tempData = NULL;
-
     if (t3d->width != 0 && t3d->height != 0)
     {
         //aspect-corrected texture
@@ -475,21 +389,28 @@ GLboolean d3d_blt_texture(gl_texture_object* tex, DDPIXELFORMAT* ddpf)
         switch (tex->Format)
         {
         case GL_COLOR_INDEX:
-            bytes = 1;
+            format = PIX_INDEX8;
             break;
         case GL_RGBA16:
-            bytes = 2;
+            format = PIX_ARGB4444;
             break;
         case GL_RGB:
         case GL_RGBA:
-            bytes = 4;
+            format = PIX_RGBA;
             break;
         default:
             return FALSE;
         }
-        tempData = new GLubyte[bytes * width * height];
-        d3d_rescale_generic(bytes, tempData, width, height, tex->Data, tex->Width, tex->Height);
-        data = tempData;
+        data = (GLubyte*)pix_arena_get(&rescaleData, pix_bytes(format) * width * height);
+        if (data == NULL)
+        {
+            return FALSE;
+        }
+        //box to shrink, bilinear to grow; indices are never filtered
+        pix_rescale(format,
+                    (width <= tex->Width && height <= tex->Height) ? PIX_BOX : PIX_BILINEAR,
+                    data, width, height, tex->Data, tex->Width, tex->Height,
+                    &rescaleScratch);
     }
     else
     {
@@ -550,11 +471,6 @@ GLboolean d3d_blt_texture(gl_texture_object* tex, DDPIXELFORMAT* ddpf)
 #endif
     }
 
-    if (tempData != NULL)
-    {
-        delete [] tempData;
-    }
-
     return result;
 }
 
@@ -897,7 +813,6 @@ void d3d_load_all_textures(GLcontext* ctx)
 {
     GLuint i;
     hashtable* table;
-    hash_t* element;
     gl_texture_object* tex;
 
     table = rglGetTexobjs();
@@ -905,24 +820,18 @@ void d3d_load_all_textures(GLcontext* ctx)
     {
         return;
     }
-    for (i = 0; i < TABLE_SIZE; i++)
+    for (i = 0; i < HASH_COUNT(table); i++)
     {
-        element = table->table[i];
-        while (element != NULL)
+        tex = (gl_texture_object*)HASH_DATA(table, i);
+        //a texture uploaded to a driver that didn't keep it is gone
+        if (tex != NULL && tex->created && tex->Data != NULL)
         {
-            tex = (gl_texture_object*)element->data;
-            if (tex != NULL && tex->created)
+            texbind(tex);
+            teximg(tex, 0, tex->Format);
+            if (tex->Format == GL_COLOR_INDEX)
             {
-                texbind(tex);
-                teximg(tex, 0, tex->Format);
-                if (tex->Format == GL_COLOR_INDEX)
-                {
-                    texpalette(tex);
-                }
+                texpalette(tex);
             }
-
-            //next chained element
-            element = element->next;
         }
     }
 }
@@ -932,27 +841,22 @@ void d3d_free_all_textures(GLcontext* ctx)
 {
     GLuint i;
     hashtable* table;
-    hash_t* element;
     gl_texture_object* tex;
 
+    pix_arena_free(&rescaleData);
+    pix_arena_free(&rescaleScratch);
+
     table = rglGetTexobjs();
     if (table == NULL || table->maxkey == 0)
     {
         return;
     }
-    for (i = 0; i < TABLE_SIZE; i++)
+    for (i = 0; i < HASH_COUNT(table); i++)
     {
-        element = table->table[i];
-        while (element != NULL)
+        tex = (gl_texture_object*)HASH_DATA(table, i);
+        if (tex != NULL)
         {
-            tex = (gl_texture_object*)element->data;
-            if (tex != NULL)
-            {
-                texdel(tex);
-            }
-
-            //next chained element
-            element = element->next;
+            texdel(tex);
         }
     }
 }
@@ -9,50 +9,6 @@
 #include "d3drv.h"
 #include "d3dblt.h"
 
-/*-----------------------------------------------------------------------------
-    Name        : d3d_blt_COLORINDEX
-    Description : copies a GL colorindexed image to a D3D surface
-    Inputs      : surf - the surface to blit onto
-                  data - the GL texture to blit from
-                  width, height - dimensions
-    Outputs     :
-    Return      : TRUE or FALSE
-----------------------------------------------------------------------------*/
-GLboolean d3d_blt_COLORINDEX(
-    IDirect3DSurface9* surf, GLubyte* data, GLsizei width, GLsizei height)
-{
-    RETrackFunction();
-
-    D3DLOCKED_RECT lockedRect;
-    HRESULT hr;
-
-    hr = surf->LockRect(&lockedRect, NULL, D3DLOCK_NOSYSLOCK);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_COLORINDEX: LockRect failed", hr);
-        return GL_FALSE;
-    }
-
-    BYTE* psurfBase = (BYTE*)lockedRect.pBits;
-    GLint pitch = lockedRect.Pitch;
-
-    if (pitch == width)
-    {
-        memcpy(psurfBase, data, width * height);
-    }
-    else
-    {
-        for (GLint y = 0; y < height; y++)
-        {
-            memcpy(psurfBase + y * pitch, data + y * width, width);
-        }
-    }
-
-    surf->UnlockRect();
-
-    return GL_TRUE;
-}
-
 /*-----------------------------------------------------------------------------
     Name        : d3d_blt_setup
     Description :
@@ -129,106 +85,101 @@ static int d3d_format_bit_count(D3DFORMAT format)
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : d3d_blt_RGBA_generic
-    Description : copies a GL RGBA image to a D3D surface
+    Name        : d3d_blt_convert
+    Description : locks a surface and converts a GL image onto it
     Inputs      : surf - the surface to blit onto
+                  name - error logged if the lock fails
+                  dformat - surface format (PIX_), or PIX_FORMATS to take it
+                            from the surface description
+                  sformat - PIX_RGBA, PIX_ARGB4444 or PIX_INDEX8
                   data - the GL texture to blit from
                   width, height - dimensions
     Outputs     :
     Return      : TRUE or FALSE
 ----------------------------------------------------------------------------*/
-GLboolean d3d_blt_RGBA_generic(
-    IDirect3DSurface9* surf, GLubyte* data, GLsizei width, GLsizei height)
+static GLboolean d3d_blt_convert(
+    IDirect3DSurface9* surf, char const* name, GLuint dformat,
+    GLuint sformat, GLubyte* data, GLsizei width, GLsizei height)
 {
-    RETrackFunction();
-
-    GLint i, bytesPerPixel, sPos, dPos;
-    GLint dColor[4], sColor[4];
-    GLint dColorBits[4];
-    GLint dColorShift[4];
-    GLushort* dShort;
-    GLuint* dLong;
-
-    BYTE* psurfBase;
-    GLint x, y, pitch;
-
-    HRESULT hr;
+    D3DLOCKED_RECT lockedRect;
     D3DSURFACE_DESC ddsd;
+    HRESULT hr;
+    GLboolean result;
 
-    D3DLOCKED_RECT lockedRect;
+    if (dformat == PIX_FORMATS)
+    {
+        hr = surf->GetDesc(&ddsd);
+        if (FAILED(hr))
+        {
+            errLog("d3d_blt_convert: GetDesc failed", hr);
+            return GL_FALSE;
+        }
+    }
 
     hr = surf->LockRect(&lockedRect, nullptr, D3DLOCK_NOSYSLOCK);
     if (FAILED(hr))
     {
-        errLog("d3d_blt_RGBA_generic: LockRect failed", hr);
+        errLog(name, hr);
         return GL_FALSE;
     }
 
-    psurfBase = (BYTE*)lockedRect.pBits;
-    pitch = lockedRect.Pitch;
-
-    hr = surf->GetDesc(&ddsd);
-    if (FAILED(hr))
-	{
-        errLog("d3d_blt_RGBA_generic: GetDesc failed", hr);
-		return GL_FALSE;
-	}
+    GLint spitch = width * pix_bytes(sformat);
 
-    bytesPerPixel = d3d_format_bit_count(ddsd.Format);
-    
-    d3d_blt_setup(ddsd.Format, dColorBits, dColorShift);
+    if (dformat == PIX_FORMATS)
+    {
+        GLint dColorBits[4];
+        GLint dColorShift[4];
 
-    for (y = 0; y < height; y++)
+        d3d_blt_setup(ddsd.Format, dColorBits, dColorShift);
+        result = pix_convert_masks(
+            lockedRect.pBits, lockedRect.Pitch, d3d_format_bit_count(ddsd.Format) / 8,
+            dColorBits, dColorShift, sformat, data, spitch, width, height);
+    }
+    else
     {
-        dPos = y * pitch;
-        sPos = 4 * y * width;
+        result = pix_convert(
+            dformat, lockedRect.pBits, lockedRect.Pitch, sformat, data, spitch, width, height);
+    }
 
-        for (x = 0; x < width; x++, dPos += bytesPerPixel, sPos += 4)
-        {
-            sColor[0] = data[sPos + 0]; //red
-            sColor[1] = data[sPos + 1]; //green
-            sColor[2] = data[sPos + 2]; //blue
-            sColor[3] = data[sPos + 3]; //alpha
+    surf->UnlockRect();
 
-            for (i = 0; i < 4; i++)
-            {
-                if (dColorBits[i] == 8)
-                {
-                    dColor[i] = sColor[i];
-                }
-                else if (dColorBits[i] < 8)
-                {
-                    dColor[i] = sColor[i] >> (8 - dColorBits[i]);
-                }
-                else
-                {
-                    dColor[i] = sColor[i] << (dColorBits[i] - 8);
-                }
-            }
+    return result;
+}
 
-            switch (bytesPerPixel)
-            {
-            case 2:
-                dShort = (GLushort*)(psurfBase + dPos);
-                *dShort = (dColor[0] << dColorShift[0]) | (dColor[1] << dColorShift[1])
-                        | (dColor[2] << dColorShift[2]) | (dColor[3] << dColorShift[3]);
-                break;
-
-            case 4:
-                dLong = (GLuint*)(psurfBase + dPos);
-                *dLong = (dColor[0] << dColorShift[0]) | (dColor[1] << dColorShift[1])
-                       | (dColor[2] << dColorShift[2]) | (dColor[3] << dColorShift[3]);
-                break;
-
-            default:
-                ;//FIXME: do something about this error
-            }
-        }
-    }
+/*-----------------------------------------------------------------------------
+    Name        : d3d_blt_COLORINDEX
+    Description : copies a GL colorindexed image to a D3D surface
+    Inputs      : surf - the surface to blit onto
+                  data - the GL texture to blit from
+                  width, height - dimensions
+    Outputs     :
+    Return      : TRUE or FALSE
+----------------------------------------------------------------------------*/
+GLboolean d3d_blt_COLORINDEX(
+    IDirect3DSurface9* surf, GLubyte* data, GLsizei width, GLsizei height)
+{
+    RETrackFunction();
 
-    surf->UnlockRect();
+    return d3d_blt_convert(surf, "d3d_blt_COLORINDEX: LockRect failed",
+                           PIX_INDEX8, PIX_INDEX8, data, width, height);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : d3d_blt_RGBA_generic
+    Description : copies a GL RGBA image to a D3D surface
+    Inputs      : surf - the surface to blit onto
+                  data - the GL texture to blit from
+                  width, height - dimensions
+    Outputs     :
+    Return      : TRUE or FALSE
+----------------------------------------------------------------------------*/
+GLboolean d3d_blt_RGBA_generic(
+    IDirect3DSurface9* surf, GLubyte* data, GLsizei width, GLsizei height)
+{
+    RETrackFunction();
 
-    return GL_TRUE;
+    return d3d_blt_convert(surf, "d3d_blt_RGBA_generic: LockRect failed",
+                           PIX_FORMATS, PIX_RGBA, data, width, height);
 }
 
 /*-----------------------------------------------------------------------------
@@ -245,96 +196,8 @@ GLboolean d3d_blt_RGBA16_generic(
 {
     RETrackFunction();
 
-    GLint i, bytesPerPixel, sPos, dPos;
-    GLint dColor[4], sColor[4];
-    GLint dColorBits[4];
-    GLint dColorShift[4];
-    GLushort* dShort;
-    GLushort* sShort;
-    GLuint* dLong;
-
-    BYTE* psurfBase;
-    GLint x, y, pitch;
-
-    HRESULT hr;
-    D3DSURFACE_DESC ddsd;
-
-    D3DLOCKED_RECT lockedRect;
-
-    hr = surf->LockRect(&lockedRect, nullptr, D3DLOCK_NOSYSLOCK);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_RGBA16_generic: LockRect failed", hr);
-        return GL_FALSE;
-    }
-
-    hr = surf->GetDesc(&ddsd);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_RGBA16_generic: GetDesc failed", hr);
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)lockedRect.pBits;
-    pitch = lockedRect.Pitch;
-
-    bytesPerPixel = d3d_format_bit_count(ddsd.Format);
-
-    d3d_blt_setup(ddsd.Format, dColorBits, dColorShift);
-
-    for (y = 0; y < height; y++)
-    {
-        dPos = y * pitch;
-        sPos = 2 * y * width;
-
-        sShort = (GLushort*)(data + sPos);
-
-        for (x = 0; x < width; x++, dPos += bytesPerPixel, sShort++)
-        {
-            sColor[0] = ((*sShort) & 0x0F00) >> 8;  //red
-            sColor[1] = ((*sShort) & 0x00F0) >> 4;  //green
-            sColor[2] =  (*sShort) & 0x000F;        //blue
-            sColor[3] = ((*sShort) & 0xF000) >> 12; //alpha
-
-            for (i = 0; i < 4; i++)
-            {
-                if (dColorBits[i] == 4)
-                {
-                    dColor[i] = sColor[i];
-                }
-                else if (dColorBits[i] < 4)
-                {
-                    dColor[i] = sColor[i] >> (4 - dColorBits[i]);
-                }
-                else
-                {
-                    dColor[i] = sColor[i] << (dColorBits[i] - 4);
-                }
-            }
-
-            switch (bytesPerPixel)
-            {
-            case 2:
-                dShort = (GLushort*)(psurfBase + dPos);
-                *dShort = (dColor[0] << dColorShift[0]) | (dColor[1] << dColorShift[1])
-                        | (dColor[2] << dColorShift[2]) | (dColor[3] << dColorShift[3]);
-                break;
-
-            case 4:
-                dLong = (GLuint*)(psurfBase + dPos);
-                *dLong = (dColor[0] << dColorShift[0]) | (dColor[1] << dColorShift[1])
-                       | (dColor[2] << dColorShift[2]) | (dColor[3] << dColorShift[3]);
-                break;
-
-            default:
-                ;//FIXME: do something about this error
-            }
-        }
-    }
-
-    surf->UnlockRect();
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, "d3d_blt_RGBA16_generic: LockRect failed",
+                           PIX_FORMATS, PIX_ARGB4444, data, width, height);
 }
 
 //special-case blitter
@@ -343,37 +206,8 @@ GLboolean d3d_blt_RGBA_0565(
 {
     RETrackFunction();
 
-    BYTE* psurfBase;
-    WORD* psurf;
-    GLint x, y, pitch;
-    GLubyte* dp;
-
-    HRESULT hr;
-
-    D3DLOCKED_RECT lockedRect;
-
-    hr = surf->LockRect(&lockedRect, nullptr, D3DLOCK_NOSYSLOCK);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_RGBA_0565: LockRect failed", hr);
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)lockedRect.pBits;
-    pitch = lockedRect.Pitch;
-
-    for (y = 0, dp = data; y < height; y++)
-    {
-        psurf = (WORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp += 4, psurf++)
-        {
-            *psurf = FORM_RGB565(dp[0],dp[1],dp[2]);
-        }
-    }
-
-    surf->UnlockRect();
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, "d3d_blt_RGBA_0565: LockRect failed",
+                           PIX_RGB565, PIX_RGBA, data, width, height);
 }
 
 //special-case blitter
@@ -382,37 +216,8 @@ GLboolean d3d_blt_RGBA_0555(
 {
     RETrackFunction();
 
-    BYTE* psurfBase;
-    WORD* psurf;
-    GLint x, y, pitch;
-    GLubyte* dp;
-
-    HRESULT hr;
-
-    D3DLOCKED_RECT lockedRect;
-
-    hr = surf->LockRect(&lockedRect, nullptr, D3DLOCK_NOSYSLOCK);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_RGBA_0555: LockRect failed", hr);
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)lockedRect.pBits;
-    pitch = lockedRect.Pitch;
-
-    for (y = 0, dp = data; y < height; y++)
-    {
-        psurf = (WORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp += 4, psurf++)
-        {
-            *psurf = FORM_RGB555(dp[0],dp[1],dp[2]);
-        }
-    }
-
-    surf->UnlockRect();
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, "d3d_blt_RGBA_0555: LockRect failed",
+                           PIX_XRGB1555, PIX_RGBA, data, width, height);
 }
 
 //special-case blitter
@@ -421,76 +226,16 @@ GLboolean d3d_blt_RGBA_8888(
 {
     RETrackFunction();
 
-    BYTE* psurfBase;
-    DWORD* psurf;
-    GLint x, y, pitch;
-    GLubyte* dp;
-
-    HRESULT hr;
-
-    D3DLOCKED_RECT lockedRect;
-
-    hr = surf->LockRect(&lockedRect, nullptr, D3DLOCK_NOSYSLOCK);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_RGBA_8888: LockRect failed", hr);
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)lockedRect.pBits;
-    pitch = lockedRect.Pitch;
-
-    for (y = 0, dp = data; y < height; y++)
-    {
-        psurf = (DWORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp += 4, psurf++)
-        {
-            *psurf = RGBA_MAKE(dp[0],dp[1],dp[2],dp[3]);
-        }
-    }
-
-    surf->UnlockRect();
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, "d3d_blt_RGBA_8888: LockRect failed",
+                           PIX_ARGB8888, PIX_RGBA, data, width, height);
 }
 
 //special-case blitter
 GLboolean d3d_blt_RGBA_4444(
     IDirect3DSurface9* surf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    BYTE* psurfBase;
-    WORD* psurf;
-    GLint x, y, pitch;
-    GLubyte* dp;
-
-    HRESULT hr;
-
-    D3DLOCKED_RECT lockedRect;
-    hr = surf->LockRect(&lockedRect, nullptr, D3DLOCK_NOSYSLOCK);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_RGBA_4444: LockRect failed", hr);
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)lockedRect.pBits;
-    pitch = lockedRect.Pitch;
-
-    for (y = 0, dp = data; y < height; y++)
-    {
-        psurf = (WORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp += 4, psurf++)
-        {
-            *psurf = ((dp[3] & 0xF0) << 8) |    //a
-                     ((dp[0] & 0xF0) << 4) |    //r
-                      (dp[1] & 0xF0) |          //g
-                     ((dp[2] & 0xF0) >> 4);     //b
-        }
-    }
-
-    surf->UnlockRect();
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, "d3d_blt_RGBA_4444: LockRect failed",
+                           PIX_ARGB4444, PIX_RGBA, data, width, height);
 }
 
 //special-case blitter
@@ -499,37 +244,8 @@ GLboolean d3d_blt_RGBA16_4444(
 {
     RETrackFunction();
 
-    BYTE* psurfBase;
-    GLint y, pitch;
-
-    HRESULT hr;
-
-    D3DLOCKED_RECT lockedRect;
-    hr = surf->LockRect(&lockedRect, nullptr, D3DLOCK_NOSYSLOCK);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_RGBA16_4444: LockRect failed", hr);
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)lockedRect.pBits;
-    pitch = lockedRect.Pitch;
-
-    if (pitch == 2*width)
-    {
-        MEMCPY(psurfBase, data, 2 * width * height);
-    }
-    else
-    {
-        for (y = 0; y < height; y++)
-        {
-            MEMCPY(psurfBase + y*pitch, data + y*2*width, 2 * width);
-        }
-    }
-
-    surf->UnlockRect();
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, "d3d_blt_RGBA16_4444: LockRect failed",
+                           PIX_ARGB4444, PIX_ARGB4444, data, width, height);
 }
 
 //special-case blitter
@@ -538,45 +254,8 @@ GLboolean d3d_blt_RGBA16_8888(
 {
     RETrackFunction();
 
-    BYTE* psurfBase;
-    DWORD* psurf;
-    GLint x, y, pitch;
-    GLushort* dp;
-    WORD r, g, b, a;
-
-    HRESULT hr;
-
-    D3DLOCKED_RECT lockedRect;
-    hr = surf->LockRect(&lockedRect, nullptr, D3DLOCK_NOSYSLOCK);
-    if (FAILED(hr))
-    {
-        errLog("d3d_blt_RGBA16_8888: LockRect failed", hr);
-        return GL_FALSE;
-    }
-
-    psurfBase = (BYTE*)lockedRect.pBits;
-    pitch = lockedRect.Pitch;
-
-    for (y = 0, dp = (GLushort*)data; y < height; y++)
-    {
-        psurf = (DWORD*)(psurfBase + y*pitch);
-        for (x = 0; x < width; x++, dp++, psurf++)
-        {
-            a = ((*dp) & 0xF000) >> 12;
-            r = ((*dp) & 0x0F00) >> 8;
-            g = ((*dp) & 0x00F0) >> 4;
-            b =  (*dp) & 0x000F;
-            a <<= 4;
-            r <<= 4;
-            g <<= 4;
-            b <<= 4;
-            *psurf = RGBA_MAKE(r, g, b, a);
-        }
-    }
-
-    surf->UnlockRect();
-
-    return GL_TRUE;
+    return d3d_blt_convert(surf, "d3d_blt_RGBA16_8888: LockRect failed",
+                           PIX_ARGB8888, PIX_ARGB4444, data, width, height);
 }
 
 void d3d_draw_quad(GLint xOfs, GLint yOfs, GLsizei width, GLsizei height, ComPtr<IDirect3DSurface9> offscreenSurface, bool reversed)
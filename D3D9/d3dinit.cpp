@@ -164,6 +164,10 @@ GLboolean init_d3d(d3d_context* d3d)
     d3d->maxTexWidth  = MIN_P2(caps.MaxTextureWidth);
     d3d->maxTexHeight = MIN_P2(caps.MaxTextureHeight);
 
+    //pretransformed vertices aren't clipped, so rglGuardBand is held to this
+    gl_driver_guard_band(CTX, caps.GuardBandLeft, caps.GuardBandTop,
+                         caps.GuardBandRight, caps.GuardBandBottom);
+
     if (caps.TextureCaps & D3DPTEXTURECAPS_POW2)
 	{
         // TODO: If we need to support this, draw_quad needs to be changed to pad up to nearest power of 2
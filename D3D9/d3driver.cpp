@@ -9,6 +9,7 @@
 #include "d3drv.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <assert.h>
 
@@ -88,9 +89,17 @@ typedef struct xyzw_t
 
 constexpr const char* LOG_FILE_NAME = "rgld3d9.log";
 
-static xyzw_c   d3dVert[MAX_VERTS];
-static xyzw_c_t d3dVertct[MAX_VERTS];
-static xyzw_t   d3dVertt[MAX_VERTS];
+/* the setup functions' output.  draw_triangle batches into the first
+   MAX_VERTS; draw_indexed_triangles and draw_point set up VB vertices in
+   place, so the arrays are moved to the heap when the VB outgrows them */
+static xyzw_c   d3dVertBuf[MAX_VERTS];
+static xyzw_c_t d3dVertctBuf[MAX_VERTS];
+static xyzw_t   d3dVerttBuf[MAX_VERTS];
+
+static xyzw_c*   d3dVert = d3dVertBuf;
+static xyzw_c_t* d3dVertct = d3dVertctBuf;
+static xyzw_t*   d3dVertt = d3dVerttBuf;
+static GLuint    gVertexMax = MAX_VERTS;
 
 static GLint  gVertexNumber;
 static DWORD  gVertexFlags;
@@ -608,6 +617,8 @@ static void d3d_min_filter(d3d_context* d3d, GLenum filter)
     switch (filter)
     {
     case GL_LINEAR:
+    case GL_LINEAR_MIPMAP_NEAREST:
+    case GL_LINEAR_MIPMAP_LINEAR:
         d3d->d3dDevice->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_LINEAR);
         break;
 
@@ -618,6 +629,23 @@ static void d3d_min_filter(d3d_context* d3d, GLenum filter)
         }
         break;
     }
+
+    switch (filter)
+    {
+    case GL_NEAREST_MIPMAP_NEAREST:
+    case GL_LINEAR_MIPMAP_NEAREST:
+        d3d->d3dDevice->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_POINT);
+        break;
+
+    case GL_NEAREST_MIPMAP_LINEAR:
+    case GL_LINEAR_MIPMAP_LINEAR:
+        d3d->d3dDevice->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_LINEAR);
+        break;
+
+    default:
+        d3d->d3dDevice->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+        break;
+    }
 }
 
 /*-----------------------------------------------------------------------------
@@ -655,9 +683,24 @@ static void d3d_setup_filter(gl_texture_object* tex)
 {
     d3d_texobj* t3d = (d3d_texobj*)tex->DriverData;
     d3d_context* d3d = D3D;
+    GLenum minFilter;
 
     if (t3d != NULL)
     {
+        //a chain built for RGL_MIPMAPS is sampled whatever the GL filter
+        minFilter = t3d->texMinFilter;
+        if (tex->MipLevels != 0)
+        {
+            if (minFilter == GL_LINEAR)
+            {
+                minFilter = GL_LINEAR_MIPMAP_LINEAR;
+            }
+            else if (minFilter == GL_NEAREST)
+            {
+                minFilter = GL_NEAREST_MIPMAP_NEAREST;
+            }
+        }
+
         if (t3d->texWrapS != d3d->texWrapS)
         {
             d3d_wrap_s(d3d, t3d->texWrapS);
@@ -668,10 +711,10 @@ static void d3d_setup_filter(gl_texture_object* tex)
             d3d_wrap_t(d3d, t3d->texWrapT);
             d3d->texWrapT = t3d->texWrapT;
         }
-        if (t3d->texMinFilter != d3d->texMinFilter)
+        if (minFilter != d3d->texMinFilter)
         {
-            d3d_min_filter(d3d, t3d->texMinFilter);
-            d3d->texMinFilter = t3d->texMinFilter;
+            d3d_min_filter(d3d, minFilter);
+            d3d->texMinFilter = minFilter;
         }
         if (t3d->texMagFilter != d3d->texMagFilter)
         {
@@ -1564,6 +1607,82 @@ static void update_projection(void)
         D3DTS_PROJECTION, (const D3DMATRIX*)CTX->ProjectionMatrix);
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : free_vertices
+    Description : back to the static setup arrays
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void free_vertices(void)
+{
+    if (d3dVert != d3dVertBuf)
+    {
+        if (gVertices == d3dVert) gVertices = d3dVertBuf;
+        else if (gVertices == d3dVertct) gVertices = d3dVertctBuf;
+        else if (gVertices == d3dVertt) gVertices = d3dVerttBuf;
+
+        free(d3dVert);
+        free(d3dVertct);
+        free(d3dVertt);
+        d3dVert = d3dVertBuf;
+        d3dVertct = d3dVertctBuf;
+        d3dVertt = d3dVerttBuf;
+        gVertexMax = MAX_VERTS;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : reserve_vertices
+    Description : make room in the setup arrays for n vertices.  they grow
+                  (doubling) along with the VB
+    Inputs      : n - number of vertices
+    Outputs     : the arrays may move, gVertices follows
+    Return      : false if out of memory
+----------------------------------------------------------------------------*/
+static bool reserve_vertices(GLuint n)
+{
+    GLuint max;
+    xyzw_c* vert;
+    xyzw_c_t* vertct;
+    xyzw_t* vertt;
+
+    if (n <= gVertexMax)
+    {
+        return true;
+    }
+
+    for (max = gVertexMax; max < n; max *= 2)
+        ;
+
+    vert = (xyzw_c*)malloc(max * sizeof(xyzw_c));
+    vertct = (xyzw_c_t*)malloc(max * sizeof(xyzw_c_t));
+    vertt = (xyzw_t*)malloc(max * sizeof(xyzw_t));
+    if (vert == NULL || vertct == NULL || vertt == NULL)
+    {
+        free(vert);
+        free(vertct);
+        free(vertt);
+        return false;
+    }
+
+    //a pending draw_triangle batch stays where it is
+    memcpy(vert, d3dVert, gVertexMax * sizeof(xyzw_c));
+    memcpy(vertct, d3dVertct, gVertexMax * sizeof(xyzw_c_t));
+    memcpy(vertt, d3dVertt, gVertexMax * sizeof(xyzw_t));
+
+    if (gVertices == d3dVert) gVertices = vert;
+    else if (gVertices == d3dVertct) gVertices = vertct;
+    else if (gVertices == d3dVertt) gVertices = vertt;
+
+    free_vertices();
+    d3dVert = vert;
+    d3dVertct = vertct;
+    d3dVertt = vertt;
+    gVertexMax = max;
+    return true;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : flush_batch
     Description : renders a batch of primitives coming from draw_[prim] fn
@@ -1591,6 +1710,12 @@ static void flush_batch(void)
 ----------------------------------------------------------------------------*/
 static void draw_triangle(GLuint vl[], GLuint pv)
 {
+    if (gVertexNumber + 3 > (GLint)gVertexMax)
+    {
+        flush_batch();
+        gVertexNumber = 0;
+    }
+
     SETUP(vl, gVertexNumber, 3, pv);
     gVertexNumber += 3;
 }
@@ -1617,6 +1742,61 @@ static void draw_quad(GLuint vl[], GLuint pv)
     draw_triangle(vlist, pv);
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : draw_indexed_triangles
+    Description : draws a list of indexed triangles from the VB.  the VB's
+                  vertices are set up once and shared, rather than 3 copies
+                  per triangle as draw_triangle does
+    Inputs      : start, end - range of VB vertices referenced,
+                  count - number of indices, indices - count/3 triangles
+    Outputs     : renders the triangles
+    Return      :
+----------------------------------------------------------------------------*/
+static void draw_indexed_triangles(GLuint start, GLuint end, GLsizei count, GLuint const* indices)
+{
+    static GLuint* identity = NULL;
+    static GLuint identityMax = 0;
+    static GLuint identityCount = 0;
+    HRESULT hr;
+
+    //anything batched by draw_triangle goes first, and its vertices are reused
+    flush_batch();
+    gVertexNumber = 0;
+
+    if (end >= identityMax)
+    {
+        GLuint* list = (GLuint*)realloc(identity, CTX->VB->Size * sizeof(GLuint));
+        if (list == NULL)
+        {
+            return;
+        }
+        identity = list;
+        identityMax = CTX->VB->Size;
+    }
+    if (!reserve_vertices(end + 1))
+    {
+        return;
+    }
+
+    for (; identityCount <= end; identityCount++)
+    {
+        identity[identityCount] = identityCount;
+    }
+
+    //set up at the same positions, so the indices can be used as they are
+    SETUP(identity + start, start, end - start + 1, 0);
+
+    D3D->d3dDevice->SetFVF(gVertexType);
+    hr = D3D->d3dDevice->DrawIndexedPrimitiveUP(
+        D3DPT_TRIANGLELIST, start, end - start + 1, count / 3,
+        indices, D3DFMT_INDEX32, gVertices, gVertexSize);
+
+    if (FAILED(hr))
+    {
+        assert(false && "DrawIndexedPrimitiveUP failed");
+    }
+}
+
 /*-----------------------------------------------------------------------------
     Name        : draw_line
     Description : draws a line
@@ -1663,7 +1843,12 @@ static void draw_point(GLuint first, GLuint last)
 {
     vertex_buffer* VB = CTX->VB;
     GLuint i, n;
-    GLuint vl[VB_SIZE];
+    GLuint* vl = VB->VList;
+
+    if (!reserve_vertices(last - first + 1))
+    {
+        return;
+    }
 
     for (i = first, n = 0; i <= last; i++)
     {
@@ -1847,6 +2032,7 @@ static void shutdown_driver(GLcontext* ctx)
     spdlog::info("Shutting down D3D9...");
     d3d_free_all_textures(ctx);
     d3d_shutdown(ctx);
+    free_vertices();
 
     if (ctx->DriverCtx != NULL)
     {
@@ -1995,8 +2181,10 @@ static void bind_texture()
     Name        : teximg
     Description : glTexImage2D handler
     Inputs      : tex - GL texture object
-                  level - mipmap level, totally ignored
-                  internalFormat - also totally ignored
+                  level - mipmap level.  0 (re)creates the texture, with
+                          room for the GL's mip chain; above 0 fills that
+                          level from the chain
+                  internalFormat - totally ignored
     Outputs     : old texture is deleted if neces, new texture is created,
                   the shared palette is bound if UsingSharedPalette
     Return      :
@@ -2014,6 +2202,15 @@ void teximg(gl_texture_object* tex, GLint level, GLint internalFormat)
 
     t3d = (d3d_texobj*)tex->DriverData;
 
+    if (level > 0)
+    {
+        if (t3d->valid)
+        {
+            d3d_blt_mipmap(tex, level);
+        }
+        return;
+    }
+
     if (t3d->valid)
     {
         d3d_free_texture(t3d);
@@ -2045,6 +2242,61 @@ void teximg(gl_texture_object* tex, GLint level, GLint internalFormat)
     }
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : texshare
+    Description : RGL_TEXTURE_SHARE handler, called instead of teximg when
+                  tex's image is one src already has
+    Inputs      : tex - GL texture object
+                  src - a texture object with the same image
+    Outputs     : tex holds a reference to src's D3D texture rather than a
+                  copy.  its wrap / filter states are still its own
+    Return      :
+----------------------------------------------------------------------------*/
+void texshare(gl_texture_object* tex, gl_texture_object* src)
+{
+    d3d_texobj* t3d;
+    d3d_texobj* s3d = (d3d_texobj*)src->DriverData;
+    GLuint level;
+
+    if (!tex->DriverData)
+    {
+        tex->DriverData = d3d_alloc_texobj();
+        d3d_fill_texobj(tex);
+    }
+
+    t3d = (d3d_texobj*)tex->DriverData;
+
+    if (s3d == NULL || !s3d->valid)
+    {
+        //src's upload failed, so tex gets one of its own
+        teximg(tex, 0, tex->Format);
+        for (level = 1; level <= tex->MipLevels; level++)
+        {
+            teximg(tex, level, GL_RGBA);
+        }
+        return;
+    }
+
+    if (t3d->valid)
+    {
+        d3d_free_texture(t3d);
+    }
+
+    t3d->texObj = s3d->texObj;
+    t3d->texObj->AddRef();
+    t3d->texSurface = s3d->texSurface;
+    if (t3d->texSurface != NULL)
+    {
+        t3d->texSurface->AddRef();
+    }
+    t3d->width = s3d->width;
+    t3d->height = s3d->height;
+    t3d->paletted = s3d->paletted;
+    t3d->valid = GL_TRUE;
+
+    texbind(tex);
+}
+
 /*-----------------------------------------------------------------------------
     Name        : texparam
     Description : GL texture parameter fn, handles texture wrap / filter states
@@ -2235,6 +2487,7 @@ extern "C" DLL GLboolean init_driver(GLcontext* ctx)
     ctx->DR.draw_point = (VoidFunc)draw_point;
 
     ctx->DR.draw_triangle_elements = (DrawElemFunc)draw_triangle_elements;
+    ctx->DR.draw_indexed_triangles = draw_indexed_triangles;
 
     ctx->DR.draw_clipped_triangle = NULL;
     ctx->DR.draw_clipped_polygon = NULL;
@@ -2245,6 +2498,9 @@ extern "C" DLL GLboolean init_driver(GLcontext* ctx)
     ctx->DR.tex_palette = (VoidFunc)texpalette;
     ctx->DR.tex_img = (VoidFunc)teximg;
     ctx->DR.tex_env = NULL;
+    //d3d_load_all_textures reads tex->Data again, so the GL keeps it
+    ctx->DR.tex_retain = NULL;
+    ctx->DR.tex_share = texshare;
 
     ctx->DR.deactivate = deactivate;
     ctx->DR.activate = activate;
@@ -23,6 +23,7 @@
 
 extern "C" {
 #include "kgl.h"
+#include "pixconv.h"
 }
 
 #define PAGE_FLIPPING           1
@@ -173,6 +174,7 @@ void d3d_shutdown(GLcontext* ctx);
 
 void texbind(gl_texture_object*);
 void teximg(gl_texture_object*, GLint, GLint);
+void texshare(gl_texture_object*, gl_texture_object*);
 void texpalette(gl_texture_object*);
 void texdel(gl_texture_object*);
 
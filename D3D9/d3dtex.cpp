@@ -96,92 +96,35 @@ void enum_texture_formats(d3d_context* d3d, D3DFORMAT adapterFormat)
     }
 }
 
-void d3d_rescale_scanline(GLsizei bytes, GLubyte* dData, GLsizei dWidth, GLubyte* sData, GLsizei sWidth)
-{
-    GLint dup, skip;
-    GLint sx, dx;
-    GLint i, j;
-
-    if (dWidth > sWidth)
-    {
-        //dup x
-        dup = dWidth / sWidth;
-        for (sx = dx = 0; sx < bytes*sWidth; sx += bytes)
-        {
-            for (j = 0; j < dup; j++, dx += bytes)
-            {
-                for (i = 0; i < bytes; i++)
-                {
-                    dData[dx+i] = sData[sx+i];
-                }
-            }
-        }
-    }
-    else if (sWidth > dWidth)
-    {
-        //skip x
-        skip = sWidth / dWidth;
-        for (sx = dx = 0; sx < bytes*sWidth; sx += bytes*skip, dx += bytes)
-        {
-            for (i = 0; i < bytes; i++)
-            {
-                dData[dx+i] = sData[sx+i];
-            }
-        }
-    }
-    else
-    {
-        //same x
-        MEMCPY(dData, sData, bytes*dWidth);
-    }
-}
+//scratch for aspect-corrected uploads, kept between them
+static pix_arena rescaleData;
+static pix_arena rescaleScratch;
 
-void d3d_rescale_generic(
-    GLsizei bytes,
-    GLubyte* dData, GLsizei dWidth, GLsizei dHeight,
-    GLubyte* sData, GLsizei sWidth, GLsizei sHeight)
+//RGBA texels to a surface of format ddpf
+static GLboolean d3d_blt_rgba(IDirect3DSurface9* surf, D3DFORMAT ddpf, GLubyte* data, GLsizei width, GLsizei height)
 {
-    GLubyte* pd;
-    GLubyte* ps;
-    GLint dy, sy;
-    GLint dup, skip;
-    GLint i;
-
-    if (dHeight > sHeight)
-    {
-        //dup y
-        dup = dHeight / sHeight;
-        for (sy = dy = 0; sy < sHeight; sy++)
-        {
-            ps = sData + bytes*sy*sWidth;
-            for (i = 0; i < dup; i++, dy++)
-            {
-                pd = dData + bytes*dy*dWidth;
-                d3d_rescale_scanline(bytes, pd, dWidth, ps, sWidth);
-            }
-        }
-    }
-    else if (sHeight > dHeight)
-    {
-        //skip y
-        skip = sHeight / dHeight;
-        for (sy = dy = 0; sy < sHeight; sy += skip, dy++)
-        {
-            pd = dData + bytes*dy*dWidth;
-            ps = sData + bytes*sy*sWidth;
-            d3d_rescale_scanline(bytes, pd, dWidth, ps, sWidth);
-        }
-    }
-    else
+#if ONLY_GENERIC_BLITTERS
+    return d3d_blt_RGBA_generic(surf, data, width, height);
+#else
+    switch (ddpf)
     {
-        //same y
-        for (sy = 0; sy < sHeight; sy++)
-        {
-            pd = dData + bytes*sy*dWidth;
-            ps = sData + bytes*sy*sWidth;
-            d3d_rescale_scanline(bytes, pd, dWidth, ps, sWidth);
-        }
+    case D3DFMT_R5G6B5:
+        ASSERT_UNTESTED();
+        return d3d_blt_RGBA_0565(surf, data, width, height);
+    case D3DFMT_X1R5G5B5: // TODO D3D9: This is probably the wrong format!
+        ASSERT_UNTESTED();
+        return d3d_blt_RGBA_0555(surf, data, width, height);
+    case D3DFMT_A4R4G4B4:
+        ASSERT_UNTESTED();
+        return d3d_blt_RGBA_4444(surf, data, width, height);
+    case D3DFMT_A8R8G8B8:
+    case D3DFMT_X8R8G8B8:
+        return d3d_blt_RGBA_8888(surf, data, width, height);
+    default:
+        assert(false && "Unhandled format");
+        return d3d_blt_RGBA_generic(surf, data, width, height);
     }
+#endif
 }
 
 /*-----------------------------------------------------------------------------
@@ -196,14 +139,12 @@ GLboolean d3d_blt_texture(gl_texture_object* tex, D3DFORMAT ddpf)
 {
     d3d_texobj* t3d = (d3d_texobj*)tex->DriverData;
     GLubyte* data;
-    GLubyte* tempData;
-    GLsizei width, height, bytes;
+    GLsizei width, height;
+    GLuint format;
     GLboolean result;
 
     // ASSERT_UNTESTED();
 
-    tempData = NULL;
-
     if (t3d->width != 0 && t3d->height != 0)
     {
         //aspect-corrected texture
@@ -212,21 +153,28 @@ GLboolean d3d_blt_texture(gl_texture_object* tex, D3DFORMAT ddpf)
         switch (tex->Format)
         {
         case GL_COLOR_INDEX:
-            bytes = 1;
+            format = PIX_INDEX8;
             break;
         case GL_RGBA16:
-            bytes = 2;
+            format = PIX_ARGB4444;
             break;
         case GL_RGB:
         case GL_RGBA:
-            bytes = 4;
+            format = PIX_RGBA;
             break;
         default:
             return FALSE;
         }
-        tempData = new GLubyte[bytes * width * height];
-        d3d_rescale_generic(bytes, tempData, width, height, tex->Data, tex->Width, tex->Height);
-        data = tempData;
+        data = (GLubyte*)pix_arena_get(&rescaleData, pix_bytes(format) * width * height);
+        if (data == NULL)
+        {
+            return FALSE;
+        }
+        //box to shrink, bilinear to grow; indices are never filtered
+        pix_rescale(format,
+                    (width <= tex->Width && height <= tex->Height) ? PIX_BOX : PIX_BILINEAR,
+                    data, width, height, tex->Data, tex->Width, tex->Height,
+                    &rescaleScratch);
     }
     else
     {
@@ -246,32 +194,7 @@ GLboolean d3d_blt_texture(gl_texture_object* tex, D3DFORMAT ddpf)
 
     case GL_RGB:
     case GL_RGBA:
-#if ONLY_GENERIC_BLITTERS
-        result = d3d_blt_RGBA_generic(t3d->texSurface, data, width, height);
-#else
-        switch (ddpf)
-        {
-        case D3DFMT_R5G6B5:
-            ASSERT_UNTESTED();
-            result = d3d_blt_RGBA_0565(t3d->texSurface, data, width, height);
-            break;
-        case D3DFMT_X1R5G5B5: // TODO D3D9: This is probably the wrong format!
-            ASSERT_UNTESTED();
-            result = d3d_blt_RGBA_0555(t3d->texSurface, data, width, height);
-            break;
-        case D3DFMT_A4R4G4B4:
-            ASSERT_UNTESTED();
-            result = d3d_blt_RGBA_4444(t3d->texSurface, data, width, height);
-            break;
-        case D3DFMT_A8R8G8B8:
-        case D3DFMT_X8R8G8B8:
-            result = d3d_blt_RGBA_8888(t3d->texSurface, data, width, height);
-            break;
-        default:
-            assert(false && "Unhandled format");
-            result = d3d_blt_RGBA_generic(t3d->texSurface, data, width, height);
-        }
-#endif
+        result = d3d_blt_rgba(t3d->texSurface, ddpf, data, width, height);
         break;
 
     case GL_RGBA16:
@@ -293,10 +216,46 @@ GLboolean d3d_blt_texture(gl_texture_object* tex, D3DFORMAT ddpf)
 #endif
     }
 
-    if (tempData != NULL)
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : d3d_blt_mipmap
+    Description : fill one level of a texture's mip chain from the GL's
+    Inputs      : tex - GL texture object
+                  level - 1..tex->MipLevels
+    Outputs     : the level's surface contains the image
+    Return      : TRUE (success) or FALSE (failure, or a single level texture)
+----------------------------------------------------------------------------*/
+GLboolean d3d_blt_mipmap(gl_texture_object* tex, GLint level)
+{
+    d3d_texobj* t3d = (d3d_texobj*)tex->DriverData;
+    IDirect3DSurface9* surf;
+    D3DSURFACE_DESC desc;
+    GLubyte* data;
+    GLsizei width, height;
+    GLboolean result;
+    HRESULT hr;
+
+    if (t3d->texObj == NULL || (DWORD)level >= t3d->texObj->GetLevelCount())
+    {
+        return FALSE;
+    }
+    data = rglGetTexLevel(tex, level, &width, &height);
+    if (data == NULL)
+    {
+        return FALSE;
+    }
+
+    hr = t3d->texObj->GetSurfaceLevel(level, &surf);
+    if (FAILED(hr))
     {
-        delete [] tempData;
+        errLog("d3d_blt_mipmap(GetSurfaceLevel)", hr);
+        return FALSE;
     }
+    surf->GetDesc(&desc);
+    result = d3d_blt_rgba(surf, desc.Format, data, width, height);
+    surf->Release();
 
     return result;
 }
@@ -315,6 +274,7 @@ GLboolean d3d_create_texture(gl_texture_object* tex)
     GLsizei width, height;
     GLint maxAspect;
     D3DFORMAT ddpf;
+    UINT levels;
 
     t3d = (d3d_texobj*)tex->DriverData;
     t3d->paletted = GL_FALSE;
@@ -467,7 +427,15 @@ GLboolean d3d_create_texture(gl_texture_object* tex)
         }
     }
 
-    hr = D3D->d3dDevice->CreateTexture(width, height, 1, D3DUSAGE_DYNAMIC, ddpf, D3DPOOL_DEFAULT, &t3d->texObj, nullptr);
+    //the GL's mip chain, filled in by teximg.  it's RGBA, so not for P8, and
+    //sized for the GL's level 0, so not for a rescaled texture
+    levels = 1;
+    if (tex->MipLevels != 0 && !t3d->paletted && t3d->width == 0)
+    {
+        levels += tex->MipLevels;
+    }
+
+    hr = D3D->d3dDevice->CreateTexture(width, height, levels, D3DUSAGE_DYNAMIC, ddpf, D3DPOOL_DEFAULT, &t3d->texObj, nullptr);
     if (FAILED(hr))
     {
         char estring[1024], texstring[16];
@@ -597,37 +565,60 @@ GLboolean d3d_bind_texture(d3d_texobj* t3d)
     }
 }
 
+//a texture already loaded with the image tex shares (RGL_TEXTURE_SHARE), or NULL
+static gl_texture_object* d3d_shared_source(gl_texture_object* tex)
+{
+    gl_texture_object* src;
+
+    if (tex->Share == NULL)
+    {
+        return NULL;
+    }
+    for (src = tex->Share->Users; src != NULL; src = src->ShareNext)
+    {
+        if (src != tex && src->DriverData != NULL && ((d3d_texobj*)src->DriverData)->valid)
+        {
+            return src;
+        }
+    }
+    return NULL;
+}
+
 //create D3D reps of all textures in the GL
 void d3d_load_all_textures(GLcontext* ctx)
 {
-    GLuint i;
+    GLuint i, level;
     hashtable* table;
-    hash_t* element;
     gl_texture_object* tex;
+    gl_texture_object* src;
 
     table = rglGetTexobjs();
     if (table == NULL || table->maxkey == 0)
     {
         return;
     }
-    for (i = 0; i < TABLE_SIZE; i++)
+    for (i = 0; i < HASH_COUNT(table); i++)
     {
-        element = table->table[i];
-        while (element != NULL)
+        tex = (gl_texture_object*)HASH_DATA(table, i);
+        //a texture uploaded to a driver that didn't keep it is gone
+        if (tex != NULL && tex->created && tex->Data != NULL)
         {
-            tex = (gl_texture_object*)element->data;
-            if (tex != NULL && tex->created)
+            texbind(tex);
+            src = d3d_shared_source(tex);
+            if (src != NULL)
             {
-                texbind(tex);
-                teximg(tex, 0, tex->Format);
-                if (tex->Format == GL_COLOR_INDEX)
-                {
-                    texpalette(tex);
-                }
+                texshare(tex, src);
+                continue;
+            }
+            teximg(tex, 0, tex->Format);
+            for (level = 1; level <= tex->MipLevels; level++)
+            {
+                teximg(tex, level, GL_RGBA);
+            }
+            if (tex->Format == GL_COLOR_INDEX)
+            {
+                texpalette(tex);
             }
-
-            //next chained element
-            element = element->next;
         }
     }
 }
@@ -637,27 +628,22 @@ void d3d_free_all_textures(GLcontext* ctx)
 {
     GLuint i;
     hashtable* table;
-    hash_t* element;
     gl_texture_object* tex;
 
+    pix_arena_free(&rescaleData);
+    pix_arena_free(&rescaleScratch);
+
     table = rglGetTexobjs();
     if (table == NULL || table->maxkey == 0)
     {
         return;
     }
-    for (i = 0; i < TABLE_SIZE; i++)
+    for (i = 0; i < HASH_COUNT(table); i++)
     {
-        element = table->table[i];
-        while (element != NULL)
+        tex = (gl_texture_object*)HASH_DATA(table, i);
+        if (tex != NULL)
         {
-            tex = (gl_texture_object*)element->data;
-            if (tex != NULL)
-            {
-                texdel(tex);
-            }
-
-            //next chained element
-            element = element->next;
+            texdel(tex);
         }
     }
 }
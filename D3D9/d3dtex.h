@@ -13,6 +13,7 @@ void enum_texture_formats(d3d_context* d3d, D3DFORMAT adapterFormat);
 GLboolean d3d_match_texture_formats(d3d_context* d3d);
 
 GLboolean d3d_blt_texture(gl_texture_object* tex, D3DFORMAT ddpf);
+GLboolean d3d_blt_mipmap(gl_texture_object* tex, GLint level);
 GLboolean d3d_create_texture(gl_texture_object* tex);
 void d3d_free_texture(d3d_texobj* t3d);
 d3d_texobj* d3d_alloc_texobj(void);
@@ -100,118 +100,6 @@ static GLubyte clip_table[8*16] =
     CLIP_VALUE8(0x78)
 };
 
-static int chkcpubit()
-{
-    int rval;
-    _asm
-    {
-        pusha
-
-        pushfd
-        pop eax
-        test eax, 0x00200000
-        jz set_21
-        and eax, 0xffdfffff
-        push eax
-        popfd
-        pushfd
-        pop eax
-        test eax, 0x00200000
-        jz cpu_id_ok
-        jmp err
-
-    set_21:
-        or eax, 0x00200000
-        push eax
-        popfd
-        pushfd
-        pop eax
-        test eax, 0x00200000
-        jnz cpu_id_ok
-
-    err:
-        mov eax, 0
-        jmp exit
-
-    cpu_id_ok:
-        mov eax, 1
-
-    exit:
-        mov [rval], eax
-
-        popa
-    }
-    return rval;
-}
-
-static GLuint cpu_eax, cpu_edx;
-
-GLuint get_cputype()
-{
-    GLuint ptype;
-
-    if (!chkcpubit())
-    {
-        cpu_edx = cpu_eax = 0;
-        return 4;
-    }
-    else
-    {
-        _asm
-        {
-            pusha
-
-            mov eax, 1
-//            cpuid
-            _emit 0x0f
-            _emit 0xa2
-            mov [cpu_eax], eax
-            mov [cpu_edx], edx
-            and eax, 0x0f00
-            shr eax, 8
-            mov [ptype], eax
-
-            popa
-        }
-        return ptype;
-    }
-}
-
-//only call after get_cputype()
-GLboolean get_cpummx()
-{
-    //check MMX bit (23)
-    if (cpu_edx & 0x400000)
-    {
-        return GL_TRUE;
-    }
-    else
-    {
-        if (((cpu_eax & 0x0f00) >= 0x600) &&
-            ((cpu_eax & 0x0f0) >= 0x30))
-        {
-            //pentium II has MMX
-            return GL_TRUE;
-        }
-        //no MMX
-        return GL_FALSE;
-    }
-}
-
-//only call after get_cputype()
-GLboolean get_cpukatmai()
-{
-    if ((cpu_edx & 0x2000000) &&    //XMM
-        (cpu_edx & 0x1000000))      //FXSR
-    {
-        return GL_TRUE;
-    }
-    else
-    {
-        return GL_FALSE;
-    }
-}
-
 void transform_points4_general(GLuint n, GLfloat* d, GLfloat* m, GLfloat* s)
 {
     _asm
@@ -1155,15 +1043,13 @@ void ablend_555(unsigned char *lpAlpha, unsigned int iAlpPitch,
 void gl_mmx_blend_span(
     GLcontext* ctx, GLuint n, GLubyte* mask, GLubyte rgba[][4], GLushort* dest)
 {
-    GLushort  srcbuf[MAX_WIDTH+4];
-    GLubyte   alphabuf[MAX_WIDTH+8];
     GLushort* src;
     GLubyte*  alpha;
     GLuint    i;
 
-    src = srcbuf;
-    while ((GLint)src & 7) src++;
-    alpha = alphabuf;
+    //n <= MaxWidth, spans are clipped to the buffer
+    src = (GLushort*)ctx->SpanBuffer;
+    alpha = ctx->SpanBuffer + 2*ctx->MaxWidth;
     while ((GLint)alpha & 7) alpha++;
 
     if (ctx->Buffer.PixelType == GL_RGB565)
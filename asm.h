@@ -11,10 +11,6 @@ Copyright Relic Entertainment, Inc.  All rights reserved.
 
 #include "kgl.h"
 
-GLuint get_cputype();
-GLboolean get_cpummx();
-GLboolean get_cpukatmai();
-
 void xmm_update_modelview(GLcontext* ctx);
 void xmm_update_projection(GLcontext* ctx);
 
@@ -2,6 +2,7 @@
 #include "kgl.h"
 #include "maths.h"
 #include "clip.h"
+#include "simd.h"
 
 
 #define LINTERP(T, A, B)  ((A) + (T) * ((B) - (A)))
@@ -29,7 +30,10 @@ static void interpolate_aux(GLcontext* ctx,
     }
     if (ctx->ClipMask & CLIP_TEXTURE_BIT)
     {
-        VB->Eye[dst][2] = LINTERP(t, VB->Eye[in][2], VB->Eye[out][2]);
+        if (VB->EyeValid)
+        {
+            VB->Eye[dst][2] = LINTERP(t, VB->Eye[in][2], VB->Eye[out][2]);
+        }
         VB->TexCoord[dst][0] = LINTERP(t, VB->TexCoord[in][0], VB->TexCoord[out][0]);
         VB->TexCoord[dst][1] = LINTERP(t, VB->TexCoord[in][1], VB->TexCoord[out][1]);
     }
@@ -84,7 +88,7 @@ GLuint gl_viewclip_line(GLcontext* ctx, GLuint* i, GLuint* j)
                 interpolate_aux(ctx, VB->Free, t, jj, ii); \
             ii = VB->Free; \
             VB->Free++; \
-            if (VB->Free == VB_SIZE) \
+            if (VB->Free == VB->Size) \
                 VB->Free = 1; \
         } \
     } \
@@ -99,7 +103,7 @@ GLuint gl_viewclip_line(GLcontext* ctx, GLuint* i, GLuint* j)
                 interpolate_aux(ctx, VB->Free, t, ii, jj); \
             jj = VB->Free; \
             VB->Free++; \
-            if (VB->Free == VB_SIZE) \
+            if (VB->Free == VB->Size) \
                 VB->Free = 1; \
         } \
     }
@@ -238,11 +242,18 @@ GLuint gl_viewclip_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
 
     GLuint previ, prevj;
     GLuint curri, currj;
-    GLuint vlist2[VB_SIZE];
+    GLuint* vlist2 = VB->VList2;
     GLuint n2;
 //    GLdouble dx, dy, dz, dw, t, neww;
     GLfloat dx, dy, dz, dw, t, neww;
 
+#if SIMD_X86
+    if (ctx->CpuSSE2 && simd_sse2_viewclip_polygon(ctx, n, vlist, &n2))
+    {
+        return n2;
+    }
+#endif
+
 /*
  * We use 6 instances of this code to implement clipping against the
  * 6 sides of the view volume.  Prior to each we define the macros:
@@ -286,7 +297,7 @@ GLuint gl_viewclip_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
                     /* output new point */ \
                     OUTLIST[OUTCOUNT] = VB->Free; \
                     VB->Free++; \
-                    if (VB->Free == VB_SIZE) \
+                    if (VB->Free == VB->Size) \
                         VB->Free = 1; \
                     OUTCOUNT++; \
                 } \
@@ -310,7 +321,7 @@ GLuint gl_viewclip_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
                     /* output new point */ \
                     OUTLIST[OUTCOUNT] = VB->Free; \
                     VB->Free++; \
-                    if (VB->Free == VB_SIZE) \
+                    if (VB->Free == VB->Size) \
                         VB->Free = 1; \
                     OUTCOUNT++; \
                 } \
@@ -321,17 +332,17 @@ GLuint gl_viewclip_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
         previ = curri; \
         prevj = currj; \
         /* check for overflowing vertex buffer */ \
-        if (OUTCOUNT >= VB_SIZE - 1) \
+        if (OUTCOUNT >= VB->Size - 1) \
         { \
             /* too many vertices */ \
             if (OUTLIST == vlist2) \
             { \
                 /* copy OUTLIST[] to vlist[] */ \
-                int i; \
-                for (i = 0; i < VB_SIZE; i++) \
+                GLuint i; \
+                for (i = 0; i < VB->Size; i++) \
                     vlist[i] = OUTLIST[i]; \
             } \
-            return VB_SIZE - 1; \
+            return VB->Size - 1; \
         } \
     }
 
@@ -532,7 +543,7 @@ GLuint gl_userclip_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
 {
     vertex_buffer* VB = ctx->VB;
 
-    GLuint vlist2[VB_SIZE];
+    GLuint* vlist2 = VB->VList2;
     GLuint *inlist, *outlist;
     GLuint incount, outcount;
     GLuint curri, currj;
@@ -613,7 +624,7 @@ GLuint gl_userclip_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
                         //output new vertex
                         outlist[outcount++] = VB->Free;
                         VB->Free++;
-                        if (VB->Free == VB_SIZE)
+                        if (VB->Free == VB->Size)
                         {
                             VB->Free = 1;
                         }
@@ -661,7 +672,7 @@ GLuint gl_userclip_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
                         //output new vertex
                         outlist[outcount++] = VB->Free;
                         VB->Free++;
-                        if (VB->Free == VB_SIZE)
+                        if (VB->Free == VB->Size)
                         {
                             VB->Free = 1;
                         }
@@ -671,14 +682,14 @@ GLuint gl_userclip_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
                 previ = curri;
                 prevj = currj;
 
-                if (outcount >= VB_SIZE-1)
+                if (outcount >= VB->Size-1)
                 {
                     //too many vertices
                     if (outlist != vlist2)
                     {
                         MEMCPY(vlist, vlist2, outcount*sizeof(GLuint));
                     }
-                    return VB_SIZE-1;
+                    return VB->Size-1;
                 }
             }
 
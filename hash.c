@@ -8,6 +8,8 @@
 =============================================================================*/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "kgl.h"
 
@@ -15,30 +17,198 @@
 static void* (*_hashAlloc)() = NULL;
 static void (*_hashFree)() = NULL;
 
+#define HASH_MIN_SLOTS  64
+#define HASH_MIN_BITS   6
+#define HASH_NONE       ((GLuint)~0)
+
+/* fibonacci hashing, the top bits of key * 2^32 / phi.  glGenTextures hands
+   out consecutive names, which this spreads evenly */
+#define HASH_HOME(T,K)  (((K) * 0x9e3779b1U) >> (T)->shift)
+
+//how far the entry in slot pos is from its home slot
+#define HASH_DIST(T,P)  (((P) - HASH_HOME(T, (T)->slots[P].key)) & (T)->mask)
+
+/*-----------------------------------------------------------------------------
+    Name        : hash_find
+    Description : find the slot holding key.  as the table is Robin Hood
+                  ordered, the search stops at the first entry closer to
+                  its home than key would be
+    Inputs      : table - the hashtable
+                  key - the key, != 0
+    Outputs     :
+    Return      : the slot, or HASH_NONE
+----------------------------------------------------------------------------*/
+static GLuint hash_find(hashtable const* table, GLuint key)
+{
+    GLuint pos = HASH_HOME(table, key);
+    GLuint dist = 0;
+
+    for (;;)
+    {
+        GLuint k = table->slots[pos].key;
+        if (k == key)
+        {
+            return pos;
+        }
+        if (k == 0 || HASH_DIST(table, pos) < dist)
+        {
+            return HASH_NONE;
+        }
+        pos = (pos + 1) & table->mask;
+        dist++;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hash_place
+    Description : put a key that isn't in the table into a slot.  on the
+                  way, an entry closer to its home than the one being placed
+                  gives up its slot and is placed further on instead
+    Inputs      : table - the hashtable, with a free slot
+                  key - the key
+                  index - its position in keys / data
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void hash_place(hashtable* table, GLuint key, GLuint index)
+{
+    GLuint pos = HASH_HOME(table, key);
+    GLuint dist = 0;
+
+    for (;;)
+    {
+        hash_slot* slot = &table->slots[pos];
+        GLuint d;
+
+        if (slot->key == 0)
+        {
+            slot->key = key;
+            slot->index = index;
+            return;
+        }
+
+        d = HASH_DIST(table, pos);
+        if (d < dist)
+        {
+            GLuint k = slot->key;
+            GLuint i = slot->index;
+            slot->key = key;
+            slot->index = index;
+            key = k;
+            index = i;
+            dist = d;
+        }
+
+        pos = (pos + 1) & table->mask;
+        dist++;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hash_resize
+    Description : reallocate the slots and rehash every entry
+    Inputs      : table - the hashtable
+                  bits - log2 of the new number of slots
+    Outputs     :
+    Return      : FALSE if out of memory, leaving the table as it was
+----------------------------------------------------------------------------*/
+static GLboolean hash_resize(hashtable* table, GLuint bits)
+{
+    GLuint nslots = 1U << bits;
+    hash_slot* slots;
+    GLuint i;
+
+    slots = (hash_slot*)_hashAlloc(nslots * sizeof(hash_slot));
+    if (slots == NULL)
+    {
+        return GL_FALSE;
+    }
+    memset(slots, 0, nslots * sizeof(hash_slot));
+
+    if (table->slots != NULL)
+    {
+        _hashFree(table->slots);
+    }
+    table->slots = slots;
+    table->mask = nslots - 1;
+    table->shift = 32 - bits;
+
+    for (i = 0; i < table->count; i++)
+    {
+        hash_place(table, table->keys[i], i);
+    }
+    return GL_TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hash_reserve
+    Description : make room for one more entry, growing the dense arrays
+                  and the slots (kept under 7/8 full) by doubling
+    Inputs      : table - the hashtable
+    Outputs     :
+    Return      : FALSE if out of memory
+----------------------------------------------------------------------------*/
+static GLboolean hash_reserve(hashtable* table)
+{
+    if (table->count == table->capacity)
+    {
+        GLuint capacity = 2 * table->capacity;
+        GLuint* keys = (GLuint*)_hashAlloc(capacity * sizeof(GLuint));
+        void** data = (void**)_hashAlloc(capacity * sizeof(void*));
+
+        if (keys == NULL || data == NULL)
+        {
+            if (keys != NULL) _hashFree(keys);
+            if (data != NULL) _hashFree(data);
+            return GL_FALSE;
+        }
+        memcpy(keys, table->keys, table->count * sizeof(GLuint));
+        memcpy(data, table->data, table->count * sizeof(void*));
+        _hashFree(table->keys);
+        _hashFree(table->data);
+        table->keys = keys;
+        table->data = data;
+        table->capacity = capacity;
+    }
+
+    if (8 * (table->count + 1) > 7 * (table->mask + 1))
+    {
+        return hash_resize(table, 32 - table->shift + 1);
+    }
+    return GL_TRUE;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : hashNewTable
-    Description : creates a new hashtable structure and initializes
-                  all entries to NULL, sets maxkey to 0.  also sets
-                  the hash.c mem de/alloc function pointers
+    Description : creates a new, empty hashtable structure, sets maxkey
+                  to 0.  also sets the hash.c mem de/alloc function pointers
     Inputs      : allocFunc - memory allocation func, void* malloc(GLint)
                   freeFunc - memory deallocation func, free(void*)
     Outputs     :
-    Return      : a freshly allocated hashtable structure
+    Return      : a freshly allocated hashtable structure, or NULL
 ----------------------------------------------------------------------------*/
 hashtable* hashNewTable(void* (*allocFunc)(), void (*freeFunc)(void*))
 {
-    int i;
     hashtable* table;
 
     _hashAlloc = allocFunc;
     _hashFree = freeFunc;
 
     table = (hashtable*)_hashAlloc(sizeof(hashtable));
+    if (table == NULL)
+    {
+        return NULL;
+    }
+    memset(table, 0, sizeof(hashtable));
 
-    table->maxkey = 0;
-    for (i = 0; i < TABLE_SIZE; i++)
+    table->capacity = HASH_MIN_SLOTS / 2;
+    table->keys = (GLuint*)_hashAlloc(table->capacity * sizeof(GLuint));
+    table->data = (void**)_hashAlloc(table->capacity * sizeof(void*));
+    if (table->keys == NULL || table->data == NULL ||
+        !hash_resize(table, HASH_MIN_BITS))
     {
-        table->table[i] = NULL;
+        hashDeleteTable(table);
+        return NULL;
     }
 
     return table;
@@ -47,26 +217,18 @@ hashtable* hashNewTable(void* (*allocFunc)(), void (*freeFunc)(void*))
 /*-----------------------------------------------------------------------------
     Name        : hashDeleteTable
     Description : deletes a hashtable structure, freeing the memory
-                  used by the entry blocks but not what the blocks
-                  contain (because this is a generic hash)
+                  used by the table but not what the entries point to
+                  (because this is a generic hash)
     Inputs      : table - the hashtable to delete
     Outputs     :
     Return      :
 ----------------------------------------------------------------------------*/
 void hashDeleteTable(hashtable* table)
 {
-    GLuint i;
     assert(table);
-    for (i = 0; i < TABLE_SIZE; i++)
-    {
-        hash_t* entry = table->table[i];
-        while (entry)
-        {
-            hash_t* next = entry->next;
-            _hashFree(entry);
-            entry = next;
-        }
-    }
+    if (table->slots != NULL) _hashFree(table->slots);
+    if (table->keys != NULL) _hashFree(table->keys);
+    if (table->data != NULL) _hashFree(table->data);
     _hashFree(table);
 }
 
@@ -81,24 +243,14 @@ void hashDeleteTable(hashtable* table)
 void* hashLookup(hashtable const* table, GLuint key)
 {
     GLuint pos;
-    hash_t* entry;
 
     assert(table);
 
     if (key == 0)
         return NULL;
 
-    pos = key % TABLE_SIZE;
-    entry = table->table[pos];
-    while (entry)
-    {
-        if (entry->key == key)
-        {
-            return entry->data;
-        }
-        entry = entry->next;
-    }
-    return NULL;
+    pos = hash_find(table, key);
+    return (pos == HASH_NONE) ? NULL : table->data[table->slots[pos].index];
 }
 
 /*-----------------------------------------------------------------------------
@@ -113,37 +265,34 @@ void* hashLookup(hashtable const* table, GLuint key)
 void hashInsert(hashtable* table, GLuint key, void* data)
 {
     GLuint pos;
-    hash_t* entry;
 
     assert(table);
 
     if (key == 0)
         return;
 
-    if (key > table->maxkey)
-        table->maxkey = key;
+    pos = hash_find(table, key);
+    if (pos != HASH_NONE)
+    {
+        /* replace entry's data.  user should really avoid this
+           and free collisions manually before inserting to avoid
+           unreferenced but allocated memory */
+        table->data[table->slots[pos].index] = data;
+        return;
+    }
 
-    pos = key % TABLE_SIZE;
-    entry = table->table[pos];
-    while (entry)
+    if (!hash_reserve(table))
     {
-        if (entry->key == key)
-        {
-            /* replace entry's data.  user should really avoid this
-               and free collisions manually before inserting to avoid
-               unreferenced but allocated memory */
-	        entry->data = data;
-	        return;
-        }
-        entry = entry->next;
+        return;
     }
 
-    /* alloc and insert new table entry */
-    entry = (hash_t*)_hashAlloc(sizeof(hash_t));
-    entry->key = key;
-    entry->data = data;
-    entry->next = table->table[pos];
-    table->table[pos] = entry;
+    if (key > table->maxkey)
+        table->maxkey = key;
+
+    table->keys[table->count] = key;
+    table->data[table->count] = data;
+    hash_place(table, key, table->count);
+    table->count++;
 }
 
 /*-----------------------------------------------------------------------------
@@ -152,39 +301,51 @@ void hashInsert(hashtable* table, GLuint key, void* data)
     Inputs      : table - the hashtable
                   key - the key of the entry to remove
     Outputs     : table is modified to not contain the entry if it
-                  was found, and the entry block is freed (but not
-                  the data it contains)
+                  was found (but the data it points to isn't freed).
+                  the last entry moves into its place in keys / data
     Return      :
 ----------------------------------------------------------------------------*/
 void hashRemove(hashtable* table, GLuint key)
 {
-    GLuint pos;
-    hash_t *entry, *prev;
+    GLuint pos, next, index, last;
 
     assert(table);
     assert(key);
 
-    pos = key % TABLE_SIZE;
-    prev = NULL;
-    entry = table->table[pos];
-    while (entry)
+    pos = hash_find(table, key);
+    if (pos == HASH_NONE)
     {
-        if (entry->key == key)
-        {
-            if (prev)
-            {
-                prev->next = entry->next;
-            }
-            else
-            {
-                table->table[pos] = entry->next;
-            }
-            _hashFree(entry);
-	        return;
-        }
-        prev = entry;
-        entry = entry->next;
+        return;
+    }
+    index = table->slots[pos].index;
+
+    /* backward shift: pull the following entries back a slot, until one
+       that's already home or an empty slot */
+    next = (pos + 1) & table->mask;
+    while (table->slots[next].key != 0 && HASH_DIST(table, next) != 0)
+    {
+        table->slots[pos] = table->slots[next];
+        pos = next;
+        next = (next + 1) & table->mask;
     }
+    table->slots[pos].key = 0;
+
+    //fill the hole in keys / data
+    last = table->count - 1;
+    if (index != last)
+    {
+        table->keys[index] = table->keys[last];
+        table->data[index] = table->data[last];
+        table->slots[hash_find(table, table->keys[index])].index = index;
+    }
+    table->count = last;
+}
+
+static int hash_key_compare(void const* a, void const* b)
+{
+    GLuint ka = *(GLuint const*)a;
+    GLuint kb = *(GLuint const*)b;
+    return (ka < kb) ? -1 : (ka > kb) ? 1 : 0;
 }
 
 /*-----------------------------------------------------------------------------
@@ -205,33 +366,155 @@ GLuint hashFindFreeKeyBlock(hashtable* table, GLuint numkeys)
         /* the quick solution */
         return table->maxkey + 1;
     }
+    else if (table->count == table->maxkey)
+    {
+        /* 1..maxkey are all in use, and there's no room past them */
+        return 0;
+    }
     else
     {
-        /* the slow solution */
-        GLuint freecount = 0;
-        GLuint freestart = 0;
-        GLuint key;
+        /* the slow solution: the gaps between the keys in order */
+        GLuint* keys;
+        GLuint prev, i, start;
 
-        for (key = 0; key != maxkey; key++)
+        keys = (GLuint*)_hashAlloc(table->count * sizeof(GLuint) + sizeof(GLuint));
+        if (keys == NULL)
         {
-            if (hashLookup(table, key))
-            {
-                /* key already in use */
-                freecount = 0;
-                freestart = key + 1;
-	        }
-	        else
+            return 0;
+        }
+        memcpy(keys, table->keys, table->count * sizeof(GLuint));
+        qsort(keys, table->count, sizeof(GLuint), hash_key_compare);
+
+        start = 0;
+        prev = 0;
+        for (i = 0; i < table->count; i++)
+        {
+            if (keys[i] - prev - 1 >= numkeys)
             {
-	            /* this key not in use, maybe we've found enough */
-	            freecount++;
-                if (freecount == numkeys)
-                {
-                    return freestart;
-                }
-	        }
-	    }
-
-        /* cannot allocate a block of numkeys consecutive keys */
-        return 0;
+                start = prev + 1;
+                break;
+            }
+            prev = keys[i];
+        }
+        if (start == 0 && maxkey - 1 - prev >= numkeys)
+        {
+            start = prev + 1;
+        }
+
+        _hashFree(keys);
+
+        /* 0 if there's no block of numkeys consecutive keys */
+        return start;
     }
 }
+
+/* xxHash64's primes */
+#define HASH64_P1   0x9E3779B185EBCA87ULL
+#define HASH64_P2   0xC2B2AE3D27D4EB4FULL
+#define HASH64_P3   0x165667B19E3779F9ULL
+#define HASH64_P4   0x85EBCA77C2B2AE63ULL
+#define HASH64_P5   0x27D4EB2F165667C5ULL
+
+#define HASH64_ROTL(X,R)    (((X) << (R)) | ((X) >> (64 - (R))))
+
+//unaligned little endian reads, as x86 does them
+static hash64 hash_read64(GLubyte const* p)
+{
+    hash64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static GLuint hash_read32(GLubyte const* p)
+{
+    GLuint v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+//fold 8 bytes into one of the 4 accumulators
+static hash64 hash_round64(hash64 acc, hash64 input)
+{
+    acc += input * HASH64_P2;
+    acc = HASH64_ROTL(acc, 31);
+    return acc * HASH64_P1;
+}
+
+static hash64 hash_merge64(hash64 h, hash64 acc)
+{
+    h ^= hash_round64(0, acc);
+    return h * HASH64_P1 + HASH64_P4;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hashBytes64
+    Description : xxHash64 of a run of bytes.  32 byte stripes go through 4
+                  independent accumulators, so it runs at several bytes a
+                  cycle; the tail & a final avalanche mix in the rest
+    Inputs      : data - the bytes
+                  length - how many
+                  seed - 0, or the hash of what came before
+    Outputs     :
+    Return      : the hash
+----------------------------------------------------------------------------*/
+hash64 hashBytes64(void const* data, GLuint length, hash64 seed)
+{
+    GLubyte const* p = (GLubyte const*)data;
+    GLubyte const* end = p + length;
+    hash64 h;
+
+    if (length >= 32)
+    {
+        GLubyte const* limit = end - 32;
+        hash64 v1 = seed + HASH64_P1 + HASH64_P2;
+        hash64 v2 = seed + HASH64_P2;
+        hash64 v3 = seed;
+        hash64 v4 = seed - HASH64_P1;
+
+        do
+        {
+            v1 = hash_round64(v1, hash_read64(p));
+            v2 = hash_round64(v2, hash_read64(p + 8));
+            v3 = hash_round64(v3, hash_read64(p + 16));
+            v4 = hash_round64(v4, hash_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = HASH64_ROTL(v1, 1) + HASH64_ROTL(v2, 7) +
+            HASH64_ROTL(v3, 12) + HASH64_ROTL(v4, 18);
+        h = hash_merge64(h, v1);
+        h = hash_merge64(h, v2);
+        h = hash_merge64(h, v3);
+        h = hash_merge64(h, v4);
+    }
+    else
+    {
+        h = seed + HASH64_P5;
+    }
+
+    h += length;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= hash_round64(0, hash_read64(p));
+        h = HASH64_ROTL(h, 27) * HASH64_P1 + HASH64_P4;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (hash64)hash_read32(p) * HASH64_P1;
+        h = HASH64_ROTL(h, 23) * HASH64_P2 + HASH64_P3;
+        p += 4;
+    }
+    for (; p < end; p++)
+    {
+        h ^= (hash64)(*p) * HASH64_P5;
+        h = HASH64_ROTL(h, 11) * HASH64_P1;
+    }
+
+    h ^= h >> 33;
+    h *= HASH64_P2;
+    h ^= h >> 29;
+    h *= HASH64_P3;
+    h ^= h >> 32;
+    return h;
+}
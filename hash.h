@@ -8,21 +8,36 @@
 #ifndef _HASH_H
 #define _HASH_H
 
-#define TABLE_SIZE 3001
-
-typedef struct hash_s
+/* open addressing (Robin Hood) over a power of two number of slots.  a
+   slot holds a key and its entry's position in the dense keys / data
+   arrays, which have no holes, so walking every entry is
+   for (i = 0; i < HASH_COUNT(t); i++) HASH_DATA(t, i).
+   removing an entry moves the last one into its place, so don't remove
+   while walking.  key 0 is never stored */
+typedef struct
 {
-    GLuint key;
-    void*  data;
-    struct hash_s* next;
-} hash_t;
+    GLuint key;                 //0 if empty
+    GLuint index;               //into keys / data
+} hash_slot;
 
 typedef struct
 {
-    hash_t* table[TABLE_SIZE];
+    hash_slot* slots;
+    GLuint  mask;               //number of slots - 1
+    GLuint  shift;              //32 - log2(number of slots)
+
+    GLuint* keys;
+    void**  data;
+    GLuint  count;
+    GLuint  capacity;           //of keys / data
+
     GLuint  maxkey;
 } hashtable;
 
+#define HASH_COUNT(T)   ((T)->count)
+#define HASH_KEY(T,I)   ((T)->keys[I])
+#define HASH_DATA(T,I)  ((T)->data[I])
+
 hashtable* hashNewTable(void* (*allocFunc)(GLint),
                         void (*freeFunc)(void*));
 void  hashDeleteTable(hashtable* table);
@@ -31,4 +46,11 @@ void  hashInsert(hashtable* table, GLuint key, void* data);
 void  hashRemove(hashtable* table, GLuint key);
 GLuint hashFindFreeKeyBlock(hashtable* table, GLuint numkeys);
 
+/* 64 bit hash of a run of bytes, xxHash64's.  for content keys (the GL's
+   shared textures), not the table, which wants uints.  seed chains calls:
+   hashBytes64(b, nb, hashBytes64(a, na, 0)) keys a then b */
+typedef unsigned long long hash64;
+
+hash64 hashBytes64(void const* data, GLuint length, hash64 seed);
+
 #endif
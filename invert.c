@@ -210,3 +210,48 @@ void invert_matrix(GLfloat const* m, GLfloat* out)
 #undef m44
 #undef MAT
 }
+
+/*
+ * invert m given its classification (MATRIX_*, as gl_classify_modelview
+ * sets).  only MATRIX_GENERAL needs the full 4x4 inverse, affine matrices
+ * go through the cofactors of the 3x3 and a scale & translate is done
+ * directly.  singular matrices invert to the identity, as above
+ */
+void invert_matrix_type(GLfloat const* m, GLint type, GLfloat* out)
+{
+    switch (type)
+    {
+    case MATRIX_IDENTITY:
+        MEMCPY(out, IdentityMatrix, 16*sizeof(GLfloat));
+        break;
+
+    case MATRIX_2D_NO_ROT:
+        if (m[M00] == 0.0f || m[M11] == 0.0f)
+        {
+            MEMCPY(out, IdentityMatrix, 16*sizeof(GLfloat));
+        }
+        else
+        {
+            /* allow out == in */
+            GLfloat sx = 1.0f / m[M00];
+            GLfloat sy = 1.0f / m[M11];
+            GLfloat tx = -m[M03] * sx;
+            GLfloat ty = -m[M13] * sy;
+
+            MEMCPY(out, IdentityMatrix, 16*sizeof(GLfloat));
+            out[M00] = sx;
+            out[M11] = sy;
+            out[M03] = tx;
+            out[M13] = ty;
+        }
+        break;
+
+    case MATRIX_GENERAL:
+        invert_matrix_general(m, out);
+        break;
+
+    default:
+        /* MATRIX_2D, MATRIX_3D: bottom row is 0 0 0 1 */
+        invert_matrix(m, out);
+    }
+}
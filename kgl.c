@@ -6,7 +6,9 @@
     Copyright Relic Entertainment, Inc.  All rights reserved.
 =============================================================================*/
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,6 +19,10 @@
 #include "maths.h"
 #include "clip.h"
 #include "asm.h"
+#include "simd.h"
+#include "pixconv.h"
+#include "nulldrv.h"
+#include "trace.h"
 
 #define CALL_VERTEX(x,y,z) CC->DriverFuncs.vertex(x,y,z)
 
@@ -39,6 +45,9 @@ static char DEFAULT_RENDERER[8];
 //poly stat variables
 GLuint g_NumPolys = 0;
 GLuint g_CulledPolys = 0;
+GLuint g_MaterialSwitches = 0;
+GLuint g_ModelViewInverses = 0;
+GLuint g_ClippedPolys = 0;
 
 //useful to determine if we're already shut down
 static GLboolean gl_is_shutdown = GL_FALSE;
@@ -46,6 +55,26 @@ static GLboolean gl_is_shutdown = GL_FALSE;
 //a screenshot'll go here
 static GLubyte* sbuf = NULL;
 
+//pix_mipmap's scratch, kept between uploads
+static pix_arena mipScratch;
+
+//RGB texels widened for a tex_img when the GL isn't keeping them
+static pix_arena texScratch;
+
+//bytes of texture images & mip chains the GL holds, see rglRetainedTextureBytes
+static GLuint texRetainedBytes = 0;
+
+//RGL_TEXTURE_SHARE's images, by Key folded to a uint (gl_share_slot)
+static hashtable* _texshares = NULL;
+
+//gl_texture_share_key's seed for a share's Check, any value but 0
+#define TEXSHARE_CHECK_SEED 0x9E3779B97F4A7C15ULL
+
+//RGL_TEXTURE_SHARE counts, see rglSharedTextureLookups &c
+static GLuint texShareLookups = 0;
+static GLuint texShareHits = 0;
+static GLuint texShareBytes = 0;
+
 //GL_TRUE if the context has been initialized, &c
 static GLboolean gl_have_initialized = GL_FALSE;
 
@@ -60,11 +89,6 @@ char* deviceToSelect = NULL;
 static MemAllocFunc gAllocFunc = NULL;
 static MemFreeFunc  gFreeFunc  = NULL;
 
-//screen y lookup table
-GLint scrMult[MAX_HEIGHT];
-GLint zMult[MAX_HEIGHT];
-GLint scrMultByte[MAX_HEIGHT];
-
 //GetString(..) strings
 #if NO_PALETTES || !SHARED_PALETTES
 GLubyte STR_EXTENSIONS[] = "xxxxxxxx GL_RGL_rgl_feature GL_EXT_rescale_normal GL_EXT_paletted_texture GL_RGL_lit_texture_palette";
@@ -151,14 +175,14 @@ DLL GLboolean rglGetFullscreen(void) { return IsFullscreen; }
 DLL GLboolean rglGetTruecolor(void) { return IsTruecolor; }
 DLL GLboolean rglGetSlow(void) { return IsSlow; }
 
-DLL void rglSetRendererString(char* s)
+DLL void rglSetRendererString(const char* s)
 {
     STR_RENDERER[0] = s[0];
     STR_RENDERER[1] = s[1];
     STR_RENDERER[2] = s[2];
 }
 
-DLL void rglSetExtensionString(char* s)
+DLL void rglSetExtensionString(const char* s)
 {
     GLint i;
 
@@ -357,9 +381,10 @@ GLboolean gl_load_devices()
 
 //    if (!gl_parse_devices())
     {
-        nDevices = 2;//3;
+        nDevices = 3;
         gl_new_device(&devices[0], "sw", "software_kgl", GL_FALSE, GL_FALSE, GL_TRUE);
         gl_new_device(&devices[1], "d3d", "d3d_direct3d_directaxe_ms", GL_TRUE, GL_TRUE, GL_FALSE);
+        gl_new_device(&devices[2], NULL_DEVICE_NAME, "null_headless_none", GL_TRUE, GL_TRUE, GL_FALSE);
 //        gl_new_device(&devices[2], "fx", "glide_glide2_glide2x_3dfx_accel", GL_TRUE, GL_TRUE, GL_FALSE);
         strcpy(DEFAULT_RENDERER, "sw");
     }
@@ -411,11 +436,11 @@ GLboolean gl_select_device(GLint index)
     if (index >= 0 && index < nDevices)
     {
         activeDevice = index;
-        return TRUE;
+        return GL_TRUE;
     }
     else
     {
-        return FALSE;
+        return GL_FALSE;
     }
 }
 
@@ -575,6 +600,11 @@ static void gl_Vertex3f_cnt(GLfloat x, GLfloat y, GLfloat z)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = x;
     VB->Obj[count][1] = y;
     VB->Obj[count][2] = z;
@@ -603,6 +633,11 @@ static void gl_Vertex3f_cn(GLfloat x, GLfloat y, GLfloat z)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = x;
     VB->Obj[count][1] = y;
     VB->Obj[count][2] = z;
@@ -628,6 +663,11 @@ static void gl_Vertex3f_ct(GLfloat x, GLfloat y, GLfloat z)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = x;
     VB->Obj[count][1] = y;
     VB->Obj[count][2] = z;
@@ -652,6 +692,11 @@ static void gl_Vertex3f_c(GLfloat x, GLfloat y, GLfloat z)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = x;
     VB->Obj[count][1] = y;
     VB->Obj[count][2] = z;
@@ -673,6 +718,11 @@ static void gl_Vertex3fv_cnt(GLfloat const* v)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = v[0];
     VB->Obj[count][1] = v[1];
     VB->Obj[count][2] = v[2];
@@ -701,6 +751,11 @@ static void gl_Vertex3fv_cn(GLfloat const* v)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = v[0];
     VB->Obj[count][1] = v[1];
     VB->Obj[count][2] = v[2];
@@ -726,6 +781,11 @@ static void gl_Vertex3fv_ct(GLfloat const* v)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = v[0];
     VB->Obj[count][1] = v[1];
     VB->Obj[count][2] = v[2];
@@ -750,6 +810,11 @@ static void gl_Vertex3fv_c(GLfloat const* v)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = v[0];
     VB->Obj[count][1] = v[1];
     VB->Obj[count][2] = v[2];
@@ -771,6 +836,11 @@ static void gl_Vertex4fv_cnt(GLfloat const* v)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Clip[count][0] = v[0];
     VB->Clip[count][1] = v[1];
     VB->Clip[count][2] = v[2];
@@ -799,6 +869,11 @@ static void gl_Vertex4fv_cn(GLfloat const* v)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Clip[count][0] = v[0];
     VB->Clip[count][1] = v[1];
     VB->Clip[count][2] = v[2];
@@ -824,6 +899,11 @@ static void gl_Vertex4fv_ct(GLfloat const* v)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Clip[count][0] = v[0];
     VB->Clip[count][1] = v[1];
     VB->Clip[count][2] = v[2];
@@ -848,6 +928,11 @@ static void gl_Vertex4fv_c(GLfloat const* v)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Clip[count][0] = v[0];
     VB->Clip[count][1] = v[1];
     VB->Clip[count][2] = v[2];
@@ -923,6 +1008,58 @@ void gl_update_raster(GLcontext* ctx)
     }
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : gl_update_light_block
+    Description : flatten the active lights into ctx->LightBlock.  both
+                  sides' material products are filled whether or not
+                  lighting is two sided
+    Inputs      : ctx - the context, with ActiveLight and VP_inf_norm current
+    Outputs     : ctx->LightBlock is filled
+    Return      :
+----------------------------------------------------------------------------*/
+static void gl_update_light_block(GLcontext* ctx)
+{
+    gl_light_block* lb = &ctx->LightBlock;
+    gl_light* light;
+    GLint side, c;
+    GLuint l;
+
+    l = 0;
+    for (light = ctx->ActiveLight; light != NULL; light = light->next, l++)
+    {
+        lb->Positional[l] = (GLboolean)(light->Position[3] != 0.0f);
+        if (lb->Positional[l])
+        {
+            lb->Px[l] = light->Position[0];
+            lb->Py[l] = light->Position[1];
+            lb->Pz[l] = light->Position[2];
+        }
+        else
+        {
+            lb->Px[l] = light->VP_inf_norm[0];
+            lb->Py[l] = light->VP_inf_norm[1];
+            lb->Pz[l] = light->VP_inf_norm[2];
+        }
+        lb->Dx[l] = light->VP_inf_norm[0];
+        lb->Dy[l] = light->VP_inf_norm[1];
+        lb->Dz[l] = light->VP_inf_norm[2];
+        lb->K0[l] = light->ConstantAttenuation;
+        lb->K1[l] = light->LinearAttenuation;
+        lb->K2[l] = light->QuadraticAttenuation;
+
+        for (side = 0; side < 2; side++)
+        {
+            gl_material* mat = &ctx->Material[side];
+            for (c = 0; c < 3; c++)
+            {
+                lb->Ambient[side][c][l] = mat->Ambient[c] * light->Ambient[c];
+                lb->Diffuse[side][c][l] = light->Diffuse[c] * mat->Diffuse[c];
+            }
+        }
+    }
+    lb->Count = l;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : gl_update_lighting
     Description : updates lighting state, precomputes useful stuff
@@ -1011,6 +1148,8 @@ void gl_update_lighting(GLcontext* ctx)
         }
     }
 
+    gl_update_light_block(ctx);
+
     for (i = 0; i < 4; i++)
     {
         ctx->BaseColor[0][i] *= 255.0f;
@@ -1040,6 +1179,8 @@ DLL void API glFrustum(GLdouble left, GLdouble right,
     GLfloat m[16];
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op_doubles(TRACE_Frustum, 6, left, right, bottom, top, zNear, zFar);
+
     if (zNear <= 0.0 || zFar <= 0.0)
     {
         gl_error(ctx, GL_INVALID_VALUE, "glFrustum(near or far)");
@@ -1059,7 +1200,9 @@ DLL void API glFrustum(GLdouble left, GLdouble right,
     M(3,0) = 0.0f; M(3,1) = 0.0f; M(3,2) = -1.0f; M(3,3) = 0.0f;
 #undef M
 
+    trace_suspend();
     glMultMatrixf(m);
+    trace_resume();
 }
 
 /*-----------------------------------------------------------------------------
@@ -1124,6 +1267,8 @@ DLL void gl_problem(GLcontext* ctx, char* s)
 ----------------------------------------------------------------------------*/
 DLL void API glMatrixMode(GLenum mode)
 {
+    if (TRACING) trace_op(TRACE_MatrixMode, 1, mode);
+
     switch (mode)
     {
     case GL_MODELVIEW:
@@ -1137,16 +1282,19 @@ DLL void API glMatrixMode(GLenum mode)
 
 /*-----------------------------------------------------------------------------
     Name        : glPushMatrix
-    Description : push a matrix onto the stack.  MODELVIEW, PROJECTION states only
+    Description : push a matrix onto the stack.  MODELVIEW, PROJECTION states only.
+                  the modelview's inverse goes along with it if it's current
     Inputs      :
     Outputs     :
     Return      :
-    State       : NEW_MODELVIEW, NEW_MODELVIEWINV, NEW_PROJECTION
+    State       : NEW_MODELVIEW, NEW_PROJECTION
 ----------------------------------------------------------------------------*/
 DLL void API glPushMatrix()
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_PushMatrix, 0);
+
     switch (ctx->MatrixMode)
     {
     case GL_MODELVIEW:
@@ -1156,8 +1304,18 @@ DLL void API glPushMatrix()
             return;
         }
         MAT4_COPY(ctx->ModelViewStack[ctx->ModelViewStackDepth], ctx->ModelViewMatrix);
+        if (ctx->NewMask & NEW_MODELVIEWINV)
+        {
+            ctx->ModelViewInvStackValid[ctx->ModelViewStackDepth] = GL_FALSE;
+        }
+        else
+        {
+            MAT4_COPY(ctx->ModelViewInvStack[ctx->ModelViewStackDepth], ctx->ModelViewInv);
+            ctx->ModelViewInvStackValid[ctx->ModelViewStackDepth] = GL_TRUE;
+        }
         ctx->ModelViewStackDepth++;
-        ctx->NewMask |= NEW_MODELVIEW | NEW_MODELVIEWINV;
+        //the matrix itself is unchanged, so is its inverse
+        ctx->NewMask |= NEW_MODELVIEW;
         break;
     case GL_PROJECTION:
         if (ctx->ProjectionStackDepth >= MAX_PROJECTION_STACK_DEPTH)
@@ -1179,7 +1337,8 @@ DLL void API glPushMatrix()
 
 /*-----------------------------------------------------------------------------
     Name        : glPopMatrix
-    Description : pop a matrix from the stack.  MODELVIEW, PROJECTION states only
+    Description : pop a matrix from the stack.  MODELVIEW, PROJECTION states only.
+                  the modelview's inverse is restored if it was saved at the push
     Inputs      :
     Outputs     :
     Return      :
@@ -1189,6 +1348,8 @@ DLL void API glPopMatrix()
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_PopMatrix, 0);
+
     switch (ctx->MatrixMode)
     {
     case GL_MODELVIEW:
@@ -1199,7 +1360,16 @@ DLL void API glPopMatrix()
         }
         ctx->ModelViewStackDepth--;
         MAT4_COPY(ctx->ModelViewMatrix, ctx->ModelViewStack[ctx->ModelViewStackDepth]);
-        ctx->NewMask |= NEW_MODELVIEW | NEW_MODELVIEWINV;
+        if (ctx->ModelViewInvStackValid[ctx->ModelViewStackDepth])
+        {
+            MAT4_COPY(ctx->ModelViewInv, ctx->ModelViewInvStack[ctx->ModelViewStackDepth]);
+            ctx->NewMask &= ~(NEW_MODELVIEWINV);
+            ctx->NewMask |= NEW_MODELVIEW;
+        }
+        else
+        {
+            ctx->NewMask |= NEW_MODELVIEW | NEW_MODELVIEWINV;
+        }
         break;
     case GL_PROJECTION:
         if (ctx->ProjectionStackDepth == 0)
@@ -1231,6 +1401,8 @@ DLL void API glPushAttrib(GLenum attrib)
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_PushAttrib, 1, attrib);
+
     if (ctx->AttribStackDepth >= MAX_ATTRIB_STACK_DEPTH - 1)
     {
         gl_error(ctx, GL_STACK_OVERFLOW, "glPushAttrib overflow");
@@ -1268,6 +1440,8 @@ DLL void API glPopAttrib()
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_PopAttrib, 0);
+
     if (ctx->AttribStackDepth == 0)
     {
         gl_error(ctx, GL_STACK_UNDERFLOW, "glPopAttrib");
@@ -1293,18 +1467,24 @@ DLL void API glPopAttrib()
     Name        : glLoadIdentity
     Description : load an identity matrix
     Inputs      :
-    Outputs     : an identity matrix is loaded as current MODELVIEW or PROJECTION
+    Outputs     : an identity matrix is loaded as current MODELVIEW (and its
+                  inverse) or PROJECTION
     Return      :
-    State       : NEW_MODELVIEW, NEW_MODELVIEWINV, NEW_PROJECTION
+    State       : NEW_MODELVIEW, NEW_PROJECTION
 ----------------------------------------------------------------------------*/
 DLL void API glLoadIdentity()
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_LoadIdentity, 0);
+
     switch (ctx->MatrixMode)
     {
     case GL_MODELVIEW:
         MAT4_COPY(ctx->ModelViewMatrix, Identity);
-        ctx->NewMask |= NEW_MODELVIEW | NEW_MODELVIEWINV;
+        MAT4_COPY(ctx->ModelViewInv, Identity);
+        ctx->NewMask &= ~(NEW_MODELVIEWINV);
+        ctx->NewMask |= NEW_MODELVIEW;
         break;
     case GL_PROJECTION:
         MAT4_COPY(ctx->ProjectionMatrix, Identity);
@@ -1328,6 +1508,8 @@ DLL void API glScalef(GLfloat x, GLfloat y, GLfloat z)
     GLcontext* ctx = CC;
     GLfloat* m;
 
+    if (TRACING) trace_op(TRACE_Scalef, 3, trace_float(x), trace_float(y), trace_float(z));
+
     switch (ctx->MatrixMode)
     {
     case GL_MODELVIEW:
@@ -1359,6 +1541,13 @@ DLL void API glScalef(GLfloat x, GLfloat y, GLfloat z)
 DLL void API glLoadMatrixf(GLfloat const* m)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING)
+    {
+        trace_record(TRACE_LoadMatrixf, 16);
+        trace_words(16, (GLuint const*)m);
+    }
+
     switch (ctx->MatrixMode)
     {
     case GL_MODELVIEW:
@@ -1436,6 +1625,13 @@ DLL void API glMultMatrixd(GLdouble const* m)
 DLL void API glMultMatrixf(GLfloat const* m)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING)
+    {
+        trace_record(TRACE_MultMatrixf, 16);
+        trace_words(16, (GLuint const*)m);
+    }
+
     switch (ctx->MatrixMode)
     {
     case GL_MODELVIEW:
@@ -1464,9 +1660,14 @@ DLL void API glRotatef(GLfloat angle, GLfloat x, GLfloat y, GLfloat z)
 {
     GLfloat m[16];
     GLfloat axis[3];
+
+    if (TRACING) trace_op(TRACE_Rotatef, 4, trace_float(angle), trace_float(x), trace_float(y), trace_float(z));
+
     V3_SET(axis, x,y,z);
     mat4_rotation(m, axis, angle);
+    trace_suspend();
     glMultMatrixf(m);
+    trace_resume();
 }
 
 /*-----------------------------------------------------------------------------
@@ -1482,6 +1683,8 @@ DLL void API glTranslatef(GLfloat x, GLfloat y, GLfloat z)
     GLcontext* ctx = CC;
     GLfloat* m;
 
+    if (TRACING) trace_op(TRACE_Translatef, 3, trace_float(x), trace_float(y), trace_float(z));
+
     switch (ctx->MatrixMode)
     {
     case GL_MODELVIEW:
@@ -1515,6 +1718,64 @@ DLL void API glTranslated(GLdouble x, GLdouble y, GLdouble z)
     glTranslatef((GLfloat)x, (GLfloat)y, (GLfloat)z);
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : update_guard_band
+    Description : cuts the guard band rglGuardBand asked for down to what
+                  keeps the viewport's band inside the driver's, so nothing
+                  reaches the rasterizer outside the coordinates it takes
+    Inputs      : ctx - the context
+    Outputs     : ctx->GuardBand is set, 1 if the driver has no guard band
+    Return      :
+----------------------------------------------------------------------------*/
+static void update_guard_band(GLcontext* ctx)
+{
+    GLfloat size = ctx->GuardBandSize;
+    GLfloat right = (GLfloat)ctx->Buffer.Width;
+    GLfloat top = (GLfloat)ctx->Buffer.Height;
+    GLfloat gx, gy;
+
+    if (size > 1.0f)
+    {
+        //x = Tx +- size * Sx in [-GuardBandX, right + GuardBandX], y likewise
+        gx = MIN2(ctx->Viewport.Tx + ctx->GuardBandX,
+                 right + ctx->GuardBandX - ctx->Viewport.Tx) / ctx->Viewport.Sx;
+        gy = MIN2(ctx->Viewport.Ty + ctx->GuardBandY,
+                 top + ctx->GuardBandY - ctx->Viewport.Ty) / ctx->Viewport.Sy;
+        size = MIN2(size, MIN2(gx, gy));
+        if (!(size > 1.0f))
+        {
+            size = 1.0f;
+        }
+    }
+    ctx->GuardBand = size;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_driver_guard_band
+    Description : a driver's report of its rasterizer's guard band, the
+                  extents it takes screen coordinates in, from its device
+                  caps.  called from the driver's init, after which
+                  rglGuardBand is limited to it; a driver that never calls
+                  this gets no guard band
+    Inputs      : ctx - the context
+                  left, top, right, bottom - the extents in device pixels,
+                  (0, 0) the top left of the buffer.  all 0 for none
+    Outputs     : ctx->GuardBandX, ctx->GuardBandY, ctx->GuardBand
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void gl_driver_guard_band(GLcontext* ctx, GLfloat left, GLfloat top,
+                              GLfloat right, GLfloat bottom)
+{
+    //the smaller margin either side, as the driver may flip y
+    ctx->GuardBandX = MIN2(-left, right - (GLfloat)ctx->Buffer.Width);
+    ctx->GuardBandY = MIN2(-top, bottom - (GLfloat)ctx->Buffer.Height);
+    if (ctx->GuardBandX < 0.0f || ctx->GuardBandY < 0.0f)
+    {
+        ctx->GuardBandX = ctx->GuardBandY = 0.0f;
+    }
+    update_guard_band(ctx);
+}
+
 /*-----------------------------------------------------------------------------
     Name        : glViewport
     Description : sets up the viewport transformation (clip -> 2D)
@@ -1526,6 +1787,8 @@ DLL void API glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_Viewport, 4, x, y, width, height);
+
     if (width < 0 || height < 0)
     {
         gl_error(ctx, GL_INVALID_VALUE, "glViewport");
@@ -1547,6 +1810,8 @@ DLL void API glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
     ctx->Viewport.Tx = ctx->Viewport.Sx + x;
     ctx->Viewport.Sy = (GLfloat)height / 2.0f;
     ctx->Viewport.Ty = ctx->Viewport.Sy + y;
+
+    update_guard_band(ctx);
 }
 
 /*-----------------------------------------------------------------------------
@@ -1560,6 +1825,8 @@ DLL void API glCullFace(GLenum mode)
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_CullFace, 1, mode);
+
     if (mode != GL_FRONT && mode != GL_BACK && mode != GL_FRONT_AND_BACK)
     {
         gl_error(ctx, GL_INVALID_ENUM, "glCullFace");
@@ -1580,6 +1847,9 @@ DLL void API glCullFace(GLenum mode)
 DLL void API glShadeModel(GLenum mode)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_ShadeModel, 1, mode);
+
     if (ctx->ShadeModel == mode)
     {
         return;
@@ -1690,6 +1960,8 @@ DLL void API glMaterialfv(GLenum face, GLenum pname, GLfloat const* params)
     GLcontext* ctx = CC;
     GLuint bitmask;
 
+    if (TRACING) trace_op_fv(TRACE_Materialfv, face, pname, params);
+
     switch (face)
     {
     case GL_FRONT:
@@ -1730,6 +2002,8 @@ DLL void API glDepthFunc(GLenum func)
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_DepthFunc, 1, func);
+
     if (ctx->DepthFunc == func)
     {
         //avoid redundant state setting
@@ -1762,6 +2036,8 @@ DLL void API glBlendFunc(GLenum sfactor, GLenum dfactor)
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_BlendFunc, 2, sfactor, dfactor);
+
     if (ctx->BlendSrc == sfactor && ctx->BlendDst == dfactor)
     {
         //avoid redundant state setting
@@ -1786,6 +2062,9 @@ DLL void API glBlendFunc(GLenum sfactor, GLenum dfactor)
 DLL void API glAlphaFunc(GLenum func, GLclampf ref)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_AlphaFunc, 2, func, trace_float(ref));
+
     if ((ctx->AlphaFunc == func) &&
         (ctx->AlphaByteRef == FAST_TO_INT(ref*255.0f)))
     {
@@ -1931,6 +2210,8 @@ DLL void gl_Enable(GLenum cap, GLboolean state)
 ----------------------------------------------------------------------------*/
 DLL void API glEnable(GLenum cap)
 {
+    if (TRACING) trace_op(TRACE_Enable, 1, cap);
+
     gl_Enable(cap, GL_TRUE);
 }
 
@@ -1943,6 +2224,8 @@ DLL void API glEnable(GLenum cap)
 ----------------------------------------------------------------------------*/
 DLL void API glDisable(GLenum cap)
 {
+    if (TRACING) trace_op(TRACE_Disable, 1, cap);
+
     gl_Enable(cap, GL_FALSE);
 }
 
@@ -2024,6 +2307,8 @@ DLL void API glLightfv(GLenum light, GLenum pname, GLfloat const* params)
     GLcontext* ctx = CC;
     GLint l;
 
+    if (TRACING) trace_op_fv(TRACE_Lightfv, light, pname, params);
+
     l = (GLint)(light - GL_LIGHT0);
     if (l < 0 || l >= MAX_LIGHTS)
     {
@@ -2081,6 +2366,9 @@ void gl_clear_colorbuffer()
 DLL void API glClearDepth(GLdouble d)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op_doubles(TRACE_ClearDepth, 1, d);
+
     ctx->DepthClear = (GLfloat)d;
 }
 
@@ -2113,6 +2401,9 @@ void gl_clear_depthbuffer()
 DLL void API glClear(GLbitfield mask)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Clear, 1, mask);
+
     if ((mask & GL_COLOR_BUFFER_BIT) &&
         (mask & GL_DEPTH_BUFFER_BIT))
     {
@@ -2144,6 +2435,8 @@ DLL void API glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_ClearColor, 4, trace_float(red), trace_float(green), trace_float(blue), trace_float(alpha));
+
     ctx->ClearColor[0] = CLAMP(red,   0.0f, 1.0f);
     ctx->ClearColor[1] = CLAMP(green, 0.0f, 1.0f);
     ctx->ClearColor[2] = CLAMP(blue,  0.0f, 1.0f);
@@ -2233,6 +2526,8 @@ DLL void API glDepthRange(GLclampd nearval, GLclampd farval)
     GLcontext* ctx = CC;
     GLfloat n, f;
 
+    if (TRACING) trace_op_doubles(TRACE_DepthRange, 2, nearval, farval);
+
     n = (GLfloat)CLAMP(nearval, 0.0, 1.0);
     f = (GLfloat)CLAMP(farval, 0.0, 1.0);
 
@@ -2431,6 +2726,11 @@ void gl_init_texobj(GLuint n, gl_texture_object* texobj)
     texobj->created = GL_FALSE;
     texobj->DriverData = NULL;
     texobj->Palette = NULL;
+    texobj->MipLevels = 0;
+    texobj->Mips = NULL;
+    texobj->DataBytes = 0;
+    texobj->Share = NULL;
+    texobj->ShareNext = NULL;
 }
 
 /*-----------------------------------------------------------------------------
@@ -2464,6 +2764,12 @@ void gl_init_context(GLcontext* MYctx,
     CC->Speedy = GL_FALSE;
 
     CC->RasterizeOnly = GL_FALSE;
+    CC->IndexedTriangles = GL_TRUE;
+    CC->MeshPretransform = GL_TRUE;
+    CC->MeshSortMaterials = GL_FALSE;
+    CC->Mipmaps = GL_FALSE;
+    CC->TexRetain = GL_TRUE;
+    CC->TexShare = GL_FALSE;
 
     {
         GLuint cputype;
@@ -2475,6 +2781,8 @@ void gl_init_context(GLcontext* MYctx,
         CC->CpuType = cputype;
         CC->CpuMMX = cpummx;
         CC->CpuKatmai = cpukatmai;
+        CC->CpuSSE2 = get_cpusse2();
+        CC->CpuAVX2 = get_cpuavx2();
     }
 
     if (CC->CpuKatmai)
@@ -2499,14 +2807,13 @@ void gl_init_context(GLcontext* MYctx,
     {
         CC->SpecularExponent[i] = CC->SpecularDefault[i];
     }
+    CC->SpecularPow = RGL_SPECPOW_TABLE;
+    CC->GuardBand = 1.0f;
+    CC->GuardBandSize = 1.0f;
 
     CC->AllocFunc = gl_Allocate;
     CC->FreeFunc  = gl_Free;
 
-    CC->scrMult = scrMult;
-    CC->zMult = zMult;
-    CC->scrMultByte = scrMultByte;
-
     CC->ClipMask = CLIP_FCOLOR_BIT;
     CC->NewMask  = NEW_ALL;
 
@@ -2519,6 +2826,7 @@ void gl_init_context(GLcontext* MYctx,
     for (i = 0; i < MAX_MODELVIEW_STACK_DEPTH; i++)
     {
         MAT4_COPY(CC->ModelViewStack[i], Identity);
+        CC->ModelViewInvStackValid[i] = GL_FALSE;
     }
     CC->ModelViewStackDepth = 0;
     CC->ModelViewMatrixType = MATRIX_IDENTITY;
@@ -2531,6 +2839,9 @@ void gl_init_context(GLcontext* MYctx,
     CC->ProjectionStackDepth = 0;
     CC->ProjectionMatrixType = MATRIX_IDENTITY;
 
+    MAT4_COPY(CC->ModelViewProjectionMatrix, Identity);
+    CC->ModelViewProjectionMatrixType = MATRIX_IDENTITY;
+
     CC->MatrixMode = GL_MODELVIEW;
 
     for (i = 0; i < MAX_ATTRIB_STACK_DEPTH; i++)
@@ -2645,9 +2956,97 @@ void gl_init_context(GLcontext* MYctx,
     CC->LinesEnabled = GL_TRUE;
 }
 
+static GLuint _vbgrowths = 0;
+
+#define VB_ALIGN_UP(n) (((n) + (VB_ALIGN - 1)) & ~(size_t)(VB_ALIGN - 1))
+
+/*-----------------------------------------------------------------------------
+    Name        : vb_realloc
+    Description : (re)allocates a vertex buffer's arrays for a new capacity.
+                  the arrays are carved from one block, each starting on a
+                  VB_ALIGN boundary.  vertices 0..Count-1 are kept
+    Inputs      : vb - the vertex buffer
+                  max - the new capacity, >= vb->Count
+    Outputs     : vb's arrays, Max and Size are updated
+    Return      : GL_FALSE if out of memory, leaving vb as it was
+----------------------------------------------------------------------------*/
+static GLboolean vb_realloc(vertex_buffer* vb, GLuint max)
+{
+    GLuint size = max + VB_CLIP_VERTS;
+    GLuint count = vb->Count;
+    GLboolean back = (GLboolean)(vb->Block != NULL && vb->Color == vb->Bcolor);
+    size_t offset[12];
+    size_t bytes;
+    GLubyte* block;
+    GLubyte* base;
+    GLuint i;
+
+    //Obj, Eye, Clip, Win, Normal, Fcolor, Bcolor, TexCoord, ClipMask, VList, VList2, Elts
+    bytes = 0;
+    offset[0] = bytes; bytes += VB_ALIGN_UP(size * 4*sizeof(GLfloat));
+    offset[1] = bytes; bytes += VB_ALIGN_UP(size * 4*sizeof(GLfloat));
+    offset[2] = bytes; bytes += VB_ALIGN_UP(size * 4*sizeof(GLfloat));
+    offset[3] = bytes; bytes += VB_ALIGN_UP(size * 3*sizeof(GLfloat));
+    offset[4] = bytes; bytes += VB_ALIGN_UP(size * 3*sizeof(GLfloat));
+    offset[5] = bytes; bytes += VB_ALIGN_UP(size * 4*sizeof(GLubyte));
+    offset[6] = bytes; bytes += VB_ALIGN_UP(size * 4*sizeof(GLubyte));
+    offset[7] = bytes; bytes += VB_ALIGN_UP(size * 2*sizeof(GLfloat));
+    offset[8] = bytes; bytes += VB_ALIGN_UP(size * sizeof(GLubyte));
+    offset[9] = bytes; bytes += VB_ALIGN_UP(size * sizeof(GLuint));
+    offset[10] = bytes; bytes += VB_ALIGN_UP(size * sizeof(GLuint));
+    offset[11] = bytes; bytes += VB_ALIGN_UP(3*size * sizeof(GLuint));
+
+    block = (GLubyte*)gl_Allocate((GLint)(bytes + VB_ALIGN));
+    if (block == NULL)
+    {
+        return GL_FALSE;
+    }
+    base = (GLubyte*)VB_ALIGN_UP((size_t)block);
+
+    if (vb->Block != NULL && count != 0)
+    {
+        MEMCPY(base + offset[0], vb->Obj, count * 4*sizeof(GLfloat));
+        MEMCPY(base + offset[2], vb->Clip, count * 4*sizeof(GLfloat));
+        MEMCPY(base + offset[4], vb->Normal, count * 3*sizeof(GLfloat));
+        MEMCPY(base + offset[5], vb->Fcolor, count * 4*sizeof(GLubyte));
+        MEMCPY(base + offset[6], vb->Bcolor, count * 4*sizeof(GLubyte));
+        MEMCPY(base + offset[7], vb->TexCoord, count * 2*sizeof(GLfloat));
+        MEMCPY(base + offset[8], vb->ClipMask, count * sizeof(GLubyte));
+    }
+    if (vb->Block != NULL)
+    {
+        gl_Free(vb->Block);
+    }
+
+    vb->Block    = block;
+    vb->Obj      = (GLfloat(*)[4])(base + offset[0]);
+    vb->Eye      = (GLfloat(*)[4])(base + offset[1]);
+    vb->Clip     = (GLfloat(*)[4])(base + offset[2]);
+    vb->Win      = (GLfloat(*)[3])(base + offset[3]);
+    vb->Normal   = (GLfloat(*)[3])(base + offset[4]);
+    vb->Fcolor   = (GLubyte(*)[4])(base + offset[5]);
+    vb->Bcolor   = (GLubyte(*)[4])(base + offset[6]);
+    vb->TexCoord = (GLfloat(*)[2])(base + offset[7]);
+    vb->ClipMask = (GLubyte*)(base + offset[8]);
+    vb->VList    = (GLuint*)(base + offset[9]);
+    vb->VList2   = (GLuint*)(base + offset[10]);
+    vb->Elts     = (GLuint*)(base + offset[11]);
+    vb->Color    = back ? vb->Bcolor : vb->Fcolor;
+
+    for (i = count; i < size; i++)
+    {
+        vb->ClipMask[i] = 0;
+        vb->Obj[i][3] = 1.0f;
+    }
+
+    vb->Max = max;
+    vb->Size = size;
+    return GL_TRUE;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : gl_alloc_vb
-    Description : allocates a new vertex buffer
+    Description : allocates a new vertex buffer, with room for VB_MAX vertices
     Inputs      :
     Outputs     :
     Return      : the newly allocated vertex buffer
@@ -2658,105 +3057,254 @@ vertex_buffer* gl_alloc_vb()
     vb = (vertex_buffer*)gl_Allocate(sizeof(vertex_buffer));
     if (vb)
     {
-            GLuint i;
-            for (i = 0; i < VB_SIZE; i++)
+        MEMSET(vb, 0, sizeof(vertex_buffer));
+        if (!vb_realloc(vb, VB_MAX))
         {
-                vb->ClipMask[i] = 0;
-                vb->Obj[i][3] = 1.0f;
-            }
-            vb->ClipOrMask = 0;
-            vb->ClipAndMask = CLIP_ALL_BITS;
+            gl_Free(vb);
+            return NULL;
+        }
+        vb->ClipOrMask = 0;
+        vb->ClipAndMask = CLIP_ALL_BITS;
+        vb->Indices = NULL;
+        vb->IndexCount = 0;
     }
     return vb;
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : glFlush
-    Description : flush render buffers.  possibly take a screenshot, too
-    Inputs      :
-    Outputs     : maybe a screenshot is saved, buffer swap occurs
+    Name        : gl_free_vb
+    Description : frees a vertex buffer and its arrays
+    Inputs      : vb - the vertex buffer, or NULL
+    Outputs     :
     Return      :
 ----------------------------------------------------------------------------*/
-DLL void API glFlush()
+void gl_free_vb(vertex_buffer* vb)
 {
-    GLcontext* ctx = CC;
-    GLubyte* framebuf;
-
-    g_NumPolys = 0;
-    g_CulledPolys = 0;
-    gl_frames++;
-
-    if (ctx->DriverFuncs.flush != NULL)
-    {
-        ctx->DriverFuncs.flush();
-    }
-    else
+    if (vb != NULL)
     {
-        gl_problem(ctx, "glFlush(DR.flush)");
+        if (vb->Block != NULL)
+        {
+            gl_Free(vb->Block);
+        }
+        gl_Free(vb);
     }
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : glGetFrameCountEXT
-    Description : returns the frame counter
-    Inputs      :
-    Outputs     :
-    Return      : frame counter
+    Name        : gl_grow_vb
+    Description : make room in the VB for at least n vertices, so a whole
+                  primitive / mesh can go through the pipeline in one pass.
+                  the capacity doubles each time, to keep reallocation rare.
+                  never call while the VB is being transformed or rendered,
+                  the arrays move
+    Inputs      : ctx - the context
+                  n - vertices needed
+    Outputs     : the VB may be reallocated
+    Return      : GL_FALSE if out of memory (GL_OUT_OF_MEMORY is raised)
 ----------------------------------------------------------------------------*/
-DLL GLuint glGetFrameCountEXT(void)
+GLboolean gl_grow_vb(GLcontext* ctx, GLuint n)
 {
-    return gl_frames;
+    vertex_buffer* VB = ctx->VB;
+    GLuint max;
+
+    if (n <= VB->Max)
+    {
+        return GL_TRUE;
+    }
+
+    for (max = VB->Max; max < n; max *= 2)
+        ;
+    if (!vb_realloc(VB, max) && !vb_realloc(VB, n))
+    {
+        gl_error(ctx, GL_OUT_OF_MEMORY, "gl_grow_vb");
+        return GL_FALSE;
+    }
+
+    _vbgrowths++;
+    return GL_TRUE;
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : rglGetSkip
-    Description : determine raster no/skip condition
-    Inputs      : y - current raster
-    Outputs     :
-    Return      : TRUE or FALSE
+    Name        : rglVertexBufferSize
+    Description : set the VB's capacity.  it still grows past this when a
+                  primitive needs more.  not valid between glBegin / glEnd
+    Inputs      : n - vertices, or 0 to leave the capacity as it is
+    Outputs     : the VB is reallocated
+    Return      : the capacity
 ----------------------------------------------------------------------------*/
-DLL GLboolean rglGetSkip(GLint y)
+DLL GLuint rglVertexBufferSize(GLuint n)
 {
-    if (gl_frames & 1)
+    GLcontext* ctx = CC;
+    vertex_buffer* VB = ctx->VB;
+
+    if (n != 0 && n != VB->Max && n >= VB->Count && ctx->Primitive == GL_NEVER)
     {
-        if (y & 1)
+        if (!vb_realloc(VB, n))
         {
-            return GL_TRUE;
+            gl_error(ctx, GL_OUT_OF_MEMORY, "rglVertexBufferSize");
         }
     }
-    else if (!(y & 1))
-    {
-        return GL_TRUE;
-    }
-
-    return GL_FALSE;
+    return VB->Max;
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : rauxInitDisplayMode
-    Description : this function does nothing
-    Inputs      : flags - ???
+    Name        : rglVertexBufferGrowths
+    Description : number of times the VB has grown to fit a primitive
+    Inputs      :
     Outputs     :
-    Return      :
+    Return      : the count
 ----------------------------------------------------------------------------*/
-DLL void rauxInitDisplayMode(GLuint flags)
+DLL GLuint rglVertexBufferGrowths()
 {
-    //nothing here
+    return _vbgrowths;
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : gl_driver_init
-    Description : initialize a rasterization driver
+    Name        : rglRetainedTextureBytes
+    Description : memory the GL holds for texture images & their mip chains,
+                  as opposed to what the driver has made of them
     Inputs      :
     Outputs     :
-    Return      : TRUE (success) or FALSE (failure)
+    Return      : the bytes
 ----------------------------------------------------------------------------*/
-static GLboolean gl_driver_init(GLboolean reload)
+DLL GLuint rglRetainedTextureBytes()
 {
-    GLcontext* ctx = CC;
-    static GLboolean (*init_driver)();
-    HINSTANCE lib;
-    char fname[64];
+    return texRetainedBytes;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglSharedTextureLookups
+    Description : glTexImage2D uploads looked up with RGL_TEXTURE_SHARE on
+    Inputs      :
+    Outputs     :
+    Return      : the count, since the context was made
+----------------------------------------------------------------------------*/
+DLL GLuint rglSharedTextureLookups()
+{
+    return texShareLookups;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglSharedTextureHits
+    Description : of rglSharedTextureLookups, those whose image was already
+                  uploaded, and so shared it
+    Inputs      :
+    Outputs     :
+    Return      : the count, since the context was made
+----------------------------------------------------------------------------*/
+DLL GLuint rglSharedTextureHits()
+{
+    return texShareHits;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglSharedTextureBytes
+    Description : bytes of texture image (level 0 & any chain) not duplicated
+                  because RGL_TEXTURE_SHARE textures share them, as things
+                  stand.  a copy the GL doesn't hold as well as the driver's
+    Inputs      :
+    Outputs     :
+    Return      : the bytes
+----------------------------------------------------------------------------*/
+DLL GLuint rglSharedTextureBytes()
+{
+    return texShareBytes;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : glFlush
+    Description : flush render buffers.  possibly take a screenshot, too
+    Inputs      :
+    Outputs     : maybe a screenshot is saved, buffer swap occurs
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void API glFlush()
+{
+    GLcontext* ctx = CC;
+    GLubyte* framebuf;
+
+    if (TRACING) trace_op(TRACE_Flush, 0);
+
+    g_NumPolys = 0;
+    g_CulledPolys = 0;
+    g_MaterialSwitches = 0;
+    g_ModelViewInverses = 0;
+    g_ClippedPolys = 0;
+    gl_frames++;
+
+    if (ctx->DriverFuncs.flush != NULL)
+    {
+        ctx->DriverFuncs.flush();
+    }
+    else
+    {
+        gl_problem(ctx, "glFlush(DR.flush)");
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : glGetFrameCountEXT
+    Description : returns the frame counter
+    Inputs      :
+    Outputs     :
+    Return      : frame counter
+----------------------------------------------------------------------------*/
+DLL GLuint glGetFrameCountEXT(void)
+{
+    return gl_frames;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglGetSkip
+    Description : determine raster no/skip condition
+    Inputs      : y - current raster
+    Outputs     :
+    Return      : TRUE or FALSE
+----------------------------------------------------------------------------*/
+DLL GLboolean rglGetSkip(GLint y)
+{
+    if (gl_frames & 1)
+    {
+        if (y & 1)
+        {
+            return GL_TRUE;
+        }
+    }
+    else if (!(y & 1))
+    {
+        return GL_TRUE;
+    }
+
+    return GL_FALSE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rauxInitDisplayMode
+    Description : this function does nothing
+    Inputs      : flags - ???
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void rauxInitDisplayMode(GLuint flags)
+{
+    //nothing here
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_driver_init
+    Description : initialize a rasterization driver
+    Inputs      :
+    Outputs     :
+    Return      : TRUE (success) or FALSE (failure)
+----------------------------------------------------------------------------*/
+static GLboolean gl_driver_init(GLboolean reload)
+{
+    GLcontext* ctx = CC;
+    static GLboolean (*init_driver)();
+#ifdef _WIN32
+    HINSTANCE lib;
+#endif
+    char fname[64];
 
     ctx->NewMask |= NEW_RASTER;
 
@@ -2778,11 +3326,17 @@ static GLboolean gl_driver_init(GLboolean reload)
         deviceToSelect = NULL;
     }
 
-    if (reload)
+    if (reload && strcmp(devices[activeDevice].name, NULL_DEVICE_NAME) == 0)
+    {
+        //built in, nothing to load
+        init_driver = (GLboolean(*)())null_init_driver;
+    }
+    else if (reload)
     {
         strcpy(fname, "rgl");
         strcat(fname, devices[activeDevice].name);
 
+#ifdef _WIN32
         lib = GetModuleHandle(fname);
         if (lib == NULL)
         {
@@ -2800,6 +3354,12 @@ static GLboolean gl_driver_init(GLboolean reload)
         {
             return GL_FALSE;
         }
+#else
+        //only the built in drivers are available here
+        strcat(fname, " : couldn't load driver");
+        gl_error(ctx, GL_INVALID_VALUE, fname);
+        return GL_FALSE;
+#endif
     }
 
     ctx->ScaleDepthValues = GL_TRUE;
@@ -2863,6 +3423,49 @@ static GLboolean gl_driver_postinit(GLcontext* ctx)
     return GL_TRUE;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : gl_alloc_raster_tables
+    Description : size the screen y lookup tables (scrMult, zMult,
+                  scrMultByte) and the span scratch for a buffer, keeping the
+                  current ones if the size hasn't changed
+    Inputs      : ctx - the context
+                  width, height - buffer dimensions
+    Outputs     : the tables are reallocated, MaxWidth / MaxHeight set
+    Return      : FALSE if out of memory
+----------------------------------------------------------------------------*/
+static GLboolean gl_alloc_raster_tables(GLcontext* ctx, GLuint width, GLuint height)
+{
+    GLuint rows = height + RASTER_GUARD_ROWS;
+    size_t tableBytes = 3 * rows * sizeof(GLint);
+    size_t spanBytes = 3*width + 16;
+    GLubyte* block;
+
+    if (ctx->RasterTables != NULL &&
+        ctx->MaxWidth == width && ctx->MaxHeight == height)
+    {
+        return GL_TRUE;
+    }
+
+    block = (GLubyte*)malloc(tableBytes + spanBytes);
+    if (block == NULL)
+    {
+        return GL_FALSE;
+    }
+    if (ctx->RasterTables != NULL)
+    {
+        free(ctx->RasterTables);
+    }
+
+    ctx->RasterTables = block;
+    ctx->scrMult     = (GLint*)block;
+    ctx->zMult       = ctx->scrMult + rows;
+    ctx->scrMultByte = ctx->zMult + rows;
+    ctx->SpanBuffer  = (GLubyte*)(((size_t)(block + tableBytes) + 7) & ~(size_t)7);
+    ctx->MaxWidth  = width;
+    ctx->MaxHeight = height;
+    return GL_TRUE;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : _rgl_init
     Description : calls gl_driver_init(), sets up dependent variables in the context,
@@ -2880,6 +3483,9 @@ static GLboolean _rgl_init(GLboolean reload, GLuint width, GLuint height, GLuint
     ctx->Buffer.Height = ctx->ScissorHeight = height;
     ctx->Buffer.Depth  = depth;
 
+    //no guard band unless the driver reports one
+    ctx->GuardBandX = ctx->GuardBandY = 0.0f;
+
     if (!gl_driver_init(reload))
     {
         return GL_FALSE;
@@ -2908,19 +3514,24 @@ static GLboolean _rgl_init(GLboolean reload, GLuint width, GLuint height, GLuint
         gl_error(ctx, GL_INVALID_ENUM, "whoa, can't handle this bitdepth");
         return GL_FALSE;
     }
+    if (!gl_alloc_raster_tables(ctx, width, height))
+    {
+        gl_error(ctx, GL_OUT_OF_MEMORY, "_rgl_init(raster tables)");
+        return GL_FALSE;
+    }
     mult = ctx->Buffer.Depth >> 3;
     pitch = ctx->Buffer.Pitch / mult;
     for (i = 0; i < height; i++)
     {
-        scrMult[i] = i*pitch;
-        scrMultByte[i] = mult*((height-1)-i)*pitch;
-        zMult[i] = i*width;
+        ctx->scrMult[i] = i*pitch;
+        ctx->scrMultByte[i] = mult*((height-1)-i)*pitch;
+        ctx->zMult[i] = i*width;
     }
-    for (i = height; i < MAX_HEIGHT; i++)
+    for (i = height; i < height + RASTER_GUARD_ROWS; i++)
     {
-        scrMult[i] = (height-(height-1))*pitch;
-        scrMultByte[i] = mult*(height-(height-1))*pitch;
-        zMult[i] = (height-(height-1))*width;
+        ctx->scrMult[i] = (height-(height-1))*pitch;
+        ctx->scrMultByte[i] = mult*(height-(height-1))*pitch;
+        ctx->zMult[i] = (height-(height-1))*width;
     }
     ctx->Buffer.ByteMult = mult;
 
@@ -2974,6 +3585,10 @@ DLL int rauxInitPosition(GLuint x, GLuint y, GLuint width, GLuint height, GLuint
     }
     else
     {
+        if (getenv("RGL_TRACE") != NULL)
+        {
+            trace_capture(getenv("RGL_TRACE"));
+        }
         return 1;
     }
 }
@@ -2989,6 +3604,8 @@ DLL void API glBegin(GLenum p)
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_Begin, 1, p);
+
     if (ctx->Primitive != GL_NEVER)
     {
         gl_error(ctx, GL_INVALID_OPERATION, "glBegin");
@@ -3049,6 +3666,8 @@ DLL void API glEnd()
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_End, 0);
+
     if (ctx->DriverTransforms)
     {
         if (ctx->NewMask & NEW_RASTER)
@@ -3098,6 +3717,8 @@ DLL void API glEnd()
 
 DLL void API glVertex4fv(GLfloat const* v)
 {
+    if (TRACING) trace_op(TRACE_Vertex4fv, 4, trace_float(v[0]), trace_float(v[1]), trace_float(v[2]), trace_float(v[3]));
+
     gl_Vertex4fv(v);
 }
 
@@ -3111,6 +3732,8 @@ DLL void API glVertex4fv(GLfloat const* v)
 ----------------------------------------------------------------------------*/
 DLL void API glVertex3f(GLfloat x, GLfloat y, GLfloat z)
 {
+    if (TRACING) trace_op(TRACE_Vertex3f, 3, trace_float(x), trace_float(y), trace_float(z));
+
     gl_Vertex3f(x, y, z);
 }
 
@@ -3123,6 +3746,8 @@ DLL void API glVertex3f(GLfloat x, GLfloat y, GLfloat z)
 ----------------------------------------------------------------------------*/
 DLL void API glVertex3fv(GLfloat const* v)
 {
+    if (TRACING) trace_op(TRACE_Vertex3f, 3, trace_float(v[0]), trace_float(v[1]), trace_float(v[2]));
+
     gl_Vertex3fv(v);
 }
 
@@ -3160,6 +3785,9 @@ DLL void API glVertex2i(GLint x, GLint y)
 DLL void API glNormal3f(GLfloat nx, GLfloat ny, GLfloat nz)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Normal3f, 3, trace_float(nx), trace_float(ny), trace_float(nz));
+
     ctx->Current.Normal[0] = nx;
     ctx->Current.Normal[1] = ny;
     ctx->Current.Normal[2] = nz;
@@ -3175,6 +3803,9 @@ DLL void API glNormal3f(GLfloat nx, GLfloat ny, GLfloat nz)
 DLL void API glNormal3fv(GLfloat* n)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Normal3f, 3, trace_float(n[0]), trace_float(n[1]), trace_float(n[2]));
+
     ctx->Current.Normal[0] = n[0];
     ctx->Current.Normal[1] = n[1];
     ctx->Current.Normal[2] = n[2];
@@ -3190,6 +3821,9 @@ DLL void API glNormal3fv(GLfloat* n)
 DLL void API glColor3f(GLfloat r, GLfloat g, GLfloat b)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Color4f, 4, trace_float(r), trace_float(g), trace_float(b), trace_float(1.0f));
+
     ctx->Current.Color[0] = (GLubyte)(ctx->Buffer.rscale * r);
     ctx->Current.Color[1] = (GLubyte)(ctx->Buffer.gscale * g);
     ctx->Current.Color[2] = (GLubyte)(ctx->Buffer.bscale * b);
@@ -3197,100 +3831,647 @@ DLL void API glColor3f(GLfloat r, GLfloat g, GLfloat b)
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : glColor4f
-    Description : adds a colour to the current vertex in the context
-    Inputs      : r, g, b, a - colour components
-    Outputs     :
+    Name        : glColor4f
+    Description : adds a colour to the current vertex in the context
+    Inputs      : r, g, b, a - colour components
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void API glColor4f(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Color4f, 4, trace_float(r), trace_float(g), trace_float(b), trace_float(a));
+
+    ctx->Current.Color[0] = (GLubyte)(ctx->Buffer.rscale * r);
+    ctx->Current.Color[1] = (GLubyte)(ctx->Buffer.gscale * g);
+    ctx->Current.Color[2] = (GLubyte)(ctx->Buffer.bscale * b);
+    ctx->Current.Color[3] = (GLubyte)(ctx->Buffer.ascale * a);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : glColor3ub
+    Description : adds a colour to the current vertex in the context
+    Inputs      : r, g, b - colour components
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void API glColor3ub(GLubyte r, GLubyte g, GLubyte b)
+{
+    GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Color4ub, 4, r, g, b, 255);
+
+    ctx->Current.Color[0] = r;
+    ctx->Current.Color[1] = g;
+    ctx->Current.Color[2] = b;
+    ctx->Current.Color[3] = 255;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : glColor4ub
+    Description : adds a colour to the current vertex in the context
+    Inputs      : r, g, b, a - colour components
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void API glColor4ub(GLubyte r, GLubyte g, GLubyte b, GLubyte a)
+{
+    GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Color4ub, 4, r, g, b, a);
+
+    ctx->Current.Color[0] = r;
+    ctx->Current.Color[1] = g;
+    ctx->Current.Color[2] = b;
+    ctx->Current.Color[3] = a;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : glTexCoord2f
+    Description : adds a texture coordinate to the current vertex in the context
+    Inputs      : s, t - texel
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void API glTexCoord2f(GLfloat s, GLfloat t)
+{
+    GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_TexCoord2f, 2, trace_float(s), trace_float(t));
+
+    ctx->Current.TexCoord[0] = s;
+    ctx->Current.TexCoord[1] = t;
+}
+
+static void _insert_texobj(GLuint textureName)
+{
+    gl_texture_object* tex = (gl_texture_object*)gl_Allocate(sizeof(gl_texture_object));
+    gl_init_texobj(textureName, tex);
+    hashInsert(_texobjs, textureName, tex);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : glGenTextures
+    Description : generates texture names
+    Inputs      : n - number of names to generate
+                  textureNames - generated names go here
+    Outputs     : textureNames will contain n names, or all 0 (null name)
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void API glGenTextures(GLsizei n, GLuint* textureNames)
+{
+    GLcontext* ctx = CC;
+    GLuint i;
+    GLuint first = hashFindFreeKeyBlock(_texobjs, n);
+    if (first == 0)
+    {
+        MEMSET(textureNames, 0, n*sizeof(GLuint));
+        gl_error(ctx, GL_INVALID_VALUE, "glGenTextures(first)");
+    }
+    else
+    {
+        for (i = 0; i < (GLuint)n; i++)
+        {
+            textureNames[i] = first + i;
+            _insert_texobj(textureNames[i]);
+        }
+    }
+
+    if (TRACING) trace_op_block(TRACE_GenTextures, textureNames, n*sizeof(GLuint), 1, n);
+}
+
+//GL_TRUE for the min filters that sample a mip chain
+static GLboolean gl_mipmap_filter(GLenum filter)
+{
+    switch (filter)
+    {
+    case GL_NEAREST_MIPMAP_NEAREST:
+    case GL_LINEAR_MIPMAP_NEAREST:
+    case GL_NEAREST_MIPMAP_LINEAR:
+    case GL_LINEAR_MIPMAP_LINEAR:
+        return GL_TRUE;
+    default:
+        return GL_FALSE;
+    }
+}
+
+//drop a texture's mip chain
+static void gl_free_mipmaps(gl_texture_object* to)
+{
+    if (to->Mips != NULL)
+    {
+        texRetainedBytes -= pix_mip_bytes(to->Width, to->Height, NULL);
+        gl_Free(to->Mips);
+        to->Mips = NULL;
+    }
+    to->MipLevels = 0;
+}
+
+//bytes of a texture's level 0, by its Format
+static GLuint gl_teximage_bytes(gl_texture_object const* to)
+{
+    switch (to->Format)
+    {
+    case GL_COLOR_INDEX:
+        return to->Width * to->Height;
+    case GL_RGBA16:
+        return 2 * to->Width * to->Height;
+    default:
+        return 4 * to->Width * to->Height;
+    }
+}
+
+//the _texshares key of a share's Key, never 0
+static GLuint gl_share_slot(hash64 key)
+{
+    GLuint slot = (GLuint)(key ^ (key >> 32));
+    return (slot != 0) ? slot : 1;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_texture_unshare
+    Description : take a texture off the image it shares (RGL_TEXTURE_SHARE).
+                  the last user frees the share, its buffers going with it,
+                  or to it if it's keeping its image
+    Inputs      : to - the texture object, to->Share != NULL
+                  keep - GL_TRUE to leave to with its own copy of the image,
+                         GL_FALSE to leave it with none
+    Outputs     : to->Share is NULL.  the driver's texture is left as it is
+    Return      :
+----------------------------------------------------------------------------*/
+static void gl_texture_unshare(gl_texture_object* to, GLboolean keep)
+{
+    gl_texture_share* sh = to->Share;
+    gl_texture_share* head;
+    gl_texture_object** user;
+    GLuint mipBytes;
+
+    for (user = &sh->Users; *user != to; user = &(*user)->ShareNext)
+        ;
+    *user = to->ShareNext;
+    to->Share = NULL;
+    to->ShareNext = NULL;
+    to->Data = NULL;
+    to->Mips = NULL;
+    to->DataBytes = 0;
+
+    mipBytes = (sh->Mips != NULL) ? pix_mip_bytes(sh->Width, sh->Height, NULL) : 0;
+
+    if (--sh->Refs != 0)
+    {
+        texShareBytes -= sh->ImageBytes;
+        if (keep && sh->Data != NULL)
+        {
+            to->Data = (GLubyte*)gl_Allocate(sh->DataBytes);
+            if (to->Data != NULL)
+            {
+                MEMCPY(to->Data, sh->Data, sh->DataBytes);
+                to->DataBytes = sh->DataBytes;
+                texRetainedBytes += sh->DataBytes;
+            }
+            if (to->Data != NULL && sh->Mips != NULL)
+            {
+                to->Mips = (GLubyte*)gl_Allocate(mipBytes);
+                if (to->Mips != NULL)
+                {
+                    MEMCPY(to->Mips, sh->Mips, mipBytes);
+                    texRetainedBytes += mipBytes;
+                }
+            }
+        }
+        if (to->Mips == NULL)
+        {
+            to->MipLevels = 0;
+        }
+        return;
+    }
+
+    //the last user
+    if (keep)
+    {
+        to->Data = sh->Data;
+        to->DataBytes = sh->DataBytes;
+        to->Mips = sh->Mips;
+    }
+    else
+    {
+        if (sh->Data != NULL)
+        {
+            texRetainedBytes -= sh->DataBytes;
+            gl_Free(sh->Data);
+        }
+        if (sh->Mips != NULL)
+        {
+            texRetainedBytes -= mipBytes;
+            gl_Free(sh->Mips);
+        }
+        to->MipLevels = 0;
+    }
+
+    head = (gl_texture_share*)hashLookup(_texshares, gl_share_slot(sh->Key));
+    if (head == sh)
+    {
+        if (sh->Next != NULL)
+        {
+            hashInsert(_texshares, gl_share_slot(sh->Key), sh->Next);
+        }
+        else
+        {
+            hashRemove(_texshares, gl_share_slot(sh->Key));
+        }
+    }
+    else
+    {
+        while (head->Next != sh)
+        {
+            head = head->Next;
+        }
+        head->Next = sh->Next;
+    }
+    gl_Free(sh);
+}
+
+//drop a texture's image, level 0 & the chain.  only Data the GL holds is freed
+static void gl_free_teximage(gl_texture_object* to)
+{
+    if (to->Share != NULL)
+    {
+        gl_texture_unshare(to, GL_FALSE);
+    }
+    gl_free_mipmaps(to);
+    if (to->DataBytes != 0)
+    {
+        texRetainedBytes -= to->DataBytes;
+        gl_Free(to->Data);
+        to->DataBytes = 0;
+    }
+    to->Data = NULL;
+}
+
+//level 0 from the caller's texels: copied if the GL holds Data, else borrowed
+static void gl_teximage_set(gl_texture_object* to, GLvoid const* pixels, GLsizei bytes)
+{
+    if (to->DataBytes != 0)
+    {
+        MEMCPY(to->Data, pixels, bytes);
+    }
+    else
+    {
+        to->Data = (GLubyte*)pixels;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_teximage_keep
+    Description : after the driver has had a level 0 the GL only borrowed,
+                  copy it (and keep any mip chain) if the driver will want
+                  it again, else let both go
+    Inputs      : ctx - the context
+                  to - the texture object
+    Outputs     : to->Data is the GL's own or NULL, to->Mips may be freed
+    Return      :
+----------------------------------------------------------------------------*/
+static void gl_teximage_keep(GLcontext* ctx, gl_texture_object* to)
+{
+    GLubyte* data;
+    GLuint bytes;
+
+    if (ctx->DriverFuncs.tex_retain == NULL || ctx->DriverFuncs.tex_retain(to))
+    {
+        bytes = gl_teximage_bytes(to);
+        data = (GLubyte*)gl_Allocate(bytes);
+        if (data != NULL)
+        {
+            MEMCPY(data, to->Data, bytes);
+            to->DataBytes = bytes;
+            texRetainedBytes += bytes;
+        }
+        to->Data = data;
+    }
+    else
+    {
+        //the driver has the chain too; MipLevels stays to say how deep it is
+        if (to->Mips != NULL)
+        {
+            texRetainedBytes -= pix_mip_bytes(to->Width, to->Height, NULL);
+            gl_Free(to->Mips);
+            to->Mips = NULL;
+        }
+        to->Data = NULL;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_texture_mipmaps
+    Description : (re)build a texture's mip chain from its level 0, if its
+                  min filter wants one or RGL_MIPMAPS is on.  RGB(A) and
+                  paletted textures get one, the latter expanded through
+                  the palette in use now; RGBA16 textures don't.  the
+                  levels are always RGBA
+    Inputs      : ctx - the context
+                  to - the texture object
+    Outputs     : to->Mips & to->MipLevels are set, or the chain freed
+    Return      :
+----------------------------------------------------------------------------*/
+static void gl_texture_mipmaps(GLcontext* ctx, gl_texture_object* to)
+{
+    GLubyte* rgba;
+    GLubyte const* palette;
+    GLsizei bytes;
+    GLuint levels;
+
+    gl_free_mipmaps(to);
+
+    if (!ctx->Mipmaps && !gl_mipmap_filter(to->Min))
+    {
+        return;
+    }
+    if (to->Data == NULL)
+    {
+        return;
+    }
+
+    bytes = pix_mip_bytes(to->Width, to->Height, &levels);
+    if (levels == 0)
+    {
+        return;
+    }
+
+    switch (to->Format)
+    {
+    case GL_RGB:
+    case GL_RGBA:
+        rgba = to->Data;
+        break;
+
+    case GL_COLOR_INDEX:
+        palette = ctx->UsingSharedPalette ? ctx->SharedPalette : to->Palette;
+        if (palette == NULL)
+        {
+            return;
+        }
+        rgba = (GLubyte*)gl_Allocate(4 * to->Width * to->Height);
+        if (rgba == NULL)
+        {
+            return;
+        }
+        //the palette's 4 bytes r g b a are a GLuint entry of RGBA
+        pix_expand_index(rgba, 4 * to->Width, 4, to->Data, to->Width,
+                         palette, to->Width, to->Height);
+        break;
+
+    default:
+        return;
+    }
+
+    to->Mips = (GLubyte*)gl_Allocate(bytes);
+    if (to->Mips != NULL)
+    {
+        texRetainedBytes += bytes;
+        if (pix_mipmap(to->Mips, rgba, to->Width, to->Height, &mipScratch))
+        {
+            to->MipLevels = levels;
+        }
+        else
+        {
+            gl_free_mipmaps(to);
+        }
+    }
+
+    if (rgba != to->Data)
+    {
+        gl_Free(rgba);
+    }
+}
+
+//hand level 0 and any mip chain to the driver
+static void gl_texture_to_driver(GLcontext* ctx, gl_texture_object* to)
+{
+    GLuint level;
+
+    if (ctx->DriverFuncs.tex_img != NULL)
+    {
+        ctx->DriverFuncs.tex_img(to, 0, to->Format);
+        for (level = 1; level <= to->MipLevels; level++)
+        {
+            ctx->DriverFuncs.tex_img(to, level, GL_RGBA);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_texture_share_key
+    Description : RGL_TEXTURE_SHARE's key for a texture's image: its format,
+                  size, whether it'll get a mip chain, its own palette (a
+                  shared one is the same for everyone) and level 0's texels.
+                  with another seed, the check confirming a match against a
+                  share that didn't keep its texels
+    Inputs      : ctx - the context
+                  to - the texture object, with Data
+                  seed - 0 for the key, TEXSHARE_CHECK_SEED for the check
+    Outputs     :
+    Return      : the key
+----------------------------------------------------------------------------*/
+static hash64 gl_texture_share_key(GLcontext* ctx, gl_texture_object const* to, hash64 seed)
+{
+    GLuint header[4];
+    hash64 key;
+
+    header[0] = to->Format;
+    header[1] = to->Width;
+    header[2] = to->Height;
+    header[3] = ctx->Mipmaps || gl_mipmap_filter(to->Min);
+    key = hashBytes64(header, sizeof(header), seed);
+
+    if (to->Format == GL_COLOR_INDEX && !ctx->UsingSharedPalette && to->Palette != NULL)
+    {
+        key = hashBytes64(to->Palette, 4 * 256, key);
+    }
+    return hashBytes64(to->Data, gl_teximage_bytes(to), key);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_texture_share_find
+    Description : look for a texture's new image among the shared ones, and
+                  if it's there make the texture another user of it.  the
+                  texels are compared if the share kept them; if not (the
+                  driver didn't want them) the share's check has to match
+                  as well as its key
+    Inputs      : ctx - the context
+                  to - the texture object, its new level 0 in Data
+                  key - from gl_texture_share_key
+    Outputs     : on a hit, to's own Data is dropped for the share's and the
+                  driver told (tex_share, or tex_img if there's none)
+    Return      : GL_TRUE on a hit
+----------------------------------------------------------------------------*/
+static GLboolean gl_texture_share_find(GLcontext* ctx, gl_texture_object* to, hash64 key)
+{
+    gl_texture_share* sh;
+    hash64 check = 0;
+    GLboolean haveCheck = GL_FALSE;
+
+    texShareLookups++;
+
+    if (_texshares == NULL)
+    {
+        return GL_FALSE;
+    }
+
+    for (sh = (gl_texture_share*)hashLookup(_texshares, gl_share_slot(key));
+         sh != NULL; sh = sh->Next)
+    {
+        if (sh->Key != key || sh->Format != to->Format ||
+            sh->Width != to->Width || sh->Height != to->Height)
+        {
+            continue;
+        }
+        if (sh->Data != NULL)
+        {
+            if (memcmp(sh->Data, to->Data, sh->DataBytes) == 0)
+            {
+                break;
+            }
+            continue;
+        }
+        //no texels to compare, so a second hash
+        if (!haveCheck)
+        {
+            check = gl_texture_share_key(ctx, to, TEXSHARE_CHECK_SEED);
+            haveCheck = GL_TRUE;
+        }
+        if (sh->Check == check)
+        {
+            break;
+        }
+    }
+    if (sh == NULL)
+    {
+        return GL_FALSE;
+    }
+    if (sh->Data == NULL && ctx->DriverFuncs.tex_share == NULL)
+    {
+        //tex_img would have nothing to read
+        return GL_FALSE;
+    }
+
+    gl_free_teximage(to);
+    to->Data = sh->Data;
+    to->Mips = sh->Mips;
+    to->MipLevels = sh->MipLevels;
+    to->Share = sh;
+    to->ShareNext = sh->Users;
+    sh->Users = to;
+    sh->Refs++;
+
+    texShareHits++;
+    texShareBytes += sh->ImageBytes;
+
+    if (ctx->DriverFuncs.tex_share != NULL)
+    {
+        ctx->DriverFuncs.tex_share(to, to->ShareNext);
+    }
+    else
+    {
+        gl_texture_to_driver(ctx, to);
+    }
+    return GL_TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_texture_share_add
+    Description : make a texture's image, just uploaded, one later uploads
+                  of the same image can share
+    Inputs      : to - the texture object, with its image kept (or not) as
+                       gl_teximage_keep left it
+                  key - from gl_texture_share_key
+                  check - gl_texture_share_key with TEXSHARE_CHECK_SEED, of
+                          the texels before gl_teximage_keep if it didn't
+                          keep them
+    Outputs     : the share owns what were to's Data & Mips
     Return      :
 ----------------------------------------------------------------------------*/
-DLL void API glColor4f(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+static void gl_texture_share_add(gl_texture_object* to, hash64 key, hash64 check)
 {
-    GLcontext* ctx = CC;
-    ctx->Current.Color[0] = (GLubyte)(ctx->Buffer.rscale * r);
-    ctx->Current.Color[1] = (GLubyte)(ctx->Buffer.gscale * g);
-    ctx->Current.Color[2] = (GLubyte)(ctx->Buffer.bscale * b);
-    ctx->Current.Color[3] = (GLubyte)(ctx->Buffer.ascale * a);
-}
+    gl_texture_share* sh;
+    GLuint slot = gl_share_slot(key);
 
-/*-----------------------------------------------------------------------------
-    Name        : glColor3ub
-    Description : adds a colour to the current vertex in the context
-    Inputs      : r, g, b - colour components
-    Outputs     :
-    Return      :
-----------------------------------------------------------------------------*/
-DLL void API glColor3ub(GLubyte r, GLubyte g, GLubyte b)
-{
-    GLcontext* ctx = CC;
-    ctx->Current.Color[0] = r;
-    ctx->Current.Color[1] = g;
-    ctx->Current.Color[2] = b;
-    ctx->Current.Color[3] = 255;
-}
+    if (_texshares == NULL)
+    {
+        _texshares = hashNewTable(gl_Allocate, gl_Free);
+        if (_texshares == NULL)
+        {
+            return;
+        }
+    }
 
-/*-----------------------------------------------------------------------------
-    Name        : glColor4ub
-    Description : adds a colour to the current vertex in the context
-    Inputs      : r, g, b, a - colour components
-    Outputs     :
-    Return      :
-----------------------------------------------------------------------------*/
-DLL void API glColor4ub(GLubyte r, GLubyte g, GLubyte b, GLubyte a)
-{
-    GLcontext* ctx = CC;
-    ctx->Current.Color[0] = r;
-    ctx->Current.Color[1] = g;
-    ctx->Current.Color[2] = b;
-    ctx->Current.Color[3] = a;
-}
+    sh = (gl_texture_share*)gl_Allocate(sizeof(gl_texture_share));
+    if (sh == NULL)
+    {
+        return;
+    }
+    sh->Key = key;
+    sh->Refs = 1;
+    sh->Users = to;
+    sh->Format = to->Format;
+    sh->Width = to->Width;
+    sh->Height = to->Height;
+    sh->ImageBytes = gl_teximage_bytes(to);
+    if (to->MipLevels != 0)
+    {
+        sh->ImageBytes += pix_mip_bytes(to->Width, to->Height, NULL);
+    }
+    sh->Data = to->Data;
+    sh->DataBytes = to->DataBytes;
+    sh->MipLevels = to->MipLevels;
+    sh->Mips = to->Mips;
+    sh->Check = check;
 
-/*-----------------------------------------------------------------------------
-    Name        : glTexCoord2f
-    Description : adds a texture coordinate to the current vertex in the context
-    Inputs      : s, t - texel
-    Outputs     :
-    Return      :
-----------------------------------------------------------------------------*/
-DLL void API glTexCoord2f(GLfloat s, GLfloat t)
-{
-    GLcontext* ctx = CC;
-    ctx->Current.TexCoord[0] = s;
-    ctx->Current.TexCoord[1] = t;
-}
+    to->DataBytes = 0;
+    to->Share = sh;
+    to->ShareNext = NULL;
 
-static void _insert_texobj(GLuint textureName)
-{
-    gl_texture_object* tex = (gl_texture_object*)gl_Allocate(sizeof(gl_texture_object));
-    gl_init_texobj(textureName, tex);
-    hashInsert(_texobjs, textureName, tex);
+    sh->Next = (gl_texture_share*)hashLookup(_texshares, slot);
+    hashInsert(_texshares, slot, sh);
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : glGenTextures
-    Description : generates texture names
-    Inputs      : n - number of names to generate
-                  textureNames - generated names go here
-    Outputs     : textureNames will contain n names, or all 0 (null name)
-    Return      :
+    Name        : rglGetTexLevel
+    Description : find a level of a texture's image, for drivers' tex_img
+    Inputs      : tex - the texture object
+                  level - 0 for the image, 1..tex->MipLevels for its chain
+    Outputs     : width, height - the level's dimensions
+    Return      : the level's texels, RGBA below level 0, or NULL if there's
+                  no such level
 ----------------------------------------------------------------------------*/
-DLL void API glGenTextures(GLsizei n, GLuint* textureNames)
+DLL GLubyte* rglGetTexLevel(gl_texture_object* tex, GLint level, GLsizei* width, GLsizei* height)
 {
-    GLcontext* ctx = CC;
-    GLuint i;
-    GLuint first = hashFindFreeKeyBlock(_texobjs, n);
-    if (first == 0)
+    GLubyte* data;
+    GLsizei w, h;
+    GLint i;
+
+    if (level < 0 || (GLuint)level > tex->MipLevels ||
+        (level > 0 && tex->Mips == NULL))
     {
-        MEMSET(textureNames, 0, n*sizeof(GLuint));
-        gl_error(ctx, GL_INVALID_VALUE, "glGenTextures(first)");
+        return NULL;
     }
-    else
+
+    data = (level == 0) ? tex->Data : tex->Mips;
+    w = tex->Width;
+    h = tex->Height;
+    for (i = 1; i <= level; i++)
     {
-        for (i = 0; i < (GLuint)n; i++)
+        if (i > 1)
         {
-            textureNames[i] = first + i;
-            _insert_texobj(textureNames[i]);
+            data += 4 * w * h;
         }
+        w = (w > 1) ? w >> 1 : 1;
+        h = (h > 1) ? h >> 1 : 1;
     }
+
+    *width = w;
+    *height = h;
+    return data;
 }
 
 /*-----------------------------------------------------------------------------
@@ -3308,6 +4489,9 @@ DLL void API glTexParameteri(GLenum target, GLenum pname, GLenum param)
 
     //ignore target
     gl_texture_object* texobj = ctx->TexBoundObject;
+
+    if (TRACING) trace_op(TRACE_TexParameteri, 3, target, pname, param);
+
     if (texobj == NULL)
     {
 //        gl_error(ctx, GL_INVALID_VALUE, "glTexParameteri(texobj)");
@@ -3334,6 +4518,20 @@ DLL void API glTexParameteri(GLenum target, GLenum pname, GLenum param)
         break;
     case GL_TEXTURE_MIN_FILTER:
         texobj->Min = param;
+        //a chain for an image that came before the filter
+        if (texobj->created && texobj->MipLevels == 0 && gl_mipmap_filter(param))
+        {
+            //the chain is this texture's alone
+            if (texobj->Share != NULL)
+            {
+                gl_texture_unshare(texobj, GL_TRUE);
+            }
+            gl_texture_mipmaps(ctx, texobj);
+            if (texobj->MipLevels != 0)
+            {
+                gl_texture_to_driver(ctx, texobj);
+            }
+        }
         break;
     default:
         gl_error(ctx, GL_INVALID_VALUE, "glTexParameteri(pname)");
@@ -3356,6 +4554,8 @@ DLL void API glBindTexture(GLenum target, GLuint textureName)
     //totally ignore target (2D textures only)
     gl_texture_object* to;
 
+    if (TRACING) trace_op(TRACE_BindTexture, 2, target, textureName);
+
 //    if ((GLint)textureName <= 0)
     if (textureName == 0 || textureName > 0xfffffff0)
     {
@@ -3453,10 +4653,13 @@ GLuint gl_log2(GLuint n)
                   to - the texture object
                   width, height - texture dimensions
                   pixels - texture data
-    Outputs     : to is modified, to->Data is allocated
+                  borrow - leave to->Data pointing at pixels rather than a copy,
+                           if it can be
+    Outputs     : to is modified, to->Data is allocated or borrowed
     Return      :
 ----------------------------------------------------------------------------*/
-void gl_paltex(gl_texture_object* to, GLsizei width, GLsizei height, GLubyte const* pixels)
+void gl_paltex(gl_texture_object* to, GLsizei width, GLsizei height, GLubyte const* pixels,
+               GLboolean borrow)
 {
 #if NO_PALETTES
     GLubyte* dp;
@@ -3466,6 +4669,8 @@ void gl_paltex(gl_texture_object* to, GLsizei width, GLsizei height, GLubyte con
     to->Format = GL_RGB;
 
     to->Data = (GLubyte*)gl_Allocate(4*width*height);
+    to->DataBytes = 4*width*height;
+    texRetainedBytes += to->DataBytes;
 
     //fill the data
     dp = (GLubyte*)to->Data;
@@ -3487,8 +4692,17 @@ void gl_paltex(gl_texture_object* to, GLsizei width, GLsizei height, GLubyte con
 
     //8bit data
     size = width*height;
-    to->Data = (GLubyte*)gl_Allocate(size);
-    MEMCPY(to->Data, pixels, size);
+    if (borrow)
+    {
+        to->Data = (GLubyte*)pixels;
+    }
+    else
+    {
+        to->Data = (GLubyte*)gl_Allocate(size);
+        to->DataBytes = size;
+        texRetainedBytes += size;
+        MEMCPY(to->Data, pixels, size);
+    }
 #endif
 
     //other stuff
@@ -3525,16 +4739,37 @@ DLL void API glTexImage2D(
 
     //ignore target
     gl_texture_object* to = ctx->TexBoundObject;
+    GLboolean borrow;
+    GLsizei size;
+    GLboolean share;
+    hash64 key = 0, check = 0;
+
+    if (TRACING)
+    {
+        //the number of bytes read below depends on internalFormat as much as format
+        GLenum sizeFormat = format;
+        if (internalFormat == GL_COLOR_INDEX || internalFormat == GL_RGBA16)
+        {
+            sizeFormat = internalFormat;
+        }
+        trace_op_block(TRACE_TexImage2D, pixels, trace_image_size(sizeFormat, width, height), 8,
+                       target, level, internalFormat, width, height, border, format, type);
+    }
+
     if (to == NULL)
     {
         gl_error(ctx, GL_INVALID_VALUE, "glTexImage2D has no bound texobj");
         return;
     }
 
+    //without TexRetain level 0 is only the caller's pixels until the driver's had them
+    borrow = !ctx->TexRetain;
+
     //handle paletted textures separately
     if (internalFormat == GL_COLOR_INDEX || format == GL_COLOR_INDEX)
     {
-        gl_paltex(to, width, height, (GLubyte const*)pixels);
+        gl_free_teximage(to);
+        gl_paltex(to, width, height, (GLubyte const*)pixels, borrow);
         goto TEXIMAGE_DONE;
     }
 
@@ -3559,18 +4794,14 @@ DLL void API glTexImage2D(
         return;
     }
 
-    if (to->Data != NULL)
-    {
-        gl_Free(to->Data);
-    }
+    gl_free_teximage(to);
 
-    if (internalFormat == GL_RGBA16)
-    {
-        to->Data = (GLubyte*)gl_Allocate(2*width*height);
-    }
-    else
+    if (!borrow)
     {
-        to->Data = (GLubyte*)gl_Allocate(4*width*height);
+        size = ((internalFormat == GL_RGBA16) ? 2 : 4) * width * height;
+        to->Data = (GLubyte*)gl_Allocate(size);
+        to->DataBytes = size;
+        texRetainedBytes += size;
     }
 
     to->Width = width;
@@ -3584,18 +4815,27 @@ DLL void API glTexImage2D(
     case GL_RGB:
         if (format == GL_RGBA)
         {
-            MEMCPY(to->Data, (GLubyte*)pixels, 4*width*height);
+            gl_teximage_set(to, pixels, 4*width*height);
         }
         else
         {
+            if (borrow)
+            {
+                to->Data = (GLubyte*)pix_arena_get(&texScratch, 4*width*height);
+                if (to->Data == NULL)
+                {
+                    gl_error(ctx, GL_OUT_OF_MEMORY, "glTexImage2D");
+                    return;
+                }
+            }
             gl_copy_3_to_4(to->Data, (GLubyte*)pixels, width, height);
         }
         break;
     case GL_RGBA16:
-        MEMCPY(to->Data, (GLubyte*)pixels, 2*width*height);
+        gl_teximage_set(to, pixels, 2*width*height);
         break;
     case GL_RGBA:
-        MEMCPY(to->Data, (GLubyte*)pixels, 4*width*height);
+        gl_teximage_set(to, pixels, 4*width*height);
         break;
     default:
         gl_error(ctx, GL_INVALID_VALUE, "glTexImage2D(format)");
@@ -3604,9 +4844,32 @@ DLL void API glTexImage2D(
     to->created = GL_TRUE;
 
 TEXIMAGE_DONE:
-    if (ctx->DriverFuncs.tex_img != NULL)
+    share = ctx->TexShare && to->Data != NULL;
+    if (share)
     {
-        ctx->DriverFuncs.tex_img(to, 0, to->Format);
+        key = gl_texture_share_key(ctx, to, 0);
+        if (gl_texture_share_find(ctx, to, key))
+        {
+            return;
+        }
+    }
+
+    gl_texture_mipmaps(ctx, to);
+    gl_texture_to_driver(ctx, to);
+    if (to->Data != NULL && to->DataBytes == 0)
+    {
+        if (share)
+        {
+            //the caller's texels, which gl_teximage_keep may not copy
+            check = gl_texture_share_key(ctx, to, TEXSHARE_CHECK_SEED);
+        }
+        gl_teximage_keep(ctx, to);
+    }
+
+    //a share with no Data is only any use to a driver that can tex_share
+    if (share && (to->Data != NULL || ctx->DriverFuncs.tex_share != NULL))
+    {
+        gl_texture_share_add(to, key, check);
     }
 
 #if 0
@@ -3634,6 +4897,8 @@ DLL void API glTexEnvi(GLenum target, GLenum pname, GLenum param)
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_TexEnvi, 3, target, pname, param);
+
     //ignore target (assume GL_TEXTURE_ENV)
     //ignore pname  (assume GL_TEXTURE_ENV_MODE)
 
@@ -3827,8 +5092,8 @@ DLL void API glGetIntegerv(GLenum pname, GLint* param)
         *param = 256*256;
         break;
     case GL_MAX_VIEWPORT_DIMS:
-        param[0] = MAX_WIDTH;
-        param[1] = MAX_HEIGHT;
+        param[0] = ctx->MaxWidth;
+        param[1] = ctx->MaxHeight;
         break;
     case GL_PERSPECTIVE_CORRECTION_HINT:
         *param = ctx->PerspectiveCorrect ? GL_NICEST : GL_FASTEST;
@@ -3916,7 +5181,7 @@ DLL char* glGluErrorString(GLenum err)
     Inputs      :
     Outputs     : gl_classify_modelview is called
     Return      :
-    State       : clear NEW_MODELVIEW
+    State       : clear NEW_MODELVIEW, set NEW_MVP
 ----------------------------------------------------------------------------*/
 void gl_update_modelview()
 {
@@ -3924,11 +5189,14 @@ void gl_update_modelview()
 
     gl_classify_modelview();
     ctx->NewMask &= ~(NEW_MODELVIEW);
+    ctx->NewMask |= NEW_MVP;
 
+#if RGL_ASM
     if (ctx->CpuKatmai)
     {
         xmm_update_modelview(ctx);
     }
+#endif
 
     if (ctx->DriverFuncs.update_modelview != NULL)
     {
@@ -3938,7 +5206,8 @@ void gl_update_modelview()
 
 /*-----------------------------------------------------------------------------
     Name        : gl_invert_modelview
-    Description : invert the current modelview matrix
+    Description : invert the current modelview matrix, by way of its
+                  classification
     Inputs      :
     Outputs     : will call gl_update_modelview if necessary.
                   ctx->ModelViewInv is calculated from ctx->ModelViewMatrix
@@ -3952,8 +5221,9 @@ void gl_invert_modelview()
     {
         gl_update_modelview();
     }
-    mat4_inverse(ctx->ModelViewInv, ctx->ModelViewMatrix);
+    invert_matrix_type(ctx->ModelViewMatrix, ctx->ModelViewMatrixType, ctx->ModelViewInv);
     ctx->NewMask &= ~(NEW_MODELVIEWINV);
+    g_ModelViewInverses++;
 }
 
 /*-----------------------------------------------------------------------------
@@ -3962,7 +5232,7 @@ void gl_invert_modelview()
     Inputs      :
     Outputs     : gl_classify_projection is called
     Return      :
-    State       : clear NEW_PROJECTION
+    State       : clear NEW_PROJECTION, set NEW_MVP
 ----------------------------------------------------------------------------*/
 void gl_update_projection()
 {
@@ -3970,11 +5240,14 @@ void gl_update_projection()
 
     gl_classify_projection();
     ctx->NewMask &= ~(NEW_PROJECTION);
+    ctx->NewMask |= NEW_MVP;
 
+#if RGL_ASM
     if (ctx->CpuKatmai)
     {
         xmm_update_projection(ctx);
     }
+#endif
 
     if (ctx->DriverFuncs.update_projection != NULL)
     {
@@ -3982,6 +5255,63 @@ void gl_update_projection()
     }
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : gl_update_mvp
+    Description : recompute the cached modelview-projection product if
+                  either matrix has changed.  the product takes the
+                  modelview's classification if the projection is the
+                  identity (and vice versa), otherwise it's MATRIX_3D or
+                  MATRIX_GENERAL
+    Inputs      :
+    Outputs     : will call gl_update_modelview / gl_update_projection if
+                  necessary.  ctx->ModelViewProjectionMatrix[Type] are set
+    Return      :
+    State       : clear NEW_MVP
+----------------------------------------------------------------------------*/
+void gl_update_mvp()
+{
+    GLcontext* ctx = CC;
+    GLfloat* m = ctx->ModelViewProjectionMatrix;
+
+    if (ctx->NewMask & NEW_MODELVIEW)
+    {
+        gl_update_modelview();
+    }
+    if (ctx->NewMask & NEW_PROJECTION)
+    {
+        gl_update_projection();
+    }
+    if (!(ctx->NewMask & NEW_MVP))
+    {
+        return;
+    }
+
+    if (ctx->ProjectionMatrixType == MATRIX_IDENTITY)
+    {
+        MAT4_COPY(m, ctx->ModelViewMatrix);
+        ctx->ModelViewProjectionMatrixType = ctx->ModelViewMatrixType;
+    }
+    else if (ctx->ModelViewMatrixType == MATRIX_IDENTITY)
+    {
+        MAT4_COPY(m, ctx->ProjectionMatrix);
+        ctx->ModelViewProjectionMatrixType = ctx->ProjectionMatrixType;
+    }
+    else
+    {
+        mat4_mult(m, ctx->ProjectionMatrix, ctx->ModelViewMatrix);
+        if (m[3] == 0.0f && m[7] == 0.0f && m[11] == 0.0f && m[15] == 1.0f)
+        {
+            ctx->ModelViewProjectionMatrixType = MATRIX_3D;
+        }
+        else
+        {
+            ctx->ModelViewProjectionMatrixType = MATRIX_GENERAL;
+        }
+    }
+
+    ctx->NewMask &= ~(NEW_MVP);
+}
+
 /*-----------------------------------------------------------------------------
     Name        : glRasterPos2f
     Description : sets the current raster position in the context
@@ -4002,6 +5332,8 @@ DLL void API glRasterPos2f(GLfloat x, GLfloat y)
                 GLfloat normal[][3],
                 GLubyte color[][4]);
 
+    if (TRACING) trace_op(TRACE_RasterPos2f, 2, trace_float(x), trace_float(y));
+
     V4_SET(v, x, y, 0.0f, 1.0f);
 
     TRANSFORM_POINT(eye, ctx->ModelViewMatrix, v);
@@ -4075,6 +5407,9 @@ DLL void API glRasterPos2i(GLint x, GLint y)
 DLL void API glRasterPos4f(GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_RasterPos4f, 4, trace_float(x), trace_float(y), trace_float(z), trace_float(w));
+
     ctx->Current.RasterPos[0] = x;
     ctx->Current.RasterPos[1] = y;
     ctx->Current.RasterPos[2] = z;
@@ -4094,6 +5429,13 @@ DLL void API glBitmap(GLsizei width, GLsizei height,
                   GLubyte const* bitmap)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING)
+    {
+        trace_op_block(TRACE_Bitmap, bitmap, ((width + 7) >> 3) * height, 6,
+                       width, height, trace_float(xb0), trace_float(yb0), trace_float(xb1), trace_float(yb1));
+    }
+
     ctx->Current.Bitmap = (GLubyte*)bitmap;
 
     if (ctx->DriverFuncs.draw_bitmap != NULL)
@@ -4122,6 +5464,9 @@ DLL void API glBitmap(GLsizei width, GLsizei height,
 DLL void API glLineWidth(GLfloat width)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_LineWidth, 1, trace_float(width));
+
     if (ctx->LineWidth != width)
     {
         ctx->LineWidth = width;
@@ -4140,6 +5485,9 @@ DLL void API glLineWidth(GLfloat width)
 DLL void API glPointSize(GLfloat size)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_PointSize, 1, trace_float(size));
+
     if (ctx->PointSize != size)
     {
         ctx->PointSize = size;
@@ -4180,6 +5528,8 @@ DLL GLubyte* API glGetString(GLenum cap)
 ----------------------------------------------------------------------------*/
 DLL void API glLightModelf(GLenum pname, GLfloat param)
 {
+    if (TRACING) trace_op(TRACE_LightModelf, 2, pname, trace_float(param));
+
     //nothing here
 }
 
@@ -4193,6 +5543,9 @@ DLL void API glLightModelf(GLenum pname, GLfloat param)
 DLL void API glLineStipple(GLint factor, GLushort pattern)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_LineStipple, 2, factor, pattern);
+
     ctx->StippleFactor = CLAMP(factor, 1, 256);
     ctx->StipplePattern = pattern;
 }
@@ -4206,6 +5559,8 @@ DLL void API glLineStipple(GLint factor, GLushort pattern)
 ----------------------------------------------------------------------------*/
 DLL void API glPixelStorei(GLenum pname, GLint param)
 {
+    if (TRACING) trace_op(TRACE_PixelStorei, 2, pname, param);
+
     //nothing here
 }
 
@@ -4223,6 +5578,8 @@ DLL void API glDeleteTextures(GLsizei n, GLuint const* textures)
     GLsizei i;
     gl_texture_object* tex;
 
+    if (TRACING) trace_op_block(TRACE_DeleteTextures, textures, n*sizeof(GLuint), 1, n);
+
     if (gl_is_shutdown)
     {
         return;
@@ -4236,11 +5593,7 @@ DLL void API glDeleteTextures(GLsizei n, GLuint const* textures)
 
         hashRemove(_texobjs, textures[i]);
 
-        if (tex->Data != NULL)
-        {
-            gl_Free(tex->Data);
-            tex->Data = NULL;
-        }
+        gl_free_teximage(tex);
 
         if (tex->created && ctx->DriverFuncs.tex_del != NULL)
         {
@@ -4264,6 +5617,9 @@ DLL void API glDeleteTextures(GLsizei n, GLuint const* textures)
 DLL void API glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Scissor, 4, x, y, width, height);
+
     ctx->ScissorX = x;
     ctx->ScissorY = y+1;
     ctx->ScissorWidth = width+1;
@@ -4289,6 +5645,8 @@ DLL void API glLightModelfv(GLenum pname, GLfloat const* params)
     GLcontext* ctx = CC;
     GLint i;
 
+    if (TRACING) trace_op_fv(TRACE_LightModelfv, 0, pname, params);
+
     switch (pname)
     {
     case GL_LIGHT_MODEL_AMBIENT:
@@ -4603,7 +5961,6 @@ DLL void rglSaveCursorUnder(GLubyte* data, GLsizei width, GLsizei height, GLint
 ----------------------------------------------------------------------------*/
 void gl_texture_log()
 {
-    hash_t* element;
     gl_texture_object* texobj;
     FILE* tlog;
     char  tlogString[64];
@@ -4616,39 +5973,32 @@ void gl_texture_log()
     }
     fprintf(tlog, "maxkey %d\n", _texobjs->maxkey);
 
-    for (i = 0; i < TABLE_SIZE; i++)
+    for (i = 0; i < HASH_COUNT(_texobjs); i++)
     {
-        element = _texobjs->table[i];
-        while (element != NULL)
+        texobj = (gl_texture_object*)HASH_DATA(_texobjs, i);
+        if (texobj != NULL)
         {
-            texobj = (gl_texture_object*)element->data;
-            if (texobj != NULL)
+            switch (texobj->Format)
             {
-                switch (texobj->Format)
-                {
-                case GL_RGB:
-                    sprintf(tlogString, "GL_RGB");
-                    break;
-                case GL_RGBA:
-                    sprintf(tlogString, "GL_RGBA");
-                    break;
-                case GL_COLOR_INDEX:
-                    sprintf(tlogString, "GL_COLOR_INDEX");
-                    break;
-                case GL_RGBA16:
-                    sprintf(tlogString, "GL_RGBA16");
-                    break;
-                case GL_RGBA8:
-                    sprintf(tlogString, "GL_RGBA8");
-                    break;
-                default:
-                    sprintf(tlogString, "GL_???");
-                }
-                fprintf(tlog, "texobj %d : %dx%d %s\n", i, texobj->Width, texobj->Height, tlogString);
+            case GL_RGB:
+                sprintf(tlogString, "GL_RGB");
+                break;
+            case GL_RGBA:
+                sprintf(tlogString, "GL_RGBA");
+                break;
+            case GL_COLOR_INDEX:
+                sprintf(tlogString, "GL_COLOR_INDEX");
+                break;
+            case GL_RGBA16:
+                sprintf(tlogString, "GL_RGBA16");
+                break;
+            case GL_RGBA8:
+                sprintf(tlogString, "GL_RGBA8");
+                break;
+            default:
+                sprintf(tlogString, "GL_???");
             }
-
-            //next element
-            element = element->next;
+            fprintf(tlog, "texobj %d : %dx%d %s\n", HASH_KEY(_texobjs, i), texobj->Width, texobj->Height, tlogString);
         }
     }
 
@@ -4688,6 +6038,31 @@ DLL char* rglD3DGetDevice(void)
     return _d3dDevice;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : rglNullRecord
+    Description : record the null driver's calls to a binary log
+    Inputs      : filename - the log file, or NULL to stop recording
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void rglNullRecord(char* filename)
+{
+    null_record(filename);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglTraceCapture
+    Description : capture the GL entry points to a binary trace for replay.
+                  the RGL_TRACE environment variable does the same from init
+    Inputs      : filename - the trace file, or NULL to stop capturing
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void rglTraceCapture(char* filename)
+{
+    trace_capture(filename);
+}
+
 /*-----------------------------------------------------------------------------
     Name        : rglFeature
     Description : utilize a special feature (extension) of rGL
@@ -4701,6 +6076,8 @@ DLL int rglFeature(unsigned int feature)
     extern GLboolean WINDOWED;
     extern GLboolean SLOW;
 
+    if (TRACING) trace_op(TRACE_Feature, 1, feature);
+
     if (gl_is_shutdown)
     {
         return 0;
@@ -4964,6 +6341,9 @@ DLL unsigned char rglIsFast(unsigned int feature)
 DLL void API glDepthMask(GLboolean flag)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_DepthMask, 1, flag);
+
     if (ctx->DepthWrite != flag)
     {
         ctx->DepthWrite = flag;
@@ -4986,19 +6366,95 @@ DLL void API glColorMask(GLboolean red, GLboolean green, GLboolean blue)
     GLcontext* ctx = CC;
     GLboolean  flag;
 
+    if (TRACING) trace_op(TRACE_ColorMask, 3, red, green, blue);
+
     flag = (red || green || blue) ? GL_TRUE : GL_FALSE;
     if (ctx->ColorWrite != flag)
     {
         ctx->ColorWrite = flag;
         ctx->NewMask |= NEW_RASTER;
     }
-}
+}
+
+typedef struct c4ub_v3f_s
+{
+    GLubyte c[4];
+    GLfloat v[3];
+} c4ub_v3f;
+
+/*-----------------------------------------------------------------------------
+    Name        : trace_draw_arrays
+    Description : record a glDrawArrays along with the part of the vertex array
+                  it's going to read.  the extent mirrors the pointer
+                  arithmetic in glDrawArrays, not the spec
+    Inputs      : ctx - the context
+                  mode, first, count - glDrawArrays' arguments
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void trace_draw_arrays(GLcontext* ctx, GLenum mode, GLint first, GLsizei count)
+{
+    GLuint size, skip, n;
+
+    n = (count > first) ? (GLuint)(count - first) : 0;
+    if (ctx->VertexFormat == GL_C3F_V3F)
+    {
+        size = 6*sizeof(GLfloat);
+        skip = 4*first;
+    }
+    else
+    {
+        size = sizeof(c4ub_v3f);
+        skip = sizeof(c4ub_v3f)*first;
+    }
+
+    trace_op_block(TRACE_DrawArrays, ctx->VertexArray,
+                   (ctx->VertexArray == NULL) ? 0 : (skip + n) * size,
+                   4, mode, first, count, ctx->VertexFormat);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : trace_draw_elements
+    Description : record a glDrawElements with its indices and the vertices
+                  they reference
+    Inputs      : ctx - the context
+                  mode, count, type, indices - glDrawElements' arguments
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void trace_draw_elements(
+    GLcontext* ctx, GLenum mode, GLsizei count, GLenum type, GLuint const* indices)
+{
+    GLuint args[4];
+    GLuint ibytes, vbytes;
+    GLuint maxIndex;
+    GLsizei i;
+
+    maxIndex = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (indices[i] > maxIndex)
+        {
+            maxIndex = indices[i];
+        }
+    }
+
+    ibytes = count * sizeof(GLuint);
+    vbytes = 0;
+    if (ctx->VertexArray != NULL && ctx->VertexFormat == GL_C4UB_V3F && count > 0)
+    {
+        vbytes = (maxIndex + 1) * sizeof(c4ub_v3f);
+    }
 
-typedef struct c4ub_v3f_s
-{
-    GLubyte c[4];
-    GLfloat v[3];
-} c4ub_v3f;
+    args[0] = mode;
+    args[1] = count;
+    args[2] = type;
+    args[3] = ctx->VertexFormat;
+    trace_record(TRACE_DrawElements, 4 + TRACE_BLOCK_WORDS(ibytes) + TRACE_BLOCK_WORDS(vbytes));
+    trace_words(4, args);
+    trace_block(indices, ibytes);
+    trace_block(ctx->VertexArray, vbytes);
+}
 
 /*-----------------------------------------------------------------------------
     Name        : glDrawElements
@@ -5017,12 +6473,22 @@ DLL void API glDrawElements(GLenum mode, GLsizei count, GLenum type, GLvoid cons
     c4ub_v3f* pVert;
     GLint i;
 
+    if (TRACING) trace_draw_elements(ctx, mode, count, type, (GLuint const*)indices);
+
     if (ctx->VertexArray == NULL)
     {
         gl_error(ctx, GL_INVALID_VALUE, "glDrawElements(VertexArray)");
         return;
     }
 
+    //the whole array goes through the VB in one pass
+    if (!ctx->DriverTransforms && count > 0 && !gl_grow_vb(ctx, (GLuint)count))
+    {
+        return;
+    }
+
+    trace_suspend();
+
 #if 0
     if (ctx->VertexFormat == GL_C4UB_V3F &&
         mode == GL_TRIANGLES &&
@@ -5070,12 +6536,14 @@ DLL void API glDrawElements(GLenum mode, GLsizei count, GLenum type, GLvoid cons
 
     default:
         glEnd();
+        trace_resume();
         gl_error(ctx, GL_INVALID_VALUE, "glDrawElements(VertexFormat)");
         return;
     }
 
     VB->Count = count;
     glEnd();
+    trace_resume();
 }
 
 /*-----------------------------------------------------------------------------
@@ -5099,12 +6567,22 @@ DLL void API glDrawArrays(GLenum mode, GLint first, GLsizei count)
     GLboolean depthed = ctx->DepthTest;
     GLboolean depthwrited = ctx->DepthWrite;
 
+    if (TRACING) trace_draw_arrays(ctx, mode, first, count);
+
     if (ctx->VertexArray == NULL)
     {
         gl_error(ctx, GL_INVALID_VALUE, "glDrawArrays(VertexArray)");
         return;
     }
 
+    //the whole array goes through the VB in one pass
+    if (!ctx->DriverTransforms && count > 0 && !gl_grow_vb(ctx, (GLuint)count))
+    {
+        return;
+    }
+
+    trace_suspend();
+
     ctx->ShadeModel = GL_SMOOTH;
     ctx->DepthTest = GL_FALSE;
     ctx->DepthWrite = GL_FALSE;
@@ -5182,6 +6660,8 @@ DLL void API glDrawArrays(GLenum mode, GLint first, GLsizei count)
     if (depthwrited)
         ctx->DepthWrite = GL_TRUE;
     gl_update_raster(ctx);
+
+    trace_resume();
 }
 
 /*-----------------------------------------------------------------------------
@@ -5196,6 +6676,8 @@ DLL void API glInterleavedArrays(GLenum format, GLsizei stride, GLvoid const* po
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_InterleavedArrays, 2, format, stride);
+
     if ((format != GL_C3F_V3F && format != GL_C4UB_V3F) || stride != 0)
     {
         gl_error(ctx, GL_INVALID_VALUE, "glInterLeavedArrays(format or stride)");
@@ -5220,6 +6702,9 @@ DLL void API glInterleavedArrays(GLenum format, GLsizei stride, GLvoid const* po
 DLL void API glVertexPointer(GLint size, GLenum type, GLsizei stride, GLvoid const* pointer)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_VertexPointer, 3, size, type, stride);
+
     ctx->VertexArray = (GLvoid*)pointer;
     ctx->VertexSize  = size;
 }
@@ -5243,6 +6728,12 @@ DLL void API glDisableClientState(GLenum array)
 ----------------------------------------------------------------------------*/
 DLL void API glArrayElement(GLint i)
 {
+    if (TRACING)
+    {
+        GLuint* element = (GLuint*)((GLfloat(*)[4])CC->VertexArray)[i];
+        trace_op(TRACE_ArrayElement, 4, element[0], element[1], element[2], element[3]);
+    }
+
     gl_ArrayElement(i);
 }
 
@@ -5255,6 +6746,11 @@ static void gl_ArrayElement_cnt_3(GLint i)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = array[i][0];
     VB->Obj[count][1] = array[i][1];
     VB->Obj[count][2] = array[i][2];
@@ -5284,6 +6780,11 @@ static void gl_ArrayElement_ct_3(GLint i)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = array[i][0];
     VB->Obj[count][1] = array[i][1];
     VB->Obj[count][2] = array[i][2];
@@ -5309,6 +6810,11 @@ static void gl_ArrayElement_cn_3(GLint i)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = array[i][0];
     VB->Obj[count][1] = array[i][1];
     VB->Obj[count][2] = array[i][2];
@@ -5335,6 +6841,11 @@ static void gl_ArrayElement_c_3(GLint i)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Obj[count][0] = array[i][0];
     VB->Obj[count][1] = array[i][1];
     VB->Obj[count][2] = array[i][2];
@@ -5357,6 +6868,11 @@ static void gl_ArrayElement_ct(GLint i)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Clip[count][0] = array[i][0];
     VB->Clip[count][1] = array[i][1];
     VB->Clip[count][2] = array[i][2];
@@ -5382,6 +6898,11 @@ static void gl_ArrayElement_c(GLint i)
     GLuint* sp;
     GLuint* dp;
 
+    if (count == VB->Max && !gl_grow_vb(ctx, count + 1))
+    {
+        return;
+    }
+
     VB->Clip[count][0] = array[i][0];
     VB->Clip[count][1] = array[i][1];
     VB->Clip[count][2] = array[i][2];
@@ -5448,6 +6969,12 @@ DLL void API glLitColorTable(
     }
 
     //ASSUME: levels == 16
+    if (TRACING)
+    {
+        trace_op_block(TRACE_LitColorTable, palette, 16*256*sizeof(GLushort), 5,
+                       target, internalformat, length, format, type);
+    }
+
     //ignore target
     //ignore internalformat
     //ignore length
@@ -5472,6 +6999,12 @@ DLL void API glColorTable(
 
     gl_texture_object* tex = ctx->TexBoundObject;
 
+    if (TRACING)
+    {
+        trace_op_block(TRACE_ColorTable, palette, 4*256, 5,
+                       target, internalformat, length, format, type);
+    }
+
     //ignore target
     //ignore internalformat
     //ignore length
@@ -5536,6 +7069,9 @@ DLL void API glColorTable(
 DLL void API glPixelTransferf(GLenum pname, GLfloat param)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_PixelTransferf, 2, pname, trace_float(param));
+
     param = CLAMP(param, 0.0f, 1.0f);
 
     switch (pname)
@@ -5582,11 +7118,14 @@ void gl_shutdown()
 {
     GLcontext* ctx = CC;
     GLuint i;
-    hash_t* element;
     gl_texture_object* texobj;
 
     gl_is_shutdown = GL_TRUE;
 
+    trace_capture(NULL);
+
+    gl_mesh_shutdown();
+
     if (sbuf != NULL)
     {
         free(sbuf);
@@ -5602,35 +7141,42 @@ void gl_shutdown()
         ctx->DriverFuncs.shutdown_driver(ctx);
     }
 
-    for (i = 0; i < TABLE_SIZE; i++)
+    for (i = 0; i < HASH_COUNT(_texobjs); i++)
     {
-        element = _texobjs->table[i];
-        while (element != NULL)
+        texobj = (gl_texture_object*)HASH_DATA(_texobjs, i);
+        if (texobj != NULL)
         {
-            texobj = (gl_texture_object*)element->data;
-            if (texobj != NULL)
+            gl_free_teximage(texobj);
+            if (texobj->created && ctx->DriverFuncs.tex_del != NULL)
             {
-                if (texobj->Data != NULL)
-                {
-                    gl_Free(texobj->Data);
-                }
-                if (texobj->created && ctx->DriverFuncs.tex_del != NULL)
-                {
-                    ctx->DriverFuncs.tex_del(texobj);
-                }
-
-                gl_Free(texobj);
+                ctx->DriverFuncs.tex_del(texobj);
             }
 
-            //next chained element
-            element = element->next;
+            gl_Free(texobj);
         }
     }
 
     hashDeleteTable(_texobjs);
+    if (_texshares != NULL)
+    {
+        //emptied as the last users went above
+        hashDeleteTable(_texshares);
+        _texshares = NULL;
+    }
+    pix_arena_free(&mipScratch);
+    pix_arena_free(&texScratch);
 
     gl_free_devices();
 
+    gl_free_vb(ctx->VB);
+    ctx->VB = NULL;
+
+    if (ctx->RasterTables != NULL)
+    {
+        free(ctx->RasterTables);
+        ctx->RasterTables = NULL;
+    }
+
     free(CC);
 
 #if 0
@@ -5699,6 +7245,7 @@ DLL unsigned char rglIsClipped(
     GLcontext* ctx = CC;
     vertex_buffer* VB = ctx->VB;
     GLboolean result;
+    GLfloat guard;
     GLint i;
 
     GLfloat upvector[3] = {1.0f, 0.0f, 0.0f};
@@ -5739,9 +7286,13 @@ DLL unsigned char rglIsClipped(
     VB->Count = 8;
     VB->Start = 0;
 
+    //culling wants the view volume, not the guard band
+    guard = ctx->GuardBand;
+    ctx->GuardBand = 1.0f;
     transform_points3(ctx, 8, VB->Obj, VB->Eye);
     project_and_cliptest(ctx, 8, VB->Eye, VB->Clip, VB->ClipMask,
                          &VB->ClipOrMask, &VB->ClipAndMask);
+    ctx->GuardBand = guard;
 #if 0
     result = VB->ClipAndMask ? GL_TRUE : GL_FALSE;
 #else
@@ -5775,6 +7326,191 @@ PASSED:
     return (unsigned char)result;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : cull_planes
+    Description : the 6 view volume planes in object space, from the rows of
+                  projection * m.  each is scaled so a b c is unit length
+    Inputs      : ctx - the context
+                  m - object -> eye, or NULL for the modelview
+    Outputs     : planes - [6] a b c d, inside where ax + by + cz + d >= 0
+    Return      :
+----------------------------------------------------------------------------*/
+static void cull_planes(GLcontext* ctx, GLfloat const* m, GLfloat planes[6][4])
+{
+    GLfloat pm[16];
+    GLfloat const* c;
+    GLfloat len;
+    GLuint i, k;
+
+    if (m == NULL)
+    {
+        gl_update_mvp();
+        c = ctx->ModelViewProjectionMatrix;
+    }
+    else
+    {
+        if (ctx->NewMask & NEW_PROJECTION)
+        {
+            gl_update_projection();
+        }
+        mat4_mult(pm, ctx->ProjectionMatrix, m);
+        c = pm;
+    }
+
+    //w - x, w + x, w - y, w + y, w - z, w + z
+    for (i = 0; i < 4; i++)
+    {
+        planes[0][i] = c[4*i + 3] - c[4*i + 0];
+        planes[1][i] = c[4*i + 3] + c[4*i + 0];
+        planes[2][i] = c[4*i + 3] - c[4*i + 1];
+        planes[3][i] = c[4*i + 3] + c[4*i + 1];
+        planes[4][i] = c[4*i + 3] - c[4*i + 2];
+        planes[5][i] = c[4*i + 3] + c[4*i + 2];
+    }
+
+    for (k = 0; k < 6; k++)
+    {
+        len = fsqrtf(planes[k][0] * planes[k][0] +
+                     planes[k][1] * planes[k][1] +
+                     planes[k][2] * planes[k][2]);
+        if (len > 0.0f)
+        {
+            len = 1.0f / len;
+            for (i = 0; i < 4; i++)
+            {
+                planes[k][i] *= len;
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cull
+    Description : rglCullBoxes / rglCullSpheres.  a box is culled if its
+                  corner furthest along some plane's normal is behind that
+                  plane, a sphere if its centre is more than its radius
+                  behind one.  this is conservative: a box across the corner
+                  of the view volume can pass every plane and still be
+                  outside
+    Inputs      : shape - SIMD_CULL_BOXES or SIMD_CULL_SPHERES
+                  n - number of boxes / spheres
+                  s - the boxes / spheres
+                  m - object -> eye, or NULL for the modelview
+    Outputs     : visible - (n + 31) / 32 words, bit i set if i may be seen
+    Return      : the number of bits set
+----------------------------------------------------------------------------*/
+static GLuint cull(
+    GLuint shape, GLuint n, GLfloat const* s, GLfloat const* m, GLuint* visible)
+{
+    GLcontext* ctx = CC;
+    GLfloat planes[6][4];
+    GLuint stride = (shape == SIMD_CULL_SPHERES) ? 4 : 6;
+    GLuint i, k, count;
+
+    cull_planes(ctx, m, planes);
+
+    MEMSET(visible, 0, ((n + 31) >> 5) * sizeof(GLuint));
+
+#if SIMD_X86
+    if (n >= SIMD_THRESH)
+    {
+        if (ctx->CpuAVX2)
+        {
+            return simd_avx2_cull(shape, n, s, planes, visible);
+        }
+        else if (ctx->CpuSSE2)
+        {
+            return simd_sse2_cull(shape, n, s, planes, visible);
+        }
+    }
+#endif
+
+    count = 0;
+    for (i = 0; i < n; i++, s += stride)
+    {
+        GLfloat cx, cy, cz, ex, ey, ez;
+
+        if (shape == SIMD_CULL_SPHERES)
+        {
+            cx = s[0];
+            cy = s[1];
+            cz = s[2];
+            ex = s[3];
+            ey = ez = 0.0f;
+        }
+        else
+        {
+            //the lengths may be negative
+            cx = s[0] + 0.5f * s[3];
+            cy = s[1] + 0.5f * s[4];
+            cz = s[2] + 0.5f * s[5];
+            ex = (GLfloat)fabs(0.5f * s[3]);
+            ey = (GLfloat)fabs(0.5f * s[4]);
+            ez = (GLfloat)fabs(0.5f * s[5]);
+        }
+
+        for (k = 0; k < 6; k++)
+        {
+            GLfloat const* p = planes[k];
+            GLfloat d = p[0] * cx + p[1] * cy + p[2] * cz + p[3];
+            if (shape == SIMD_CULL_SPHERES)
+            {
+                d += ex;
+            }
+            else
+            {
+                d += (GLfloat)fabs(p[0]) * ex + (GLfloat)fabs(p[1]) * ey + (GLfloat)fabs(p[2]) * ez;
+            }
+            if (d < 0.0f)
+            {
+                break;
+            }
+        }
+        if (k == 6)
+        {
+            visible[i >> 5] |= 1u << (i & 31);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglCullBoxes
+    Description : batch version of rglIsClipped: test n boxes against the
+                  view volume with a plane test instead of clipping 12
+                  edges each.  see cull for how conservative it is
+    Inputs      : n - number of boxes
+                  boxes - [n][6], rglIsClipped's collrectoffset then
+                  uplength, rightlength, forwardlength (the x, y & z sizes)
+                  m - object -> eye for the boxes, or NULL for the modelview
+    Outputs     : visible - (n + 31) / 32 words, bit i set unless box i is
+                  wholly outside the view volume
+    Return      : the number of boxes that may be visible
+----------------------------------------------------------------------------*/
+DLL GLuint rglCullBoxes(GLuint n, GLfloat const* boxes, GLfloat const* m, GLuint* visible)
+{
+    return cull(SIMD_CULL_BOXES, n, boxes, m, visible);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglCullSpheres
+    Description : as rglCullBoxes, for bounding spheres
+    Inputs      : n - number of spheres
+                  spheres - [n][4], x y z centre and radius
+                  m - object -> eye for the spheres, or NULL for the
+                  modelview.  with a non-uniform scale the radius is taken
+                  in object space
+    Outputs     : visible - (n + 31) / 32 words, bit i set unless sphere i
+                  is wholly outside the view volume
+    Return      : the number of spheres that may be visible
+----------------------------------------------------------------------------*/
+DLL GLuint rglCullSpheres(GLuint n, GLfloat const* spheres, GLfloat const* m, GLuint* visible)
+{
+    return cull(SIMD_CULL_SPHERES, n, spheres, m, visible);
+}
+
 /*-----------------------------------------------------------------------------
     Name        : rglDrawLightVectors
     Description : renders vectors corresponding to the direction of a GL light
@@ -5816,6 +7552,13 @@ DLL void API glDrawPixels(
 {
     GLboolean animatic;
     GLcontext* ctx = CC;
+
+    if (TRACING)
+    {
+        trace_op_block(TRACE_DrawPixels, pixels, trace_image_size(format, width, height), 4,
+                       width, height, format, type);
+    }
+
     ctx->Current.Bitmap = (GLubyte*)pixels;
 
     if ((format == GL_RGB || format == GL_RGBA16) && width == 640 && height == 480)
@@ -5883,6 +7626,9 @@ DLL void API glReadPixels(
 DLL void API glFogi(GLenum pname, GLint param)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Fogi, 2, pname, param);
+
     if (pname == GL_FOG_MODE)
     {
         ctx->FogMode = param;
@@ -5903,6 +7649,9 @@ DLL void API glFogi(GLenum pname, GLint param)
 DLL void API glFogf(GLenum pname, GLfloat param)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Fogf, 2, pname, trace_float(param));
+
     if (pname == GL_FOG_DENSITY)
     {
         ctx->FogDensity = param;
@@ -5923,6 +7672,9 @@ DLL void API glFogf(GLenum pname, GLfloat param)
 DLL void API glFogfv(GLenum pname, GLfloat const* params)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op_fv(TRACE_Fogfv, 0, pname, params);
+
     if (pname == GL_FOG_COLOR)
     {
         V4_COPY(ctx->FogColor, params);
@@ -5946,6 +7698,8 @@ DLL void API glOrtho(GLdouble left, GLdouble right, GLdouble bottom, GLdouble to
     GLfloat tx, ty, tz;
     GLfloat m[16];
 
+    if (TRACING) trace_op_doubles(TRACE_Ortho, 6, left, right, bottom, top, nearval, farval);
+
     x = 2.0 / (right - left);
     y = 2.0 / (top - bottom);
     z = -2.0 / (farval - nearval);
@@ -5960,7 +7714,9 @@ DLL void API glOrtho(GLdouble left, GLdouble right, GLdouble bottom, GLdouble to
     M(3,0) = 0.0F; M(3,1) = 0.0F; M(3,2) = 0.0F; M(3,3) = 1.0F;
 #undef M
 
+    trace_suspend();
     glMultMatrixf(m);
+    trace_resume();
 }
 
 /*-----------------------------------------------------------------------------
@@ -5989,6 +7745,46 @@ DLL GLuint rglCulledPolys()
     return g_CulledPolys;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : rglMaterialSwitches
+    Description : returns g_MaterialSwitches, the number of times rglMeshRender
+                  has called its material callback since the last Flush
+    Inputs      :
+    Outputs     :
+    Return      : g_MaterialSwitches
+----------------------------------------------------------------------------*/
+DLL GLuint rglMaterialSwitches()
+{
+    return g_MaterialSwitches;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglModelViewInverses
+    Description : returns g_ModelViewInverses, the number of times the
+                  modelview has been inverted since the last Flush.  an
+                  inverse restored by glPopMatrix isn't counted
+    Inputs      :
+    Outputs     :
+    Return      : g_ModelViewInverses
+----------------------------------------------------------------------------*/
+DLL GLuint rglModelViewInverses()
+{
+    return g_ModelViewInverses;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglClippedPolys
+    Description : returns g_ClippedPolys, the number of polygons that have
+                  gone down the clipping path since the last Flush
+    Inputs      :
+    Outputs     :
+    Return      : g_ClippedPolys
+----------------------------------------------------------------------------*/
+DLL GLuint rglClippedPolys()
+{
+    return g_ClippedPolys;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : rglAnotherPoly
     Description : externally accessible way to increment g_NumPolys
@@ -6012,6 +7808,9 @@ DLL void rglAnotherPoly()
 DLL void rglSpecExp(GLint index, GLfloat exp)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_SpecExp, 2, index, trace_float(exp));
+
     if (index < 0 || index > 2)
     {
         gl_error(ctx, GL_INVALID_VALUE, "rglSpecExp(index)");
@@ -6021,6 +7820,35 @@ DLL void rglSpecExp(GLint index, GLfloat exp)
     ctx->SpecularExponent[index] = (exp == -1.0f) ? ctx->SpecularDefault[index] : exp;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : rglSpecPow
+    Description : choose how the SPECHACK shaders raise n.v to the specular
+                  exponent
+    Inputs      : mode - RGL_SPECPOW_EXACT (libm pow), RGL_SPECPOW_TABLE
+                  (interpolated per exponent tables; the error grows with
+                  the exponent's square, 1.3e-5 at 11 and 2e-3 at 128) or
+                  RGL_SPECPOW_APPROX (single precision exp2 / log2
+                  polynomials, within 4e-6 up to 128)
+    Outputs     : ctx->SpecularPow is set to mode
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void rglSpecPow(GLint mode)
+{
+    GLcontext* ctx = CC;
+
+    switch (mode)
+    {
+    case RGL_SPECPOW_EXACT:
+    case RGL_SPECPOW_TABLE:
+    case RGL_SPECPOW_APPROX:
+        ctx->SpecularPow = mode;
+        break;
+
+    default:
+        gl_error(ctx, GL_INVALID_ENUM, "rglSpecPow(mode)");
+    }
+}
+
 /*-----------------------------------------------------------------------------
     Name        : rglLightingAdjust
     Description : hook for fading (w/ alpha or -> black) the colour of vertices
@@ -6031,6 +7859,9 @@ DLL void rglSpecExp(GLint index, GLfloat exp)
 DLL void rglLightingAdjust(GLfloat adj)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_LightingAdjust, 1, trace_float(adj));
+
     if (adj < 0.0f || adj > 1.0f)
     {
         gl_error(ctx, GL_INVALID_VALUE, "rglLightingAdjust(adj)");
@@ -6040,6 +7871,37 @@ DLL void rglLightingAdjust(GLfloat adj)
     ctx->LightingAdjust = adj;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : rglGuardBand
+    Description : widen the x & y clip planes to +-size * w.  a polygon
+                  that only crosses the screen edges inside the band is no
+                  longer clipped geometrically but drawn as it is, leaving
+                  the rasterizer to scissor it; near & far are still
+                  clipped.  triangles wholly offscreen but inside the band
+                  aren't rejected either, so the band is held to what the
+                  driver reports its rasterizer takes (gl_driver_guard_band)
+                  and stays off for a driver that reports none
+    Inputs      : size - >= 1.  1 (the default) turns the guard band off
+    Outputs     : ctx->GuardBand is set to size, or as much of it as fits
+                  the driver's guard band
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void rglGuardBand(GLfloat size)
+{
+    GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_GuardBand, 1, trace_float(size));
+
+    if (!(size >= 1.0f))
+    {
+        gl_error(ctx, GL_INVALID_VALUE, "rglGuardBand(size)");
+        return;
+    }
+
+    ctx->GuardBandSize = size;
+    update_guard_band(ctx);
+}
+
 /*-----------------------------------------------------------------------------
     Name        : glLightModeli
     Description : control lighting model parameters
@@ -6053,6 +7915,9 @@ DLL void rglLightingAdjust(GLfloat adj)
 DLL void API glLightModeli(GLenum pname, GLint param)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_LightModeli, 2, pname, param);
+
     switch (pname)
     {
     case GL_LIGHT_MODEL_TWO_SIDE:
@@ -6075,12 +7940,39 @@ DLL void API glLightModeli(GLenum pname, GLint param)
 DLL void rglEnable(GLint cap)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_rglEnable, 1, cap);
+
     switch (cap)
     {
     case RGL_RASTERIZE_ONLY:
         ctx->RasterizeOnly = GL_TRUE;
         break;
 
+    case RGL_INDEXED_TRIANGLES:
+        ctx->IndexedTriangles = GL_TRUE;
+        break;
+
+    case RGL_MESH_PRETRANSFORM:
+        ctx->MeshPretransform = GL_TRUE;
+        break;
+
+    case RGL_MESH_SORT:
+        ctx->MeshSortMaterials = GL_TRUE;
+        break;
+
+    case RGL_MIPMAPS:
+        ctx->Mipmaps = GL_TRUE;
+        break;
+
+    case RGL_TEXTURE_RETAIN:
+        ctx->TexRetain = GL_TRUE;
+        break;
+
+    case RGL_TEXTURE_SHARE:
+        ctx->TexShare = GL_TRUE;
+        break;
+
     case RGL_D3D_FULLSCENE:
         if (ctx->DriverFuncs.fullscene != NULL)
         {
@@ -6103,12 +7995,39 @@ DLL void rglEnable(GLint cap)
 DLL void rglDisable(GLint cap)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_rglDisable, 1, cap);
+
     switch (cap)
     {
     case RGL_RASTERIZE_ONLY:
         ctx->RasterizeOnly = GL_FALSE;
         break;
 
+    case RGL_INDEXED_TRIANGLES:
+        ctx->IndexedTriangles = GL_FALSE;
+        break;
+
+    case RGL_MESH_PRETRANSFORM:
+        ctx->MeshPretransform = GL_FALSE;
+        break;
+
+    case RGL_MESH_SORT:
+        ctx->MeshSortMaterials = GL_FALSE;
+        break;
+
+    case RGL_MIPMAPS:
+        ctx->Mipmaps = GL_FALSE;
+        break;
+
+    case RGL_TEXTURE_RETAIN:
+        ctx->TexRetain = GL_FALSE;
+        break;
+
+    case RGL_TEXTURE_SHARE:
+        ctx->TexShare = GL_FALSE;
+        break;
+
     case RGL_D3D_FULLSCENE:
         if (ctx->DriverFuncs.fullscene != NULL)
         {
@@ -6131,6 +8050,9 @@ DLL void rglDisable(GLint cap)
 DLL void glSuperClear()
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_SuperClear, 0);
+
     if (ctx->DriverFuncs.super_clear != NULL)
     {
         ctx->DriverFuncs.super_clear();
@@ -6151,6 +8073,9 @@ DLL void glSuperClear()
 DLL void API glHint(GLenum target, GLenum mode)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING) trace_op(TRACE_Hint, 2, target, mode);
+
     switch (target)
     {
     case GL_PERSPECTIVE_CORRECTION_HINT:
@@ -6202,6 +8127,8 @@ DLL void API glPolygonMode(GLenum face, GLenum mode)
 {
     GLcontext* ctx = CC;
 
+    if (TRACING) trace_op(TRACE_PolygonMode, 2, face, mode);
+
     switch (mode)
     {
     case GL_FILL:
@@ -6227,6 +8154,13 @@ DLL void API glClipPlane(GLenum plane, GLdouble const* equation)
     GLfloat fequation[4];
     GLint p;
 
+    if (TRACING)
+    {
+        trace_record(TRACE_ClipPlane, 9);
+        trace_words(1, &plane);
+        trace_words(8, (GLuint const*)equation);
+    }
+
     for (p = 0; p < 4; p++)
     {
         fequation[p] = (GLfloat)equation[p];
@@ -6299,7 +8233,12 @@ DLL void API glGetTexImage(GLenum target, GLint level, GLenum format, GLenum typ
 
     if (tex != NULL && tex->created)
     {
-        if (tex->Format == GL_RGBA)
+        if (tex->Data == NULL)
+        {
+            //not kept, see RGL_TEXTURE_RETAIN
+            gl_error(ctx, GL_INVALID_OPERATION, "glGetTexImage(not retained)");
+        }
+        else if (tex->Format == GL_RGBA)
         {
             MEMCPY(pixels, tex->Data, 4*tex->Width*tex->Height);
         }
@@ -6419,6 +8358,13 @@ DLL void rglDrawPitchedPixels(
     GLvoid const* pixels)
 {
     GLcontext* ctx = CC;
+
+    if (TRACING)
+    {
+        trace_op_block(TRACE_DrawPitchedPixels, pixels, pitch*height, 7,
+                       x0, y0, x1, y1, width, height, pitch);
+    }
+
     if (ctx->DriverFuncs.draw_pitched_pixels != NULL)
     {
         ctx->DriverFuncs.draw_pitched_pixels(x0, y0, x1, y1,
@@ -6433,15 +8379,28 @@ static struct __extensions__ ext[] =
     { (pROC)glLitColorTable, "glLitColorTableEXT" },
     { (pROC)rglFeature, "rglFeature" },
     { (pROC)rglSpecExp, "rglSpecExp" },
+    { (pROC)rglSpecPow, "rglSpecPow" },
     { (pROC)rglLightingAdjust, "rglLightingAdjust" },
+    { (pROC)rglGuardBand, "rglGuardBand" },
     { (pROC)rglSaveCursorUnder, "rglSaveCursorUnder" },
     { (pROC)rglRestoreCursorUnder, "rglRestoreCursorUnder" },
     { (pROC)rglIsFast, "rglIsFast" },
     { (pROC)rglCreateWindow, "rglCreateWindow" },
     { (pROC)rglDeleteWindow, "rglDeleteWindow" },
     { (pROC)rglIsClipped, "rglIsClipped" },
+    { (pROC)rglCullBoxes, "rglCullBoxes" },
+    { (pROC)rglCullSpheres, "rglCullSpheres" },
     { (pROC)rglNumPolys, "rglNumPolys" },
     { (pROC)rglCulledPolys, "rglCulledPolys" },
+    { (pROC)rglMaterialSwitches, "rglMaterialSwitches" },
+    { (pROC)rglModelViewInverses, "rglModelViewInverses" },
+    { (pROC)rglClippedPolys, "rglClippedPolys" },
+    { (pROC)rglVertexBufferSize, "rglVertexBufferSize" },
+    { (pROC)rglVertexBufferGrowths, "rglVertexBufferGrowths" },
+    { (pROC)rglRetainedTextureBytes, "rglRetainedTextureBytes" },
+    { (pROC)rglSharedTextureLookups, "rglSharedTextureLookups" },
+    { (pROC)rglSharedTextureHits, "rglSharedTextureHits" },
+    { (pROC)rglSharedTextureBytes, "rglSharedTextureBytes" },
     { (pROC)rglBackground, "rglBackground" },
     { (pROC)rglSetAllocs, "rglSetAllocs" },
     { (pROC)glSuperClear, "rglSuperClear" },
@@ -6455,17 +8414,19 @@ static struct __extensions__ ext[] =
     { (pROC)rglSmoothTriangle, "rglSmoothTriangle" },
     { (pROC)rglSmoothTexturedTriangle, "rglSmoothTexturedTriangle" },
     { (pROC)rglMeshRender, "rglMeshRender" },
+    { (pROC)rglMeshStats, "rglMeshStats" },
     { (pROC)rauxInitPosition, "rauxInitPosition" },
     { (pROC)rglSelectDevice, "rglSelectDevice" },
     { (pROC)rglD3DSetDevice, "rglD3DSetDevice" },
     { (pROC)rglD3DGetDevice, "rglD3DGetDevice" },
     { (pROC)rglGetFramebuffer, "rglGetFramebuffer" },
-    { (pROC)rglDrawPitchedPixels, "rglDrawPitchedPixels" }
+    { (pROC)rglDrawPitchedPixels, "rglDrawPitchedPixels" },
+    { (pROC)rglTraceCapture, "rglTraceCapture" }
 };
 
 static int qt_ext = sizeof(ext) / sizeof(ext[0]);
 
-pROC rglGetProcAddress(LPCSTR lpszProc)
+pROC rglGetProcAddress(char const* lpszProc)
 {
     int i;
 
@@ -45,7 +45,7 @@ illegal number of depth bits
 extern GLint g_DepthMask;
 
 #define Z_ADDRESS(CTX, X, Y) \
-    (CTX->DepthBuffer + zMult[Y] + (X))
+    (CTX->DepthBuffer + CTX->zMult[Y] + (X))
 
 #define CTX_Z_ADDRESS(CTX, X, Y) \
     (CTX->DepthBuffer + CTX->zMult[Y] + (X))
@@ -108,9 +108,10 @@ typedef unsigned int GLenum;
 
 #define MAX_LIGHTS		3
 
-// TODO: Remove and dynamically allocate arrays instead of hardcoding
-#define MAX_WIDTH		3840
-#define MAX_HEIGHT		2160
+/* rows past the bottom of the buffer that the row tables still cover
+   (aliasing row 1).  the tables themselves are sized from the buffer, see
+   MaxWidth / MaxHeight */
+#define RASTER_GUARD_ROWS	16
 
 #define MAX_MODELVIEW_STACK_DEPTH	16
 #define MAX_PROJECTION_STACK_DEPTH	8
@@ -121,7 +122,8 @@ typedef unsigned int GLenum;
 #define NEW_PROJECTION      0x4
 #define NEW_MODELVIEWINV    0x8
 #define NEW_RASTER          0x10
-#define NEW_ALL             0x1f
+#define NEW_MVP             0x20
+#define NEW_ALL             0x3f
 
 typedef struct device_s
 {
@@ -159,8 +161,38 @@ typedef struct gl_texture_object_s
     GLvoid  *DriverData;    //optional Driver-specific data
 
     GLubyte* Palette;
+
+    GLuint   MipLevels;     //levels below 0 in Mips, see gl_texture_mipmaps
+    GLubyte* Mips;          //RGBA levels 1..MipLevels, one after another
+
+    GLuint   DataBytes;     //of Data if the GL holds it, 0 if it's the caller's
+
+    struct gl_texture_share_s* Share;       //the image it shares, see RGL_TEXTURE_SHARE
+    struct gl_texture_object_s* ShareNext;  //the next texture sharing it
 } gl_texture_object;
 
+/* an image uploaded to more than one texture object with RGL_TEXTURE_SHARE
+   on.  its users' Data & Mips point at the share's, which the share owns,
+   and the driver has one device texture for them all (tex_share) */
+typedef struct gl_texture_share_s
+{
+    hash64  Key;            //of format, size, palette, mip wanting & texels
+    GLuint  Refs;           //users
+    gl_texture_object* Users;   //linked through ShareNext
+    struct gl_texture_share_s* Next;    //shares whose Key folds to the same uint
+
+    GLenum  Format;
+    GLuint  Width, Height;
+    GLuint  ImageBytes;     //of level 0 & the chain, kept or not
+
+    GLubyte* Data;          //NULL if the driver didn't want it kept
+    GLuint   DataBytes;
+    GLuint   MipLevels;
+    GLubyte* Mips;
+
+    hash64  Check;          //the key seeded apart, to confirm a match if no Data
+} gl_texture_share;
+
 /* texture object hashtable */
 extern hashtable* _texobjs;
 
@@ -215,6 +247,26 @@ typedef struct gl_light_s
     struct gl_light_s* next;
 } gl_light;
 
+/* the active lights, in ActiveLight order, flattened by gl_update_lighting
+   for the vector shading kernels (simd.c).  each array has one entry per
+   light so a kernel can broadcast a light's terms across its vertices */
+typedef struct gl_light_block_s
+{
+    GLuint  Count;
+    GLfloat Px[MAX_LIGHTS];         //eye space position, or VP_inf_norm
+    GLfloat Py[MAX_LIGHTS];         //for a directional light
+    GLfloat Pz[MAX_LIGHTS];
+    GLboolean Positional[MAX_LIGHTS];
+    GLfloat Dx[MAX_LIGHTS];         //VP_inf_norm
+    GLfloat Dy[MAX_LIGHTS];
+    GLfloat Dz[MAX_LIGHTS];
+    GLfloat K0[MAX_LIGHTS];         //attenuation
+    GLfloat K1[MAX_LIGHTS];
+    GLfloat K2[MAX_LIGHTS];
+    GLfloat Ambient[2][3][MAX_LIGHTS];  //light * material, per side
+    GLfloat Diffuse[2][3][MAX_LIGHTS];
+} gl_light_block;
+
 typedef struct gl_viewport_s
 {
     GLint X, Y;
@@ -244,6 +296,8 @@ typedef struct gl_attrib_s
     } val;
 } gl_attrib;
 
+struct gl_context_s;
+
 typedef struct gl_driver_funcs_s
 {
     /* some of these may be NULL, so check before using */
@@ -432,6 +486,24 @@ typedef struct gl_driver_funcs_s
 
     //rglDrawPitchedPixels
     void (*draw_pitched_pixels)(GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei, GLvoid const*);
+
+    //count/3 smooth shaded, unclipped triangles indexing the current VB's
+    //post-transform vertices, all in [start, end].  one call per VB (or per
+    //run of triangles between clipped polygons) instead of a draw_triangle each
+    //draw_indexed_triangles(GLuint start, GLuint end, GLsizei count, GLuint const* indices)
+    void (*draw_indexed_triangles)(GLuint, GLuint, GLsizei, GLuint const*);
+
+    //with RGL_TEXTURE_RETAIN off, asked after tex_img whether the driver
+    //will read tex->Data or tex->Mips again (to reload after a device loss,
+    //say).  NULL is always TRUE
+    //GLboolean tex_retain(gl_texture_object* tex)
+    GLboolean (*tex_retain)(gl_texture_object*);
+
+    //with RGL_TEXTURE_SHARE on, tex's image turned out to be src's: make
+    //tex use src's device texture rather than a tex_img of its own.  NULL
+    //falls back to tex_img
+    //void tex_share(gl_texture_object* tex, gl_texture_object* src)
+    void (*tex_share)(gl_texture_object*, gl_texture_object*);
 } gl_driver_funcs;
 
 #include "kvb.h"
@@ -505,6 +577,8 @@ typedef struct gl_context_s
     GLuint      CpuType;
     GLboolean   CpuMMX;
     GLboolean   CpuKatmai;
+    GLboolean   CpuSSE2;
+    GLboolean   CpuAVX2;
 
     /* lighting */
     GLenum	    ShadeModel;		/* GL_FLAT, GL_SMOOTH */
@@ -605,6 +679,68 @@ typedef struct gl_context_s
     GLboolean Speedy;
 
     GLint D3DReference;
+
+    /* hand unclipped triangles to draw_indexed_triangles, default GL_TRUE */
+    GLboolean IndexedTriangles;
+
+    /* rglMeshRender puts each mesh vertex in the VB once, default GL_TRUE */
+    GLboolean MeshPretransform;
+
+    /* rglMeshRender draws polys grouped by material, default GL_FALSE */
+    GLboolean MeshSortMaterials;
+
+    /* the buffer size scrMult & co and SpanBuffer were allocated for,
+       reallocated by _rgl_init when the resolution changes */
+    GLuint MaxWidth;
+    GLuint MaxHeight;
+    GLubyte* SpanBuffer;    //MaxWidth 565 pixels + alphas, 8 byte aligned
+    void* RasterTables;     //the allocation behind the above
+
+    /* how the spechack shaders take x^SpecularExponent, default
+       RGL_SPECPOW_TABLE */
+    GLint SpecularPow;
+
+    /* ActiveLight as the vector shading kernels want it */
+    gl_light_block LightBlock;
+
+    /* ProjectionMatrix * ModelViewMatrix, see gl_update_mvp */
+    GLfloat ModelViewProjectionMatrix[16];
+    GLint   ModelViewProjectionMatrixType;
+
+    /* ModelViewInv alongside each ModelViewStack entry, restored by
+       glPopMatrix if it was up to date at the push */
+    GLfloat   ModelViewInvStack[MAX_MODELVIEW_STACK_DEPTH][16];
+    GLboolean ModelViewInvStackValid[MAX_MODELVIEW_STACK_DEPTH];
+
+    /* the x & y clip planes sit at +-GuardBand * w, see rglGuardBand.
+       default 1.0f, the view volume */
+    GLfloat GuardBand;
+
+    /* the size rglGuardBand asked for, and the pixels the driver's
+       rasterizer takes past the buffer's left & right (X) and top & bottom
+       (Y) edges, see gl_driver_guard_band.  GuardBand is the size cut down
+       to what fits those for the viewport; 0 margins (the default) keep
+       it at 1 */
+    GLfloat GuardBandSize;
+    GLfloat GuardBandX, GuardBandY;
+
+    /* glTexImage2D builds mip chains whatever the min filter, see
+       RGL_MIPMAPS.  default GL_FALSE */
+    GLboolean Mipmaps;
+
+    /* glTexImage2D copies the caller's texels into tex->Data before the
+       driver's tex_img.  if GL_FALSE, tex_img reads them where they are and
+       the GL only copies them after if the driver's tex_retain wants them.
+       see RGL_TEXTURE_RETAIN, default GL_TRUE */
+    GLboolean TexRetain;
+
+    /* glTexImage2D looks each image up by a hash of its contents, and a
+       texture whose image is already uploaded shares that copy & device
+       texture.  a kept image is compared texel for texel; one the driver
+       didn't want kept is matched on a second, independently seeded
+       64 bit hash as well, so a false share takes both colliding.  see
+       RGL_TEXTURE_SHARE, default GL_FALSE */
+    GLboolean TexShare;
 } gl_context;
 
 typedef gl_context GLcontext;
@@ -612,9 +748,14 @@ typedef gl_context GLcontext;
 void gl_update_modelview();
 void gl_invert_modelview();
 void gl_update_projection();
+void gl_update_mvp();
 void gl_update_lighting(GLcontext*);
 void gl_update_raster(GLcontext*);
 
+void* gl_Allocate(GLint size);
+void gl_Free(void* data);
+void gl_mesh_shutdown(void);
+
 DLL void API glFlush();
 
 DLL void rauxInitDisplayMode(GLuint flags);
@@ -657,6 +798,17 @@ DLL int  rauxInitPosition(GLuint x, GLuint y, GLuint width, GLuint height, GLuin
 #define RGL_RASTERIZE_ONLY  0x9002
 #define RGL_BROKEN_MIXED_DEPTHTEST 0x9003
 #define RGL_COLOROP_ADD     0x9004
+#define RGL_INDEXED_TRIANGLES 0x9005
+#define RGL_MESH_PRETRANSFORM 0x9006
+#define RGL_MESH_SORT       0x9007
+#define RGL_MIPMAPS         0x9008
+#define RGL_TEXTURE_RETAIN  0x9009
+#define RGL_TEXTURE_SHARE   0x900A
+
+/* rglSpecPow modes */
+#define RGL_SPECPOW_EXACT   0x9010
+#define RGL_SPECPOW_TABLE   0x9011
+#define RGL_SPECPOW_APPROX  0x9012
 
 #define RGL_FEATURE_ALPHA	0x3000
 #define RGL_FEATURE_BLEND	0x3001
@@ -687,6 +839,7 @@ typedef GLint (*MemFreeFunc)(void* pointer);
 DLL gl_texture_object* rglGetTexobj(GLuint name);
 DLL GLuint rglGetMaxTexobj(void);
 DLL hashtable* rglGetTexobjs(void);
+DLL GLubyte* rglGetTexLevel(gl_texture_object* tex, GLint level, GLsizei* width, GLsizei* height);
 DLL void rglAnotherPoly(void);
 
 DLL GLubyte* API glGetString(GLenum cap);
@@ -735,6 +888,7 @@ DLL void API glMaterialfv(GLenum face, GLenum pname, GLfloat const* params);
 
 DLL void API glBegin(GLenum p);
 DLL void API glEnd();
+DLL void API glVertex4fv(GLfloat const* v);
 DLL void API glVertex3f(GLfloat x, GLfloat y, GLfloat z);
 DLL void API glVertex3fv(GLfloat const* v);
 DLL void API glVertex2f(GLfloat x, GLfloat y);
@@ -864,12 +1018,41 @@ DLL GLint rglCreate2(void);
 DLL void  rglD3DSetDevice(char* dev);
 DLL char* rglD3DGetDevice(void);
 
+DLL void rglSetAllocs(MemAllocFunc allocFunc, MemFreeFunc freeFunc);
+DLL GLuint rglNumPolys();
+DLL GLuint rglCulledPolys();
+DLL GLuint rglMaterialSwitches();
+DLL GLuint rglModelViewInverses();
+DLL GLuint rglClippedPolys();
+DLL GLuint rglVertexBufferSize(GLuint n);
+DLL GLuint rglVertexBufferGrowths();
+DLL GLuint rglRetainedTextureBytes();
+DLL GLuint rglSharedTextureLookups();
+DLL GLuint rglSharedTextureHits();
+DLL GLuint rglSharedTextureBytes();
+DLL void rglSpecExp(GLint index, GLfloat exp);
+DLL void rglSpecPow(GLint mode);
+DLL void rglLightingAdjust(GLfloat adj);
+DLL void rglGuardBand(GLfloat size);
+DLL GLuint rglCullBoxes(GLuint n, GLfloat const* boxes, GLfloat const* m, GLuint* visible);
+DLL GLuint rglCullSpheres(GLuint n, GLfloat const* spheres, GLfloat const* m, GLuint* visible);
+DLL void rglEnable(GLint cap);
+DLL void rglDisable(GLint cap);
+DLL void rglDrawPitchedPixels(
+    GLint x0, GLint y0, GLint x1, GLint y1,
+    GLsizei width, GLsizei height, GLsizei pitch,
+    GLvoid const* pixels);
+DLL void rglNullRecord(char* filename);
+DLL void rglTraceCapture(char* filename);
+
 void gl_classify_modelview();
 void gl_classify_projection();
 
 extern GLint g_DepthMask;
 
 DLL GLcontext* gl_get_context_ext();
+DLL void gl_driver_guard_band(GLcontext* ctx, GLfloat left, GLfloat top,
+                              GLfloat right, GLfloat bottom);
 
 DLL void API glGetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint* params);
 
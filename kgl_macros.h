@@ -6,8 +6,22 @@
 #define MEMSET memset
 #define MIN2(X, Y) ((X) < (Y) ? (X) : (Y))
 
+#ifdef _MSC_VER
 #define DLL __declspec(dllexport)
 #define API __stdcall
+#else
+#define DLL
+#define API
+#endif
+
+//MSVC inline asm (asm.c & friends) is only available on 32bit x86
+#ifndef RGL_ASM
+#if defined(_MSC_VER) && defined(_M_IX86)
+#define RGL_ASM 1
+#else
+#define RGL_ASM 0
+#endif
+#endif
 
 #define LOCK_BUFFER(CTX) \
     if (CTX->DriverFuncs.lock_buffer != NULL) \
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #include <assert.h>
 #include "kgl.h"
 #include "kgl_macros.h"
@@ -17,17 +18,16 @@
 #include "maths.h"
 #include "clip.h"
 #include "asm.h"
+#include "simd.h"
 
 #define KATMAI_THRESH_3D  61
 #define KATMAI_THRESH_PER 125
 
 double chop_temp;
 
-extern GLint scrMultByte[];
-extern GLint scrMult[];
-
 extern GLuint g_NumPolys;
 extern GLuint g_CulledPolys;
+extern GLuint g_ClippedPolys;
 
 #define PARANOID_W              0
 #define DRIVER_TRIANGLE_FAN     0
@@ -36,7 +36,7 @@ extern GLuint g_CulledPolys;
 #define FANCY_RESET 0
 
 #define EPSILON -0.8e-03f
-#define C_MATH  0
+#define C_MATH  (!RGL_ASM)
 
 #define CALL_TRIANGLE(CTX,VL,PV) \
     { \
@@ -56,11 +56,157 @@ extern GLuint g_CulledPolys;
         } \
     }
 
+/* unclipped triangles of the VB being rendered, collected by render_triangle
+   and render_quad when the driver takes indexed triangles (see gl_render_vb)
+   and handed over in one draw_indexed_triangles call.  the list is the
+   VB's Elts */
+static GLboolean indexedTriangles = GL_FALSE;
+static GLuint* indexList = NULL;
+static GLuint indexCount = 0;
+static GLuint indexStart = 0;
+static GLuint indexEnd = 0;
+
+#define INDEX_VERTEX(V) \
+    { \
+        indexList[indexCount++] = V; \
+        if (V < indexStart) indexStart = V; \
+        if (V > indexEnd) indexEnd = V; \
+    }
+
+#define INDEX_TRIANGLE(CTX,V0,V1,V2) \
+    { \
+        if (indexCount + 3 > 3*CTX->VB->Size) \
+            flush_indexed_triangles(CTX); \
+        g_NumPolys++; \
+        INDEX_VERTEX(V0); \
+        INDEX_VERTEX(V1); \
+        INDEX_VERTEX(V2); \
+    }
+
+static void flush_indexed_triangles(GLcontext* ctx)
+{
+    if (indexCount != 0)
+    {
+        ctx->DriverFuncs.draw_indexed_triangles(indexStart, indexEnd, indexCount, indexList);
+        indexCount = 0;
+        indexStart = ctx->VB->Size;
+        indexEnd = 0;
+    }
+}
+
 GLfloat gl_pow(GLfloat a, GLfloat b)
 {
     return (GLfloat)pow((double)a, (double)b);
 }
 
+/* specular power for the spechack shaders, per ctx->SpecularPow (see
+   rglSpecPow).  RGL_SPECPOW_TABLE interpolates in a table of x^exp over
+   [0, 1], one per exponent.  tables are built the first time an exponent
+   is drawn with and kept for the last SPEC_TABLES exponents, so switching
+   between a few rglSpecExp values doesn't rebuild them */
+#define SPEC_TABLE_BITS 10
+#define SPEC_TABLE_SIZE (1 << SPEC_TABLE_BITS)
+#define SPEC_TABLES     8
+
+//+1 for x == 1, +1 so the lerp there doesn't read past the end
+static GLfloat specTable[SPEC_TABLES][SPEC_TABLE_SIZE + 2];
+static GLfloat specTableExp[SPEC_TABLES];
+static GLuint specTableCount = 0;
+static GLuint specTableNext = 0;
+
+typedef struct
+{
+    GLint mode;
+    GLfloat exp;
+    GLfloat const* table;
+} spec_power;
+
+static GLfloat const* spec_table(GLfloat exp)
+{
+    GLuint i, slot;
+    GLfloat* table;
+
+    for (slot = 0; slot < specTableCount; slot++)
+    {
+        if (specTableExp[slot] == exp)
+        {
+            return specTable[slot];
+        }
+    }
+
+    slot = specTableNext;
+    specTableNext = (specTableNext + 1) % SPEC_TABLES;
+    if (specTableCount < SPEC_TABLES)
+    {
+        specTableCount++;
+    }
+
+    table = specTable[slot];
+    for (i = 0; i <= SPEC_TABLE_SIZE; i++)
+    {
+        table[i] = gl_pow((GLfloat)i / (GLfloat)SPEC_TABLE_SIZE, exp);
+    }
+    table[SPEC_TABLE_SIZE + 1] = table[SPEC_TABLE_SIZE];
+    specTableExp[slot] = exp;
+
+    return table;
+}
+
+static void spec_power_init(spec_power* p, GLcontext* ctx, GLint index)
+{
+    p->mode = ctx->SpecularPow;
+    p->exp = ctx->SpecularExponent[index];
+    p->table = NULL;
+    if (p->mode == RGL_SPECPOW_TABLE)
+    {
+        if (p->exp < 1.0f)
+        {
+            //x^exp is too steep near 0 for the lerp
+            p->mode = RGL_SPECPOW_APPROX;
+        }
+        else
+        {
+            p->table = spec_table(p->exp);
+        }
+    }
+}
+
+//x^exp for x > 0
+static GLfloat spec_power_eval(spec_power const* p, GLfloat x)
+{
+    GLfloat f;
+    GLint i;
+
+    switch (p->mode)
+    {
+    case RGL_SPECPOW_TABLE:
+        if (x < 1.0f)
+        {
+            f = x * (GLfloat)SPEC_TABLE_SIZE;
+            i = (GLint)f;
+            f -= (GLfloat)i;
+            return p->table[i] + f * (p->table[i+1] - p->table[i]);
+        }
+        //unnormalized normals, spechack2 doesn't clamp
+        return gl_pow(x, p->exp);
+
+    case RGL_SPECPOW_APPROX:
+        return fpow(x, p->exp);
+
+    default:
+        return gl_pow(x, p->exp);
+    }
+}
+
+//x^SpecularExponent[index] as spechack pass index+1 takes it, for tests
+GLfloat gl_spec_power(GLcontext* ctx, GLint index, GLfloat x)
+{
+    spec_power power;
+
+    spec_power_init(&power, ctx, index);
+    return spec_power_eval(&power, x);
+}
+
 /*
  * spechack shader.
  * alpha component is scaled by n_dot_VP.
@@ -79,8 +225,10 @@ void gl_spechack_shade_vertices(
     GLfloat ascale, alpha, n_dot_VP;
     GLfloat veye[3] = {0.0f, 0.0f, 1.0f};
     GLfloat adjust = 1.0f - ctx->LightingAdjust;
+    spec_power power;
 
     ascale = ctx->Buffer.ascale;
+    spec_power_init(&power, ctx, 0);
 
     for (j = 0; j < (GLint)n; j++)
     {
@@ -104,7 +252,7 @@ void gl_spechack_shade_vertices(
         n_dot_VP = nx * veye[0] + ny * veye[1] + nz * veye[2];
         if (n_dot_VP > 0.0f)
         {
-            alpha += gl_pow(CLAMP(n_dot_VP, 0.0f, 1.0f), ctx->SpecularExponent[0]);
+            alpha += spec_power_eval(&power, CLAMP(n_dot_VP, 0.0f, 1.0f));
         }
 
         color[j][3] = FAST_TO_INT((GLfloat)color[j][3] * CLAMP(alpha, 0.0f, 1.0f) * adjust);
@@ -128,8 +276,10 @@ void gl_spechack2_shade_vertices(
     GLfloat ascale, alpha, n_dot_VP;
     GLfloat veye[3] = {0.0f, 0.0f, 1.0f};
     gl_light* light;
+    spec_power power;
 
     ascale = ctx->Buffer.ascale;
+    spec_power_init(&power, ctx, 1);
 
     for (j = 0; j < (GLint)n; j++)
     {
@@ -161,7 +311,7 @@ void gl_spechack2_shade_vertices(
                      + nz * light->VP_inf_norm[2];
             if (n_dot_VP > 0.0f)
             {
-                alpha += gl_pow(n_dot_VP, ctx->SpecularExponent[1]);
+                alpha += spec_power_eval(&power, n_dot_VP);
             }
         }
         {
@@ -193,8 +343,10 @@ void gl_spechack3_shade_vertices(
     GLfloat ascale, alpha, n_dot_VP;
     GLfloat veye[3];
     GLfloat adjust = 1.0f - ctx->LightingAdjust;
+    spec_power power;
 
     ascale = ctx->Buffer.ascale;
+    spec_power_init(&power, ctx, 2);
 
     for (j = 0; j < (GLint)n; j++)
     {
@@ -223,7 +375,7 @@ void gl_spechack3_shade_vertices(
         n_dot_VP = fabs(nx * veye[0] + ny * veye[1] + nz * veye[2]);
         if (n_dot_VP > 0.0f)
         {
-            alpha += gl_pow(CLAMP(n_dot_VP, 0.0f, 1.0f), ctx->SpecularExponent[2]);
+            alpha += spec_power_eval(&power, CLAMP(n_dot_VP, 0.0f, 1.0f));
         }
 
         color[j][1] = FAST_TO_INT((GLfloat)color[j][1] * CLAMP(alpha, 0.0f, 0.92f));
@@ -294,6 +446,42 @@ void gl_illum_shade_vertices(
     }
 }
 
+#if SIMD_X86
+/*
+ * hand a lighting pass to the vector kernels when there are enough
+ * vertices and ctx->LightBlock is current.  returns GL_FALSE if the caller
+ * should shade the vertices itself
+ */
+static GLboolean simd_shade_vertices(
+        GLcontext* ctx,
+        simd_shade const* sh,
+        GLuint n,
+        GLfloat vertex[][4],
+        GLfloat normal[][3],
+        GLubyte color[][4]
+      )
+{
+    if (n < SIMD_THRESH || (ctx->NewMask & NEW_LIGHTING))
+    {
+        return GL_FALSE;
+    }
+
+    if (ctx->CpuAVX2)
+    {
+        simd_avx2_shade_vertices(sh, n, &vertex[0][0], &normal[0][0], &color[0][0]);
+    }
+    else if (ctx->CpuSSE2)
+    {
+        simd_sse2_shade_vertices(sh, n, &vertex[0][0], &normal[0][0], &color[0][0]);
+    }
+    else
+    {
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+#endif
+
 /*
  * optimized shader.  technically this shouldn't be used unless the context decides
  * the lighting parameters are within range, but Homeworld figures "what the hell"
@@ -317,6 +505,26 @@ void gl_fast_color_shade_vertices(
 
     sumA = (GLint)ctx->BaseColor[side][3];
 
+#if SIMD_X86
+    {
+        simd_shade sh;
+
+        //the kernels clamp to [0, 1] and scale, so take the 255 out
+        sh.lights = &ctx->LightBlock;
+        sh.side = side;
+        sh.fast = GL_TRUE;
+        sh.base[0] = baseColor[0] * (1.0f / 255.0f);
+        sh.base[1] = baseColor[1] * (1.0f / 255.0f);
+        sh.base[2] = baseColor[2] * (1.0f / 255.0f);
+        sh.scale[0] = sh.scale[1] = sh.scale[2] = 255.0f;
+        sh.alpha = (GLubyte)sumA;
+        if (simd_shade_vertices(ctx, &sh, n, vertex, normal, color))
+        {
+            return;
+        }
+    }
+#endif
+
     for (j = 0; j < (GLint)n; j++)
     {
         GLfloat sumR, sumG, sumB;
@@ -402,6 +610,27 @@ void gl_color_shade_vertices(
 
     sumA = (GLint)(CLAMP(baseA, 0.0f, 1.0f) * ascale);
 
+#if SIMD_X86
+    {
+        simd_shade sh;
+
+        sh.lights = &ctx->LightBlock;
+        sh.side = side;
+        sh.fast = GL_FALSE;
+        sh.base[0] = baseR;
+        sh.base[1] = baseG;
+        sh.base[2] = baseB;
+        sh.scale[0] = rscale;
+        sh.scale[1] = gscale;
+        sh.scale[2] = bscale;
+        sh.alpha = (GLubyte)sumA;
+        if (simd_shade_vertices(ctx, &sh, n, vertex, normal, color))
+        {
+            return;
+        }
+    }
+#endif
+
     for (j = 0; j < (GLint)n; j++)
     {
 	    GLfloat sumR, sumG, sumB;
@@ -440,14 +669,15 @@ void gl_color_shade_vertices(
 	        }
             else
             {
-                GLfloat d;
+                GLfloat d, d2, invd;
                 VPx = light->Position[0] - vertex[j][0];
                 VPy = light->Position[1] - vertex[j][1];
                 VPz = light->Position[2] - vertex[j][2];
-                d = (GLfloat)fsqrt(VPx*VPx + VPy*VPy + VPz*VPz);
+                d2 = VPx*VPx + VPy*VPy + VPz*VPz;
+                invd = frsqrt(d2);
+                d = d2 * invd;
                 if (d > 0.0001f)
                 {
-                    GLfloat invd = 1.0f / d;
                     VPx *= invd;
                     VPy *= invd;
                     VPz *= invd;
@@ -547,6 +777,28 @@ void gl_color_shade_vertices(
 void transform_points3(GLcontext* ctx, GLuint n,
 	                   GLfloat vObj[][4], GLfloat vEye[][4])
 {
+#if SIMD_X86
+    if (n >= SIMD_THRESH &&
+        (ctx->ModelViewMatrixType == MATRIX_GENERAL ||
+         ctx->ModelViewMatrixType == MATRIX_3D))
+    {
+        if (ctx->CpuAVX2)
+        {
+            simd_avx2_transform_points3(
+                ctx->ModelViewMatrixType, n,
+                &vEye[0][0], ctx->ModelViewMatrix, &vObj[0][0]);
+            return;
+        }
+        else if (ctx->CpuSSE2)
+        {
+            simd_sse2_transform_points3(
+                ctx->ModelViewMatrixType, n,
+                &vEye[0][0], ctx->ModelViewMatrix, &vObj[0][0]);
+            return;
+        }
+    }
+#endif
+
     switch (ctx->ModelViewMatrixType)
     {
     case MATRIX_GENERAL:
@@ -645,13 +897,99 @@ void transform_points3(GLcontext* ctx, GLuint n,
     }
 }
 
+#if !C_MATH
+/*-----------------------------------------------------------------------------
+    Name        : guard_band_retest
+    Description : the asm clip tests only know the view volume.  with a guard
+                  band, take back the x & y bits of vertices inside it and
+                  rebuild the or & and masks
+    Inputs      : ctx - the context
+                  n - number of vertices
+                  vClip - [n][4] clip coordinates
+                  inOrMask, inAndMask - the masks before the asm test
+    Outputs     : clipMask[], orMask & andMask are corrected
+    Return      :
+----------------------------------------------------------------------------*/
+static void guard_band_retest(
+    GLcontext* ctx,
+    GLuint n, GLfloat vClip[][4],
+    GLubyte clipMask[],
+    GLubyte* orMask, GLubyte* andMask,
+    GLubyte inOrMask, GLubyte inAndMask)
+{
+    GLfloat guard = ctx->GuardBand;
+    GLubyte tmpOrMask = inOrMask;
+    GLubyte tmpAndMask = inAndMask;
+    GLuint i;
+
+    if (guard == 1.0f)
+    {
+        return;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        GLubyte mask = clipMask[i];
+        if (mask & (CLIP_RIGHT_BIT | CLIP_LEFT_BIT | CLIP_TOP_BIT | CLIP_BOTTOM_BIT))
+        {
+            GLfloat gw = vClip[i][3] * guard;
+            mask &= ~(CLIP_RIGHT_BIT | CLIP_LEFT_BIT | CLIP_TOP_BIT | CLIP_BOTTOM_BIT);
+            if (vClip[i][0] >  gw)       mask |= CLIP_RIGHT_BIT;
+            else if (vClip[i][0] < -gw)  mask |= CLIP_LEFT_BIT;
+            if (vClip[i][1] >  gw)       mask |= CLIP_TOP_BIT;
+            else if (vClip[i][1] < -gw)  mask |= CLIP_BOTTOM_BIT;
+            clipMask[i] = mask;
+        }
+        //the user bit isn't part of the and
+        mask &= CLIP_ALL_BITS;
+        tmpOrMask |= mask;
+        tmpAndMask &= mask;
+    }
+    *orMask = tmpOrMask;
+    *andMask = tmpAndMask;
+}
+#endif
+
 void cliptest(
     GLcontext* ctx,
     GLuint n, GLfloat vClip[][4],
     GLubyte clipMask[],
     GLubyte* orMask, GLubyte* andMask)
 {
+#if C_MATH
+    GLfloat guard = ctx->GuardBand;
+    GLubyte tmpOrMask = *orMask;
+    GLubyte tmpAndMask = *andMask;
+    GLuint i;
+    for (i = 0; i < n; i++)
+    {
+        GLfloat cx = vClip[i][0];
+        GLfloat cy = vClip[i][1];
+        GLfloat cz = vClip[i][2];
+        GLfloat cw = vClip[i][3];
+        GLfloat gw = cw * guard;
+        GLubyte mask = 0;
+        if (cx >  gw)       mask |= CLIP_RIGHT_BIT;
+        else if (cx < -gw)  mask |= CLIP_LEFT_BIT;
+        if (cy >  gw)       mask |= CLIP_TOP_BIT;
+        else if (cy < -gw)  mask |= CLIP_BOTTOM_BIT;
+        if (cz >  cw)       mask |= CLIP_FAR_BIT;
+        else if (cz < -cw)  mask |= CLIP_NEAR_BIT;
+        if (mask)
+        {
+            clipMask[i] |= mask;
+            tmpOrMask |= mask;
+        }
+        tmpAndMask &= mask;
+    }
+    *orMask = tmpOrMask;
+    *andMask = tmpAndMask;
+#else
+    GLubyte inOrMask = *orMask;
+    GLubyte inAndMask = *andMask;
     asm_cliptest(n, (GLfloat*)vClip, clipMask, orMask, andMask);
+    guard_band_retest(ctx, n, vClip, clipMask, orMask, andMask, inOrMask, inAndMask);
+#endif
 }
 
 /*
@@ -667,9 +1005,34 @@ void project_and_cliptest(
 			GLfloat vClip[][4], GLubyte clipMask[],
 			GLubyte* orMask, GLubyte* andMask)
 {
+    GLfloat guard = ctx->GuardBand;
     GLubyte tmpOrMask = *orMask;
     GLubyte tmpAndMask = *andMask;
 
+#if SIMD_X86
+    if (n >= SIMD_THRESH &&
+        ctx->ProjectionMatrixType >= MATRIX_IDENTITY &&
+        ctx->ProjectionMatrixType <= MATRIX_PERSPECTIVE)
+    {
+        if (ctx->CpuAVX2)
+        {
+            simd_avx2_project_and_cliptest(
+                ctx->ProjectionMatrixType, n,
+                &vClip[0][0], ctx->ProjectionMatrix, &vEye[0][0],
+                guard, clipMask, orMask, andMask);
+            return;
+        }
+        else if (ctx->CpuSSE2)
+        {
+            simd_sse2_project_and_cliptest(
+                ctx->ProjectionMatrixType, n,
+                &vClip[0][0], ctx->ProjectionMatrix, &vEye[0][0],
+                guard, clipMask, orMask, andMask);
+            return;
+        }
+    }
+#endif
+
     switch (ctx->ProjectionMatrixType)
     {
     case MATRIX_GENERAL:
@@ -686,15 +1049,16 @@ void project_and_cliptest(
 	        GLfloat cy = m[1] * ex + m[5] * ey + m[9]  * ez + m[13] * ew;
 	        GLfloat cz = m[2] * ex + m[6] * ey + m[10] * ez + m[14] * ew;
 	        GLfloat cw = m[3] * ex + m[7] * ey + m[11] * ez + m[15] * ew;
+	        GLfloat gw = cw * guard;
 	        GLubyte mask = 0;
 	        vClip[i][0] = cx;
 	        vClip[i][1] = cy;
 	        vClip[i][2] = cz;
 	        vClip[i][3] = cw;
-	        if (cx >  cw)       mask |= CLIP_RIGHT_BIT;
-	        else if (cx < -cw)  mask |= CLIP_LEFT_BIT;
-	        if (cy >  cw)       mask |= CLIP_TOP_BIT;
-	        else if (cy < -cw)  mask |= CLIP_BOTTOM_BIT;
+	        if (cx >  gw)       mask |= CLIP_RIGHT_BIT;
+	        else if (cx < -gw)  mask |= CLIP_LEFT_BIT;
+	        if (cy >  gw)       mask |= CLIP_TOP_BIT;
+	        else if (cy < -gw)  mask |= CLIP_BOTTOM_BIT;
 	        if (cz >  cw)       mask |= CLIP_FAR_BIT;
 	        else if (cz < -cw)  mask |= CLIP_NEAR_BIT;
 	        if (mask)
@@ -710,6 +1074,7 @@ void project_and_cliptest(
             n,
             (GLfloat*)vClip, ctx->ProjectionMatrix, (GLfloat*)vEye,
             clipMask, orMask, andMask);
+        guard_band_retest(ctx, n, vClip, clipMask, orMask, andMask, tmpOrMask, tmpAndMask);
         return;
 #endif
     }
@@ -723,11 +1088,12 @@ void project_and_cliptest(
             GLfloat cy = vClip[i][1] = vEye[i][1];
             GLfloat cz = vClip[i][2] = vEye[i][2];
             GLfloat cw = vClip[i][3] = vEye[i][3];
+            GLfloat gw = cw * guard;
             GLubyte mask = 0;
-            if (cx >  cw)       mask |= CLIP_RIGHT_BIT;
-            else if (cx < -cw)  mask |= CLIP_LEFT_BIT;
-            if (cy >  cw)       mask |= CLIP_TOP_BIT;
-            else if (cy < -cw)  mask |= CLIP_BOTTOM_BIT;
+            if (cx >  gw)       mask |= CLIP_RIGHT_BIT;
+            else if (cx < -gw)  mask |= CLIP_LEFT_BIT;
+            if (cy >  gw)       mask |= CLIP_TOP_BIT;
+            else if (cy < -gw)  mask |= CLIP_BOTTOM_BIT;
             if (cz >  cw)       mask |= CLIP_FAR_BIT;
             else if (cz < -cw)  mask |= CLIP_NEAR_BIT;
             if (mask)
@@ -743,6 +1109,7 @@ void project_and_cliptest(
             n,
             (GLfloat*)vClip, ctx->ProjectionMatrix, (GLfloat*)vEye,
             clipMask, orMask, andMask);
+        guard_band_retest(ctx, n, vClip, clipMask, orMask, andMask, tmpOrMask, tmpAndMask);
         return;
 #endif
     }
@@ -758,15 +1125,16 @@ void project_and_cliptest(
             GLfloat cy = m[5]  * ey + m[13] * ew;
             GLfloat cz = m[10] * ez + m[14] * ew;
             GLfloat cw = ew;
+            GLfloat gw = cw * guard;
             GLubyte mask = 0;
             vClip[i][0] = cx;
             vClip[i][1] = cy;
             vClip[i][2] = cz;
             vClip[i][3] = cw;
-            if (cx >  cw)       mask |= CLIP_RIGHT_BIT;
-            else if (cx < -cw)  mask |= CLIP_LEFT_BIT;
-            if (cy >  cw)       mask |= CLIP_TOP_BIT;
-            else if (cy < -cw)  mask |= CLIP_BOTTOM_BIT;
+            if (cx >  gw)       mask |= CLIP_RIGHT_BIT;
+            else if (cx < -gw)  mask |= CLIP_LEFT_BIT;
+            if (cy >  gw)       mask |= CLIP_TOP_BIT;
+            else if (cy < -gw)  mask |= CLIP_BOTTOM_BIT;
             if (cz >  cw)       mask |= CLIP_FAR_BIT;
             else if (cz < -cw)  mask |= CLIP_NEAR_BIT;
             if (mask)
@@ -791,15 +1159,16 @@ void project_and_cliptest(
             GLfloat cy = m[5] * ey + m[9] * ez;
             GLfloat cz = m[10] * ez + m[14] * ew;
             GLfloat cw = -ez;
+            GLfloat gw = cw * guard;
             GLubyte mask = 0;
             vClip[i][0] = cx;
             vClip[i][1] = cy;
             vClip[i][2] = cz;
             vClip[i][3] = cw;
-            if (cx >  cw)       mask |= CLIP_RIGHT_BIT;
-            else if (cx < -cw)  mask |= CLIP_LEFT_BIT;
-            if (cy >  cw)       mask |= CLIP_TOP_BIT;
-            else if (cy < -cw)  mask |= CLIP_BOTTOM_BIT;
+            if (cx >  gw)       mask |= CLIP_RIGHT_BIT;
+            else if (cx < -gw)  mask |= CLIP_LEFT_BIT;
+            if (cy >  gw)       mask |= CLIP_TOP_BIT;
+            else if (cy < -gw)  mask |= CLIP_BOTTOM_BIT;
             if (cz >  cw)       mask |= CLIP_FAR_BIT;
             else if (cz < -cw)  mask |= CLIP_NEAR_BIT;
             if (mask)
@@ -825,6 +1194,7 @@ void project_and_cliptest(
                 (GLfloat*)vClip, ctx->ProjectionMatrix, (GLfloat*)vEye,
                 clipMask, orMask, andMask);
         }
+        guard_band_retest(ctx, n, vClip, clipMask, orMask, andMask, tmpOrMask, tmpAndMask);
         return;
 #endif
     }
@@ -837,6 +1207,42 @@ void project_and_cliptest(
     *andMask = tmpAndMask;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : viewport_params
+    Description : the clip -> window scale & offset, and whether clip
+                  coordinates have to be divided by w first
+    Inputs      : ctx - the context
+    Outputs     : scale, offset - [3], x y z
+    Return      : TRUE if the divide by w is needed
+----------------------------------------------------------------------------*/
+static GLboolean viewport_params(GLcontext* ctx, GLfloat scale[3], GLfloat offset[3])
+{
+    scale[0] = ctx->Viewport.Sx;
+    offset[0] = ctx->Viewport.Tx;
+    scale[1] = ctx->Viewport.Sy;
+    offset[1] = ctx->Viewport.Ty;
+
+    if (ctx->ScaleDepthValues)
+    {
+        scale[2] = ctx->Viewport.Sz;
+        offset[2] = ctx->Viewport.Tz;
+    }
+    else
+    {
+        scale[2] = 0.5f;
+        offset[2] = 0.0f;
+    }
+
+    if ((!ctx->RasterizeOnly) &&
+        (ctx->ModelViewMatrixType != MATRIX_GENERAL) &&
+        (ctx->ProjectionMatrixType == MATRIX_ORTHO ||
+         ctx->ProjectionMatrixType == MATRIX_IDENTITY))
+    {
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+
 /*
  * Input: ctx - the context
  *        n - number of vertices to transform
@@ -850,27 +1256,13 @@ void viewport_map_vertices(
 			GLubyte const clipMask[], GLfloat vWin[][3])
 {
     GLuint i;
-    GLfloat sz, tz;
-    GLfloat sx = ctx->Viewport.Sx;
-    GLfloat tx = ctx->Viewport.Tx;
-    GLfloat sy = ctx->Viewport.Sy;
-    GLfloat ty = ctx->Viewport.Ty;
+    GLfloat scale[3], offset[3];
+    GLboolean divide = viewport_params(ctx, scale, offset);
+    GLfloat sx = scale[0], tx = offset[0];
+    GLfloat sy = scale[1], ty = offset[1];
+    GLfloat sz = scale[2], tz = offset[2];
 
-    if (ctx->ScaleDepthValues)
-    {
-        sz = ctx->Viewport.Sz;
-        tz = ctx->Viewport.Tz;
-    }
-    else
-    {
-        sz = 0.5f;
-        tz = 0.0f;
-    }
-
-    if ((!ctx->RasterizeOnly) &&
-        (ctx->ModelViewMatrixType != MATRIX_GENERAL) &&
-        (ctx->ProjectionMatrixType == MATRIX_ORTHO ||
-         ctx->ProjectionMatrixType == MATRIX_IDENTITY))
+    if (!divide)
     {
         // don't need to divide by w
         if (clipMask)
@@ -1081,8 +1473,42 @@ void shade_vertices(GLcontext* ctx)
     }
 }
 
+#if SIMD_X86
 /*
- * call subsidiary xform funcs or do it ourselves if we have to normalize
+ * hand a normal transform to the vector kernels.  returns GL_FALSE if the
+ * caller should transform the normals itself
+ */
+static GLboolean simd_xform_normals(
+        GLuint mode, GLuint n, GLfloat v[][3], GLfloat const m[16],
+        GLfloat u[][3], GLfloat scale)
+{
+    GLcontext* ctx = gl_get_context_ext();
+
+    if (n < SIMD_THRESH)
+    {
+        return GL_FALSE;
+    }
+
+    if (ctx->CpuAVX2)
+    {
+        simd_avx2_xform_normals(mode, n, &v[0][0], m, &u[0][0], scale);
+    }
+    else if (ctx->CpuSSE2)
+    {
+        simd_sse2_xform_normals(mode, n, &v[0][0], m, &u[0][0], scale);
+    }
+    else
+    {
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+#endif
+
+/*
+ * call subsidiary xform funcs or do it ourselves if we have to normalize.
+ * an identity modelview leaves the normals alone unless they're to be
+ * normalized, and a rescale by 1 is a plain transform
  */
 void gl_xform_normals_3fv(GLuint n, GLfloat v[][3], GLfloat const m[16],
 			              GLfloat u[][3], GLboolean normalize, GLboolean rescale)
@@ -1092,11 +1518,23 @@ void gl_xform_normals_3fv(GLuint n, GLfloat v[][3], GLfloat const m[16],
     GLfloat m1 = m[1], m5 = m[5], m9 = m[9];
     GLfloat m2 = m[2], m6 = m[6], m10 = m[10];
 
+    if (!normalize && gl_get_context_ext()->ModelViewMatrixType == MATRIX_IDENTITY)
+    {
+        //normals are assumed to be already transformed
+        return;
+    }
+
     if (normalize)
     {
+#if SIMD_X86
+        if (simd_xform_normals(SIMD_NORMALS_NORMALIZE, n, v, m, u, 1.0f))
+        {
+            return;
+        }
+#endif
         for (i = 0; i < n; i++)
         {
-            GLdouble tx, ty, tz;
+            GLfloat tx, ty, tz;
             {
                 GLfloat ux = u[i][0], uy = u[i][1], uz = u[i][2];
                 tx = ux*m0 + uy*m1 + uz*m2;
@@ -1104,12 +1542,14 @@ void gl_xform_normals_3fv(GLuint n, GLfloat v[][3], GLfloat const m[16],
                 tz = ux*m8 + uy*m9 + uz*m10;
             }
             {
-                GLdouble len, scale;
-                len = fsqrt(tx*tx + ty*ty + tz*tz);
-                scale = (len > 1E-30) ? (1.0 / len) : 1.0;
-                v[i][0] = (GLfloat)(tx * scale);
-                v[i][1] = (GLfloat)(ty * scale);
-                v[i][2] = (GLfloat)(tz * scale);
+                //as the SIMD_NORMALS_NORMALIZE kernels, degenerate
+                //normals are left alone
+                GLfloat len2, scale;
+                len2 = tx*tx + ty*ty + tz*tz;
+                scale = (len2 >= FLT_MIN) ? frsqrt(len2) : 1.0f;
+                v[i][0] = tx * scale;
+                v[i][1] = ty * scale;
+                v[i][2] = tz * scale;
             }
         }
     }
@@ -1118,8 +1558,15 @@ void gl_xform_normals_3fv(GLuint n, GLfloat v[][3], GLfloat const m[16],
         GLfloat ux, uy, uz;
         GLfloat tx, ty, tz;
 
-        GLfloat mscale = fsqrt(m2*m2 + m6*m6 + m10*m10);
+        GLfloat mscale = fsqrtf(m2*m2 + m6*m6 + m10*m10);
         mscale = (mscale > 1E-30f) ? (1.0f / mscale) : 1.0f;
+#if SIMD_X86
+        if (simd_xform_normals((mscale == 1.0f) ? SIMD_NORMALS_PLAIN : SIMD_NORMALS_RESCALE,
+                               n, v, m, u, mscale))
+        {
+            return;
+        }
+#endif
 #if C_MATH
         for (i = 0; i < n; i++)
         {
@@ -1145,13 +1592,14 @@ void gl_xform_normals_3fv(GLuint n, GLfloat v[][3], GLfloat const m[16],
         }
 #endif
     }
-    else if (gl_get_context_ext()->ModelViewMatrixType == MATRIX_IDENTITY)
-    {
-        //normals are assumed to be already transformed
-        return;
-    }
     else
     {
+#if SIMD_X86
+        if (simd_xform_normals(SIMD_NORMALS_PLAIN, n, v, m, u, 1.0f))
+        {
+            return;
+        }
+#endif
 #if C_MATH
         for (i = 0; i < n; i++)
         {
@@ -1214,6 +1662,70 @@ static GLuint gl_userclip_vertices(
 void gl_reset_vb(GLcontext* ctx, GLboolean allDone);
 void gl_render_vb(GLcontext* ctx, GLboolean allDone);
 void gl_transform_vb_part2(GLcontext*, GLboolean);
+static void transform_vb_finish(GLcontext*, GLboolean, GLboolean);
+
+/*-----------------------------------------------------------------------------
+    Name        : transform_project_viewport
+    Description : object -> clip -> window in a single SIMD pass through
+                  the cached modelview-projection product, when no
+                  stage in between needs eye coordinates (no lighting, no
+                  user clip planes, no driver fog).  VB->Eye is left
+                  untouched (VB->EyeValid is cleared); VB->Clip is still
+                  written as the drivers take 1/w from it
+    Inputs      : ctx - the context
+    Outputs     : VB->Clip, VB->Win, VB->ClipMask, VB->ClipOrMask &
+                  VB->ClipAndMask as from the separate passes
+    Return      : TRUE if done, FALSE if the separate passes have to run
+----------------------------------------------------------------------------*/
+static GLboolean transform_project_viewport(GLcontext* ctx)
+{
+#if SIMD_X86
+    vertex_buffer* VB = ctx->VB;
+    GLuint n = VB->Count - VB->Start;
+    GLint type;
+    simd_viewport vp;
+
+    //a driver's fog_vertices may want eye z
+    if (ctx->RasterizeOnly || ctx->Lighting || ctx->UserClip ||
+        (ctx->Fog && ctx->DriverFuncs.fog_vertices != NULL) ||
+        n < SIMD_THRESH ||
+        (ctx->ModelViewMatrixType != MATRIX_GENERAL &&
+         ctx->ModelViewMatrixType != MATRIX_3D) ||
+        ctx->ProjectionMatrixType < MATRIX_IDENTITY ||
+        ctx->ProjectionMatrixType > MATRIX_PERSPECTIVE)
+    {
+        return GL_FALSE;
+    }
+
+    if (ctx->NewMask & NEW_MVP)
+    {
+        gl_update_mvp();
+    }
+    //3D or GENERAL, given the modelview is
+    type = ctx->ModelViewProjectionMatrixType;
+
+    vp.divide = viewport_params(ctx, vp.scale, vp.offset);
+    vp.guard = ctx->GuardBand;
+
+    if (ctx->CpuAVX2)
+    {
+        simd_avx2_transform_project_viewport(
+            type, n, ctx->ModelViewProjectionMatrix, &vp,
+            &VB->Obj[VB->Start][0], &VB->Clip[VB->Start][0], &VB->Win[VB->Start][0],
+            VB->ClipMask + VB->Start, &VB->ClipOrMask, &VB->ClipAndMask);
+        return GL_TRUE;
+    }
+    else if (ctx->CpuSSE2)
+    {
+        simd_sse2_transform_project_viewport(
+            type, n, ctx->ModelViewProjectionMatrix, &vp,
+            &VB->Obj[VB->Start][0], &VB->Clip[VB->Start][0], &VB->Win[VB->Start][0],
+            VB->ClipMask + VB->Start, &VB->ClipOrMask, &VB->ClipAndMask);
+        return GL_TRUE;
+    }
+#endif
+    return GL_FALSE;
+}
 
 /*
  * the transformation stage is divided into 2 funcs so that vertex buffers
@@ -1223,6 +1735,7 @@ void gl_transform_vb_part2(GLcontext*, GLboolean);
 void gl_transform_vb_part1(GLcontext* ctx, GLboolean allDone)
 {
     vertex_buffer* VB = ctx->VB;
+    GLboolean fused;
 
     if (VB->Count == 0)
     {
@@ -1240,8 +1753,9 @@ void gl_transform_vb_part1(GLcontext* ctx, GLboolean allDone)
         gl_update_projection();
     }
 
-    //transform object -> eye
-    if (!ctx->RasterizeOnly)
+    //transform object -> window in one go, or object -> eye
+    fused = transform_project_viewport(ctx);
+    if (!fused && !ctx->RasterizeOnly)
     {
         transform_points3(ctx, VB->Count - VB->Start,
     		              VB->Obj + VB->Start, VB->Eye + VB->Start);
@@ -1262,14 +1776,25 @@ void gl_transform_vb_part1(GLcontext* ctx, GLboolean allDone)
     }
 
     //complete the process
-    gl_transform_vb_part2(ctx, allDone);
+    transform_vb_finish(ctx, allDone, fused);
 }
 
 void gl_transform_vb_part2(GLcontext* ctx, GLboolean allDone)
+{
+    transform_vb_finish(ctx, allDone, GL_FALSE);
+}
+
+/*
+ * fused - transform_project_viewport has already produced clip & window
+ *         coordinates
+ */
+static void transform_vb_finish(GLcontext* ctx, GLboolean allDone, GLboolean fused)
 {
     GLboolean blendoff = GL_FALSE;
     vertex_buffer* VB = ctx->VB;
 
+    VB->EyeValid = !fused && !ctx->RasterizeOnly;
+
 #if 0
     if (VB->Count == 0)
     {
@@ -1300,7 +1825,11 @@ void gl_transform_vb_part2(GLcontext* ctx, GLboolean allDone)
     }
 
     //project eye -> clip
-    if (ctx->RasterizeOnly)
+    if (fused)
+    {
+        //done in gl_transform_vb_part1
+    }
+    else if (ctx->RasterizeOnly)
     {
         cliptest(ctx, VB->Count - VB->Start, VB->Clip + VB->Start,
                  VB->ClipMask + VB->Start, &VB->ClipOrMask, &VB->ClipAndMask);
@@ -1358,10 +1887,13 @@ void gl_transform_vb_part2(GLcontext* ctx, GLboolean allDone)
     }
 
     //transform/project clip -> window
-    viewport_map_vertices(
-            ctx, VB->Count - VB->Start, VB->Clip + VB->Start,
-            VB->ClipOrMask ? VB->ClipMask + VB->Start : NULL,
-            VB->Win + VB->Start);
+    if (!fused)
+    {
+        viewport_map_vertices(
+                ctx, VB->Count - VB->Start, VB->Clip + VB->Start,
+                VB->ClipOrMask ? VB->ClipMask + VB->Start : NULL,
+                VB->Win + VB->Start);
+    }
 
     if (blendoff)
     {
@@ -1551,7 +2083,7 @@ void render_clipped_line(GLcontext* ctx, GLuint v1, GLuint v2)
 
     provoking_vertex = v2;
 
-    VB->Free = VB_MAX;
+    VB->Free = VB->Max;
 
     if (gl_viewclip_line(ctx, &v1, &v2) == 0)
     {
@@ -1617,13 +2149,21 @@ void render_clipped_polygon(GLcontext* ctx, GLuint n, GLuint vlist[])
 
     pv = (ctx->Primitive == GL_POLYGON) ? vlist[0] : vlist[n-1];
 
+    g_ClippedPolys++;
+
+    //keep submission order; what's been collected goes ahead of this
+    if (indexedTriangles)
+    {
+        flush_indexed_triangles(ctx);
+    }
+
     if (n == 3 && ctx->DriverFuncs.draw_clipped_triangle != NULL)
     {
         ctx->DriverFuncs.draw_clipped_triangle(vlist, pv);
         return;
     }
 
-    VB->Free = VB_MAX;
+    VB->Free = VB->Max;
 
     if (ctx->TexEnabled)
     {
@@ -1776,6 +2316,12 @@ void render_triangle(
         }
     }
 
+    if (indexedTriangles)
+    {
+        INDEX_TRIANGLE(ctx, v0, v1, v2);
+        return;
+    }
+
     if (ctx->TwoSide && (!facing)) VB->Color = VB->Bcolor;
 
     if (ctx->PolygonMode == GL_FILL)
@@ -1827,6 +2373,14 @@ void render_quad(GLcontext* ctx,
         }
     }
 
+    if (indexedTriangles)
+    {
+        //split as the drivers' draw_quad do
+        INDEX_TRIANGLE(ctx, v0, v1, v3);
+        INDEX_TRIANGLE(ctx, v1, v2, v3);
+        return;
+    }
+
     if (ctx->TwoSide && (!facing)) VB->Color = VB->Bcolor;
 
     if (ctx->PolygonMode == GL_FILL)
@@ -1849,10 +2403,37 @@ void render_quad(GLcontext* ctx,
     if (ctx->TwoSide && (!facing)) VB->Color = VB->Fcolor;
 }
 
+/*
+ * GL_TRIANGLES from VB->Indices.  clipped the same way as the sequential
+ * list, with the last vertex of each triangle as the provoking vertex
+ */
+static void render_indexed_triangles(GLcontext* ctx)
+{
+    vertex_buffer* VB = ctx->VB;
+    GLuint const* ip = VB->Indices;
+    GLuint* vlist = VB->VList;
+    GLuint i;
+
+    for (i = 2; i < VB->IndexCount; i += 3, ip += 3)
+    {
+        if (VB->ClipMask[ip[0]] | VB->ClipMask[ip[1]] | VB->ClipMask[ip[2]])
+        {
+            vlist[0] = ip[0];
+            vlist[1] = ip[1];
+            vlist[2] = ip[2];
+            render_clipped_polygon(ctx, 3, vlist);
+        }
+        else
+        {
+            render_triangle(ctx, ip[0], ip[1], ip[2], ip[2]);
+        }
+    }
+}
+
 void gl_render_vb(GLcontext* ctx, GLboolean allDone)
 {
     vertex_buffer* VB = ctx->VB;
-    GLuint vlist[VB_SIZE];
+    GLuint* vlist = VB->VList;
 
     if (ctx->RequireLocking && !ctx->ExclusiveLock)
     {
@@ -1860,6 +2441,18 @@ void gl_render_vb(GLcontext* ctx, GLboolean allDone)
         ctx->FrameBuffer = GET_FRAMEBUFFER(ctx);
     }
 
+    //flat shading, two sided lighting and line / point polygon modes need
+    //per triangle state, so those still go through draw_triangle
+    indexedTriangles = (GLboolean)(ctx->IndexedTriangles &&
+                                   ctx->DriverFuncs.draw_indexed_triangles != NULL &&
+                                   ctx->PolygonMode == GL_FILL &&
+                                   ctx->ShadeModel == GL_SMOOTH &&
+                                   !ctx->TwoSide);
+    indexList = VB->Elts;
+    indexCount = 0;
+    indexStart = VB->Size;
+    indexEnd = 0;
+
     switch (ctx->Primitive)
     {
     case GL_POLYGON:
@@ -2061,7 +2654,11 @@ void gl_render_vb(GLcontext* ctx, GLboolean allDone)
         break;
 
     case GL_TRIANGLES:
-        if (VB->ClipOrMask)
+        if (VB->Indices != NULL)
+        {
+            render_indexed_triangles(ctx);
+        }
+        else if (VB->ClipOrMask)
         {
             GLuint i;
             for (i = 2; i < VB->Count; i += 3)
@@ -2180,10 +2777,17 @@ void gl_render_vb(GLcontext* ctx, GLboolean allDone)
     }
 
     default:
+        indexedTriangles = GL_FALSE;
         gl_problem(ctx, "unsupported type in gl_render_vb");
         return;
     }
 
+    if (indexedTriangles)
+    {
+        flush_indexed_triangles(ctx);
+        indexedTriangles = GL_FALSE;
+    }
+
     gl_reset_vb(ctx, allDone);
     if (ctx->RequireLocking && !ctx->ExclusiveLock)
     {
@@ -2213,6 +2817,9 @@ void gl_reset_vb(GLcontext* ctx, GLboolean allDone)
                (VB->Count - VB->Start) * sizeof(VB->ClipMask[0]));
     }
 
+    VB->Indices = NULL;
+    VB->IndexCount = 0;
+
 #if !FANCY_RESET
 
     VB->Count = 0;
@@ -3,25 +3,32 @@
 
 #define MAX_CLIP_PLANES	6
 
+/* the VB starts out holding VB_MAX vertices and grows (gl_grow_vb) when a
+   primitive needs more.  VB_CLIP_VERTS more past the capacity are where
+   clipping puts new vertices */
 #define VB_MAX	8192
-#define VB_SIZE	(VB_MAX + 2 * (6 + MAX_CLIP_PLANES))
+#define VB_CLIP_VERTS	(2 * (6 + MAX_CLIP_PLANES))
+#define VB_SIZE	(VB_MAX + VB_CLIP_VERTS)
+
+/* the arrays are allocated together, each aligned to this */
+#define VB_ALIGN	32
 
 typedef struct vertex_buffer_s
 {
-    GLfloat Obj[VB_SIZE][4];
-    GLfloat Eye[VB_SIZE][4];
-    GLfloat Clip[VB_SIZE][4];
-    GLfloat Win[VB_SIZE][3];
+    GLfloat (*Obj)[4];
+    GLfloat (*Eye)[4];
+    GLfloat (*Clip)[4];
+    GLfloat (*Win)[3];
 
-    GLfloat Normal[VB_SIZE][3];
+    GLfloat (*Normal)[3];
 
     GLubyte (*Color)[4];
-    GLubyte Fcolor[VB_SIZE][4];
-    GLubyte Bcolor[VB_SIZE][4];
+    GLubyte (*Fcolor)[4];
+    GLubyte (*Bcolor)[4];
 
-    GLfloat TexCoord[VB_SIZE][2];
+    GLfloat (*TexCoord)[2];
 
-    GLubyte ClipMask[VB_SIZE];
+    GLubyte* ClipMask;
     GLubyte ClipOrMask;
     GLubyte ClipAndMask;
 
@@ -29,6 +36,30 @@ typedef struct vertex_buffer_s
     GLuint Count;
     GLuint Free;		/* next empty position (for clipping) */
 
+    /* if set, GL_TRIANGLES are drawn from this list of vertex indices
+       rather than from 0..Count-1 (rglMeshRender's shared vertices).
+       cleared by gl_reset_vb */
+    GLuint* Indices;
+    GLuint IndexCount;
+
+    GLuint Max;		/* vertex capacity */
+    GLuint Size;		/* Max + VB_CLIP_VERTS, the length of the arrays */
+
+    /* scratch, Size entries each: the polygon vertex list gl_render_vb
+       hands the clipper, and the clipper's second list */
+    GLuint* VList;
+    GLuint* VList2;
+
+    /* 3*Size entries, for kvb.c's indexed triangle list */
+    GLuint* Elts;
+
+    void* Block;	/* the arrays' allocation */
+
+    /* set if Eye holds this batch's eye coordinates.  the fused
+       transform_project_viewport pass and RasterizeOnly don't write them, so
+       the clipper mustn't interpolate eye z from stale values */
+    GLboolean EyeValid;
+
     /* FIXME: materials */
 } vertex_buffer;
 
@@ -46,10 +77,15 @@ typedef struct vertex_buffer_s
 #define CLIP_SOME	3
 
 vertex_buffer* gl_alloc_vb(void);
+void gl_free_vb(vertex_buffer*);
+struct gl_context_s;
+GLboolean gl_grow_vb(struct gl_context_s*, GLuint);
 //void gl_render_vb(GLcontext*, GLboolean);
 //void gl_reset_vb(GLcontext*, GLboolean);
 
-void gl_transform_vb_part1();
-void gl_transform_vb_part2();
+void gl_transform_vb_part1(struct gl_context_s*, GLboolean);
+void gl_transform_vb_part2(struct gl_context_s*, GLboolean);
+
+GLfloat gl_spec_power(struct gl_context_s*, GLint, GLfloat);
 
 #endif
@@ -1,9 +1,17 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#include <float.h>
 #include "kgl.h"
 #include "maths.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MATHS_SSE 1
+#else
+#define MATHS_SSE 0
+#endif
+
 typedef enum {X,Y,Z,W} quat_coefficient;
 
 GLfloat xaxis[3] = {1.0f,0.0f,0.0f};
@@ -30,6 +38,28 @@ void mat4_output(GLfloat* m)
 }
 
 
+/* sqrt & 1/sqrt.  fsqrt is a 16K entry table of mantissas worked through
+ * the bits of a double, ~14 significant bits (6e-5 relative) for 64K of
+ * table.  it stays the default (RGL_SQRT_TABLE) as the lighting is tuned
+ * to it.  with RGL_SQRT_TABLE 0, fsqrt is libm's and the float frsqrt /
+ * fsqrtf are rsqrtss + a Newton step (2e-7) and sqrtss where SSE is there
+ * to be had, and the 0x5f375a86 bit trick + 2 Newton steps (5e-6) where
+ * it isn't.  frsqrt & fsqrtf of anything below FLT_MIN are 0
+ */
+
+static void init_identity_matrix()
+{
+    int i, j;
+
+    for (i = 0; i < 4; i++)
+	    for (j = 0; j < 4; j++)
+        {
+	        mat4_identity_matrix[4*i + j] = (i == j) ? 1.0f : 0.0f;
+	    }
+}
+
+#if RGL_SQRT_TABLE
+
 /* MOST_SIG_OFFSET gives the (int *) offset from the address of the double
  * to the part of the number containing the sign and exponent.
  * You will need to find the relevant offset for your architecture.
@@ -59,16 +89,11 @@ static int sqrt_tab[SQRT_TAB_SIZE];
 
 void init_sqrt_tab()
 {
-    int           i, j;
+    int           i;
     double        f;
     unsigned int  *fi = (unsigned int *) &f + MOST_SIG_OFFSET;
 
-    for (i = 0; i < 4; i++)
-	    for (j = 0; j < 4; j++)
-        {
-	        f = (i == j) ? 1.0 : 0.0;
-	        mat4_identity_matrix[4*i + j] = (GLfloat)f;
-	    }
+    init_identity_matrix();
 
     for (i = 0; i < SQRT_TAB_SIZE/2; i++)
     {
@@ -101,6 +126,157 @@ double fsqrt(double f)
     return f;
 }
 
+GLfloat frsqrt(GLfloat x)
+{
+    return (x >= FLT_MIN) ? (GLfloat)(1.0 / fsqrt(x)) : 0.0f;
+}
+
+GLfloat fsqrtf(GLfloat x)
+{
+    return (GLfloat)fsqrt(x);
+}
+
+#else   /* !RGL_SQRT_TABLE */
+
+void init_sqrt_tab()
+{
+    init_identity_matrix();
+}
+
+double fsqrt(double f)
+{
+    return sqrt(f);
+}
+
+#if MATHS_SSE
+
+GLfloat frsqrt(GLfloat x)
+{
+    __m128 v, r;
+
+    if (!(x >= FLT_MIN))
+    {
+        return 0.0f;
+    }
+
+    //~12 bits, and a Newton step
+    v = _mm_set_ss(x);
+    r = _mm_rsqrt_ss(v);
+    r = _mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f),
+        _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), v), _mm_mul_ss(r, r))));
+    return _mm_cvtss_f32(r);
+}
+
+GLfloat fsqrtf(GLfloat x)
+{
+    if (!(x >= FLT_MIN))
+    {
+        return 0.0f;
+    }
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+}
+
+#else   /* !MATHS_SSE */
+
+GLfloat frsqrt(GLfloat x)
+{
+    GLuint i;
+    GLfloat y, halfx;
+
+    if (!(x >= FLT_MIN))
+    {
+        return 0.0f;
+    }
+
+    //~3.4% off, then 2 Newton steps
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5f375a86 - (i >> 1);
+    memcpy(&y, &i, sizeof(y));
+    halfx = 0.5f * x;
+    y = y * (1.5f - halfx*y*y);
+    y = y * (1.5f - halfx*y*y);
+    return y;
+}
+
+GLfloat fsqrtf(GLfloat x)
+{
+    return x * frsqrt(x);
+}
+
+#endif  /* MATHS_SSE */
+
+#endif  /* RGL_SQRT_TABLE */
+
+/* fpow - x^y for 0 <= x, as 2^(y log2 x) in single precision.
+ * log2 of the mantissa, taken in [sqrt(1/2), sqrt(2)), is the atanh series
+ * to t^7; 2^f for the fraction rounded into [-1/2, 1/2] is Taylor to f^6.
+ * relative error is around 1e-6 for the exponents the specular shaders
+ * use.  results below 2^-126 are 0.  no data dependent branches but the
+ * range checks, n.v is all over the place
+ */
+
+#define LOG2_C1 2.885390082f    /* 2/ln 2 */
+#define LOG2_C3 0.961796694f    /* 2/(3 ln 2) */
+#define LOG2_C5 0.577078016f
+#define LOG2_C7 0.412198583f
+
+#define EXP2_C1 0.6931471806f   /* ln 2 */
+#define EXP2_C2 0.2402265070f   /* (ln 2)^2 / 2! */
+#define EXP2_C3 0.0555041087f
+#define EXP2_C4 0.0096181291f
+#define EXP2_C5 0.0013333558f
+#define EXP2_C6 0.0001540353f
+
+#define SQRT_HALF_BITS 0x3f3504f3
+#define ROUND_MAGIC    12582912.0f  /* 1.5 * 2^23 */
+
+typedef union
+{
+    GLfloat f;
+    GLint   i;
+} float_bits;
+
+GLfloat fpow(GLfloat x, GLfloat y)
+{
+    float_bits u;
+    GLint e;
+    GLfloat m, t, t2, l, k, f;
+
+    if (x < 1.175494351e-38f)
+    {
+        //0 or denormal
+        return (y == 0.0f) ? 1.0f : 0.0f;
+    }
+
+    //x = 2^e * m, m in [sqrt(1/2), sqrt(2))
+    u.f = x;
+    e = (u.i - SQRT_HALF_BITS) >> 23;
+    u.i -= e << 23;
+    m = u.f;
+
+    t = (m - 1.0f) / (m + 1.0f);
+    t2 = t * t;
+    l = (GLfloat)e + t * (LOG2_C1 + t2 * (LOG2_C3 + t2 * (LOG2_C5 + t2 * LOG2_C7)));
+
+    l *= y;
+    if (l < -126.0f)
+    {
+        return 0.0f;
+    }
+    if (l > 127.0f)
+    {
+        l = 127.0f;
+    }
+
+    //k = l rounded to nearest
+    k = (l + ROUND_MAGIC) - ROUND_MAGIC;
+    f = l - k;
+
+    u.i = ((GLint)k + 127) << 23;
+    return u.f * (1.0f + f * (EXP2_C1 + f * (EXP2_C2 + f * (EXP2_C3 +
+                  f * (EXP2_C4 + f * (EXP2_C5 + f * EXP2_C6))))));
+}
+
 
 /* ----- v3 */
 
@@ -112,7 +288,7 @@ GLfloat v3_mag2(GLfloat* v)
 GLfloat v3_magnitude(GLfloat* v)
 {
     GLfloat mag = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
-    return (GLfloat)fsqrt(mag);
+    return fsqrtf(mag);
 }
 
 void v3_set(GLfloat* v, GLfloat x, GLfloat y, GLfloat z)
@@ -276,7 +452,7 @@ void mat4_rotation(GLfloat* m, GLfloat* axis, GLfloat degrees)
     rads = (GLdouble)degrees * M_PI / 180.0;
     s = (GLfloat)sin(rads);
     c = (GLfloat)cos(rads);
-    mag = (GLfloat)fsqrt((GLdouble)(x*x + y*y + z*z));
+    mag = fsqrtf(x*x + y*y + z*z);
     if (mag == 0.0)
     {
 	    mat4_identity(m);
@@ -17,8 +17,16 @@ void v3_output(GLfloat*);
 
 void mat4_output(GLfloat*);
 
+//fsqrt through the original lookup table; 0 for libm / rsqrtss (see maths.c)
+#ifndef RGL_SQRT_TABLE
+#define RGL_SQRT_TABLE 1
+#endif
+
 void init_sqrt_tab();
 double fsqrt(double);
+GLfloat frsqrt(GLfloat x);
+GLfloat fsqrtf(GLfloat x);
+GLfloat fpow(GLfloat x, GLfloat y);
 
 /* v3, 3-space vectors */
 
@@ -56,6 +64,8 @@ void mat4_copy(GLfloat* d, GLfloat* s);
 void mat4_transpose(GLfloat* d, GLfloat* s);	/** intelligent */
 void mat4_inverse(GLfloat* d, GLfloat* s);
 void mat4_inversed(GLdouble* d, GLdouble* s);
+void invert_matrix(GLfloat const* m, GLfloat* out);
+void invert_matrix_type(GLfloat const* m, GLint type, GLfloat* out);
 
 
 #endif
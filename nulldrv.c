@@ -0,0 +1,762 @@
+/*=============================================================================
+        Name    : nulldrv.c
+        Purpose : in-process "null" rasterization driver.  every hook in
+                  gl_driver_funcs but draw_clipped_* is filled, nothing is
+                  drawn.  calls are
+                  counted, and optionally recorded to a compact binary log
+                  (see nulldrv.h for the format), so the whole transform /
+                  light / clip front end can be run and profiled without
+                  a window or a GPU
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kgl.h"
+#include "kvb.h"
+#include "nulldrv.h"
+
+typedef GLboolean (*BoolFunc)(void);
+typedef void (*VoidFunc)(void);
+typedef GLubyte* (*PtrFunc)(void);
+
+//pixels past each buffer edge reported as the guard band
+#define NULL_GUARD_BAND 65536.0f
+
+static GLcontext* CTX = NULL;
+
+static GLuint nullCalls[NULL_OP_COUNT];
+
+//vertex and index data handed to the draw_* hooks
+static GLdouble nullVertexBytes = 0.0;
+
+//binary log, NULL if not recording
+static FILE* nullLog = NULL;
+static char nullLogName[260];
+
+//stand-in for the framebuffer, for the few paths that poke at it
+static GLubyte* nullFramebuffer = NULL;
+
+/*-----------------------------------------------------------------------------
+    log output
+-----------------------------------------------------------------------------*/
+
+static void null_open_log(void)
+{
+    GLuint header[2];
+
+    if (nullLog != NULL || nullLogName[0] == '\0')
+    {
+        return;
+    }
+
+    nullLog = fopen(nullLogName, "wb");
+    if (nullLog == NULL)
+    {
+        gl_problem(CTX, "null driver: couldn't open log file");
+        return;
+    }
+
+    header[0] = NULL_LOG_MAGIC;
+    header[1] = NULL_LOG_VERSION;
+    fwrite(header, sizeof(header), 1, nullLog);
+}
+
+static void null_close_log(void)
+{
+    if (nullLog != NULL)
+    {
+        fclose(nullLog);
+        nullLog = NULL;
+    }
+}
+
+static void null_op(GLuint op)
+{
+    GLubyte code = (GLubyte)op;
+
+    nullCalls[op]++;
+    if (nullLog != NULL)
+    {
+        fwrite(&code, 1, 1, nullLog);
+    }
+}
+
+//n 32bit arguments
+static void null_args(GLuint n, GLuint const* args)
+{
+    if (nullLog != NULL)
+    {
+        fwrite(args, sizeof(GLuint), n, nullLog);
+    }
+}
+
+static void null_op_args(GLuint op, GLuint n, ...)
+{
+    GLuint args[8];
+    GLuint i;
+    va_list ap;
+
+    null_op(op);
+    if (nullLog == NULL)
+    {
+        return;
+    }
+
+    va_start(ap, n);
+    for (i = 0; i < n; i++)
+    {
+        args[i] = va_arg(ap, GLuint);
+    }
+    va_end(ap);
+
+    null_args(n, args);
+}
+
+static GLuint null_float(GLfloat f)
+{
+    GLuint u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+//a vertex as the rasterizer would consume it
+static void null_vertex(GLuint v)
+{
+    vertex_buffer* VB = CTX->VB;
+
+    fwrite(VB->Win[v], sizeof(GLfloat), 3, nullLog);
+    fwrite(VB->Color[v], sizeof(GLubyte), 4, nullLog);
+    fwrite(VB->TexCoord[v], sizeof(GLfloat), 2, nullLog);
+}
+
+static void null_vertices(GLuint n, GLuint const* vl)
+{
+    GLuint i;
+
+    nullVertexBytes += (GLdouble)(n * NULL_VTX_BYTES);
+    if (nullLog == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        null_vertex(vl[i]);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    driver hooks
+-----------------------------------------------------------------------------*/
+
+static void driver_caps(GLcontext* ctx)
+{
+    ctx->Buffer.Pitch = 2 * ctx->Buffer.Width;
+    ctx->Buffer.PixelType = GL_RGB565;
+
+    //nothing's rasterized, so any guard band will do
+    gl_driver_guard_band(ctx, -NULL_GUARD_BAND, -NULL_GUARD_BAND,
+                         (GLfloat)ctx->Buffer.Width + NULL_GUARD_BAND,
+                         (GLfloat)ctx->Buffer.Height + NULL_GUARD_BAND);
+}
+
+static GLboolean post_init_driver(GLcontext* ctx)
+{
+    if (nullFramebuffer != NULL)
+    {
+        free(nullFramebuffer);
+    }
+    //a little slack for the 24bit pixel peeks that read a whole GLuint
+    nullFramebuffer = (GLubyte*)malloc(ctx->Buffer.Pitch * ctx->Buffer.Height + 4);
+    if (nullFramebuffer == NULL)
+    {
+        return GL_FALSE;
+    }
+    MEMSET(nullFramebuffer, 0, ctx->Buffer.Pitch * ctx->Buffer.Height + 4);
+
+    null_open_log();
+
+    return GL_TRUE;
+}
+
+static void shutdown_driver(GLcontext* ctx)
+{
+    null_op(NULL_OP_SHUTDOWN);
+    null_close_log();
+
+    if (nullFramebuffer != NULL)
+    {
+        free(nullFramebuffer);
+        nullFramebuffer = NULL;
+    }
+}
+
+static GLboolean create_window(GLint a, GLint b)
+{
+    return GL_TRUE;
+}
+
+static void delete_window(GLint a)
+{
+}
+
+static void set_save_state(GLint on)
+{
+}
+
+static GLubyte* get_scratch(GLcontext* ctx)
+{
+    return nullFramebuffer;
+}
+
+static void clear_depthbuffer(GLcontext* ctx)
+{
+    null_op(NULL_OP_CLEAR_DEPTH);
+}
+
+static void clear_colorbuffer(GLcontext* ctx)
+{
+    null_op(NULL_OP_CLEAR_COLOR);
+}
+
+static void clear_both_buffers(GLcontext* ctx)
+{
+    null_op(NULL_OP_CLEAR_BOTH);
+}
+
+static void lock_buffer(GLcontext* ctx)
+{
+    null_op(NULL_OP_LOCK);
+}
+
+static void unlock_buffer(GLcontext* ctx)
+{
+    null_op(NULL_OP_UNLOCK);
+}
+
+static GLubyte* get_framebuffer(GLcontext* ctx)
+{
+    return nullFramebuffer;
+}
+
+static void setup_triangle(GLcontext* ctx)
+{
+    null_op(NULL_OP_SETUP_TRIANGLE);
+}
+
+static void setup_line(GLcontext* ctx)
+{
+    null_op(NULL_OP_SETUP_LINE);
+}
+
+static void setup_point(GLcontext* ctx)
+{
+    null_op(NULL_OP_SETUP_POINT);
+}
+
+static void setup_raster(GLcontext* ctx)
+{
+    null_op(NULL_OP_SETUP_RASTER);
+}
+
+static void set_monocolor(GLcontext* ctx, GLint r, GLint g, GLint b, GLint a)
+{
+    null_op_args(NULL_OP_MONOCOLOR, 4, r, g, b, a);
+}
+
+static void flush(void)
+{
+    null_op(NULL_OP_FLUSH);
+    if (nullLog != NULL)
+    {
+        fflush(nullLog);
+    }
+}
+
+static void clear_color(GLubyte r, GLubyte g, GLubyte b, GLubyte a)
+{
+    null_op_args(NULL_OP_CLEAR_COLOR_VALUE, 4, r, g, b, a);
+}
+
+static void scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    null_op_args(NULL_OP_SCISSOR, 4, x, y, width, height);
+}
+
+static void flush_batch(void)
+{
+    null_op(NULL_OP_FLUSH_BATCH);
+}
+
+static void draw_triangle(GLuint vl[], GLuint pv)
+{
+    null_op_args(NULL_OP_TRIANGLE, 1, pv);
+    null_vertices(3, vl);
+}
+
+static void draw_triangle_array(GLint n, GLuint vl[], GLuint pv)
+{
+    null_op_args(NULL_OP_TRIANGLE_ARRAY, 2, n, pv);
+    null_vertices(3*n, vl);
+}
+
+static void draw_quad(GLuint vl[], GLuint pv)
+{
+    null_op_args(NULL_OP_QUAD, 1, pv);
+    null_vertices(4, vl);
+}
+
+static void draw_triangle_fan(GLint n, GLuint vl[], GLuint pv)
+{
+    null_op_args(NULL_OP_TRIANGLE_FAN, 2, n, pv);
+    null_vertices(n, vl);
+}
+
+static void draw_triangle_strip(GLint n, GLuint vl[], GLuint pv)
+{
+    null_op_args(NULL_OP_TRIANGLE_STRIP, 2, n, pv);
+    null_vertices(n, vl);
+}
+
+static void draw_polygon(GLint n, GLuint vl[], GLuint pv)
+{
+    null_op_args(NULL_OP_POLYGON, 2, n, pv);
+    null_vertices(n, vl);
+}
+
+static void draw_line(GLuint v0, GLuint v1, GLuint pv)
+{
+    GLuint vl[2];
+
+    vl[0] = v0;
+    vl[1] = v1;
+    null_op_args(NULL_OP_LINE, 1, pv);
+    null_vertices(2, vl);
+}
+
+static void draw_pixel(GLint x, GLint y, GLdepth z)
+{
+    null_op_args(NULL_OP_PIXEL, 3, x, y, z);
+}
+
+static void draw_bitmap(
+    GLcontext* ctx, GLsizei width, GLsizei height,
+    GLfloat xb0, GLfloat yb0, GLfloat xb1, GLfloat yb1)
+{
+    null_op_args(NULL_OP_BITMAP, 2, width, height);
+}
+
+static void draw_pixels(
+    GLcontext* ctx, GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+    null_op_args(NULL_OP_PIXELS, 4, width, height, format, type);
+}
+
+static void read_pixels(
+    GLcontext* ctx, GLint x, GLint y, GLsizei width, GLsizei height,
+    GLenum format, GLenum type)
+{
+    null_op_args(NULL_OP_READ_PIXELS, 6, x, y, width, height, format, type);
+}
+
+static void draw_point(GLuint first, GLuint last)
+{
+    null_op_args(NULL_OP_POINT, 2, first, last);
+    nullVertexBytes += (GLdouble)((last - first + 1) * NULL_VTX_BYTES);
+}
+
+static void draw_triangle_elements(GLsizei count, GLsizei numVerts, GLvoid const* indices)
+{
+    null_op_args(NULL_OP_TRIANGLE_ELEMENTS, 2, count, numVerts);
+    null_args(count, (GLuint const*)indices);
+}
+
+static void draw_indexed_triangles(GLuint start, GLuint end, GLsizei count, GLuint const* indices)
+{
+    GLuint v;
+
+    null_op_args(NULL_OP_INDEXED_TRIANGLES, 3, start, end, count);
+    nullVertexBytes += (GLdouble)((end - start + 1) * NULL_VTX_BYTES + count * sizeof(GLuint));
+    if (nullLog == NULL)
+    {
+        return;
+    }
+
+    null_args(count, indices);
+    for (v = start; v <= end; v++)
+    {
+        null_vertex(v);
+    }
+}
+
+static void bind_texture(void)
+{
+    gl_texture_object* tex = CTX->TexBoundObject;
+    null_op_args(NULL_OP_BIND_TEXTURE, 1, (tex != NULL) ? tex->Name : 0);
+}
+
+static void tex_param(GLenum pname, GLfloat const* params)
+{
+    null_op_args(NULL_OP_TEX_PARAM, 2, pname, null_float(params[0]));
+}
+
+static void tex_del(gl_texture_object* tex)
+{
+    null_op_args(NULL_OP_TEX_DEL, 1, tex->Name);
+}
+
+static void tex_palette(gl_texture_object* tex)
+{
+    null_op_args(NULL_OP_TEX_PALETTE, 1, (tex != NULL) ? tex->Name : 0);
+}
+
+static void tex_img(gl_texture_object* tex, GLint level, GLint internalFormat)
+{
+    GLsizei width = tex->Width;
+    GLsizei height = tex->Height;
+
+    if (level != 0)
+    {
+        rglGetTexLevel(tex, level, &width, &height);
+    }
+    null_op_args(NULL_OP_TEX_IMG, 5,
+                 tex->Name, level, internalFormat, width, height);
+}
+
+static void tex_share(gl_texture_object* tex, gl_texture_object* src)
+{
+    null_op_args(NULL_OP_TEX_SHARE, 2, tex->Name, src->Name);
+}
+
+//nothing here reads texels, so the GL needn't keep them
+static GLboolean tex_retain(gl_texture_object* tex)
+{
+    return GL_FALSE;
+}
+
+static void tex_env(GLenum param)
+{
+    null_op_args(NULL_OP_TEX_ENV, 1, param);
+}
+
+static void deactivate(void)
+{
+    null_op(NULL_OP_DEACTIVATE);
+}
+
+static void activate(void)
+{
+    null_op(NULL_OP_ACTIVATE);
+}
+
+static void screenshot(GLubyte* buf)
+{
+}
+
+static void gamma_up(void)
+{
+}
+
+static void gamma_dn(void)
+{
+}
+
+static void chromakey(GLubyte r, GLubyte g, GLubyte b, GLboolean on)
+{
+}
+
+static void super_clear(void)
+{
+    null_op(NULL_OP_CLEAR_BOTH);
+}
+
+static void fastbind_set(GLboolean state)
+{
+}
+
+static void draw_background(GLubyte* pixels)
+{
+}
+
+static void fog_vertices(GLcontext* ctx)
+{
+    null_op(NULL_OP_FOG_VERTICES);
+}
+
+static void begin(GLcontext* ctx, GLenum primitive)
+{
+    null_op_args(NULL_OP_BEGIN, 1, primitive);
+}
+
+static void end(GLcontext* ctx)
+{
+    null_op(NULL_OP_END);
+}
+
+static void vertex(GLfloat x, GLfloat y, GLfloat z)
+{
+    null_op_args(NULL_OP_VERTEX, 3, null_float(x), null_float(y), null_float(z));
+}
+
+static void update_modelview(void)
+{
+    null_op(NULL_OP_UPDATE_MODELVIEW);
+}
+
+static void update_projection(void)
+{
+    null_op(NULL_OP_UPDATE_PROJECTION);
+}
+
+static void draw_c4ub_v3f(GLenum mode, GLint first, GLsizei count)
+{
+    null_op_args(NULL_OP_C4UB_V3F, 3, mode, first, count);
+}
+
+static int feature_exists(GLint feature)
+{
+    return 0;
+}
+
+static void fullscene(GLboolean on)
+{
+    null_op_args(NULL_OP_FULLSCENE, 1, on);
+}
+
+static GLubyte* get_animaticbuffer(GLint* pitch)
+{
+    if (pitch != NULL)
+    {
+        *pitch = CTX->Buffer.Pitch;
+    }
+    return nullFramebuffer;
+}
+
+static void draw_pitched_pixels(
+    GLint x0, GLint y0, GLint x1, GLint y1,
+    GLsizei width, GLsizei height, GLsizei pitch,
+    GLvoid const* pixels)
+{
+    null_op_args(NULL_OP_PITCHED_PIXELS, 7, x0, y0, x1, y1, width, height, pitch);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : null_record
+    Description : start / stop recording driver calls.  may be called before
+                  the driver is initialized, in which case the log is opened
+                  by post_init_driver.  if never called, the RGL_NULL_LOG
+                  environment variable is used
+    Inputs      : filename - log file to write, NULL to stop recording
+    Outputs     : any previous log is closed
+    Return      :
+----------------------------------------------------------------------------*/
+void null_record(char const* filename)
+{
+    null_close_log();
+
+    if (filename == NULL)
+    {
+        nullLogName[0] = '\0';
+        return;
+    }
+
+    strncpy(nullLogName, filename, sizeof(nullLogName) - 1);
+    nullLogName[sizeof(nullLogName) - 1] = '\0';
+
+    if (CTX != NULL)
+    {
+        null_open_log();
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : null_call_count
+    Description : number of times a driver hook has been called since the
+                  driver was initialized (or null_reset_counts)
+    Inputs      : op - one of the NULL_OP_* values
+    Outputs     :
+    Return      : the count
+----------------------------------------------------------------------------*/
+GLuint null_call_count(GLuint op)
+{
+    return (op < NULL_OP_COUNT) ? nullCalls[op] : 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : null_draw_calls
+    Description : number of primitive submissions (draw_triangle, draw_quad,
+                  draw_indexed_triangles, &c) since the counts were reset
+    Inputs      :
+    Outputs     :
+    Return      : the count
+----------------------------------------------------------------------------*/
+GLuint null_draw_calls(void)
+{
+    static GLuint const drawOps[] =
+    {
+        NULL_OP_TRIANGLE, NULL_OP_TRIANGLE_ARRAY, NULL_OP_QUAD,
+        NULL_OP_TRIANGLE_FAN, NULL_OP_TRIANGLE_STRIP, NULL_OP_POLYGON,
+        NULL_OP_LINE, NULL_OP_POINT, NULL_OP_TRIANGLE_ELEMENTS,
+        NULL_OP_C4UB_V3F, NULL_OP_INDEXED_TRIANGLES
+    };
+    GLuint i, n = 0;
+
+    for (i = 0; i < sizeof(drawOps) / sizeof(drawOps[0]); i++)
+    {
+        n += nullCalls[drawOps[i]];
+    }
+    return n;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : null_vertex_bytes
+    Description : bytes of vertex and index data the draw_* hooks have been
+                  handed since the counts were reset, counting NULL_VTX_BYTES
+                  per vertex and 4 per index.  a driver that copies each
+                  primitive's vertices moves at least this much
+    Inputs      :
+    Outputs     :
+    Return      : the byte count
+----------------------------------------------------------------------------*/
+GLdouble null_vertex_bytes(void)
+{
+    return nullVertexBytes;
+}
+
+void null_reset_counts(void)
+{
+    MEMSET(nullCalls, 0, sizeof(nullCalls));
+    nullVertexBytes = 0.0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : null_init_driver
+    Description : the null driver's init_driver.  called directly by
+                  gl_driver_init rather than through a loaded module
+    Inputs      : ctx - the GL context
+    Outputs     : ctx->DriverFuncs are all filled
+    Return      : TRUE
+----------------------------------------------------------------------------*/
+GLboolean null_init_driver(GLcontext* ctx)
+{
+    gl_driver_funcs* dr = &ctx->DriverFuncs;
+    char const* env;
+
+    CTX = ctx;
+
+    null_reset_counts();
+
+    if (nullLogName[0] == '\0')
+    {
+        env = getenv("RGL_NULL_LOG");
+        if (env != NULL)
+        {
+            strncpy(nullLogName, env, sizeof(nullLogName) - 1);
+            nullLogName[sizeof(nullLogName) - 1] = '\0';
+        }
+    }
+
+    dr->init_driver = (BoolFunc)null_init_driver;
+    dr->post_init_driver = (BoolFunc)post_init_driver;
+    dr->shutdown_driver = (VoidFunc)shutdown_driver;
+
+    dr->create_window = (BoolFunc)create_window;
+    dr->delete_window = (VoidFunc)delete_window;
+    dr->set_save_state = (VoidFunc)set_save_state;
+    dr->get_scratch = (PtrFunc)get_scratch;
+
+    dr->driver_caps = (VoidFunc)driver_caps;
+
+    dr->allocate_depthbuffer = NULL;
+    dr->allocate_colorbuffer = NULL;
+
+    dr->clear_depthbuffer = (VoidFunc)clear_depthbuffer;
+    dr->clear_colorbuffer = (VoidFunc)clear_colorbuffer;
+    dr->clear_both_buffers = (VoidFunc)clear_both_buffers;
+
+    dr->lock_buffer = (VoidFunc)lock_buffer;
+    dr->unlock_buffer = (VoidFunc)unlock_buffer;
+    dr->get_framebuffer = (PtrFunc)get_framebuffer;
+
+    dr->setup_triangle = (VoidFunc)setup_triangle;
+    dr->setup_line = (VoidFunc)setup_line;
+    dr->setup_point = (VoidFunc)setup_point;
+    dr->setup_raster = (VoidFunc)setup_raster;
+
+    dr->set_monocolor = (VoidFunc)set_monocolor;
+    dr->flush = (VoidFunc)flush;
+    dr->clear_color = (VoidFunc)clear_color;
+    dr->scissor = (VoidFunc)scissor;
+
+    dr->flush_batch = (VoidFunc)flush_batch;
+
+    dr->draw_triangle = (VoidFunc)draw_triangle;
+    dr->draw_triangle_array = (VoidFunc)draw_triangle_array;
+    dr->draw_quad = (VoidFunc)draw_quad;
+    dr->draw_triangle_fan = (VoidFunc)draw_triangle_fan;
+    dr->draw_triangle_strip = (VoidFunc)draw_triangle_strip;
+    dr->draw_polygon = (VoidFunc)draw_polygon;
+    dr->draw_line = (VoidFunc)draw_line;
+    dr->draw_pixel = (VoidFunc)draw_pixel;
+    dr->draw_bitmap = (VoidFunc)draw_bitmap;
+    dr->draw_pixels = (VoidFunc)draw_pixels;
+    dr->read_pixels = (VoidFunc)read_pixels;
+    dr->draw_point = (VoidFunc)draw_point;
+
+    dr->draw_triangle_elements = draw_triangle_elements;
+    dr->draw_indexed_triangles = draw_indexed_triangles;
+
+    //left NULL so clipped polygons go through the GL's own clipper
+    dr->draw_clipped_triangle = NULL;
+    dr->draw_clipped_polygon = NULL;
+
+    dr->bind_texture = (VoidFunc)bind_texture;
+    dr->tex_param = (VoidFunc)tex_param;
+    dr->tex_del = (VoidFunc)tex_del;
+    dr->tex_palette = (VoidFunc)tex_palette;
+    dr->tex_img = (VoidFunc)tex_img;
+    dr->tex_env = (VoidFunc)tex_env;
+    dr->tex_retain = tex_retain;
+    dr->tex_share = tex_share;
+
+    dr->deactivate = (VoidFunc)deactivate;
+    dr->activate = (VoidFunc)activate;
+
+    dr->screenshot = (VoidFunc)screenshot;
+
+    dr->gamma_up = (VoidFunc)gamma_up;
+    dr->gamma_dn = (VoidFunc)gamma_dn;
+
+    dr->chromakey = (VoidFunc)chromakey;
+    dr->super_clear = (VoidFunc)super_clear;
+
+    dr->fastbind_set = (VoidFunc)fastbind_set;
+
+    dr->draw_background = (VoidFunc)draw_background;
+
+    dr->fog_vertices = (VoidFunc)fog_vertices;
+
+    ctx->DriverTransforms = GL_FALSE;
+    dr->begin = begin;
+    dr->end = end;
+    dr->vertex = vertex;
+    dr->update_modelview = (VoidFunc)update_modelview;
+    dr->update_projection = (VoidFunc)update_projection;
+    dr->draw_c4ub_v3f = draw_c4ub_v3f;
+
+    dr->feature_exists = feature_exists;
+
+    dr->fullscene = fullscene;
+
+    dr->get_animaticbuffer = get_animaticbuffer;
+
+    dr->draw_pitched_pixels = draw_pitched_pixels;
+
+    ctx->RequireLocking = GL_FALSE;
+
+    return GL_TRUE;
+}
@@ -0,0 +1,85 @@
+/*=============================================================================
+        Name    : nulldrv.h
+        Purpose : in-process "null" rasterization driver.  draws nothing, but
+                  counts every driver call and can record them to a binary log
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#ifndef _NULLDRV_H
+#define _NULLDRV_H
+
+#include "kgl.h"
+
+#define NULL_DEVICE_NAME "null"
+
+/* log file header: NULL_LOG_MAGIC, NULL_LOG_VERSION, then records.
+   a record is a GLubyte opcode followed by its arguments, 32 bits each
+   unless noted */
+#define NULL_LOG_MAGIC   0x4e4c4752     /* "RGLN" */
+#define NULL_LOG_VERSION 1
+
+/* a "vtx" below is one vertex from the VB as the rasterizer would see it:
+   Win[3] (float), Color[4] (ubyte), TexCoord[2] (float) = 24 bytes */
+#define NULL_VTX_BYTES 24
+enum
+{
+    NULL_OP_SHUTDOWN,
+    NULL_OP_CLEAR_DEPTH,
+    NULL_OP_CLEAR_COLOR,
+    NULL_OP_CLEAR_BOTH,
+    NULL_OP_LOCK,
+    NULL_OP_UNLOCK,
+    NULL_OP_SETUP_TRIANGLE,
+    NULL_OP_SETUP_LINE,
+    NULL_OP_SETUP_POINT,
+    NULL_OP_SETUP_RASTER,
+    NULL_OP_MONOCOLOR,              /* r, g, b, a */
+    NULL_OP_FLUSH,
+    NULL_OP_CLEAR_COLOR_VALUE,      /* r, g, b, a */
+    NULL_OP_SCISSOR,                /* x, y, width, height */
+    NULL_OP_FLUSH_BATCH,
+    NULL_OP_TRIANGLE,               /* pv, 3 vtx */
+    NULL_OP_TRIANGLE_ARRAY,         /* n, pv, 3n vtx */
+    NULL_OP_QUAD,                   /* pv, 4 vtx */
+    NULL_OP_TRIANGLE_FAN,           /* n, pv, n vtx */
+    NULL_OP_TRIANGLE_STRIP,         /* n, pv, n vtx */
+    NULL_OP_POLYGON,                /* n, pv, n vtx */
+    NULL_OP_LINE,                   /* pv, 2 vtx */
+    NULL_OP_PIXEL,                  /* x, y, z */
+    NULL_OP_BITMAP,                 /* width, height */
+    NULL_OP_PIXELS,                 /* width, height, format, type */
+    NULL_OP_READ_PIXELS,            /* x, y, width, height, format, type */
+    NULL_OP_POINT,                  /* first, last */
+    NULL_OP_TRIANGLE_ELEMENTS,      /* count, numVerts, count indices */
+    NULL_OP_BIND_TEXTURE,           /* name */
+    NULL_OP_TEX_PARAM,              /* pname, params[0] */
+    NULL_OP_TEX_DEL,                /* name */
+    NULL_OP_TEX_PALETTE,            /* name */
+    NULL_OP_TEX_IMG,                /* name, level, format, the level's width, height */
+    NULL_OP_TEX_ENV,                /* param */
+    NULL_OP_DEACTIVATE,
+    NULL_OP_ACTIVATE,
+    NULL_OP_FOG_VERTICES,
+    NULL_OP_BEGIN,                  /* primitive */
+    NULL_OP_END,
+    NULL_OP_VERTEX,                 /* x, y, z */
+    NULL_OP_UPDATE_MODELVIEW,
+    NULL_OP_UPDATE_PROJECTION,
+    NULL_OP_C4UB_V3F,               /* mode, first, count */
+    NULL_OP_FULLSCENE,              /* on */
+    NULL_OP_PITCHED_PIXELS,         /* x0, y0, x1, y1, width, height, pitch */
+    NULL_OP_INDEXED_TRIANGLES,      /* start, end, count, count indices, end-start+1 vtx */
+    NULL_OP_TEX_SHARE,              /* name, the name of the texture it shares */
+    NULL_OP_COUNT
+};
+
+GLboolean null_init_driver(GLcontext* ctx);
+
+void null_record(char const* filename);
+GLuint null_call_count(GLuint op);
+GLuint null_draw_calls(void);
+GLdouble null_vertex_bytes(void);
+void null_reset_counts(void);
+
+#endif
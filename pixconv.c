@@ -0,0 +1,1078 @@
+/*=============================================================================
+        Name    : pixconv.c
+        Purpose : pixel format conversion, rescaling & mip chains for
+                  texture uploads, shared by the core and the drivers'
+                  blitters.  a row goes through the
+                  SSE2 / AVX2 kernels in simd.c as far as they take it and
+                  the scalar loop here does the rest
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <string.h>
+#include <math.h>
+#include "kgl.h"
+#include "pixconv.h"
+#include "simd.h"
+
+//bytes per pixel of each format
+static GLubyte const pixBytes[PIX_FORMATS] =
+{
+    4, 4, 4, 2, 2, 2, 1, 1
+};
+
+DLL GLuint pix_bytes(GLuint format)
+{
+    return (format < PIX_FORMATS) ? pixBytes[format] : 0;
+}
+
+//one RGBA pixel, as the d3d_blt_RGBA_ loops did it
+static GLuint pix_from_rgba(GLuint dformat, GLubyte const* s)
+{
+    switch (dformat)
+    {
+    case PIX_ARGB8888:
+        return ((GLuint)s[3] << 24) | ((GLuint)s[0] << 16) | ((GLuint)s[1] << 8) | s[2];
+    case PIX_XRGB8888:
+        return ((GLuint)s[0] << 16) | ((GLuint)s[1] << 8) | s[2];
+    case PIX_RGB565:
+        return ((s[0] & 0xF8) << 8) | ((s[1] & 0xFC) << 3) | (s[2] >> 3);
+    case PIX_XRGB1555:
+        return ((s[0] & 0xF8) << 7) | ((s[1] & 0xF8) << 2) | (s[2] >> 3);
+    default:
+        return ((s[3] & 0xF0) << 8) | ((s[0] & 0xF0) << 4) | (s[1] & 0xF0) | (s[2] >> 4);
+    }
+}
+
+//one ARGB4444 pixel, each channel shifted up, as d3d_blt_RGBA16_ did it
+static GLuint pix_from_4444(GLuint dformat, GLuint s)
+{
+    switch (dformat)
+    {
+    case PIX_ARGB8888:
+        return ((s & 0xF000) << 16) | ((s & 0x0F00) << 12) | ((s & 0x00F0) << 8) | ((s & 0x000F) << 4);
+    case PIX_XRGB8888:
+        return ((s & 0x0F00) << 12) | ((s & 0x00F0) << 8) | ((s & 0x000F) << 4);
+    case PIX_RGB565:
+        return ((s & 0x0F00) << 4) | ((s & 0x00F0) << 3) | ((s & 0x000F) << 1);
+    case PIX_XRGB1555:
+        return ((s & 0x0F00) << 3) | ((s & 0x00F0) << 2) | ((s & 0x000F) << 1);
+    default:
+        return s;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_row
+    Description : convert one row, the vector kernels first
+    Inputs      : dformat, sformat - the formats, not the same
+                  src - the source row
+                  width - pixels
+    Outputs     : dst - the destination row
+    Return      :
+----------------------------------------------------------------------------*/
+static void pix_row(
+    GLuint dformat, GLubyte* dst, GLuint sformat, GLubyte const* src, GLsizei width)
+{
+    GLsizei x = 0;
+
+#if SIMD_X86
+    GLcontext* ctx = gl_get_context_ext();
+    if (ctx != NULL)
+    {
+        if (ctx->CpuAVX2)
+        {
+            x = simd_avx2_pix_row(dformat, dst, sformat, src, width);
+        }
+        else if (ctx->CpuSSE2)
+        {
+            x = simd_sse2_pix_row(dformat, dst, sformat, src, width);
+        }
+    }
+#endif
+
+    if (sformat == PIX_RGBA)
+    {
+        for (src += 4*x; x < width; x++, src += 4)
+        {
+            if (pixBytes[dformat] == 4)
+            {
+                ((GLuint*)dst)[x] = pix_from_rgba(dformat, src);
+            }
+            else
+            {
+                ((GLushort*)dst)[x] = (GLushort)pix_from_rgba(dformat, src);
+            }
+        }
+    }
+    else
+    {
+        GLushort const* s = (GLushort const*)src;
+        for (; x < width; x++)
+        {
+            if (pixBytes[dformat] == 4)
+            {
+                ((GLuint*)dst)[x] = pix_from_4444(dformat, s[x]);
+            }
+            else
+            {
+                ((GLushort*)dst)[x] = (GLushort)pix_from_4444(dformat, s[x]);
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_convert
+    Description : convert an image between two formats (see pixconv.h)
+    Inputs      : dformat, dpitch - destination format & bytes per row
+                  sformat, src, spitch - the source image
+                  width, height - dimensions
+    Outputs     : dst is filled
+    Return      : FALSE if there's no conversion between the formats
+----------------------------------------------------------------------------*/
+DLL GLboolean pix_convert(
+    GLuint dformat, GLvoid* dst, GLint dpitch,
+    GLuint sformat, GLvoid const* src, GLint spitch,
+    GLsizei width, GLsizei height)
+{
+    GLubyte* d = (GLubyte*)dst;
+    GLubyte const* s = (GLubyte const*)src;
+    GLint y;
+
+    if (dformat == sformat &&
+        (sformat == PIX_ARGB4444 || sformat == PIX_INDEX8 || sformat == PIX_L8))
+    {
+        GLint bytes = width * pixBytes[sformat];
+        if (dpitch == bytes && spitch == bytes)
+        {
+            MEMCPY(d, s, bytes * height);
+        }
+        else
+        {
+            for (y = 0; y < height; y++, d += dpitch, s += spitch)
+            {
+                MEMCPY(d, s, bytes);
+            }
+        }
+        return GL_TRUE;
+    }
+
+    if ((sformat != PIX_RGBA && sformat != PIX_ARGB4444) ||
+        dformat < PIX_ARGB8888 || dformat > PIX_ARGB4444)
+    {
+        return GL_FALSE;
+    }
+
+    for (y = 0; y < height; y++, d += dpitch, s += spitch)
+    {
+        pix_row(dformat, d, sformat, s, width);
+    }
+    return GL_TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_convert_masks
+    Description : convert an RGBA or ARGB4444 image to a format given as bit
+                  counts & shifts.  the ones pix_convert has kernels for go
+                  there, anything else a channel at a time
+    Inputs      : dpitch, bytesPerPixel - of the destination, 2 or 4 bytes
+                  bits, shift - [4] r g b a channel sizes & positions
+                  sformat, src, spitch - the source image
+                  width, height - dimensions
+    Outputs     : dst is filled
+    Return      : FALSE if the formats can't be handled
+----------------------------------------------------------------------------*/
+DLL GLboolean pix_convert_masks(
+    GLvoid* dst, GLint dpitch, GLint bytesPerPixel,
+    GLint const bits[4], GLint const shift[4],
+    GLuint sformat, GLvoid const* src, GLint spitch,
+    GLsizei width, GLsizei height)
+{
+    static struct
+    {
+        GLuint format;
+        GLint bytes;
+        GLint bits[4];
+        GLint shift[4];
+    } const known[] =
+    {
+        { PIX_ARGB8888, 4, { 8, 8, 8, 8 }, { 16, 8, 0, 24 } },
+        { PIX_XRGB8888, 4, { 8, 8, 8, 0 }, { 16, 8, 0, 0 } },
+        { PIX_RGB565,   2, { 5, 6, 5, 0 }, { 11, 5, 0, 0 } },
+        { PIX_XRGB1555, 2, { 5, 5, 5, 0 }, { 10, 5, 0, 0 } },
+        { PIX_ARGB4444, 2, { 4, 4, 4, 4 }, { 8, 4, 0, 12 } },
+    };
+    GLubyte* d = (GLubyte*)dst;
+    GLubyte const* s = (GLubyte const*)src;
+    GLint sbits = (sformat == PIX_RGBA) ? 8 : 4;
+    GLint i, k, x, y;
+
+    if ((sformat != PIX_RGBA && sformat != PIX_ARGB4444) ||
+        (bytesPerPixel != 2 && bytesPerPixel != 4))
+    {
+        return GL_FALSE;
+    }
+
+    //a channel with no bits can have any shift
+    for (k = 0; k < (GLint)(sizeof(known) / sizeof(known[0])); k++)
+    {
+        if (known[k].bytes != bytesPerPixel)
+        {
+            continue;
+        }
+        for (i = 0; i < 4; i++)
+        {
+            if (known[k].bits[i] != bits[i] ||
+                (bits[i] != 0 && known[k].shift[i] != shift[i]))
+            {
+                break;
+            }
+        }
+        if (i == 4)
+        {
+            return pix_convert(known[k].format, dst, dpitch, sformat, src, spitch, width, height);
+        }
+    }
+
+    for (y = 0; y < height; y++, d += dpitch, s += spitch)
+    {
+        for (x = 0; x < width; x++)
+        {
+            GLint sColor[4];
+            GLuint p = 0;
+
+            if (sformat == PIX_RGBA)
+            {
+                sColor[0] = s[4*x + 0];
+                sColor[1] = s[4*x + 1];
+                sColor[2] = s[4*x + 2];
+                sColor[3] = s[4*x + 3];
+            }
+            else
+            {
+                GLuint t = ((GLushort const*)s)[x];
+                sColor[0] = (t & 0x0F00) >> 8;
+                sColor[1] = (t & 0x00F0) >> 4;
+                sColor[2] =  t & 0x000F;
+                sColor[3] = (t & 0xF000) >> 12;
+            }
+
+            for (i = 0; i < 4; i++)
+            {
+                GLint c;
+                if (bits[i] == 0)
+                {
+                    continue;
+                }
+                if (bits[i] <= sbits)
+                {
+                    c = sColor[i] >> (sbits - bits[i]);
+                }
+                else
+                {
+                    c = sColor[i] << (bits[i] - sbits);
+                }
+                p |= (GLuint)c << shift[i];
+            }
+
+            if (bytesPerPixel == 4)
+            {
+                ((GLuint*)d)[x] = p;
+            }
+            else
+            {
+                ((GLushort*)d)[x] = (GLushort)p;
+            }
+        }
+    }
+    return GL_TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_expand_index
+    Description : look a colour index image up in a palette that's already
+                  in the destination format.  table lookups don't vectorize
+                  without gathers, which aren't any faster, so this is
+                  scalar
+    Inputs      : dpitch, bytesPerPixel - of the destination, 2 or 4 bytes
+                  src, spitch - the INDEX8 image
+                  palette - [256] GLushort or GLuint
+                  width, height - dimensions
+    Outputs     : dst is filled
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void pix_expand_index(
+    GLvoid* dst, GLint dpitch, GLint bytesPerPixel,
+    GLubyte const* src, GLint spitch,
+    GLvoid const* palette, GLsizei width, GLsizei height)
+{
+    GLubyte* d = (GLubyte*)dst;
+    GLint x, y;
+
+    for (y = 0; y < height; y++, d += dpitch, src += spitch)
+    {
+        if (bytesPerPixel == 4)
+        {
+            GLuint const* pal = (GLuint const*)palette;
+            GLuint* dl = (GLuint*)d;
+            for (x = 0; x < width; x++)
+            {
+                dl[x] = pal[src[x]];
+            }
+        }
+        else
+        {
+            GLushort const* pal = (GLushort const*)palette;
+            GLushort* ds = (GLushort*)d;
+            for (x = 0; x < width; x++)
+            {
+                ds[x] = pal[src[x]];
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_arena_get
+    Description : hand out an arena's memory, growing it if it's too small
+    Inputs      : arena - the arena
+                  bytes - how much is needed
+    Outputs     : arena may be reallocated
+    Return      : the memory, or NULL if it couldn't be had
+----------------------------------------------------------------------------*/
+DLL GLvoid* pix_arena_get(pix_arena* arena, GLsizei bytes)
+{
+    if (bytes > arena->size)
+    {
+        if (arena->data != NULL)
+        {
+            gl_Free(arena->data);
+        }
+        bytes = (bytes + 4095) & ~4095;
+        arena->data = (GLubyte*)gl_Allocate(bytes);
+        arena->size = (arena->data != NULL) ? bytes : 0;
+    }
+    return arena->data;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_arena_free
+    Description : release an arena's memory.  it can still be used after
+    Inputs      : arena - the arena
+    Outputs     : arena is empty
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void pix_arena_free(pix_arena* arena)
+{
+    if (arena->data != NULL)
+    {
+        gl_Free(arena->data);
+    }
+    arena->data = NULL;
+    arena->size = 0;
+}
+
+//0 scalar, 1 SSE2, 2 AVX2
+static GLint pix_simd(void)
+{
+#if SIMD_X86
+    GLcontext* ctx = gl_get_context_ext();
+    if (ctx != NULL)
+    {
+        return ctx->CpuAVX2 ? 2 : (ctx->CpuSSE2 ? 1 : 0);
+    }
+#endif
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_rescale_nearest
+    Description : point sampled pix_rescale
+    Inputs      : bytes - per texel
+                  (see pix_rescale)
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void pix_rescale_nearest(
+    GLint bytes,
+    GLubyte* dst, GLsizei dwidth, GLsizei dheight,
+    GLubyte const* src, GLsizei swidth, GLsizei sheight)
+{
+    GLubyte const* ps;
+    GLint x, y, sx;
+
+    for (y = 0; y < dheight; y++)
+    {
+        ps = src + bytes * swidth * (((2*y + 1) * sheight) / (2*dheight));
+        for (x = 0; x < dwidth; x++)
+        {
+            sx = ((2*x + 1) * swidth) / (2*dwidth);
+            switch (bytes)
+            {
+            case 4:
+                ((GLuint*)dst)[x] = ((GLuint const*)ps)[sx];
+                break;
+            case 2:
+                ((GLushort*)dst)[x] = ((GLushort const*)ps)[sx];
+                break;
+            default:
+                dst[x] = ps[sx];
+            }
+        }
+        dst += bytes * dwidth;
+    }
+}
+
+/* box spans: the texels of source row / column s*step .. (s + n - 1)*step.
+   sums stay in 16 bits, so n is kept to 256 by stepping over texels of
+   very large boxes */
+static void pix_box_span(GLint d, GLsizei dsize, GLsizei ssize, GLint* s, GLint* n, GLint step)
+{
+    GLint s0 = (d * ssize) / dsize;
+    GLint s1 = ((d + 1) * ssize) / dsize;
+
+    if (dsize >= ssize)
+    {
+        //growing, only the texel under the centre
+        *s = ((2*d + 1) * ssize) / (2*dsize);
+        *n = 1;
+    }
+    else
+    {
+        *s = s0;
+        *n = (s1 - s0 + step - 1) / step;
+    }
+}
+
+//reciprocal for ((sum + n/2) * recip) >> 16, round(sum / n) for sums of n bytes
+#define PIX_RECIP(N) ((65536 + (N) - 1) / (N))
+
+/* bilinear taps: the left / top texel and the right / bottom one's weight
+   in 256ths, sampling at texel centres and clamping at the edges */
+static void pix_bilinear_tap(GLint d, GLsizei dsize, GLsizei ssize, GLint* s, GLint* f)
+{
+    GLint pos = (GLint)floor(((d + 0.5) * ssize / dsize - 0.5) * 256.0 + 0.5);
+
+    if (pos < 0)
+    {
+        pos = 0;
+    }
+    *s = pos >> 8;
+    *f = pos & 255;
+    if (*s >= ssize - 1)
+    {
+        *s = ssize - 1;
+        *f = 0;
+    }
+}
+
+static void pix_lerp(GLint simd, GLubyte* dst, GLubyte const* a, GLubyte const* b, GLsizei n, GLint f)
+{
+    GLsizei i = 0;
+
+#if SIMD_X86
+    if (simd == 2)
+    {
+        i = simd_avx2_pix_lerp(dst, a, b, n, f);
+    }
+    else if (simd == 1)
+    {
+        i = simd_sse2_pix_lerp(dst, a, b, n, f);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i] = (GLubyte)((a[i]*(256 - f) + b[i]*f + 128) >> 8);
+    }
+}
+
+static void pix_accum(GLint simd, GLushort* acc, GLubyte const* row, GLsizei n, GLboolean first)
+{
+    GLsizei i = 0;
+
+#if SIMD_X86
+    if (simd == 2)
+    {
+        i = simd_avx2_pix_accum(acc, row, n, first);
+    }
+    else if (simd == 1)
+    {
+        i = simd_sse2_pix_accum(acc, row, n, first);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        acc[i] = (GLushort)(first ? row[i] : acc[i] + row[i]);
+    }
+}
+
+static void pix_average(GLint simd, GLubyte* dst, GLushort const* acc, GLsizei n, GLint count)
+{
+    GLuint recip = PIX_RECIP(count);
+    GLuint bias = count >> 1;
+    GLsizei i = 0;
+
+#if SIMD_X86
+    if (simd == 2)
+    {
+        i = simd_avx2_pix_average(dst, acc, n, recip, bias);
+    }
+    else if (simd == 1)
+    {
+        i = simd_sse2_pix_average(dst, acc, n, recip, bias);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i] = (GLubyte)(((acc[i] + bias) * recip) >> 16);
+    }
+}
+
+static void pix_expand4444(GLint simd, GLubyte* dst, GLushort const* src, GLsizei n)
+{
+    GLsizei i = 0;
+
+#if SIMD_X86
+    if (simd != 0)
+    {
+        i = simd_sse2_pix_expand4444(dst, src, n);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[4*i + 0] = (GLubyte)(( src[i]        & 0xF) * 17);
+        dst[4*i + 1] = (GLubyte)(((src[i] >> 4)  & 0xF) * 17);
+        dst[4*i + 2] = (GLubyte)(((src[i] >> 8)  & 0xF) * 17);
+        dst[4*i + 3] = (GLubyte)(( src[i] >> 12)        * 17);
+    }
+}
+
+#define PIX_NIBBLE(C) (((C) * 15 + 135) >> 8)
+
+static void pix_compress4444(GLint simd, GLushort* dst, GLubyte const* src, GLsizei n)
+{
+    GLsizei i = 0;
+
+#if SIMD_X86
+    if (simd != 0)
+    {
+        i = simd_sse2_pix_compress4444(dst, src, n);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i] = (GLushort)( PIX_NIBBLE(src[4*i + 0])        | (PIX_NIBBLE(src[4*i + 1]) << 4) |
+                            (PIX_NIBBLE(src[4*i + 2]) << 8)  | (PIX_NIBBLE(src[4*i + 3]) << 12));
+    }
+}
+
+/* scratch for pix_rescale_filtered, carved from one arena block */
+typedef struct
+{
+    GLint    simd;
+    GLint    chans;             //1 or 4
+    GLboolean nibbles;          //ARGB4444, widened to 4 bytes a row at a time
+    GLubyte const* src;
+    GLsizei  swidth;
+
+    GLubyte* wide[2];           //widened ARGB4444 rows
+    GLint    wideRow[2];        //which source row each holds, -1 for none
+    GLint    wideNext;
+} pix_rows;
+
+//row y of the source as byte channels
+static GLubyte const* pix_source_row(pix_rows* r, GLint y)
+{
+    GLint k;
+
+    if (!r->nibbles)
+    {
+        return r->src + r->chans * r->swidth * y;
+    }
+
+    for (k = 0; k < 2; k++)
+    {
+        if (r->wideRow[k] == y)
+        {
+            return r->wide[k];
+        }
+    }
+    k = r->wideNext;
+    r->wideNext ^= 1;
+    r->wideRow[k] = y;
+    pix_expand4444(r->simd, r->wide[k], (GLushort const*)r->src + r->swidth * y, r->swidth);
+    return r->wide[k];
+}
+
+#define PIX_ALIGN(N) (((N) + 31) & ~31)
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_rescale_filtered
+    Description : box / bilinear pix_rescale.  each destination row is
+                  filtered vertically into a row of source width, then
+                  horizontally
+    Inputs      : chans - byte channels per texel, 1 or 4
+                  (see pix_rescale)
+    Outputs     :
+    Return      : FALSE if there's no memory for scratch
+----------------------------------------------------------------------------*/
+static GLboolean pix_rescale_filtered(
+    GLuint format, GLuint filter, GLint chans,
+    GLubyte* dst, GLsizei dwidth, GLsizei dheight,
+    GLubyte const* src, GLsizei swidth, GLsizei sheight,
+    pix_arena* arena)
+{
+    pix_rows rows;
+    GLsizei rowBytes = PIX_ALIGN(chans * (swidth + 1) + 32);
+    GLsizei tabBytes = PIX_ALIGN(sizeof(GLint) * dwidth);
+    GLsizei wBytes = PIX_ALIGN(16 * dwidth);
+    GLsizei outBytes = PIX_ALIGN(4 * dwidth + 32);
+    GLint xstep = ((swidth + dwidth - 1) / dwidth + 255) / 256;
+    GLint ystep = ((sheight + dheight - 1) / dheight + 255) / 256;
+    GLubyte* base;
+    GLubyte* vrow;
+    GLubyte* orow;
+    GLushort* acc;
+    GLushort* xw;
+    GLint* xs;
+    GLint* xn;
+    GLint* xr;
+    GLubyte const* a;
+    GLubyte const* b;
+    GLubyte* out;
+    GLint x, y, k, s, n, f, c;
+    GLuint sum;
+
+    base = (GLubyte*)pix_arena_get(arena, 5*rowBytes + outBytes + 3*tabBytes + wBytes);
+    if (base == NULL)
+    {
+        return GL_FALSE;
+    }
+    vrow = base;
+    acc = (GLushort*)(base + rowBytes);     //2 bytes per channel
+    rows.wide[0] = base + 3*rowBytes;
+    rows.wide[1] = base + 4*rowBytes;
+    orow = base + 5*rowBytes;
+    xs = (GLint*)(orow + outBytes);
+    xn = (GLint*)((GLubyte*)xs + tabBytes);
+    xr = (GLint*)((GLubyte*)xn + tabBytes);
+    xw = (GLushort*)((GLubyte*)xr + tabBytes);
+
+    rows.simd = pix_simd();
+    rows.chans = chans;
+    rows.nibbles = (format == PIX_ARGB4444);
+    rows.src = src;
+    rows.swidth = swidth;
+    rows.wideRow[0] = rows.wideRow[1] = -1;
+    rows.wideNext = 0;
+
+    //horizontal taps
+    for (x = 0; x < dwidth; x++)
+    {
+        if (filter == PIX_BOX)
+        {
+            pix_box_span(x, dwidth, swidth, &xs[x], &xn[x], xstep);
+            xr[x] = PIX_RECIP(xn[x]);
+        }
+        else
+        {
+            pix_bilinear_tap(x, dwidth, swidth, &xs[x], &xn[x]);
+            if (chans == 4)
+            {
+                for (k = 0; k < 4; k++)
+                {
+                    xw[8*x + k] = (GLushort)(256 - xn[x]);
+                    xw[8*x + 4 + k] = (GLushort)xn[x];
+                }
+            }
+            else
+            {
+                xw[2*x + 0] = (GLushort)(256 - xn[x]);
+                xw[2*x + 1] = (GLushort)xn[x];
+            }
+        }
+    }
+
+    for (y = 0; y < dheight; y++)
+    {
+        //vertical, into vrow
+        if (filter == PIX_BOX)
+        {
+            pix_box_span(y, dheight, sheight, &s, &n, ystep);
+            if (n == 1)
+            {
+                MEMCPY(vrow, pix_source_row(&rows, s), chans * swidth);
+            }
+            else
+            {
+                for (k = 0; k < n; k++)
+                {
+                    pix_accum(rows.simd, acc, pix_source_row(&rows, s + k*ystep), chans * swidth, k == 0);
+                }
+                pix_average(rows.simd, vrow, acc, chans * swidth, n);
+            }
+        }
+        else
+        {
+            pix_bilinear_tap(y, dheight, sheight, &s, &f);
+            a = pix_source_row(&rows, s);
+            if (f == 0)
+            {
+                MEMCPY(vrow, a, chans * swidth);
+            }
+            else
+            {
+                b = pix_source_row(&rows, s + 1);
+                pix_lerp(rows.simd, vrow, a, b, chans * swidth, f);
+            }
+        }
+        //the right edge tap reads one past the end
+        MEMCPY(vrow + chans * swidth, vrow + chans * (swidth - 1), chans);
+
+        //horizontal, into the destination row
+        out = rows.nibbles ? orow : dst;
+        x = 0;
+#if SIMD_X86
+        if (rows.simd != 0)
+        {
+            if (filter != PIX_BOX)
+            {
+                x = (chans == 4) ? simd_sse2_pix_hlerp4(out, vrow, xs, xw, dwidth)
+                                 : simd_sse2_pix_hlerp1(out, vrow, xs, xw, dwidth);
+            }
+            else if (chans == 4)
+            {
+                simd_sse2_pix_hbox4(out, vrow, xs, xn, xr, xstep, dwidth);
+                x = dwidth;
+            }
+        }
+#endif
+        for (; x < dwidth; x++)
+        {
+            for (c = 0; c < chans; c++)
+            {
+                a = vrow + chans * xs[x] + c;
+                if (filter == PIX_BOX)
+                {
+                    for (k = 0, sum = xn[x] >> 1; k < xn[x]; k++)
+                    {
+                        sum += a[chans * xstep * k];
+                    }
+                    out[chans*x + c] = (GLubyte)((sum * xr[x]) >> 16);
+                }
+                else
+                {
+                    out[chans*x + c] = (GLubyte)((a[0]*(256 - xn[x]) + a[chans]*xn[x] + 128) >> 8);
+                }
+            }
+        }
+
+        if (rows.nibbles)
+        {
+            pix_compress4444(rows.simd, (GLushort*)dst, orow, dwidth);
+            dst += 2 * dwidth;
+        }
+        else
+        {
+            dst += chans * dwidth;
+        }
+    }
+
+    return GL_TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_rescale
+    Description : resize an image (see pixconv.h)
+    Inputs      : format - PIX_ format of both images
+                  filter - PIX_NEAREST, PIX_BOX or PIX_BILINEAR.  BOX is
+                           for shrinking; an axis that grows gets NEAREST.
+                           BILINEAR is for growing, or shrinking by up to 2
+                  dwidth, dheight - destination dimensions
+                  src, swidth, sheight - the source image
+                  arena - scratch, or NULL
+    Outputs     : dst is filled
+    Return      : FALSE for a bad format or no memory
+----------------------------------------------------------------------------*/
+DLL GLboolean pix_rescale(
+    GLuint format, GLuint filter,
+    GLvoid* dst, GLsizei dwidth, GLsizei dheight,
+    GLvoid const* src, GLsizei swidth, GLsizei sheight,
+    pix_arena* arena)
+{
+    pix_arena local;
+    GLint chans;
+    GLboolean result;
+
+    if (format >= PIX_FORMATS ||
+        dwidth <= 0 || dheight <= 0 || swidth <= 0 || sheight <= 0)
+    {
+        return GL_FALSE;
+    }
+
+    if (dwidth == swidth && dheight == sheight)
+    {
+        MEMCPY(dst, src, pixBytes[format] * swidth * sheight);
+        return GL_TRUE;
+    }
+
+    switch (format)
+    {
+    case PIX_L8:
+        chans = 1;
+        break;
+    case PIX_RGBA:
+    case PIX_ARGB8888:
+    case PIX_XRGB8888:
+    case PIX_ARGB4444:
+        chans = 4;
+        break;
+    default:
+        chans = 0;
+    }
+
+    //a box no bigger than a texel is a point
+    if (filter == PIX_NEAREST || chans == 0 ||
+        (filter == PIX_BOX && dwidth >= swidth && dheight >= sheight))
+    {
+        pix_rescale_nearest(pixBytes[format], (GLubyte*)dst, dwidth, dheight,
+                            (GLubyte const*)src, swidth, sheight);
+        return GL_TRUE;
+    }
+
+    local.data = NULL;
+    local.size = 0;
+    result = pix_rescale_filtered(format, filter, chans, (GLubyte*)dst, dwidth, dheight,
+                                  (GLubyte const*)src, swidth, sheight,
+                                  (arena != NULL) ? arena : &local);
+    pix_arena_free(&local);
+    return result;
+}
+
+/* linear light is kept in 14 bits, so 4 texels sum in a GLushort.  colour
+   goes through pixLinear / pixSrgb, alpha is scaled: a*64 + a/4 */
+#define PIX_LINEAR_BITS 14
+#define PIX_LINEAR_MAX  ((1 << PIX_LINEAR_BITS) - 1)
+
+//byte -> linear, channel c at [256*c].  padded for 4 byte gathers
+static GLushort pixLinear[4*256 + 2];
+//linear -> sRGB byte
+static GLubyte pixSrgb[PIX_LINEAR_MAX + 1];
+static GLboolean pixSrgbReady = GL_FALSE;
+
+static void pix_srgb_tables(void)
+{
+    GLint i, c;
+    GLdouble v;
+
+    if (pixSrgbReady)
+    {
+        return;
+    }
+
+    for (i = 0; i < 256; i++)
+    {
+        v = i / 255.0;
+        v = (v <= 0.04045) ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+        for (c = 0; c < 3; c++)
+        {
+            pixLinear[256*c + i] = (GLushort)floor(v * PIX_LINEAR_MAX + 0.5);
+        }
+        pixLinear[768 + i] = (GLushort)((i << 6) | (i >> 2));
+    }
+    for (i = 0; i <= PIX_LINEAR_MAX; i++)
+    {
+        v = (GLdouble)i / PIX_LINEAR_MAX;
+        v = (v <= 0.0031308) ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+        pixSrgb[i] = (GLubyte)floor(v * 255.0 + 0.5);
+    }
+    pixSrgbReady = GL_TRUE;
+}
+
+//n RGBA texels to linear
+static void pix_srgb_decode(GLint simd, GLushort* dst, GLubyte const* src, GLsizei n)
+{
+    GLsizei i = 0;
+
+#if SIMD_X86
+    if (simd == 2)
+    {
+        i = simd_avx2_pix_srgb_decode(dst, src, n, pixLinear);
+    }
+#endif
+    for (i *= 4; i < 4*n; i += 4)
+    {
+        dst[i + 0] = pixLinear[src[i + 0]];
+        dst[i + 1] = pixLinear[256 + src[i + 1]];
+        dst[i + 2] = pixLinear[512 + src[i + 2]];
+        dst[i + 3] = pixLinear[768 + src[i + 3]];
+    }
+}
+
+//n linear texels back to RGBA
+static void pix_srgb_encode(GLubyte* dst, GLushort const* src, GLsizei n)
+{
+    GLsizei i;
+
+    for (i = 0; i < 4*n; i += 4)
+    {
+        dst[i + 0] = pixSrgb[src[i + 0]];
+        dst[i + 1] = pixSrgb[src[i + 1]];
+        dst[i + 2] = pixSrgb[src[i + 2]];
+        dst[i + 3] = (GLubyte)((src[i + 3] * 255 + (1 << (PIX_LINEAR_BITS - 1))) >> PIX_LINEAR_BITS);
+    }
+}
+
+/* a row of the next level from 2 linear rows of swidth texels.  a 1 wide
+   row has its texel counted twice, an odd one drops its last */
+static void pix_mip_reduce(GLint simd, GLushort* dst, GLushort const* r0, GLushort const* r1, GLsizei swidth)
+{
+    GLsizei n = swidth >> 1;
+    GLsizei i = 0;
+    GLint c;
+
+    if (n == 0)
+    {
+        for (c = 0; c < 4; c++)
+        {
+            dst[c] = (GLushort)((2*r0[c] + 2*r1[c] + 2) >> 2);
+        }
+        return;
+    }
+
+#if SIMD_X86
+    if (simd == 2)
+    {
+        i = simd_avx2_pix_mip_reduce(dst, r0, r1, n);
+    }
+    else if (simd == 1)
+    {
+        i = simd_sse2_pix_mip_reduce(dst, r0, r1, n);
+    }
+#endif
+    for (i *= 4; i < 4*n; i++)
+    {
+        c = (i & ~3) * 2 + (i & 3);
+        dst[i] = (GLushort)((r0[c] + r0[c + 4] + r1[c] + r1[c + 4] + 2) >> 2);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_mip_bytes
+    Description : size up a mip chain (see pixconv.h)
+    Inputs      : width, height - level 0
+    Outputs     : levels - the number below level 0, if not NULL
+    Return      : bytes of a PIX_RGBA chain, 0 for a 1x1 image
+----------------------------------------------------------------------------*/
+DLL GLsizei pix_mip_bytes(GLsizei width, GLsizei height, GLuint* levels)
+{
+    GLsizei bytes = 0;
+    GLuint n = 0;
+
+    while (width > 1 || height > 1)
+    {
+        width  = (width > 1) ? width >> 1 : 1;
+        height = (height > 1) ? height >> 1 : 1;
+        bytes += 4 * width * height;
+        n++;
+    }
+
+    if (levels != NULL)
+    {
+        *levels = n;
+    }
+    return bytes;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pix_mipmap
+    Description : build a PIX_RGBA image's mip chain.  level 0 is decoded to
+                  linear a pair of rows at a time, and every level after is
+                  filtered from the linear one before it, so the rounding to
+                  bytes isn't compounded down the chain
+    Inputs      : src, width, height - level 0
+                  arena - scratch, or NULL
+    Outputs     : dst - levels 1.., pix_mip_bytes of them
+    Return      : FALSE for a bad size or no memory
+----------------------------------------------------------------------------*/
+DLL GLboolean pix_mipmap(
+    GLvoid* dst, GLvoid const* src, GLsizei width, GLsizei height,
+    pix_arena* arena)
+{
+    pix_arena local;
+    GLint simd = pix_simd();
+    GLsizei w1 = (width > 1) ? width >> 1 : 1;
+    GLsizei h1 = (height > 1) ? height >> 1 : 1;
+    GLsizei rowBytes = PIX_ALIGN(8 * width);
+    GLsizei levelBytes = PIX_ALIGN(8 * w1 * h1);
+    GLsizei level2Bytes = PIX_ALIGN(8 * ((w1 > 1) ? w1 >> 1 : 1) * ((h1 > 1) ? h1 >> 1 : 1));
+    GLubyte* base;
+    GLubyte* out = (GLubyte*)dst;
+    GLubyte const* in = (GLubyte const*)src;
+    GLushort* row[2];
+    GLushort* lin[2];
+    GLushort const* prev;
+    GLushort* next;
+    GLsizei w, h, y;
+    GLint k;
+
+    if (width <= 0 || height <= 0)
+    {
+        return GL_FALSE;
+    }
+    if (width == 1 && height == 1)
+    {
+        return GL_TRUE;
+    }
+
+    local.data = NULL;
+    local.size = 0;
+    if (arena == NULL)
+    {
+        arena = &local;
+    }
+    //levels 1 & 2 in linear, the ones below going back and forth between them
+    base = (GLubyte*)pix_arena_get(arena, 2*rowBytes + levelBytes + level2Bytes);
+    if (base == NULL)
+    {
+        return GL_FALSE;
+    }
+    row[0] = (GLushort*)base;
+    row[1] = (GLushort*)(base + rowBytes);
+    lin[0] = (GLushort*)(base + 2*rowBytes);
+    lin[1] = (GLushort*)(base + 2*rowBytes + levelBytes);
+
+    pix_srgb_tables();
+
+    //level 1 straight from the source rows
+    for (y = 0; y < h1; y++)
+    {
+        pix_srgb_decode(simd, row[0], in + 4 * width * 2*y, width);
+        if (height > 1)
+        {
+            pix_srgb_decode(simd, row[1], in + 4 * width * (2*y + 1), width);
+        }
+        pix_mip_reduce(simd, lin[0] + 4 * w1 * y, row[0], (height > 1) ? row[1] : row[0], width);
+    }
+    pix_srgb_encode(out, lin[0], w1 * h1);
+    out += 4 * w1 * h1;
+
+    for (w = w1, h = h1, k = 0; w > 1 || h > 1; k ^= 1)
+    {
+        prev = lin[k];
+        next = lin[k ^ 1];
+        for (y = 0; y < ((h > 1) ? h >> 1 : 1); y++)
+        {
+            pix_mip_reduce(simd, next + 4 * ((w > 1) ? w >> 1 : 1) * y,
+                           prev + 4 * w * 2*y, prev + 4 * w * ((h > 1) ? 2*y + 1 : 0), w);
+        }
+        w = (w > 1) ? w >> 1 : 1;
+        h = (h > 1) ? h >> 1 : 1;
+        pix_srgb_encode(out, next, w * h);
+        out += 4 * w * h;
+    }
+
+    pix_arena_free(&local);
+    return GL_TRUE;
+}
@@ -0,0 +1,94 @@
+/*=============================================================================
+        Name    : pixconv.h
+        Purpose : pixel format conversion for texture uploads, shared by the
+                  drivers' blitters.  scalar, with SSE2 / AVX2 rows where
+                  the CPU has them
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#ifndef _PIXCONV_H
+#define _PIXCONV_H
+
+#include "kgl.h"
+
+/* formats, named for their layout in memory.  the 16 & 32 bit ones are
+   little endian words, high bits first as D3D names them */
+#define PIX_RGBA        0   //GL RGBA, 4 bytes r g b a
+#define PIX_ARGB8888    1   //D3DFMT_A8R8G8B8, RGBA_MAKE
+#define PIX_XRGB8888    2   //D3DFMT_X8R8G8B8, the top byte 0
+#define PIX_RGB565      3   //D3DFMT_R5G6B5
+#define PIX_XRGB1555    4   //D3DFMT_X1R5G5B5, the top bit 0
+#define PIX_ARGB4444    5   //D3DFMT_A4R4G4B4, and GL_RGBA16 as rgl keeps it
+#define PIX_INDEX8      6   //colour index
+#define PIX_L8          7   //one byte, luminance or alpha
+#define PIX_FORMATS     8
+
+/* sources: PIX_RGBA, PIX_ARGB4444 and PIX_INDEX8.  RGBA & ARGB4444 go to
+   any of ARGB8888, XRGB8888, RGB565, XRGB1555 and ARGB4444, truncating (or
+   shifting up) each channel as the old d3d_blt_ loops did; INDEX8 & L8
+   only to themselves.  pitches are in bytes, multiples of the pixel size */
+DLL GLboolean pix_convert(
+    GLuint dformat, GLvoid* dst, GLint dpitch,
+    GLuint sformat, GLvoid const* src, GLint spitch,
+    GLsizei width, GLsizei height);
+
+/* as pix_convert to a 2 or 4 byte format described by per channel (r g b
+   a) bit counts & shifts, eg. from a DDPIXELFORMAT.  layouts pix_convert
+   knows go through it */
+DLL GLboolean pix_convert_masks(
+    GLvoid* dst, GLint dpitch, GLint bytesPerPixel,
+    GLint const bits[4], GLint const shift[4],
+    GLuint sformat, GLvoid const* src, GLint spitch,
+    GLsizei width, GLsizei height);
+
+/* INDEX8 through a 256 entry palette already in the destination format,
+   GLushort for a 2 byte format and GLuint for a 4 byte one */
+DLL void pix_expand_index(
+    GLvoid* dst, GLint dpitch, GLint bytesPerPixel,
+    GLubyte const* src, GLint spitch,
+    GLvoid const* palette, GLsizei width, GLsizei height);
+
+/* pix_rescale filters */
+#define PIX_NEAREST     0   //the texel under each destination texel's centre
+#define PIX_BOX         1   //the average of the texels under it
+#define PIX_BILINEAR    2   //the 4 texels nearest its centre, weighted
+
+/* scratch memory kept between calls.  start it out zeroed */
+typedef struct
+{
+    GLubyte* data;
+    GLsizei  size;
+} pix_arena;
+
+//at least bytes of scratch, whatever was in it before is lost
+DLL GLvoid* pix_arena_get(pix_arena* arena, GLsizei bytes);
+DLL void pix_arena_free(pix_arena* arena);
+
+/* resize a packed image.  4 byte formats, ARGB4444 and L8 are filtered a
+   channel at a time; INDEX8, RGB565 and XRGB1555 always go NEAREST.  arena
+   may be NULL, in which case scratch is allocated for the call */
+DLL GLboolean pix_rescale(
+    GLuint format, GLuint filter,
+    GLvoid* dst, GLsizei dwidth, GLsizei dheight,
+    GLvoid const* src, GLsizei swidth, GLsizei sheight,
+    pix_arena* arena);
+
+/* mip chains.  each level is the 2x2 box filter of the one before, halving
+   both sides down to 1; a side of 1 stays 1 and an odd one drops its last
+   texel.  colour is averaged in linear light, taking texels to be sRGB,
+   and alpha as it is */
+
+//bytes of a PIX_RGBA chain below a width x height level 0, & how many levels
+DLL GLsizei pix_mip_bytes(GLsizei width, GLsizei height, GLuint* levels);
+
+/* a PIX_RGBA image's chain, levels 1.. packed one after another.  arena as
+   pix_rescale */
+DLL GLboolean pix_mipmap(
+    GLvoid* dst, GLvoid const* src, GLsizei width, GLsizei height,
+    pix_arena* arena);
+
+//bytes per pixel of a format, 0 if it isn't one
+DLL GLuint pix_bytes(GLuint format);
+
+#endif
@@ -7,8 +7,11 @@
 =============================================================================*/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "kgl.h"
 #include "rglext.h"
+#include "trace.h"
 
 //mesh polygon modes for rendering
 #define MPM_Flat            0
@@ -47,6 +50,45 @@ static GLint pentry_material;
 static GLint pentry_texcoords;
 static GLubyte* poly_list;
 
+/* pretransform mode (RGL_MESH_PRETRANSFORM): each mesh vertex goes into
+   the VB once per batch, triangles index it.  meshSlot[v] is the VB slot
+   mesh vertex v went in, valid while meshStamp[v] == meshBatch.  a slot is
+   only shared by corners with the same normal (and texcoords, if textured).
+   meshSlotNormal and meshIndices grow with the VB (mesh_reserve), so a
+   material's batch is only split if memory runs out */
+#define MESH_MAX_VERTS   65536
+
+static GLuint meshSlot[MESH_MAX_VERTS];
+static GLuint meshStamp[MESH_MAX_VERTS];
+static GLuint meshBatch = 0;
+static GLint* meshSlotNormal = NULL;
+static GLuint meshSlotMax = 0;
+static GLuint* meshIndices = NULL;
+static GLuint meshIndexMax = 0;
+static GLuint meshIndexCount;
+
+//vertices put in the VB / referenced by polys, in the last rglMeshRender
+static GLuint meshUnique;
+static GLuint meshReferenced;
+
+/* material sorting (RGL_MESH_SORT): a mesh's poly indices, stably sorted by
+   material, built the first time a poly list is seen and kept.  keyed by the
+   list pointer and poly count, since the game's poly lists don't move or
+   change.  a stale order is only ever a worse grouping, as the materials are
+   still read from the polys as they're drawn */
+#define MESH_ORDER_CACHE 256
+
+typedef struct mesh_order_s
+{
+    GLubyte* polyList;
+    GLint nPolys;
+    GLushort* order;
+} mesh_order;
+
+static mesh_order meshOrder[MESH_ORDER_CACHE];
+
+extern GLuint g_MaterialSwitches;
+
 #define NORMAL(n) \
     { \
         current->Normal[0] = n[0]; \
@@ -56,6 +98,8 @@ static GLubyte* poly_list;
 
 DLL void rglListSpec(RGLenum pname, RGLenum param, GLint n, GLenum format)
 {
+    if (TRACING) trace_op(TRACE_ListSpec, 4, pname, param, n, format);
+
     switch (pname)
     {
     case RGL_VERTEX_LIST:
@@ -157,8 +201,15 @@ DLL void rglTriangle(GLint iPoly)
     GLushort* sptr;
 
     GLuint    count = VB->Count;
-    GLfloat*  obj = VB->Obj[count];
-    GLfloat*  normal = VB->Normal[count];
+    GLfloat*  obj;
+    GLfloat*  normal;
+
+    if (count + 3 > VB->Max && !gl_grow_vb(ctx, count + 3))
+    {
+        return;
+    }
+    obj = VB->Obj[count];
+    normal = VB->Normal[count];
 
     iptr = (GLint*)(poly_list + pentry_size*iPoly + pentry_normal);
 #if SLOW
@@ -205,9 +256,17 @@ DLL void rglTexturedTriangle(GLint iPoly)
     GLushort* sptr;
 
     GLuint    count = VB->Count;
-    GLfloat*  obj = VB->Obj[count];
-    GLfloat*  normal = VB->Normal[count];
-    GLfloat*  tex = VB->TexCoord[count];
+    GLfloat*  obj;
+    GLfloat*  normal;
+    GLfloat*  tex;
+
+    if (count + 3 > VB->Max && !gl_grow_vb(ctx, count + 3))
+    {
+        return;
+    }
+    obj = VB->Obj[count];
+    normal = VB->Normal[count];
+    tex = VB->TexCoord[count];
 
     iptr = (GLint*)(poly_list + pentry_size*iPoly + pentry_normal);
 #if SLOW
@@ -258,8 +317,15 @@ DLL void rglSmoothTriangle(GLint iPoly)
     GLushort* sptr;
 
     GLuint    count = VB->Count;
-    GLfloat*  obj = VB->Obj[count];
-    GLfloat*  normal = VB->Normal[count];
+    GLfloat*  obj;
+    GLfloat*  normal;
+
+    if (count + 3 > VB->Max && !gl_grow_vb(ctx, count + 3))
+    {
+        return;
+    }
+    obj = VB->Obj[count];
+    normal = VB->Normal[count];
 
     sptr = (GLushort*)(poly_list + pentry_size*iPoly + pentry_vertices);
 
@@ -317,9 +383,17 @@ DLL void rglSmoothTexturedTriangle(GLint iPoly)
     GLushort* sptr;
 
     GLuint    count = VB->Count;
-    GLfloat*  obj = VB->Obj[count];
-    GLfloat*  normal = VB->Normal[count];
-    GLfloat*  tex = VB->TexCoord[count];
+    GLfloat*  obj;
+    GLfloat*  normal;
+    GLfloat*  tex;
+
+    if (count + 3 > VB->Max && !gl_grow_vb(ctx, count + 3))
+    {
+        return;
+    }
+    obj = VB->Obj[count];
+    normal = VB->Normal[count];
+    tex = VB->TexCoord[count];
 
     sptr = (GLushort*)(poly_list + pentry_size*iPoly + pentry_vertices);
     tptr = (GLfloat*)(poly_list + pentry_size*iPoly + pentry_texcoords);
@@ -372,6 +446,62 @@ DLL void rglSmoothTexturedTriangle(GLint iPoly)
     VB->Count += 3;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : trace_mesh
+    Description : record an rglMeshRender along with the vertex, normal and
+                  poly lists it's going to read.  the normal list is sized by
+                  the largest normal index found in either the polys or the
+                  vertices, since the callback may switch between flat and
+                  smooth modes part way through.  a mesh that's only drawn
+                  flat may not have vertex normals at all, so anything out of
+                  16 bit range there is taken to be something else
+    Inputs      : n - rglMeshRender's packed poly / vertex count
+                  mode - the mesh poly mode at entry
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void trace_mesh(GLint n, GLint mode)
+{
+    GLint nPolys, nVerts, i, index, maxNormal;
+    GLuint args[2];
+    GLuint vbytes, nbytes, pbytes;
+
+    nVerts = (n & 0xffff0000) >> 16;
+    nPolys = n & 0xffff;
+
+    maxNormal = -1;
+    for (i = 0; i < nPolys; i++)
+    {
+        index = *(GLint*)(poly_list + pentry_size*i + pentry_normal);
+        if (index > maxNormal)
+        {
+            maxNormal = index;
+        }
+    }
+    for (i = 0; i < nVerts; i++)
+    {
+        index = *(GLint*)(vertex_list + ventry_size*i + ventry_normal);
+        if (index > maxNormal && index <= 0xffff)
+        {
+            maxNormal = index;
+        }
+    }
+
+    vbytes = nVerts * ventry_size;
+    nbytes = (maxNormal + 1) * nentry_size;
+    pbytes = nPolys * pentry_size;
+
+    args[0] = n;
+    args[1] = mode;
+    trace_record(TRACE_MeshRender,
+                 2 + TRACE_BLOCK_WORDS(vbytes) + TRACE_BLOCK_WORDS(nbytes) + TRACE_BLOCK_WORDS(pbytes));
+    trace_words(2, args);
+    trace_block(vertex_list, vbytes);
+    trace_block(normal_list, nbytes);
+    trace_block(poly_list, pbytes);
+}
+
+#if RGL_ASM
 #define S(x)   dword ptr [esi + 4*x]
 #define D(x)   dword ptr [edi + 4*x]
 #define M(n)   dword ptr [edx + 4*n]
@@ -516,17 +646,360 @@ static void normal_transform(GLfloat* d, GLfloat* s, GLfloat* m, GLuint n)
     }
 }
 
+#elif !SLOW
+
+//C versions for the !SLOW path in rglMeshRender
+static void affine_transform(
+    GLuint n, GLfloat* d, GLfloat m[16], GLfloat* s)
+{
+    GLuint i;
+    for (i = 0; i < n; i++, d += 4, s += 4)
+    {
+        GLfloat ox = s[0], oy = s[1], oz = s[2];
+        d[0] = m[0] * ox + m[4] * oy + m[8]  * oz + m[12];
+        d[1] = m[1] * ox + m[5] * oy + m[9]  * oz + m[13];
+        d[2] = m[2] * ox + m[6] * oy + m[10] * oz + m[14];
+        d[3] = 1.0f;
+    }
+}
+
+static void normal_transform(GLfloat* d, GLfloat* s, GLfloat* m, GLuint n)
+{
+    GLuint i;
+    for (i = 0; i < n; i++, d += 3, s += 4)
+    {
+        GLfloat ux = s[0], uy = s[1], uz = s[2];
+        d[0] = ux * m[0] + uy * m[1] + uz * m[2];
+        d[1] = ux * m[4] + uy * m[5] + uz * m[6];
+        d[2] = ux * m[8] + uy * m[9] + uz * m[10];
+    }
+}
+
+#endif
+
+/*-----------------------------------------------------------------------------
+    Name        : mesh_begin, mesh_end
+    Description : bracket a pretransform mode batch, in place of
+                  glBegin(GL_TRIANGLES) / glEnd.  the VB is transformed, lit
+                  and cliptested as usual, then drawn from meshIndices
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void mesh_begin(void)
+{
+    glBegin(GL_TRIANGLES);
+
+    meshBatch++;
+    if (meshBatch == 0)
+    {
+        //wrapped, every stamp is suspect
+        MEMSET(meshStamp, 0, sizeof(meshStamp));
+        meshBatch = 1;
+    }
+    meshIndexCount = 0;
+}
+
+static void mesh_end(void)
+{
+    if (VB->Count != 0)
+    {
+        VB->Indices = meshIndices;
+        VB->IndexCount = meshIndexCount;
+    }
+    glEnd();
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : mesh_vertex
+    Description : VB slot for a poly corner, adding the vertex to the VB if
+                  it isn't already there with the same normal and texcoords
+    Inputs      : v - mesh vertex index
+                  nindex - normal list index
+                  tex - the corner's texcoords, or NULL
+    Outputs     :
+    Return      : the slot
+----------------------------------------------------------------------------*/
+static GLuint mesh_vertex(GLint v, GLint nindex, GLfloat const* tex)
+{
+    GLuint slot;
+    GLfloat* vptr;
+    GLfloat* nptr;
+
+    if (meshStamp[v] == meshBatch)
+    {
+        slot = meshSlot[v];
+        if (meshSlotNormal[slot] == nindex &&
+            (tex == NULL ||
+             (VB->TexCoord[slot][0] == tex[0] && VB->TexCoord[slot][1] == tex[1])))
+        {
+            return slot;
+        }
+    }
+
+    slot = VB->Count++;
+    meshUnique++;
+
+    meshStamp[v] = meshBatch;
+    meshSlot[v] = slot;
+    meshSlotNormal[slot] = nindex;
+
+    vptr = (GLfloat*)(vertex_list + ventry_size*v + ventry_x);
+    nptr = (GLfloat*)(normal_list + nentry_size*nindex + nentry_x);
+    VB->Obj[slot][0] = vptr[0];
+    VB->Obj[slot][1] = vptr[1];
+    VB->Obj[slot][2] = vptr[2];
+    VB->Obj[slot][3] = 1.0f;
+    VB->Normal[slot][0] = nptr[0];
+    VB->Normal[slot][1] = nptr[1];
+    VB->Normal[slot][2] = nptr[2];
+    if (tex != NULL)
+    {
+        VB->TexCoord[slot][0] = tex[0];
+        VB->TexCoord[slot][1] = tex[1];
+    }
+
+    return slot;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : mesh_reserve
+    Description : make room for another poly in the current batch, growing
+                  the VB and the mesh arrays along with it
+    Inputs      :
+    Outputs     : meshSlotNormal, meshIndices may be reallocated
+    Return      : GL_FALSE if out of memory
+----------------------------------------------------------------------------*/
+static GLboolean mesh_reserve(void)
+{
+    if (!gl_grow_vb(ctx, VB->Count + 3))
+    {
+        return GL_FALSE;
+    }
+
+    if (meshSlotMax < VB->Max)
+    {
+        GLint* slotNormal = (GLint*)gl_Allocate(VB->Max * sizeof(GLint));
+        if (slotNormal == NULL)
+        {
+            return GL_FALSE;
+        }
+        if (meshSlotNormal != NULL)
+        {
+            MEMCPY(slotNormal, meshSlotNormal, VB->Count * sizeof(GLint));
+            gl_Free(meshSlotNormal);
+        }
+        meshSlotNormal = slotNormal;
+        meshSlotMax = VB->Max;
+    }
+
+    if (meshIndexCount + 3 > meshIndexMax)
+    {
+        GLuint max = (meshIndexMax != 0) ? 2*meshIndexMax : 3*VB_MAX;
+        GLuint* indices = (GLuint*)gl_Allocate(max * sizeof(GLuint));
+        if (indices == NULL)
+        {
+            return GL_FALSE;
+        }
+        if (meshIndices != NULL)
+        {
+            MEMCPY(indices, meshIndices, meshIndexCount * sizeof(GLuint));
+            gl_Free(meshIndices);
+        }
+        meshIndices = indices;
+        meshIndexMax = max;
+    }
+
+    return GL_TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : mesh_triangle
+    Description : pretransform mode equivalent of rglTriangle & co
+    Inputs      : iPoly - poly index
+                  mode - mesh poly mode
+    Outputs     : the poly's corners are added to meshIndices
+    Return      :
+----------------------------------------------------------------------------*/
+static void mesh_triangle(GLint iPoly, GLint mode)
+{
+    GLubyte*  poly = poly_list + pentry_size*iPoly;
+    GLushort* sptr = (GLushort*)(poly + pentry_vertices);
+    GLfloat*  tptr = NULL;
+    GLint     nindex = -1;
+    GLint     j, v;
+
+    if (mode == MPM_Texture || mode == MPM_SmoothTexture)
+    {
+        tptr = (GLfloat*)(poly + pentry_texcoords);
+    }
+    if (mode == MPM_Flat || mode == MPM_Texture)
+    {
+        nindex = *(GLint*)(poly + pentry_normal);
+    }
+
+    if ((VB->Count + 3 > meshSlotMax || meshIndexCount + 3 > meshIndexMax) &&
+        !mesh_reserve())
+    {
+        //draw what we have, the batch then fits in what's already allocated
+        mesh_end();
+        mesh_begin();
+        if (meshIndices == NULL || meshSlotNormal == NULL)
+        {
+            return;
+        }
+    }
+
+    meshReferenced += 3;
+    for (j = 0; j < 3; j++)
+    {
+        v = sptr[j];
+        meshIndices[meshIndexCount++] = mesh_vertex(
+            v,
+            (nindex >= 0) ? nindex : *(GLint*)(vertex_list + ventry_size*v + ventry_normal),
+            (tptr != NULL) ? tptr + 2*j : NULL);
+    }
+}
+
+static int mesh_order_compare(void const* a, void const* b)
+{
+    GLuint ka = *(GLuint const*)a;
+    GLuint kb = *(GLuint const*)b;
+    return (ka < kb) ? -1 : (ka > kb) ? 1 : 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : mesh_sort
+    Description : poly drawing order for the current poly list, grouped by
+                  material and otherwise in list order
+    Inputs      : nPolys - number of polys in the list
+    Outputs     : the order is cached
+    Return      : poly indices, or NULL if out of memory
+----------------------------------------------------------------------------*/
+static GLushort* mesh_sort(GLint nPolys)
+{
+    mesh_order* entry;
+    GLuint* keys;
+    GLint i;
+
+    entry = &meshOrder[((size_t)poly_list >> 4) % MESH_ORDER_CACHE];
+    if (entry->polyList == poly_list && entry->nPolys == nPolys)
+    {
+        return entry->order;
+    }
+
+    if (entry->order != NULL)
+    {
+        gl_Free(entry->order);
+        entry->order = NULL;
+        entry->polyList = NULL;
+    }
+
+    keys = (GLuint*)gl_Allocate(nPolys * sizeof(GLuint));
+    entry->order = (GLushort*)gl_Allocate(nPolys * sizeof(GLushort));
+    if (keys == NULL || entry->order == NULL)
+    {
+        if (keys != NULL)
+        {
+            gl_Free(keys);
+        }
+        if (entry->order != NULL)
+        {
+            gl_Free(entry->order);
+            entry->order = NULL;
+        }
+        return NULL;
+    }
+
+    //material in the high half, list position in the low keeps it stable
+    for (i = 0; i < nPolys; i++)
+    {
+        keys[i] = ((GLuint)*(GLushort*)(poly_list + pentry_size*i + pentry_material) << 16) | i;
+    }
+    qsort(keys, nPolys, sizeof(GLuint), mesh_order_compare);
+    for (i = 0; i < nPolys; i++)
+    {
+        entry->order[i] = (GLushort)(keys[i] & 0xffff);
+    }
+    gl_Free(keys);
+
+    entry->polyList = poly_list;
+    entry->nPolys = nPolys;
+    return entry->order;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : gl_mesh_shutdown
+    Description : free the cached material orders and the pretransform
+                  mode arrays
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void gl_mesh_shutdown(void)
+{
+    GLint i;
+
+    for (i = 0; i < MESH_ORDER_CACHE; i++)
+    {
+        if (meshOrder[i].order != NULL)
+        {
+            gl_Free(meshOrder[i].order);
+        }
+        meshOrder[i].order = NULL;
+        meshOrder[i].polyList = NULL;
+        meshOrder[i].nPolys = 0;
+    }
+
+    if (meshSlotNormal != NULL)
+    {
+        gl_Free(meshSlotNormal);
+        meshSlotNormal = NULL;
+    }
+    meshSlotMax = 0;
+    if (meshIndices != NULL)
+    {
+        gl_Free(meshIndices);
+        meshIndices = NULL;
+    }
+    meshIndexMax = 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : rglMeshStats
+    Description : vertex counts for the last rglMeshRender.  referenced is
+                  3 per poly, unique is what went through transform, lighting
+                  and cliptesting (the same as referenced with
+                  RGL_MESH_PRETRANSFORM disabled)
+    Inputs      :
+    Outputs     : unique, referenced - the counts, either may be NULL
+    Return      :
+----------------------------------------------------------------------------*/
+DLL void rglMeshStats(GLuint* unique, GLuint* referenced)
+{
+    if (unique != NULL)
+    {
+        *unique = meshUnique;
+    }
+    if (referenced != NULL)
+    {
+        *referenced = meshReferenced;
+    }
+}
+
 DLL void rglMeshRender(
     GLint n, void (*callback)(GLint material), GLint* meshPolyMode)
 {
     GLint currentMaterial, material;
-    GLint i, mode, nVerts;
+    GLint i, k, mode, nVerts;
+    GLushort* order;
     GLenum model;
     GLubyte* poly;
     GLfloat* xptr;
     GLfloat* vptr;
     GLfloat  temp[4], v[4];
     GLfloat modelview[16], modelviewInv[16];
+    GLboolean pretransform;
     static GLfloat Identity[16] =
     {
         1.0f, 0.0f, 0.0f, 0.0f,
@@ -535,6 +1008,11 @@ DLL void rglMeshRender(
         0.0f, 0.0f, 0.0f, 1.0f
     };
 
+    if (TRACING) trace_mesh(n, *meshPolyMode);
+
+    //the callback's calls are recorded, ours aren't
+    trace_suspend();
+
 #if !SLOW
     if (xvertex_list == NULL)
     {
@@ -549,6 +1027,8 @@ DLL void rglMeshRender(
 #if !SLOW
     MEMCPY(modelview, ctx->ModelViewMatrix, 16*sizeof(GLfloat));
     MEMCPY(ctx->ModelViewMatrix, Identity, 16*sizeof(GLfloat));
+    //the type is left alone, but the cached product is now wrong
+    ctx->NewMask |= NEW_MVP;
     invert_matrix(modelview, modelviewInv);
 
     //transform the coordinates
@@ -558,28 +1038,74 @@ DLL void rglMeshRender(
 #endif
 
     currentMaterial = -1;
-    poly = poly_list;
+    order = ctx->MeshSortMaterials ? mesh_sort(n) : NULL;
+
+    //the callback can change lighting between materials, so sharing is
+    //within a material's batch
+    pretransform = (GLboolean)(ctx->MeshPretransform &&
+                               !ctx->DriverTransforms &&
+                               !ctx->RasterizeOnly);
+    meshUnique = 0;
+    meshReferenced = 0;
 
     model = GL_SMOOTH;
     if (ctx->ShadeModel != GL_SMOOTH)
     {
         glShadeModel(GL_SMOOTH);
     }
-    glBegin(GL_TRIANGLES);
+    if (pretransform)
+    {
+        mesh_begin();
+    }
+    else
+    {
+        glBegin(GL_TRIANGLES);
+    }
 
-    for (i = 0; i < n; i++, poly += pentry_size)
+    for (k = 0; k < n; k++)
     {
+        i = (order != NULL) ? order[k] : k;
+        poly = poly_list + pentry_size*i;
+
         material = (GLint)(*((GLushort*)(poly + pentry_material)));
         if (currentMaterial != material)
         {
-            glEnd();
+            g_MaterialSwitches++;
+            if (pretransform)
+            {
+                mesh_end();
+            }
+            else
+            {
+                glEnd();
+            }
+            trace_resume();
+            if (TRACING) trace_op(TRACE_MeshMaterial, 1, material);
             callback(material);
+            if (TRACING) trace_op(TRACE_MeshMaterialEnd, 1, *meshPolyMode);
+            trace_suspend();
             currentMaterial = material;
-            glBegin(GL_TRIANGLES);
+            if (pretransform)
+            {
+                mesh_begin();
+            }
+            else
+            {
+                glBegin(GL_TRIANGLES);
+            }
         }
 
         mode = *meshPolyMode;
 
+        if (pretransform)
+        {
+            mesh_triangle(i, mode);
+            continue;
+        }
+
+        meshUnique += 3;
+        meshReferenced += 3;
+
         switch (mode)
         {
         case MPM_Flat:
@@ -628,7 +1154,14 @@ DLL void rglMeshRender(
         }
     }
 
-    glEnd();
+    if (pretransform)
+    {
+        mesh_end();
+    }
+    else
+    {
+        glEnd();
+    }
 #if MPM_MatSwitch
     glShadeModel(GL_SMOOTH);
 #endif
@@ -636,5 +1169,8 @@ DLL void rglMeshRender(
 
 #if !SLOW
     MEMCPY(ctx->ModelViewMatrix, modelview, 16*sizeof(GLfloat));
+    ctx->NewMask |= NEW_MVP;
 #endif
+
+    trace_resume();
 }
@@ -23,6 +23,7 @@ DLL void rglTexturedTriangle(GLint iPoly);
 DLL void rglSmoothTriangle(GLint iPoly);
 DLL void rglSmoothTexturedTriangle(GLint iPoly);
 DLL void rglMeshRender(GLint n, void (*callback)(GLint material), GLint* meshPolyMode);
+DLL void rglMeshStats(GLuint* unique, GLuint* referenced);
 
 #endif
 
@@ -0,0 +1,2748 @@
+/*=============================================================================
+        Name    : simd.c
+        Purpose : portable SSE2 / AVX2 intrinsics versions of the rGL vertex
+                  transform & cliptest paths, and cpuid feature detection.
+                  the vertex buffer is array-of-structures ([n][4]), so each
+                  block of 4 (SSE2) or 8 (AVX2) vertices is transposed into
+                  x/y/z/w registers, worked on, and transposed back.
+                  arithmetic is ordered exactly as in the C_MATH paths
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "kgl.h"
+#include "kvb.h"
+#include "simd.h"
+#include "pixconv.h"
+
+#if SIMD_X86
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define SIMD_SSE2
+#define SIMD_AVX2
+#define SIMD_INLINE __forceinline
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#define SIMD_SSE2 __attribute__((target("sse2")))
+#define SIMD_AVX2 __attribute__((target("avx2")))
+#define SIMD_INLINE __inline__ __attribute__((always_inline))
+#endif
+
+/* cpuid leaf 1 results, filled by get_cputype() */
+static GLuint cpu_eax, cpu_ecx, cpu_edx;
+
+static void simd_cpuid(GLuint leaf, GLuint subleaf, GLuint regs[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+    if (__get_cpuid_max(0, NULL) < leaf)
+    {
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+        return;
+    }
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static GLuint simd_xgetbv()
+{
+#if defined(_MSC_VER)
+    return (GLuint)_xgetbv(0);
+#else
+    GLuint lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return lo;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : get_cputype
+    Description : query cpuid leaf 1 and remember the feature bits for the
+                  other get_cpu* functions
+    Inputs      :
+    Outputs     : cpu_eax, cpu_ecx, cpu_edx are set
+    Return      : the cpu family
+----------------------------------------------------------------------------*/
+GLuint get_cputype()
+{
+    GLuint regs[4];
+
+    simd_cpuid(0, 0, regs);
+    if (regs[0] < 1)
+    {
+        cpu_eax = cpu_ecx = cpu_edx = 0;
+        return 4;
+    }
+
+    simd_cpuid(1, 0, regs);
+    cpu_eax = regs[0];
+    cpu_ecx = regs[2];
+    cpu_edx = regs[3];
+    return (cpu_eax & 0x0f00) >> 8;
+}
+
+//only call after get_cputype()
+GLboolean get_cpummx()
+{
+    //MMX bit (23)
+    return (cpu_edx & 0x800000) ? GL_TRUE : GL_FALSE;
+}
+
+//only call after get_cputype()
+GLboolean get_cpukatmai()
+{
+    if ((cpu_edx & 0x2000000) &&    //XMM
+        (cpu_edx & 0x1000000))      //FXSR
+    {
+        return GL_TRUE;
+    }
+    else
+    {
+        return GL_FALSE;
+    }
+}
+
+//only call after get_cputype()
+GLboolean get_cpusse2()
+{
+    //SSE2 bit (26)
+    return (cpu_edx & 0x4000000) ? GL_TRUE : GL_FALSE;
+}
+
+//only call after get_cputype()
+GLboolean get_cpuavx2()
+{
+    GLuint regs[4];
+
+    //OSXSAVE (27) & AVX (28), and the OS must save ymm state
+    if ((cpu_ecx & 0x18000000) != 0x18000000)
+    {
+        return GL_FALSE;
+    }
+    if ((simd_xgetbv() & 0x6) != 0x6)
+    {
+        return GL_FALSE;
+    }
+
+    //AVX2 is leaf 7 ebx bit 5
+    simd_cpuid(7, 0, regs);
+    return (regs[1] & 0x20) ? GL_TRUE : GL_FALSE;
+}
+
+/*
+ * SSE2, 4 vertices per block
+ */
+
+#define SSE2_SIGN _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000))
+#define SSE2_BIT(B) _mm_castsi128_ps(_mm_set1_epi32(B))
+
+static SIMD_SSE2 void sse2_load_matrix(__m128 mv[16], GLfloat const* m)
+{
+    GLuint i;
+    for (i = 0; i < 16; i++)
+    {
+        mv[i] = _mm_set1_ps(m[i]);
+    }
+}
+
+/* object -> eye for a MATRIX_GENERAL or MATRIX_3D modelview, w taken as 1.
+   object -> clip likewise with the modelview-projection product.
+   the x/y/z/w lanes go in and out as arrays: MSVC's x86 convention can't pass
+   more than 3 aligned vectors by value (C2719) */
+static SIMD_SSE2 SIMD_INLINE void sse2_eye4(
+    GLuint type, __m128 const* mv, __m128 const* v, __m128* e)
+{
+    e[0] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(mv[0], v[0]), _mm_mul_ps(mv[4], v[1])), _mm_mul_ps(mv[8], v[2])), mv[12]);
+    e[1] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(mv[1], v[0]), _mm_mul_ps(mv[5], v[1])), _mm_mul_ps(mv[9], v[2])), mv[13]);
+    e[2] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(mv[2], v[0]), _mm_mul_ps(mv[6], v[1])), _mm_mul_ps(mv[10], v[2])), mv[14]);
+    if (type == MATRIX_3D)
+    {
+        e[3] = _mm_set1_ps(1.0f);
+    }
+    else
+    {
+        e[3] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(mv[3], v[0]), _mm_mul_ps(mv[7], v[1])), _mm_mul_ps(mv[11], v[2])), mv[15]);
+    }
+}
+
+/* the clip bits of each vertex in its lane, with the same
+   "if > else if <" ordering as the C path.  x & y are tested against
+   guard * w (see rglGuardBand) */
+static SIMD_SSE2 SIMD_INLINE __m128 sse2_cliptest4(
+    __m128 const* c, __m128 guard)
+{
+    __m128 gw, ngw, ncw, hi, lo, mask;
+
+    gw = _mm_mul_ps(c[3], guard);
+    ngw = _mm_xor_ps(gw, SSE2_SIGN);
+    ncw = _mm_xor_ps(c[3], SSE2_SIGN);
+    hi = _mm_cmpgt_ps(c[0], gw);
+    lo = _mm_andnot_ps(hi, _mm_cmplt_ps(c[0], ngw));
+    mask = _mm_or_ps(_mm_and_ps(hi, SSE2_BIT(CLIP_RIGHT_BIT)),
+                     _mm_and_ps(lo, SSE2_BIT(CLIP_LEFT_BIT)));
+    hi = _mm_cmpgt_ps(c[1], gw);
+    lo = _mm_andnot_ps(hi, _mm_cmplt_ps(c[1], ngw));
+    mask = _mm_or_ps(mask, _mm_or_ps(_mm_and_ps(hi, SSE2_BIT(CLIP_TOP_BIT)),
+                                     _mm_and_ps(lo, SSE2_BIT(CLIP_BOTTOM_BIT))));
+    hi = _mm_cmpgt_ps(c[2], c[3]);
+    lo = _mm_andnot_ps(hi, _mm_cmplt_ps(c[2], ncw));
+    mask = _mm_or_ps(mask, _mm_or_ps(_mm_and_ps(hi, SSE2_BIT(CLIP_FAR_BIT)),
+                                     _mm_and_ps(lo, SSE2_BIT(CLIP_NEAR_BIT))));
+    return mask;
+}
+
+/* eye -> clip, and the clip bits of each vertex in its lane */
+static SIMD_SSE2 SIMD_INLINE __m128 sse2_clip4(
+    GLuint type, __m128 const* mv, __m128 guard, __m128 const* v, __m128* c)
+{
+    switch (type)
+    {
+    case MATRIX_IDENTITY:
+        c[0] = v[0];
+        c[1] = v[1];
+        c[2] = v[2];
+        c[3] = v[3];
+        break;
+    case MATRIX_ORTHO:
+        c[0] = _mm_add_ps(_mm_mul_ps(mv[0], v[0]), _mm_mul_ps(mv[12], v[3]));
+        c[1] = _mm_add_ps(_mm_mul_ps(mv[5], v[1]), _mm_mul_ps(mv[13], v[3]));
+        c[2] = _mm_add_ps(_mm_mul_ps(mv[10], v[2]), _mm_mul_ps(mv[14], v[3]));
+        c[3] = v[3];
+        break;
+    case MATRIX_PERSPECTIVE:
+        c[0] = _mm_add_ps(_mm_mul_ps(mv[0], v[0]), _mm_mul_ps(mv[8], v[2]));
+        c[1] = _mm_add_ps(_mm_mul_ps(mv[5], v[1]), _mm_mul_ps(mv[9], v[2]));
+        c[2] = _mm_add_ps(_mm_mul_ps(mv[10], v[2]), _mm_mul_ps(mv[14], v[3]));
+        c[3] = _mm_xor_ps(v[2], SSE2_SIGN);
+        break;
+    default:
+        c[0] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(mv[0], v[0]), _mm_mul_ps(mv[4], v[1])),
+            _mm_mul_ps(mv[8], v[2])), _mm_mul_ps(mv[12], v[3]));
+        c[1] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(mv[1], v[0]), _mm_mul_ps(mv[5], v[1])),
+            _mm_mul_ps(mv[9], v[2])), _mm_mul_ps(mv[13], v[3]));
+        c[2] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(mv[2], v[0]), _mm_mul_ps(mv[6], v[1])),
+            _mm_mul_ps(mv[10], v[2])), _mm_mul_ps(mv[14], v[3]));
+        c[3] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(mv[3], v[0]), _mm_mul_ps(mv[7], v[1])),
+            _mm_mul_ps(mv[11], v[2])), _mm_mul_ps(mv[15], v[3]));
+        break;
+    }
+
+    return sse2_cliptest4(c, guard);
+}
+
+/* the 4 lanes' clip bits as bytes, vertex 0 in the low byte */
+static SIMD_SSE2 SIMD_INLINE GLuint sse2_pack_masks(__m128 mask)
+{
+    __m128i packed;
+
+    packed = _mm_packs_epi32(_mm_castps_si128(mask), _mm_setzero_si128());
+    packed = _mm_packus_epi16(packed, packed);
+    return (GLuint)_mm_cvtsi128_si32(packed);
+}
+
+static SIMD_SSE2 void sse2_transform4(
+    GLuint type, __m128 const* mv, GLfloat* d, GLfloat const* s)
+{
+    __m128 v[4], e[4];
+
+    v[0] = _mm_loadu_ps(s + 0);
+    v[1] = _mm_loadu_ps(s + 4);
+    v[2] = _mm_loadu_ps(s + 8);
+    v[3] = _mm_loadu_ps(s + 12);
+    _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+    sse2_eye4(type, mv, v, e);
+
+    _MM_TRANSPOSE4_PS(e[0], e[1], e[2], e[3]);
+
+    _mm_storeu_ps(d + 0, e[0]);
+    _mm_storeu_ps(d + 4, e[1]);
+    _mm_storeu_ps(d + 8, e[2]);
+    _mm_storeu_ps(d + 12, e[3]);
+}
+
+/* returns the 4 clipmask bytes, vertex 0 in the low byte */
+static SIMD_SSE2 GLuint sse2_project4(
+    GLuint type, __m128 const* mv, __m128 guard, GLfloat* d, GLfloat const* s)
+{
+    __m128 v[4], c[4], mask;
+
+    v[0] = _mm_loadu_ps(s + 0);
+    v[1] = _mm_loadu_ps(s + 4);
+    v[2] = _mm_loadu_ps(s + 8);
+    v[3] = _mm_loadu_ps(s + 12);
+    _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+    mask = sse2_clip4(type, mv, guard, v, c);
+
+    _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+    _mm_storeu_ps(d + 0, c[0]);
+    _mm_storeu_ps(d + 4, c[1]);
+    _mm_storeu_ps(d + 8, c[2]);
+    _mm_storeu_ps(d + 12, c[3]);
+
+    return sse2_pack_masks(mask);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_transform_points3
+    Description : transform n object-space points (w taken as 1) by a
+                  MATRIX_GENERAL or MATRIX_3D modelview
+    Inputs      : type - the matrix classification
+                  n - number of vertices
+                  d - [n][4] destination
+                  m - the matrix
+                  s - [n][4] source
+    Outputs     : d is filled
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_SSE2 void simd_sse2_transform_points3(
+    GLuint type, GLuint n, GLfloat* d, GLfloat const* m, GLfloat const* s)
+{
+    __m128 mv[16];
+    GLuint i;
+
+    sse2_load_matrix(mv, m);
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        sse2_transform4(type, mv, d + 4*i, s + 4*i);
+    }
+
+    if (i < n)
+    {
+        GLfloat tmpS[16], tmpD[16];
+        GLuint rem = n - i;
+
+        memset(tmpS, 0, sizeof(tmpS));
+        memcpy(tmpS, s + 4*i, 4*rem*sizeof(GLfloat));
+        sse2_transform4(type, mv, tmpD, tmpS);
+        memcpy(d + 4*i, tmpD, 4*rem*sizeof(GLfloat));
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_project_and_cliptest
+    Description : project n eye-space points and classify them against the
+                  view volume
+    Inputs      : type - the projection matrix classification
+                  n - number of vertices
+                  d - [n][4] destination clip coordinates
+                  m - the matrix
+                  s - [n][4] source eye coordinates
+                  guard - x & y are tested against guard * w
+    Outputs     : d is filled, clip bits are or'ed into clipmask[],
+                  ormask & andmask are accumulated
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_SSE2 void simd_sse2_project_and_cliptest(
+    GLuint type, GLuint n, GLfloat* d, GLfloat const* m, GLfloat const* s,
+    GLfloat guard, GLubyte* clipmask, GLubyte* ormask, GLubyte* andmask)
+{
+    __m128 mv[16];
+    __m128 g = _mm_set1_ps(guard);
+    GLubyte tmpOrMask = *ormask;
+    GLubyte tmpAndMask = *andmask;
+    GLuint i, j, masks;
+
+    sse2_load_matrix(mv, m);
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        masks = sse2_project4(type, mv, g, d + 4*i, s + 4*i);
+        for (j = 0; j < 4; j++, masks >>= 8)
+        {
+            GLubyte mask = (GLubyte)masks;
+            clipmask[i + j] |= mask;
+            tmpOrMask |= mask;
+            tmpAndMask &= mask;
+        }
+    }
+
+    if (i < n)
+    {
+        GLfloat tmpS[16], tmpD[16];
+        GLuint rem = n - i;
+
+        memset(tmpS, 0, sizeof(tmpS));
+        memcpy(tmpS, s + 4*i, 4*rem*sizeof(GLfloat));
+        masks = sse2_project4(type, mv, g, tmpD, tmpS);
+        memcpy(d + 4*i, tmpD, 4*rem*sizeof(GLfloat));
+        for (j = 0; j < rem; j++, masks >>= 8)
+        {
+            GLubyte mask = (GLubyte)masks;
+            clipmask[i + j] |= mask;
+            tmpOrMask |= mask;
+            tmpAndMask &= mask;
+        }
+    }
+
+    *ormask = tmpOrMask;
+    *andmask = tmpAndMask;
+}
+
+/* x, y and z of 4 [n][3] normals */
+#define SSE2_LOAD_NORMALS(S, X, Y, Z) \
+    { \
+        __m128 a = _mm_loadu_ps(S); \
+        __m128 b = _mm_loadu_ps((S) + 4); \
+        __m128 c = _mm_loadu_ps((S) + 8); \
+        X = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,3,0)), \
+                           _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,1,0)); \
+        Y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), \
+                           _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0)); \
+        Z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), \
+                           _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0)); \
+    }
+
+/* shade 4 vertices; the lights are a loop, the vertices are the lanes */
+static SIMD_SSE2 void sse2_shade4(
+    simd_shade const* sh, GLfloat const* vertex, GLfloat const* normal, GLubyte* color)
+{
+    gl_light_block const* lb = sh->lights;
+    __m128 nx, ny, nz, vx, vy, vz, vw;
+    __m128 sumR, sumG, sumB;
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128i rgba;
+    GLuint l;
+
+    SSE2_LOAD_NORMALS(normal, nx, ny, nz);
+    if (sh->side != 0)
+    {
+        nx = _mm_xor_ps(nx, SSE2_SIGN);
+        ny = _mm_xor_ps(ny, SSE2_SIGN);
+        nz = _mm_xor_ps(nz, SSE2_SIGN);
+    }
+
+    vx = _mm_loadu_ps(vertex);
+    vy = _mm_loadu_ps(vertex + 4);
+    vz = _mm_loadu_ps(vertex + 8);
+    vw = _mm_loadu_ps(vertex + 12);
+    _MM_TRANSPOSE4_PS(vx, vy, vz, vw);
+
+    sumR = _mm_set1_ps(sh->base[0]);
+    sumG = _mm_set1_ps(sh->base[1]);
+    sumB = _mm_set1_ps(sh->base[2]);
+
+    for (l = 0; l < lb->Count; l++)
+    {
+        GLfloat const (*ambient)[MAX_LIGHTS] = lb->Ambient[sh->side];
+        GLfloat const (*diffuse)[MAX_LIGHTS] = lb->Diffuse[sh->side];
+        __m128 lx, ly, lz, ndl, r, g, b;
+
+        if (sh->fast)
+        {
+            lx = _mm_set1_ps(lb->Dx[l]);
+            ly = _mm_set1_ps(lb->Dy[l]);
+            lz = _mm_set1_ps(lb->Dz[l]);
+        }
+        else
+        {
+            lx = _mm_set1_ps(lb->Px[l]);
+            ly = _mm_set1_ps(lb->Py[l]);
+            lz = _mm_set1_ps(lb->Pz[l]);
+        }
+
+        if (!sh->fast && lb->Positional[l])
+        {
+            __m128 len2, rsq, d, onLight, att;
+
+            lx = _mm_sub_ps(lx, vx);
+            ly = _mm_sub_ps(ly, vy);
+            lz = _mm_sub_ps(lz, vz);
+            len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, lx), _mm_mul_ps(ly, ly)),
+                              _mm_mul_ps(lz, lz));
+
+            //rsqrt and a Newton step, ~22 bits
+            rsq = _mm_rsqrt_ps(_mm_max_ps(len2, _mm_set1_ps(1.0e-30f)));
+            rsq = _mm_mul_ps(rsq, _mm_sub_ps(_mm_set1_ps(1.5f),
+                  _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), len2), _mm_mul_ps(rsq, rsq))));
+            d = _mm_mul_ps(len2, rsq);
+
+            //a light on the vertex isn't normalized
+            onLight = _mm_cmple_ps(d, _mm_set1_ps(0.0001f));
+            rsq = _mm_or_ps(_mm_andnot_ps(onLight, rsq), _mm_and_ps(onLight, one));
+            lx = _mm_mul_ps(lx, rsq);
+            ly = _mm_mul_ps(ly, rsq);
+            lz = _mm_mul_ps(lz, rsq);
+
+            att = _mm_div_ps(one,
+                  _mm_add_ps(_mm_set1_ps(lb->K0[l]), _mm_mul_ps(d,
+                  _mm_add_ps(_mm_set1_ps(lb->K1[l]), _mm_mul_ps(d, _mm_set1_ps(lb->K2[l]))))));
+
+            ndl = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, lx), _mm_mul_ps(ny, ly)),
+                             _mm_mul_ps(nz, lz));
+            ndl = _mm_max_ps(ndl, zero);
+
+            r = _mm_add_ps(_mm_set1_ps(ambient[0][l]), _mm_mul_ps(ndl, _mm_set1_ps(diffuse[0][l])));
+            g = _mm_add_ps(_mm_set1_ps(ambient[1][l]), _mm_mul_ps(ndl, _mm_set1_ps(diffuse[1][l])));
+            b = _mm_add_ps(_mm_set1_ps(ambient[2][l]), _mm_mul_ps(ndl, _mm_set1_ps(diffuse[2][l])));
+            sumR = _mm_add_ps(sumR, _mm_mul_ps(att, r));
+            sumG = _mm_add_ps(sumG, _mm_mul_ps(att, g));
+            sumB = _mm_add_ps(sumB, _mm_mul_ps(att, b));
+            continue;
+        }
+
+        ndl = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, lx), _mm_mul_ps(ny, ly)),
+                         _mm_mul_ps(nz, lz));
+        ndl = _mm_max_ps(ndl, zero);
+
+        r = _mm_mul_ps(ndl, _mm_set1_ps(diffuse[0][l]));
+        g = _mm_mul_ps(ndl, _mm_set1_ps(diffuse[1][l]));
+        b = _mm_mul_ps(ndl, _mm_set1_ps(diffuse[2][l]));
+        if (!sh->fast)
+        {
+            r = _mm_add_ps(r, _mm_set1_ps(ambient[0][l]));
+            g = _mm_add_ps(g, _mm_set1_ps(ambient[1][l]));
+            b = _mm_add_ps(b, _mm_set1_ps(ambient[2][l]));
+        }
+        sumR = _mm_add_ps(sumR, r);
+        sumG = _mm_add_ps(sumG, g);
+        sumB = _mm_add_ps(sumB, b);
+    }
+
+    sumR = _mm_mul_ps(_mm_min_ps(_mm_max_ps(sumR, zero), one), _mm_set1_ps(sh->scale[0]));
+    sumG = _mm_mul_ps(_mm_min_ps(_mm_max_ps(sumG, zero), one), _mm_set1_ps(sh->scale[1]));
+    sumB = _mm_mul_ps(_mm_min_ps(_mm_max_ps(sumB, zero), one), _mm_set1_ps(sh->scale[2]));
+
+    //round to nearest like FAST_TO_INT, and pack to r g b a bytes
+    rgba = _mm_or_si128(
+        _mm_or_si128(_mm_cvtps_epi32(sumR), _mm_slli_epi32(_mm_cvtps_epi32(sumG), 8)),
+        _mm_or_si128(_mm_slli_epi32(_mm_cvtps_epi32(sumB), 16),
+                     _mm_set1_epi32((int)((GLuint)sh->alpha << 24))));
+    _mm_storeu_si128((__m128i*)color, rgba);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_shade_vertices
+    Description : light n vertices, 4 at a time, as gl_color_shade_vertices
+                  or (sh->fast) gl_fast_color_shade_vertices would
+    Inputs      : sh - the lights and the shading parameters
+                  n - number of vertices
+                  vertex - [n][4] eye coordinates
+                  normal - [n][3] eye space normals
+    Outputs     : color - [n][4] is filled
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_SSE2 void simd_sse2_shade_vertices(
+    simd_shade const* sh, GLuint n,
+    GLfloat const* vertex, GLfloat const* normal, GLubyte* color)
+{
+    GLuint i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        sse2_shade4(sh, vertex + 4*i, normal + 3*i, color + 4*i);
+    }
+
+    if (i < n)
+    {
+        GLfloat tmpV[16], tmpN[12];
+        GLubyte tmpC[16];
+        GLuint rem = n - i;
+
+        memset(tmpV, 0, sizeof(tmpV));
+        memset(tmpN, 0, sizeof(tmpN));
+        memcpy(tmpV, vertex + 4*i, 4*rem*sizeof(GLfloat));
+        memcpy(tmpN, normal + 3*i, 3*rem*sizeof(GLfloat));
+        sse2_shade4(sh, tmpV, tmpN, tmpC);
+        memcpy(color + 4*i, tmpC, 4*rem);
+    }
+}
+
+/* 3 floats of a transposed window coordinate */
+#define SSE2_STORE3(D, R) \
+    _mm_storel_pi((__m64*)(D), R); \
+    _mm_store_ss((D) + 2, _mm_movehl_ps(R, R));
+
+/* x, y, z of 4 vertices to the 12 floats of 4 [3] vectors, in 3 registers */
+#define SSE2_PACK3(X, Y, Z, O0, O1, O2) \
+    { \
+        __m128 xyLo = _mm_unpacklo_ps(X, Y); \
+        __m128 xyHi = _mm_unpackhi_ps(X, Y); \
+        O0 = _mm_shuffle_ps(xyLo, _mm_shuffle_ps(Z, X, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,1,0)); \
+        O1 = _mm_shuffle_ps(_mm_shuffle_ps(Y, Z, _MM_SHUFFLE(1,1,1,1)), xyHi, _MM_SHUFFLE(1,0,2,0)); \
+        O2 = _mm_shuffle_ps(_mm_shuffle_ps(Z, X, _MM_SHUFFLE(3,3,2,2)), \
+                            _mm_shuffle_ps(Y, Z, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)); \
+    }
+
+/* clip -> window, in the same order of operations as viewport_map_vertices */
+static SIMD_SSE2 SIMD_INLINE void sse2_window4(
+    simd_viewport const* vp, __m128 const* c, __m128* w)
+{
+    __m128 x = c[0], y = c[1], z = c[2];
+
+    if (vp->divide)
+    {
+        __m128 wInv = _mm_div_ps(_mm_set1_ps(1.0f), c[3]);
+        x = _mm_mul_ps(x, wInv);
+        y = _mm_mul_ps(y, wInv);
+        z = _mm_mul_ps(z, wInv);
+    }
+    w[0] = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(vp->scale[0])), _mm_set1_ps(vp->offset[0]));
+    w[1] = _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(vp->scale[1])), _mm_set1_ps(vp->offset[1]));
+    w[2] = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(vp->scale[2])), _mm_set1_ps(vp->offset[2]));
+}
+
+/* object -> clip -> window for 4 vertices through the combined
+   modelview-projection matrix (MATRIX_GENERAL or MATRIX_3D, object w taken
+   as 1 as in sse2_eye4).  the clip bits are or'ed into clipmask[0..3] and
+   returned as by sse2_project4.  window coordinates are only stored for vertices whose
+   clipmask ends up 0, as viewport_map_vertices does, and not computed at
+   all if every vertex is clipped */
+static SIMD_SSE2 SIMD_INLINE GLuint sse2_fused4(
+    GLuint type, __m128 const* mvp, simd_viewport const* vp, GLfloat const* s, GLfloat* clip, GLfloat* win,
+    GLubyte* clipmask)
+{
+    __m128 v[4], c[4], w[4], mask;
+    GLfloat junk[3];
+    GLuint masks, j, clipped;
+
+    v[0] = _mm_loadu_ps(s + 0);
+    v[1] = _mm_loadu_ps(s + 4);
+    v[2] = _mm_loadu_ps(s + 8);
+    v[3] = _mm_loadu_ps(s + 12);
+    _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+    sse2_eye4(type, mvp, v, c);
+    mask = sse2_cliptest4(c, _mm_set1_ps(vp->guard));
+
+    masks = sse2_pack_masks(mask);
+    clipped = 0;
+    for (j = 0; j < 4; j++)
+    {
+        clipmask[j] |= (GLubyte)(masks >> (8*j));
+        clipped += (clipmask[j] != 0);
+    }
+
+    //win is [n][3]
+    if (clipped == 0)
+    {
+        __m128 o0, o1, o2;
+        sse2_window4(vp, c, w);
+        SSE2_PACK3(w[0], w[1], w[2], o0, o1, o2);
+        _mm_storeu_ps(win + 0, o0);
+        _mm_storeu_ps(win + 4, o1);
+        _mm_storeu_ps(win + 8, o2);
+    }
+    else if (clipped < 4)
+    {
+        //clipped vertices' stores go to a scratch slot rather than round
+        //a branch
+        sse2_window4(vp, c, w);
+        w[3] = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(w[0], w[1], w[2], w[3]);
+        SSE2_STORE3(clipmask[0] ? junk : win + 0, w[0]);
+        SSE2_STORE3(clipmask[1] ? junk : win + 3, w[1]);
+        SSE2_STORE3(clipmask[2] ? junk : win + 6, w[2]);
+        SSE2_STORE3(clipmask[3] ? junk : win + 9, w[3]);
+    }
+
+    _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+    _mm_storeu_ps(clip + 0, c[0]);
+    _mm_storeu_ps(clip + 4, c[1]);
+    _mm_storeu_ps(clip + 8, c[2]);
+    _mm_storeu_ps(clip + 12, c[3]);
+
+    return masks;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_transform_project_viewport
+    Description : object -> clip with the clip test, and clip -> window, in
+                  one pass over the vertices
+    Inputs      : type - classification of the modelview-projection
+                  product, MATRIX_GENERAL or MATRIX_3D
+                  n - number of vertices
+                  mvp - the modelview-projection product
+                  vp - the viewport mapping
+                  obj - [n][4] object coordinates
+    Outputs     : clip - [n][4] and win - [n][3] are filled, clip bits are
+                  or'ed into clipmask[], ormask & andmask are accumulated
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_SSE2 void simd_sse2_transform_project_viewport(
+    GLuint type, GLuint n, GLfloat const* mvp, simd_viewport const* vp,
+    GLfloat const* obj, GLfloat* clip, GLfloat* win,
+    GLubyte* clipmask, GLubyte* ormask, GLubyte* andmask)
+{
+    __m128 mvpv[16];
+    GLubyte tmpOrMask = *ormask;
+    GLubyte tmpAndMask = *andmask;
+    GLuint i, j, masks;
+
+    sse2_load_matrix(mvpv, mvp);
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        masks = sse2_fused4(type, mvpv, vp,
+                            obj + 4*i, clip + 4*i, win + 3*i, clipmask + i);
+        for (j = 0; j < 4; j++, masks >>= 8)
+        {
+            GLubyte mask = (GLubyte)masks;
+            tmpOrMask |= mask;
+            tmpAndMask &= mask;
+        }
+    }
+
+    if (i < n)
+    {
+        GLfloat tmpS[16], tmpC[16], tmpW[12];
+        GLubyte tmpM[4];
+        GLuint rem = n - i;
+
+        memset(tmpS, 0, sizeof(tmpS));
+        memcpy(tmpS, obj + 4*i, 4*rem*sizeof(GLfloat));
+        memset(tmpM, 0, sizeof(tmpM));
+        memcpy(tmpM, clipmask + i, rem);
+        masks = sse2_fused4(type, mvpv, vp, tmpS, tmpC, tmpW, tmpM);
+        memcpy(clip + 4*i, tmpC, 4*rem*sizeof(GLfloat));
+        memcpy(clipmask + i, tmpM, rem);
+        for (j = 0; j < rem; j++, masks >>= 8)
+        {
+            GLubyte mask = (GLubyte)masks;
+            if (tmpM[j] == 0)
+            {
+                memcpy(win + 3*(i + j), tmpW + 3*j, 3*sizeof(GLfloat));
+            }
+            tmpOrMask |= mask;
+            tmpAndMask &= mask;
+        }
+    }
+
+    *ormask = tmpOrMask;
+    *andmask = tmpAndMask;
+}
+
+/* normal transform by the upper 3x3 of m, used transposed as
+   gl_xform_normals_3fv does, then scaled per mode */
+static SIMD_SSE2 SIMD_INLINE void sse2_normals4(
+    GLuint mode, __m128 const mv[9], __m128 scale, GLfloat* v, GLfloat const* u)
+{
+    __m128 ux, uy, uz, tx, ty, tz, o0, o1, o2;
+
+    SSE2_LOAD_NORMALS(u, ux, uy, uz);
+    tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ux, mv[0]), _mm_mul_ps(uy, mv[1])), _mm_mul_ps(uz, mv[2]));
+    ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ux, mv[3]), _mm_mul_ps(uy, mv[4])), _mm_mul_ps(uz, mv[5]));
+    tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ux, mv[6]), _mm_mul_ps(uy, mv[7])), _mm_mul_ps(uz, mv[8]));
+
+    if (mode == SIMD_NORMALS_RESCALE)
+    {
+        tx = _mm_mul_ps(tx, scale);
+        ty = _mm_mul_ps(ty, scale);
+        tz = _mm_mul_ps(tz, scale);
+    }
+    else if (mode == SIMD_NORMALS_NORMALIZE)
+    {
+        __m128 len2, rsq, tiny;
+
+        len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)),
+                          _mm_mul_ps(tz, tz));
+
+        //rsqrt and a Newton step, ~22 bits.  degenerate normals are left alone
+        rsq = _mm_rsqrt_ps(_mm_max_ps(len2, _mm_set1_ps(FLT_MIN)));
+        rsq = _mm_mul_ps(rsq, _mm_sub_ps(_mm_set1_ps(1.5f),
+              _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), len2), _mm_mul_ps(rsq, rsq))));
+        tiny = _mm_cmplt_ps(len2, _mm_set1_ps(FLT_MIN));
+        rsq = _mm_or_ps(_mm_andnot_ps(tiny, rsq), _mm_and_ps(tiny, _mm_set1_ps(1.0f)));
+
+        tx = _mm_mul_ps(tx, rsq);
+        ty = _mm_mul_ps(ty, rsq);
+        tz = _mm_mul_ps(tz, rsq);
+    }
+
+    SSE2_PACK3(tx, ty, tz, o0, o1, o2);
+    _mm_storeu_ps(v + 0, o0);
+    _mm_storeu_ps(v + 4, o1);
+    _mm_storeu_ps(v + 8, o2);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_xform_normals
+    Description : transform normals by the modelview inverse, as
+                  gl_xform_normals_3fv.  SIMD_NORMALS_NORMALIZE is in single
+                  precision with rsqrt + a Newton step rather than fsqrt in
+                  double, and normals shorter than sqrt(FLT_MIN) are left
+                  unscaled
+    Inputs      : mode - SIMD_NORMALS_PLAIN, _RESCALE or _NORMALIZE
+                  n - number of normals
+                  m - the matrix (the modelview inverse)
+                  u - [n][3] source normals, may be the same as v
+                  scale - the uniform scale for SIMD_NORMALS_RESCALE
+    Outputs     : v - [n][3] transformed normals
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_SSE2 void simd_sse2_xform_normals(
+    GLuint mode, GLuint n, GLfloat* v, GLfloat const* m, GLfloat const* u,
+    GLfloat scale)
+{
+    __m128 mv[9];
+    __m128 scalev = _mm_set1_ps(scale);
+    GLuint i;
+
+    mv[0] = _mm_set1_ps(m[0]); mv[1] = _mm_set1_ps(m[1]); mv[2] = _mm_set1_ps(m[2]);
+    mv[3] = _mm_set1_ps(m[4]); mv[4] = _mm_set1_ps(m[5]); mv[5] = _mm_set1_ps(m[6]);
+    mv[6] = _mm_set1_ps(m[8]); mv[7] = _mm_set1_ps(m[9]); mv[8] = _mm_set1_ps(m[10]);
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        sse2_normals4(mode, mv, scalev, v + 3*i, u + 3*i);
+    }
+
+    if (i < n)
+    {
+        GLfloat tmp[12];
+        GLuint rem = n - i;
+
+        memset(tmp, 0, sizeof(tmp));
+        memcpy(tmp, u + 3*i, 3*rem*sizeof(GLfloat));
+        sse2_normals4(mode, mv, scalev, tmp, tmp);
+        memcpy(v + 3*i, tmp, 3*rem*sizeof(GLfloat));
+    }
+}
+
+/* the view volume clipper.  a vertex's distances inside the 6 planes, in
+   gl_viewclip_polygon's order (+x -x +y -y +z -z), are the lanes of
+   (w - x, w + x, w - y, w + y) and (w - z, w + z) */
+#define SSE2_CLIP_MAX 64
+
+typedef struct
+{
+    GLfloat d[8];               //distances, negative (or NaN) outside
+    GLuint outside;             //a bit per plane
+    GLuint j;                   //index into the VB
+} sse2_clip_vert;
+
+static SIMD_SSE2 SIMD_INLINE void sse2_clip_distances(
+    __m128 p, sse2_clip_vert* v)
+{
+    __m128 w = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3,3,3,3));
+    __m128 sign = _mm_castsi128_ps(_mm_set_epi32(0, (int)0x80000000, 0, (int)0x80000000));
+    __m128 zero = _mm_setzero_ps();
+    __m128 lo, hi;
+
+    //w + -x is w - x to the bit
+    lo = _mm_add_ps(w, _mm_xor_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1,1,0,0)), sign));
+    hi = _mm_add_ps(w, _mm_xor_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2,2,2,2)), sign));
+    _mm_storeu_ps(v->d, lo);
+    _mm_storeu_ps(v->d + 4, hi);
+    v->outside = (GLuint)(_mm_movemask_ps(_mm_cmpnge_ps(lo, zero)) |
+                          ((_mm_movemask_ps(_mm_cmpnge_ps(hi, zero)) & 3) << 4));
+}
+
+static SIMD_INLINE GLuint sse2_lowest_bit(GLuint mask)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (GLuint)i;
+#else
+    return (GLuint)__builtin_ctz(mask);
+#endif
+}
+
+/* the point where in -> out crosses the plane, into a free VB slot, with
+   the aux data lerped alongside.  coordinates are in the same order of
+   operations as the COMPUTE_INTERSECTIONs in clip.c.  returns GL_FALSE if
+   the point is on top of in */
+static SIMD_SSE2 SIMD_INLINE GLboolean sse2_clip_intersect(
+    GLcontext* ctx, GLuint plane, sse2_clip_vert const* in, sse2_clip_vert const* out,
+    sse2_clip_vert* dst)
+{
+    //the lane the plane's coordinate is in, and -w for the - planes
+    static GLuint const lane[3][4] =
+    {
+        { 0xffffffff, 0, 0, 0 },
+        { 0, 0xffffffff, 0, 0 },
+        { 0, 0, 0xffffffff, 0 }
+    };
+    vertex_buffer* VB = ctx->VB;
+    GLfloat (*coord)[4] = VB->Clip;
+    GLuint a = plane >> 1;
+    GLfloat dw, da, t;
+    __m128 cin, c, w, sel, tv;
+    GLuint f;
+
+    //dw - da on the + planes, dw + da on the -
+    dw = coord[out->j][3] - coord[in->j][3];
+    da = coord[out->j][a] - coord[in->j][a];
+    t = -in->d[plane] / ((plane & 1) ? (dw + da) : (dw - da));
+    if (!(t > 0.0f))
+    {
+        return GL_FALSE;
+    }
+
+    f = VB->Free;
+    tv = _mm_set1_ps(t);
+    cin = _mm_loadu_ps(coord[in->j]);
+    c = _mm_add_ps(cin, _mm_mul_ps(tv, _mm_sub_ps(_mm_loadu_ps(coord[out->j]), cin)));
+    w = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,3,3));
+    if (plane & 1)
+    {
+        w = _mm_xor_ps(w, SSE2_SIGN);
+    }
+    sel = _mm_loadu_ps((GLfloat const*)lane[a]);
+    c = _mm_or_ps(_mm_andnot_ps(sel, c), _mm_and_ps(sel, w));
+    _mm_storeu_ps(coord[f], c);
+
+    if (ctx->ClipMask & (CLIP_FCOLOR_BIT | CLIP_BCOLOR_BIT))
+    {
+        GLubyte (*color)[4];
+        __m128i zero = _mm_setzero_si128();
+        GLuint pass;
+
+        for (pass = 0; pass < 2; pass++)
+        {
+            GLint ci, co, cr;
+            __m128 vi, vo;
+
+            if (!(ctx->ClipMask & (pass ? CLIP_BCOLOR_BIT : CLIP_FCOLOR_BIT)))
+            {
+                continue;
+            }
+            color = pass ? VB->Bcolor : VB->Fcolor;
+
+            //4 bytes -> 4 floats, lerp, round to nearest like FAST_TO_INT
+            memcpy(&ci, color[in->j], 4);
+            memcpy(&co, color[out->j], 4);
+            vi = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(ci), zero), zero));
+            vo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(co), zero), zero));
+            vi = _mm_add_ps(vi, _mm_mul_ps(tv, _mm_sub_ps(vo, vi)));
+            cr = _mm_cvtsi128_si32(_mm_packus_epi16(
+                     _mm_packs_epi32(_mm_cvtps_epi32(vi), zero), zero));
+            memcpy(color[f], &cr, 4);
+        }
+    }
+    if (ctx->ClipMask & CLIP_TEXTURE_BIT)
+    {
+        __m128 ai, ao;
+
+        //s, t, eye z (when the transform wrote it)
+        ai = _mm_loadl_pi(_mm_setzero_ps(), (__m64 const*)VB->TexCoord[in->j]);
+        ao = _mm_loadl_pi(_mm_setzero_ps(), (__m64 const*)VB->TexCoord[out->j]);
+        if (VB->EyeValid)
+        {
+            ai = _mm_movelh_ps(ai, _mm_load_ss(&VB->Eye[in->j][2]));
+            ao = _mm_movelh_ps(ao, _mm_load_ss(&VB->Eye[out->j][2]));
+        }
+        ai = _mm_add_ps(ai, _mm_mul_ps(tv, _mm_sub_ps(ao, ai)));
+        _mm_storel_pi((__m64*)VB->TexCoord[f], ai);
+        if (VB->EyeValid)
+        {
+            _mm_store_ss(&VB->Eye[f][2], _mm_movehl_ps(ai, ai));
+        }
+    }
+
+    dst->j = f;
+    sse2_clip_distances(c, dst);
+
+    VB->Free++;
+    if (VB->Free == VB->Size)
+    {
+        VB->Free = 1;
+    }
+    return GL_TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_viewclip_polygon
+    Description : gl_viewclip_polygon with the 6 plane distances of a vertex
+                  taken at once, and only the planes some vertex is outside
+                  of clipped against
+    Inputs      : ctx - the context
+                  n - number of vertices in the polygon
+                  vlist - indices into the VB of the polygon's vertices
+    Outputs     : vlist - the clipped polygon
+                  nOut - number of vertices in the clipped polygon
+    Return      : GL_FALSE if the polygon is too big for the clipper's lists,
+                  and gl_viewclip_polygon should do it
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLboolean simd_sse2_viewclip_polygon(
+    GLcontext* ctx, GLuint n, GLuint vlist[], GLuint* nOut)
+{
+    vertex_buffer* VB = ctx->VB;
+    sse2_clip_vert pool[SSE2_CLIP_MAX];
+    GLubyte list[2][SSE2_CLIP_MAX];     //into pool[]
+    GLubyte *inList, *outList;
+    GLuint inCount, outCount, poolCount;
+    GLuint orMask = 0, andMask = 0x3f;
+    GLuint plane, i, free;
+
+    //a convex polygon gains at most a vertex a plane
+    if (n > SSE2_CLIP_MAX/2)
+    {
+        return GL_FALSE;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        pool[i].j = vlist[i];
+        sse2_clip_distances(_mm_loadu_ps(VB->Clip[vlist[i]]), &pool[i]);
+        orMask |= pool[i].outside;
+        andMask &= pool[i].outside;
+        list[0][i] = (GLubyte)i;
+    }
+
+    *nOut = 0;
+    if (n < 3 || andMask != 0)
+    {
+        return GL_TRUE;
+    }
+    if (orMask == 0)
+    {
+        *nOut = n;
+        return GL_TRUE;
+    }
+
+    free = VB->Free;
+    poolCount = n;
+    inList = list[0];
+    outList = list[1];
+    inCount = n;
+
+    //only the planes something's outside of, without a branch on each of
+    //the 6
+    while (orMask != 0)
+    {
+        GLuint prev, bit;
+
+        plane = sse2_lowest_bit(orMask);
+        bit = 1 << plane;
+        orMask &= ~bit;
+
+        if (inCount < 3)
+        {
+            return GL_TRUE;
+        }
+
+        prev = inList[inCount - 1];
+        outCount = 0;
+
+        for (i = 0; i < inCount; i++)
+        {
+            GLuint curr = inList[i];
+            GLuint currIn = !(pool[curr].outside & bit);
+
+            if (poolCount == SSE2_CLIP_MAX || outCount + 2 > SSE2_CLIP_MAX)
+            {
+                //not convex.  start again from the top
+                VB->Free = free;
+                return GL_FALSE;
+            }
+
+            if (currIn != !(pool[prev].outside & bit))
+            {
+                //in -> out or out -> in, the intersection's lerped from
+                //the inside end
+                GLuint in = currIn ? curr : prev;
+                GLuint out = curr + prev - in;
+
+                if (sse2_clip_intersect(ctx, plane, &pool[in], &pool[out], &pool[poolCount]))
+                {
+                    outList[outCount++] = (GLubyte)poolCount++;
+                }
+            }
+            outList[outCount] = (GLubyte)curr;
+            outCount += currIn;
+
+            prev = curr;
+        }
+
+        inCount = outCount;
+        inList = outList;
+        outList = (outList == list[0]) ? list[1] : list[0];
+    }
+
+    for (i = 0; i < inCount; i++)
+    {
+        vlist[i] = pool[inList[i]].j;
+    }
+    *nOut = inCount;
+    return GL_TRUE;
+}
+
+/* a plane as broadcast a, b, c, d and |a|, |b|, |c| */
+#define SIMD_CULL_PLANE 7
+
+/* the visible bits of 4 boxes or spheres, box 0 in bit 0.  a box is
+   outside if its corner furthest along a plane's normal is behind it, a
+   sphere if its centre is more than its radius behind */
+static SIMD_SSE2 SIMD_INLINE GLuint sse2_cull4(
+    GLuint shape, GLfloat const* s, __m128 const* pl)
+{
+    __m128 r0, r1, r2, r3, cx, cy, cz, ex, ey, ez, d, out;
+    GLuint k;
+
+    if (shape == SIMD_CULL_SPHERES)
+    {
+        r0 = _mm_loadu_ps(s + 0);
+        r1 = _mm_loadu_ps(s + 4);
+        r2 = _mm_loadu_ps(s + 8);
+        r3 = _mm_loadu_ps(s + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        cx = r0;
+        cy = r1;
+        cz = r2;
+        ex = r3;
+        ey = ez = _mm_setzero_ps();
+    }
+    else
+    {
+        __m128 half = _mm_set1_ps(0.5f);
+        __m128 lx, ly, lz;
+
+        //offset x y z & length x, then offset z & length x y z
+        r0 = _mm_loadu_ps(s + 0);
+        r1 = _mm_loadu_ps(s + 6);
+        r2 = _mm_loadu_ps(s + 12);
+        r3 = _mm_loadu_ps(s + 18);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        cx = r0;
+        cy = r1;
+        cz = r2;
+        lx = r3;
+        r0 = _mm_loadu_ps(s + 2);
+        r1 = _mm_loadu_ps(s + 8);
+        r2 = _mm_loadu_ps(s + 14);
+        r3 = _mm_loadu_ps(s + 20);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        ly = r2;
+        lz = r3;
+
+        //the lengths may be negative
+        cx = _mm_add_ps(cx, _mm_mul_ps(lx, half));
+        cy = _mm_add_ps(cy, _mm_mul_ps(ly, half));
+        cz = _mm_add_ps(cz, _mm_mul_ps(lz, half));
+        ex = _mm_andnot_ps(SSE2_SIGN, _mm_mul_ps(lx, half));
+        ey = _mm_andnot_ps(SSE2_SIGN, _mm_mul_ps(ly, half));
+        ez = _mm_andnot_ps(SSE2_SIGN, _mm_mul_ps(lz, half));
+    }
+
+    out = _mm_setzero_ps();
+    for (k = 0; k < 6; k++, pl += SIMD_CULL_PLANE)
+    {
+        d = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(pl[0], cx), _mm_mul_ps(pl[1], cy)), _mm_mul_ps(pl[2], cz)), pl[3]);
+        if (shape == SIMD_CULL_SPHERES)
+        {
+            d = _mm_add_ps(d, ex);
+        }
+        else
+        {
+            d = _mm_add_ps(d, _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(pl[4], ex), _mm_mul_ps(pl[5], ey)), _mm_mul_ps(pl[6], ez)));
+        }
+        out = _mm_or_ps(out, _mm_cmplt_ps(d, _mm_setzero_ps()));
+    }
+
+    return ~(GLuint)_mm_movemask_ps(out) & 0xf;
+}
+
+static SIMD_SSE2 void sse2_load_planes(__m128* pl, GLfloat const planes[6][4])
+{
+    GLuint k;
+    for (k = 0; k < 6; k++, pl += SIMD_CULL_PLANE)
+    {
+        pl[0] = _mm_set1_ps(planes[k][0]);
+        pl[1] = _mm_set1_ps(planes[k][1]);
+        pl[2] = _mm_set1_ps(planes[k][2]);
+        pl[3] = _mm_set1_ps(planes[k][3]);
+        pl[4] = _mm_set1_ps(fabsf(planes[k][0]));
+        pl[5] = _mm_set1_ps(fabsf(planes[k][1]));
+        pl[6] = _mm_set1_ps(fabsf(planes[k][2]));
+    }
+}
+
+//number of bits set in a nibble
+static GLubyte const sse2_nibble_bits[16] =
+{
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_cull
+    Description : test n boxes or spheres against 6 planes
+    Inputs      : shape - SIMD_CULL_BOXES, [n][6] x y z offsets & x y z
+                  lengths as rglIsClipped, or SIMD_CULL_SPHERES, [n][4]
+                  centre & radius
+                  n - number of boxes / spheres
+                  s - the boxes / spheres
+                  planes - [6] a b c d, inside where ax + by + cz + d >= 0.
+                  for spheres a b c must be unit length
+    Outputs     : bit i of visible[i / 32] is set if box i is at least
+                  partly inside every plane.  visible must start out 0
+    Return      : the number of bits set
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLuint simd_sse2_cull(
+    GLuint shape, GLuint n, GLfloat const* s, GLfloat const planes[6][4],
+    GLuint* visible)
+{
+    __m128 pl[6 * SIMD_CULL_PLANE];
+    GLuint stride = (shape == SIMD_CULL_SPHERES) ? 4 : 6;
+    GLuint i, bits, count;
+
+    sse2_load_planes(pl, planes);
+
+    count = 0;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        bits = sse2_cull4(shape, s + stride*i, pl);
+        visible[i >> 5] |= bits << (i & 31);
+        count += sse2_nibble_bits[bits];
+    }
+
+    if (i < n)
+    {
+        GLfloat tmp[24];
+        GLuint rem = n - i;
+
+        memset(tmp, 0, sizeof(tmp));
+        memcpy(tmp, s + stride*i, stride*rem*sizeof(GLfloat));
+        bits = sse2_cull4(shape, tmp, pl) & ((1 << rem) - 1);
+        visible[i >> 5] |= bits << (i & 31);
+        count += sse2_nibble_bits[bits];
+    }
+
+    return count;
+}
+
+/*
+ * pixel format conversion rows for pixconv.c.  RGBA sources are 4 pixels
+ * to a register as 32-bit lanes, ARGB4444 ones 8 as 16-bit lanes.  the 16
+ * bit results are sign extended into their lanes before packs_epi32 so it
+ * doesn't saturate them
+ */
+
+#define SSE2_PIX_MASK(M) _mm_set1_epi32(M)
+
+//4 RGBA pixels to dformat, one per 32-bit lane
+static SIMD_SSE2 SIMD_INLINE __m128i sse2_pix_rgba4(GLuint dformat, __m128i p)
+{
+    __m128i r;
+
+    switch (dformat)
+    {
+    case PIX_ARGB8888:
+    case PIX_XRGB8888:
+        r = _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(p, SSE2_PIX_MASK((int)0xff00ff00)),
+            _mm_and_si128(_mm_srli_epi32(p, 16), SSE2_PIX_MASK(0xff))),
+            _mm_slli_epi32(_mm_and_si128(p, SSE2_PIX_MASK(0xff)), 16));
+        if (dformat == PIX_XRGB8888)
+        {
+            r = _mm_and_si128(r, SSE2_PIX_MASK(0x00ffffff));
+        }
+        return r;
+    case PIX_RGB565:
+        return _mm_or_si128(_mm_or_si128(
+            _mm_slli_epi32(_mm_and_si128(p, SSE2_PIX_MASK(0xf8)), 8),
+            _mm_and_si128(_mm_srli_epi32(p, 5), SSE2_PIX_MASK(0x7e0))),
+            _mm_and_si128(_mm_srli_epi32(p, 19), SSE2_PIX_MASK(0x1f)));
+    case PIX_XRGB1555:
+        return _mm_or_si128(_mm_or_si128(
+            _mm_slli_epi32(_mm_and_si128(p, SSE2_PIX_MASK(0xf8)), 7),
+            _mm_and_si128(_mm_srli_epi32(p, 6), SSE2_PIX_MASK(0x3e0))),
+            _mm_and_si128(_mm_srli_epi32(p, 19), SSE2_PIX_MASK(0x1f)));
+    default:
+        return _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(_mm_srli_epi32(p, 16), SSE2_PIX_MASK(0xf000)),
+            _mm_slli_epi32(_mm_and_si128(p, SSE2_PIX_MASK(0xf0)), 4)), _mm_or_si128(
+            _mm_and_si128(_mm_srli_epi32(p, 8), SSE2_PIX_MASK(0xf0)),
+            _mm_and_si128(_mm_srli_epi32(p, 20), SSE2_PIX_MASK(0xf))));
+    }
+}
+
+//8 ARGB4444 pixels to a 16 bit dformat
+static SIMD_SSE2 SIMD_INLINE __m128i sse2_pix_4444_16(GLuint dformat, __m128i s)
+{
+    GLint sh = (dformat == PIX_RGB565) ? 1 : 0;
+
+    return _mm_or_si128(_mm_or_si128(
+        _mm_sll_epi16(_mm_and_si128(s, _mm_set1_epi16(0x0f00)), _mm_cvtsi32_si128(3 + sh)),
+        _mm_sll_epi16(_mm_and_si128(s, _mm_set1_epi16(0x00f0)), _mm_cvtsi32_si128(2 + sh))),
+        _mm_slli_epi16(_mm_and_si128(s, _mm_set1_epi16(0x000f)), 1));
+}
+
+//4 ARGB4444 pixels, zero extended to 32 bits, to ARGB8888 / XRGB8888
+static SIMD_SSE2 SIMD_INLINE __m128i sse2_pix_4444_32(GLuint dformat, __m128i u)
+{
+    __m128i r = _mm_or_si128(_mm_or_si128(
+        _mm_slli_epi32(_mm_and_si128(u, SSE2_PIX_MASK(0x0f00)), 12),
+        _mm_slli_epi32(_mm_and_si128(u, SSE2_PIX_MASK(0x00f0)), 8)),
+        _mm_slli_epi32(_mm_and_si128(u, SSE2_PIX_MASK(0x000f)), 4));
+    if (dformat == PIX_ARGB8888)
+    {
+        r = _mm_or_si128(r, _mm_slli_epi32(_mm_and_si128(u, SSE2_PIX_MASK(0xf000)), 16));
+    }
+    return r;
+}
+
+//sign extend the low 16 bits of each lane, then narrow 8 lanes to 16 bits
+#define SSE2_PIX_PACK(A, B) \
+    _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(A, 16), 16), \
+                    _mm_srai_epi32(_mm_slli_epi32(B, 16), 16))
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_row
+    Description : convert as much of a row as fits in blocks of 8 pixels
+    Inputs      : dformat - PIX_ARGB8888, XRGB8888, RGB565, XRGB1555 or
+                  ARGB4444
+                  sformat - PIX_RGBA or PIX_ARGB4444, not dformat
+                  src - the source row, no alignment needed
+                  width - pixels in the row
+    Outputs     : dst - the destination row
+    Return      : the number of pixels converted, a multiple of 8
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_row(
+    GLuint dformat, GLvoid* dst, GLuint sformat, GLvoid const* src, GLsizei width)
+{
+    GLubyte* d = (GLubyte*)dst;
+    GLubyte const* s = (GLubyte const*)src;
+    GLsizei x;
+    __m128i a, b;
+
+    if (sformat == PIX_RGBA)
+    {
+        for (x = 0; x + 8 <= width; x += 8, s += 32)
+        {
+            a = sse2_pix_rgba4(dformat, _mm_loadu_si128((__m128i const*)s));
+            b = sse2_pix_rgba4(dformat, _mm_loadu_si128((__m128i const*)(s + 16)));
+            if (dformat <= PIX_XRGB8888)
+            {
+                _mm_storeu_si128((__m128i*)(d + 4*x), a);
+                _mm_storeu_si128((__m128i*)(d + 4*x + 16), b);
+            }
+            else
+            {
+                _mm_storeu_si128((__m128i*)(d + 2*x), SSE2_PIX_PACK(a, b));
+            }
+        }
+    }
+    else
+    {
+        for (x = 0; x + 8 <= width; x += 8, s += 16)
+        {
+            a = _mm_loadu_si128((__m128i const*)s);
+            if (dformat <= PIX_XRGB8888)
+            {
+                b = _mm_unpackhi_epi16(a, _mm_setzero_si128());
+                a = _mm_unpacklo_epi16(a, _mm_setzero_si128());
+                _mm_storeu_si128((__m128i*)(d + 4*x), sse2_pix_4444_32(dformat, a));
+                _mm_storeu_si128((__m128i*)(d + 4*x + 16), sse2_pix_4444_32(dformat, b));
+            }
+            else
+            {
+                _mm_storeu_si128((__m128i*)(d + 2*x), sse2_pix_4444_16(dformat, a));
+            }
+        }
+    }
+
+    return x;
+}
+
+/*
+ * rescaler rows for pix_rescale.  a texel is 1 or 4 byte channels; ARGB4444
+ * is widened to 4 bytes a row at a time.  weights are 8 bit fixed point, a
+ * box's sum is turned into an average with mulhi by a 16 bit reciprocal
+ */
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_lerp
+    Description : blend two rows of byte channels
+    Inputs      : a, b - the rows
+                  n - number of bytes
+                  f - weight of b, 0..256
+    Outputs     : dst[i] = (a[i]*(256 - f) + b[i]*f + 128) >> 8
+    Return      : the number of bytes done, a multiple of 16
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_lerp(
+    GLubyte* dst, GLubyte const* a, GLubyte const* b, GLsizei n, GLint f)
+{
+    __m128i wa = _mm_set1_epi16((short)(256 - f));
+    __m128i wb = _mm_set1_epi16((short)f);
+    __m128i round = _mm_set1_epi16(128);
+    __m128i z = _mm_setzero_si128();
+    __m128i va, vb, lo, hi;
+    GLsizei i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        va = _mm_loadu_si128((__m128i const*)(a + i));
+        vb = _mm_loadu_si128((__m128i const*)(b + i));
+        lo = _mm_add_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(va, z), wa),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(vb, z), wb)), round);
+        hi = _mm_add_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(va, z), wa),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(vb, z), wb)), round);
+        _mm_storeu_si128((__m128i*)(dst + i),
+                         _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_accum
+    Description : add a row of byte channels into 16 bit sums
+    Inputs      : row - the row
+                  n - number of bytes
+                  first - the sums start at 0 rather than acc
+    Outputs     : acc[i] += row[i]
+    Return      : the number of bytes done, a multiple of 16
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_accum(
+    GLushort* acc, GLubyte const* row, GLsizei n, GLboolean first)
+{
+    __m128i z = _mm_setzero_si128();
+    __m128i v, lo, hi;
+    GLsizei i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        v = _mm_loadu_si128((__m128i const*)(row + i));
+        lo = _mm_unpacklo_epi8(v, z);
+        hi = _mm_unpackhi_epi8(v, z);
+        if (!first)
+        {
+            lo = _mm_add_epi16(lo, _mm_loadu_si128((__m128i const*)(acc + i)));
+            hi = _mm_add_epi16(hi, _mm_loadu_si128((__m128i const*)(acc + i + 8)));
+        }
+        _mm_storeu_si128((__m128i*)(acc + i), lo);
+        _mm_storeu_si128((__m128i*)(acc + i + 8), hi);
+    }
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_average
+    Description : turn 16 bit sums back into byte channels
+    Inputs      : acc - the sums
+                  n - number of bytes
+                  recip, bias - reciprocal & half of the count summed
+    Outputs     : dst[i] = ((acc[i] + bias) * recip) >> 16
+    Return      : the number of bytes done, a multiple of 16
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_average(
+    GLubyte* dst, GLushort const* acc, GLsizei n, GLuint recip, GLuint bias)
+{
+    __m128i r = _mm_set1_epi16((short)recip);
+    __m128i b = _mm_set1_epi16((short)bias);
+    __m128i lo, hi;
+    GLsizei i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        lo = _mm_mulhi_epu16(_mm_add_epi16(_mm_loadu_si128((__m128i const*)(acc + i)), b), r);
+        hi = _mm_mulhi_epu16(_mm_add_epi16(_mm_loadu_si128((__m128i const*)(acc + i + 8)), b), r);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_hlerp4
+    Description : horizontal bilinear over a row of 4 byte texels
+    Inputs      : row - the source row, texel x0 + 1 readable for every x0
+                  xi - [n] left texel of each destination texel
+                  xw - [n][8] 256 - f four times, then f four times
+                  n - destination texels
+    Outputs     : dst - n texels
+    Return      : the number of texels done, a multiple of 4
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_hlerp4(
+    GLubyte* dst, GLubyte const* row, GLint const* xi, GLushort const* xw, GLsizei n)
+{
+    __m128i z = _mm_setzero_si128();
+    __m128i round = _mm_set1_epi16(128);
+    __m128i m0, m1, m2, m3, s0, s1;
+    GLsizei i;
+
+#define SSE2_PIX_HLERP(I) \
+    _mm_mullo_epi16( \
+        _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const*)(row + 4*xi[I])), z), \
+        _mm_loadu_si128((__m128i const*)(xw + 8*(I))))
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        m0 = SSE2_PIX_HLERP(i + 0);
+        m1 = SSE2_PIX_HLERP(i + 1);
+        m2 = SSE2_PIX_HLERP(i + 2);
+        m3 = SSE2_PIX_HLERP(i + 3);
+        s0 = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi64(m0, m1), _mm_unpackhi_epi64(m0, m1)), round);
+        s1 = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi64(m2, m3), _mm_unpackhi_epi64(m2, m3)), round);
+        _mm_storeu_si128((__m128i*)(dst + 4*i),
+                         _mm_packus_epi16(_mm_srli_epi16(s0, 8), _mm_srli_epi16(s1, 8)));
+    }
+
+#undef SSE2_PIX_HLERP
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_hlerp1
+    Description : horizontal bilinear over a row of 1 byte texels
+    Inputs      : row - the source row, texel x0 + 1 readable for every x0
+                  xi - [n] left texel of each destination texel
+                  xw - [n][2] 256 - f, f
+                  n - destination texels
+    Outputs     : dst - n texels
+    Return      : the number of texels done, a multiple of 8
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_hlerp1(
+    GLubyte* dst, GLubyte const* row, GLint const* xi, GLushort const* xw, GLsizei n)
+{
+    __m128i z = _mm_setzero_si128();
+    __m128i round = _mm_set1_epi32(128);
+    __m128i p, lo, hi;
+    GLsizei i;
+
+#define SSE2_PIX_PAIR1(I) (short)(row[xi[I]] | (row[xi[I] + 1] << 8))
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        p = _mm_set_epi16(SSE2_PIX_PAIR1(i + 7), SSE2_PIX_PAIR1(i + 6),
+                          SSE2_PIX_PAIR1(i + 5), SSE2_PIX_PAIR1(i + 4),
+                          SSE2_PIX_PAIR1(i + 3), SSE2_PIX_PAIR1(i + 2),
+                          SSE2_PIX_PAIR1(i + 1), SSE2_PIX_PAIR1(i + 0));
+        lo = _mm_madd_epi16(_mm_unpacklo_epi8(p, z), _mm_loadu_si128((__m128i const*)(xw + 2*i)));
+        hi = _mm_madd_epi16(_mm_unpackhi_epi8(p, z), _mm_loadu_si128((__m128i const*)(xw + 2*i + 8)));
+        lo = _mm_srli_epi32(_mm_add_epi32(lo, round), 8);
+        hi = _mm_srli_epi32(_mm_add_epi32(hi, round), 8);
+        p = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(p, p));
+    }
+
+#undef SSE2_PIX_PAIR1
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_hbox4
+    Description : horizontal box over a row of 4 byte texels
+    Inputs      : row - the source row
+                  xs, xn - [n] first texel & number of texels of each box
+                  xr - [n] reciprocal of each xn, see PIX_RECIP
+                  step - texels between the ones summed
+                  n - destination texels
+    Outputs     : dst - n texels
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_SSE2 void simd_sse2_pix_hbox4(
+    GLubyte* dst, GLubyte const* row, GLint const* xs, GLint const* xn,
+    GLint const* xr, GLint step, GLsizei n)
+{
+    __m128i z = _mm_setzero_si128();
+    __m128i acc;
+    GLuint const* t;
+    GLsizei i;
+    GLint k;
+
+    for (i = 0; i < n; i++)
+    {
+        t = (GLuint const*)row + xs[i];
+        if (xn[i] == 1)
+        {
+            //a reciprocal of 65536 doesn't fit
+            ((GLuint*)dst)[i] = *t;
+            continue;
+        }
+        acc = _mm_set1_epi16((short)(xn[i] >> 1));
+        for (k = 0; k < xn[i]; k++, t += step)
+        {
+            acc = _mm_add_epi16(acc, _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)*t), z));
+        }
+        acc = _mm_mulhi_epu16(acc, _mm_set1_epi16((short)xr[i]));
+        ((GLuint*)dst)[i] = (GLuint)_mm_cvtsi128_si32(_mm_packus_epi16(acc, z));
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_expand4444
+    Description : widen ARGB4444 texels to 4 bytes, nibble k to byte k,
+                  each nibble times 17
+    Inputs      : src - the texels
+                  n - number of texels
+    Outputs     : dst - 4n bytes
+    Return      : the number of texels done, a multiple of 8
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_expand4444(GLubyte* dst, GLushort const* src, GLsizei n)
+{
+    __m128i m = _mm_set1_epi8(0x0f);
+    __m128i v, lo, hi, e0, e1;
+    GLsizei i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        v = _mm_loadu_si128((__m128i const*)(src + i));
+        lo = _mm_and_si128(v, m);
+        hi = _mm_and_si128(_mm_srli_epi16(v, 4), m);
+        e0 = _mm_unpacklo_epi8(lo, hi);
+        e1 = _mm_unpackhi_epi8(lo, hi);
+        _mm_storeu_si128((__m128i*)(dst + 4*i), _mm_or_si128(e0, _mm_slli_epi16(e0, 4)));
+        _mm_storeu_si128((__m128i*)(dst + 4*i + 16), _mm_or_si128(e1, _mm_slli_epi16(e1, 4)));
+    }
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_compress4444
+    Description : narrow 4 byte texels back to ARGB4444, each byte rounded
+                  to (c*15 + 135) >> 8
+    Inputs      : src - 4n bytes
+                  n - number of texels
+    Outputs     : dst - the texels
+    Return      : the number of texels done, a multiple of 8
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_compress4444(GLushort* dst, GLubyte const* src, GLsizei n)
+{
+    __m128i z = _mm_setzero_si128();
+    __m128i k15 = _mm_set1_epi16(15);
+    __m128i k135 = _mm_set1_epi16(135);
+    __m128i lo4 = _mm_set1_epi16(0x000f);
+    __m128i hi4 = _mm_set1_epi16(0x00f0);
+    __m128i v0, v1, n0, n1;
+    GLsizei i;
+
+#define SSE2_PIX_NIBBLE(V, H) \
+    _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(H(V, z), k15), k135), 8)
+#define SSE2_PIX_PAIR(N) \
+    _mm_or_si128(_mm_and_si128(N, lo4), _mm_and_si128(_mm_srli_epi16(N, 4), hi4))
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        v0 = _mm_loadu_si128((__m128i const*)(src + 4*i));
+        v1 = _mm_loadu_si128((__m128i const*)(src + 4*i + 16));
+        n0 = _mm_packus_epi16(SSE2_PIX_NIBBLE(v0, _mm_unpacklo_epi8), SSE2_PIX_NIBBLE(v0, _mm_unpackhi_epi8));
+        n1 = _mm_packus_epi16(SSE2_PIX_NIBBLE(v1, _mm_unpacklo_epi8), SSE2_PIX_NIBBLE(v1, _mm_unpackhi_epi8));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(SSE2_PIX_PAIR(n0), SSE2_PIX_PAIR(n1)));
+    }
+
+#undef SSE2_PIX_NIBBLE
+#undef SSE2_PIX_PAIR
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_sse2_pix_mip_reduce
+    Description : 2x2 box filter of 4 channel 16 bit texels, for mip chains
+    Inputs      : r0, r1 - 2 rows of 2n texels
+                  n - number of texels out
+    Outputs     : dst - each channel (the 4 under it + 2) >> 2
+    Return      : the number of texels done, a multiple of 2
+----------------------------------------------------------------------------*/
+SIMD_SSE2 GLsizei simd_sse2_pix_mip_reduce(
+    GLushort* dst, GLushort const* r0, GLushort const* r1, GLsizei n)
+{
+    __m128i two = _mm_set1_epi16(2);
+    __m128i a, b;
+    GLsizei i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        //texel pairs 01 & 23 summed down the columns, then across
+        a = _mm_add_epi16(_mm_loadu_si128((__m128i const*)(r0 + 8*i)),
+                          _mm_loadu_si128((__m128i const*)(r1 + 8*i)));
+        b = _mm_add_epi16(_mm_loadu_si128((__m128i const*)(r0 + 8*i + 8)),
+                          _mm_loadu_si128((__m128i const*)(r1 + 8*i + 8)));
+        a = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+        _mm_storeu_si128((__m128i*)(dst + 4*i), _mm_srli_epi16(_mm_add_epi16(a, two), 2));
+    }
+
+    return i;
+}
+
+/*
+ * AVX2, 8 vertices per block.  vertices k and k+4 share a register, one per
+ * 128-bit lane, so the in-lane shuffles give the same transpose as SSE
+ */
+
+#define AVX2_SIGN _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000))
+#define AVX2_BIT(B) _mm256_castsi256_ps(_mm256_set1_epi32(B))
+
+#define AVX2_TRANSPOSE4(r0, r1, r2, r3) \
+    { \
+        __m256 t0 = _mm256_unpacklo_ps(r0, r1); \
+        __m256 t1 = _mm256_unpacklo_ps(r2, r3); \
+        __m256 t2 = _mm256_unpackhi_ps(r0, r1); \
+        __m256 t3 = _mm256_unpackhi_ps(r2, r3); \
+        r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1,0,1,0)); \
+        r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3,2,3,2)); \
+        r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1,0,1,0)); \
+        r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3,2,3,2)); \
+    }
+
+#define AVX2_LOAD(S, K) \
+    _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps((S) + 4*(K))), \
+                         _mm_loadu_ps((S) + 4*((K) + 4)), 1)
+
+#define AVX2_STORE(D, K, R) \
+    _mm_storeu_ps((D) + 4*(K), _mm256_castps256_ps128(R)); \
+    _mm_storeu_ps((D) + 4*((K) + 4), _mm256_extractf128_ps(R, 1));
+
+static SIMD_AVX2 void avx2_load_matrix(__m256 mv[16], GLfloat const* m)
+{
+    GLuint i;
+    for (i = 0; i < 16; i++)
+    {
+        mv[i] = _mm256_set1_ps(m[i]);
+    }
+}
+
+/* as sse2_eye4 */
+static SIMD_AVX2 SIMD_INLINE void avx2_eye8(
+    GLuint type, __m256 const* mv, __m256 const* v, __m256* e)
+{
+    e[0] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(mv[0], v[0]), _mm256_mul_ps(mv[4], v[1])), _mm256_mul_ps(mv[8], v[2])), mv[12]);
+    e[1] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(mv[1], v[0]), _mm256_mul_ps(mv[5], v[1])), _mm256_mul_ps(mv[9], v[2])), mv[13]);
+    e[2] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(mv[2], v[0]), _mm256_mul_ps(mv[6], v[1])), _mm256_mul_ps(mv[10], v[2])), mv[14]);
+    if (type == MATRIX_3D)
+    {
+        e[3] = _mm256_set1_ps(1.0f);
+    }
+    else
+    {
+        e[3] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(mv[3], v[0]), _mm256_mul_ps(mv[7], v[1])), _mm256_mul_ps(mv[11], v[2])), mv[15]);
+    }
+}
+
+/* as sse2_cliptest4 */
+static SIMD_AVX2 SIMD_INLINE __m256 avx2_cliptest8(
+    __m256 const* c, __m256 guard)
+{
+    __m256 gw, ngw, ncw, hi, lo, mask;
+
+    gw = _mm256_mul_ps(c[3], guard);
+    ngw = _mm256_xor_ps(gw, AVX2_SIGN);
+    ncw = _mm256_xor_ps(c[3], AVX2_SIGN);
+    hi = _mm256_cmp_ps(c[0], gw, _CMP_GT_OQ);
+    lo = _mm256_andnot_ps(hi, _mm256_cmp_ps(c[0], ngw, _CMP_LT_OQ));
+    mask = _mm256_or_ps(_mm256_and_ps(hi, AVX2_BIT(CLIP_RIGHT_BIT)),
+                        _mm256_and_ps(lo, AVX2_BIT(CLIP_LEFT_BIT)));
+    hi = _mm256_cmp_ps(c[1], gw, _CMP_GT_OQ);
+    lo = _mm256_andnot_ps(hi, _mm256_cmp_ps(c[1], ngw, _CMP_LT_OQ));
+    mask = _mm256_or_ps(mask, _mm256_or_ps(_mm256_and_ps(hi, AVX2_BIT(CLIP_TOP_BIT)),
+                                           _mm256_and_ps(lo, AVX2_BIT(CLIP_BOTTOM_BIT))));
+    hi = _mm256_cmp_ps(c[2], c[3], _CMP_GT_OQ);
+    lo = _mm256_andnot_ps(hi, _mm256_cmp_ps(c[2], ncw, _CMP_LT_OQ));
+    mask = _mm256_or_ps(mask, _mm256_or_ps(_mm256_and_ps(hi, AVX2_BIT(CLIP_FAR_BIT)),
+                                           _mm256_and_ps(lo, AVX2_BIT(CLIP_NEAR_BIT))));
+    return mask;
+}
+
+/* as sse2_clip4 */
+static SIMD_AVX2 SIMD_INLINE __m256 avx2_clip8(
+    GLuint type, __m256 const* mv, __m256 guard, __m256 const* v, __m256* c)
+{
+    switch (type)
+    {
+    case MATRIX_IDENTITY:
+        c[0] = v[0];
+        c[1] = v[1];
+        c[2] = v[2];
+        c[3] = v[3];
+        break;
+    case MATRIX_ORTHO:
+        c[0] = _mm256_add_ps(_mm256_mul_ps(mv[0], v[0]), _mm256_mul_ps(mv[12], v[3]));
+        c[1] = _mm256_add_ps(_mm256_mul_ps(mv[5], v[1]), _mm256_mul_ps(mv[13], v[3]));
+        c[2] = _mm256_add_ps(_mm256_mul_ps(mv[10], v[2]), _mm256_mul_ps(mv[14], v[3]));
+        c[3] = v[3];
+        break;
+    case MATRIX_PERSPECTIVE:
+        c[0] = _mm256_add_ps(_mm256_mul_ps(mv[0], v[0]), _mm256_mul_ps(mv[8], v[2]));
+        c[1] = _mm256_add_ps(_mm256_mul_ps(mv[5], v[1]), _mm256_mul_ps(mv[9], v[2]));
+        c[2] = _mm256_add_ps(_mm256_mul_ps(mv[10], v[2]), _mm256_mul_ps(mv[14], v[3]));
+        c[3] = _mm256_xor_ps(v[2], AVX2_SIGN);
+        break;
+    default:
+        c[0] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(mv[0], v[0]), _mm256_mul_ps(mv[4], v[1])),
+            _mm256_mul_ps(mv[8], v[2])), _mm256_mul_ps(mv[12], v[3]));
+        c[1] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(mv[1], v[0]), _mm256_mul_ps(mv[5], v[1])),
+            _mm256_mul_ps(mv[9], v[2])), _mm256_mul_ps(mv[13], v[3]));
+        c[2] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(mv[2], v[0]), _mm256_mul_ps(mv[6], v[1])),
+            _mm256_mul_ps(mv[10], v[2])), _mm256_mul_ps(mv[14], v[3]));
+        c[3] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(mv[3], v[0]), _mm256_mul_ps(mv[7], v[1])),
+            _mm256_mul_ps(mv[11], v[2])), _mm256_mul_ps(mv[15], v[3]));
+        break;
+    }
+
+    return avx2_cliptest8(c, guard);
+}
+
+/* the 8 lanes' clip bits as bytes */
+static SIMD_AVX2 SIMD_INLINE void avx2_pack_masks(__m256 mask, GLubyte masks[8])
+{
+    __m128i packed;
+
+    /* low lane holds vertices 0-3, high lane 4-7 */
+    packed = _mm_packs_epi32(_mm256_castsi256_si128(_mm256_castps_si256(mask)),
+                             _mm256_extracti128_si256(_mm256_castps_si256(mask), 1));
+    packed = _mm_packus_epi16(packed, packed);
+    _mm_storel_epi64((__m128i*)masks, packed);
+}
+
+static SIMD_AVX2 void avx2_transform8(
+    GLuint type, __m256 const* mv, GLfloat* d, GLfloat const* s)
+{
+    __m256 v[4], e[4];
+
+    v[0] = AVX2_LOAD(s, 0);
+    v[1] = AVX2_LOAD(s, 1);
+    v[2] = AVX2_LOAD(s, 2);
+    v[3] = AVX2_LOAD(s, 3);
+    AVX2_TRANSPOSE4(v[0], v[1], v[2], v[3]);
+
+    avx2_eye8(type, mv, v, e);
+
+    AVX2_TRANSPOSE4(e[0], e[1], e[2], e[3]);
+
+    AVX2_STORE(d, 0, e[0]);
+    AVX2_STORE(d, 1, e[1]);
+    AVX2_STORE(d, 2, e[2]);
+    AVX2_STORE(d, 3, e[3]);
+}
+
+/* fills the 8 clipmask bytes in masks[] */
+static SIMD_AVX2 void avx2_project8(
+    GLuint type, __m256 const* mv, __m256 guard, GLfloat* d, GLfloat const* s, GLubyte masks[8])
+{
+    __m256 v[4], c[4], mask;
+
+    v[0] = AVX2_LOAD(s, 0);
+    v[1] = AVX2_LOAD(s, 1);
+    v[2] = AVX2_LOAD(s, 2);
+    v[3] = AVX2_LOAD(s, 3);
+    AVX2_TRANSPOSE4(v[0], v[1], v[2], v[3]);
+
+    mask = avx2_clip8(type, mv, guard, v, c);
+
+    AVX2_TRANSPOSE4(c[0], c[1], c[2], c[3]);
+
+    AVX2_STORE(d, 0, c[0]);
+    AVX2_STORE(d, 1, c[1]);
+    AVX2_STORE(d, 2, c[2]);
+    AVX2_STORE(d, 3, c[3]);
+
+    avx2_pack_masks(mask, masks);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_transform_points3
+    Description : AVX2 version of simd_sse2_transform_points3.  the final
+                  (n % 8) vertices are handed to the SSE2 version
+    Inputs      : see simd_sse2_transform_points3
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_AVX2 void simd_avx2_transform_points3(
+    GLuint type, GLuint n, GLfloat* d, GLfloat const* m, GLfloat const* s)
+{
+    __m256 mv[16];
+    GLuint i;
+
+    avx2_load_matrix(mv, m);
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        avx2_transform8(type, mv, d + 4*i, s + 4*i);
+    }
+
+    if (i < n)
+    {
+        simd_sse2_transform_points3(type, n - i, d + 4*i, m, s + 4*i);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_project_and_cliptest
+    Description : AVX2 version of simd_sse2_project_and_cliptest.  the final
+                  (n % 8) vertices are handed to the SSE2 version
+    Inputs      : see simd_sse2_project_and_cliptest
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_AVX2 void simd_avx2_project_and_cliptest(
+    GLuint type, GLuint n, GLfloat* d, GLfloat const* m, GLfloat const* s,
+    GLfloat guard, GLubyte* clipmask, GLubyte* ormask, GLubyte* andmask)
+{
+    __m256 mv[16];
+    __m256 g = _mm256_set1_ps(guard);
+    GLubyte masks[8];
+    GLubyte tmpOrMask = *ormask;
+    GLubyte tmpAndMask = *andmask;
+    GLuint i, j;
+
+    avx2_load_matrix(mv, m);
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        avx2_project8(type, mv, g, d + 4*i, s + 4*i, masks);
+        for (j = 0; j < 8; j++)
+        {
+            clipmask[i + j] |= masks[j];
+            tmpOrMask |= masks[j];
+            tmpAndMask &= masks[j];
+        }
+    }
+
+    *ormask = tmpOrMask;
+    *andmask = tmpAndMask;
+
+    if (i < n)
+    {
+        simd_sse2_project_and_cliptest(
+            type, n - i, d + 4*i, m, s + 4*i, guard, clipmask + i, ormask, andmask);
+    }
+}
+
+/* as SSE2_PACK3, per lane */
+#define AVX2_PACK3(X, Y, Z, O0, O1, O2) \
+    { \
+        __m256 xyLo = _mm256_unpacklo_ps(X, Y); \
+        __m256 xyHi = _mm256_unpackhi_ps(X, Y); \
+        O0 = _mm256_shuffle_ps(xyLo, _mm256_shuffle_ps(Z, X, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,1,0)); \
+        O1 = _mm256_shuffle_ps(_mm256_shuffle_ps(Y, Z, _MM_SHUFFLE(1,1,1,1)), xyHi, _MM_SHUFFLE(1,0,2,0)); \
+        O2 = _mm256_shuffle_ps(_mm256_shuffle_ps(Z, X, _MM_SHUFFLE(3,3,2,2)), \
+                               _mm256_shuffle_ps(Y, Z, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)); \
+    }
+
+/* as sse2_window4 */
+static SIMD_AVX2 SIMD_INLINE void avx2_window8(
+    simd_viewport const* vp, __m256 const* c, __m256* w)
+{
+    __m256 x = c[0], y = c[1], z = c[2];
+
+    if (vp->divide)
+    {
+        __m256 wInv = _mm256_div_ps(_mm256_set1_ps(1.0f), c[3]);
+        x = _mm256_mul_ps(x, wInv);
+        y = _mm256_mul_ps(y, wInv);
+        z = _mm256_mul_ps(z, wInv);
+    }
+    w[0] = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(vp->scale[0])), _mm256_set1_ps(vp->offset[0]));
+    w[1] = _mm256_add_ps(_mm256_mul_ps(y, _mm256_set1_ps(vp->scale[1])), _mm256_set1_ps(vp->offset[1]));
+    w[2] = _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(vp->scale[2])), _mm256_set1_ps(vp->offset[2]));
+}
+
+/* as sse2_fused4, 8 vertices */
+static SIMD_AVX2 SIMD_INLINE void avx2_fused8(
+    GLuint type, __m256 const* mvp, simd_viewport const* vp, GLfloat const* s, GLfloat* clip, GLfloat* win,
+    GLubyte* clipmask, GLubyte masks[8])
+{
+    __m256 v[4], c[4], w[4], mask;
+    __m128 r;
+    GLfloat junk[3];
+    GLuint j, clipped;
+
+    v[0] = AVX2_LOAD(s, 0);
+    v[1] = AVX2_LOAD(s, 1);
+    v[2] = AVX2_LOAD(s, 2);
+    v[3] = AVX2_LOAD(s, 3);
+    AVX2_TRANSPOSE4(v[0], v[1], v[2], v[3]);
+
+    avx2_eye8(type, mvp, v, c);
+    mask = avx2_cliptest8(c, _mm256_set1_ps(vp->guard));
+
+    avx2_pack_masks(mask, masks);
+    clipped = 0;
+    for (j = 0; j < 8; j++)
+    {
+        clipmask[j] |= masks[j];
+        clipped += (clipmask[j] != 0);
+    }
+
+    //win is [n][3]
+    if (clipped == 0)
+    {
+        //the low lane packs vertices 0-3, the high 4-7
+        __m256 o0, o1, o2;
+        avx2_window8(vp, c, w);
+        AVX2_PACK3(w[0], w[1], w[2], o0, o1, o2);
+        _mm_storeu_ps(win + 0, _mm256_castps256_ps128(o0));
+        _mm_storeu_ps(win + 4, _mm256_castps256_ps128(o1));
+        _mm_storeu_ps(win + 8, _mm256_castps256_ps128(o2));
+        _mm_storeu_ps(win + 12, _mm256_extractf128_ps(o0, 1));
+        _mm_storeu_ps(win + 16, _mm256_extractf128_ps(o1, 1));
+        _mm_storeu_ps(win + 20, _mm256_extractf128_ps(o2, 1));
+    }
+    else if (clipped < 8)
+    {
+        //register k holds vertices k and k+4
+        avx2_window8(vp, c, w);
+        w[3] = _mm256_setzero_ps();
+        AVX2_TRANSPOSE4(w[0], w[1], w[2], w[3]);
+        r = _mm256_castps256_ps128(w[0]);
+        SSE2_STORE3(clipmask[0] ? junk : win + 0, r);
+        r = _mm256_castps256_ps128(w[1]);
+        SSE2_STORE3(clipmask[1] ? junk : win + 3, r);
+        r = _mm256_castps256_ps128(w[2]);
+        SSE2_STORE3(clipmask[2] ? junk : win + 6, r);
+        r = _mm256_castps256_ps128(w[3]);
+        SSE2_STORE3(clipmask[3] ? junk : win + 9, r);
+        r = _mm256_extractf128_ps(w[0], 1);
+        SSE2_STORE3(clipmask[4] ? junk : win + 12, r);
+        r = _mm256_extractf128_ps(w[1], 1);
+        SSE2_STORE3(clipmask[5] ? junk : win + 15, r);
+        r = _mm256_extractf128_ps(w[2], 1);
+        SSE2_STORE3(clipmask[6] ? junk : win + 18, r);
+        r = _mm256_extractf128_ps(w[3], 1);
+        SSE2_STORE3(clipmask[7] ? junk : win + 21, r);
+    }
+
+    AVX2_TRANSPOSE4(c[0], c[1], c[2], c[3]);
+
+    AVX2_STORE(clip, 0, c[0]);
+    AVX2_STORE(clip, 1, c[1]);
+    AVX2_STORE(clip, 2, c[2]);
+    AVX2_STORE(clip, 3, c[3]);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_transform_project_viewport
+    Description : AVX2 version of simd_sse2_transform_project_viewport.  the
+                  final (n % 8) vertices are handed to the SSE2 version
+    Inputs      : see simd_sse2_transform_project_viewport
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_AVX2 void simd_avx2_transform_project_viewport(
+    GLuint type, GLuint n, GLfloat const* mvp, simd_viewport const* vp,
+    GLfloat const* obj, GLfloat* clip, GLfloat* win,
+    GLubyte* clipmask, GLubyte* ormask, GLubyte* andmask)
+{
+    __m256 mvpv[16];
+    GLubyte masks[8];
+    GLubyte tmpOrMask = *ormask;
+    GLubyte tmpAndMask = *andmask;
+    GLuint i, j;
+
+    avx2_load_matrix(mvpv, mvp);
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        avx2_fused8(type, mvpv, vp,
+                    obj + 4*i, clip + 4*i, win + 3*i, clipmask + i, masks);
+        for (j = 0; j < 8; j++)
+        {
+            tmpOrMask |= masks[j];
+            tmpAndMask &= masks[j];
+        }
+    }
+
+    *ormask = tmpOrMask;
+    *andmask = tmpAndMask;
+
+    if (i < n)
+    {
+        simd_sse2_transform_project_viewport(
+            type, n - i, mvp, vp,
+            obj + 4*i, clip + 4*i, win + 3*i, clipmask + i, ormask, andmask);
+    }
+}
+
+/* x, y and z of 8 [n][3] normals, 0-3 in the low lane and 4-7 in the high */
+#define AVX2_LOAD_HALVES(S) \
+    _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(S)), _mm_loadu_ps((S) + 12), 1)
+
+#define AVX2_LOAD_NORMALS(S, X, Y, Z) \
+    { \
+        __m256 a = AVX2_LOAD_HALVES(S); \
+        __m256 b = AVX2_LOAD_HALVES((S) + 4); \
+        __m256 c = AVX2_LOAD_HALVES((S) + 8); \
+        X = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2,0,3,0)), \
+                              _mm256_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,1,0)); \
+        Y = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), \
+                              _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0)); \
+        Z = _mm256_shuffle_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), \
+                              _mm256_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0)); \
+    }
+
+/* shade 8 vertices, as sse2_shade4 */
+static SIMD_AVX2 void avx2_shade8(
+    simd_shade const* sh, GLfloat const* vertex, GLfloat const* normal, GLubyte* color)
+{
+    gl_light_block const* lb = sh->lights;
+    __m256 nx, ny, nz, vx, vy, vz, vw;
+    __m256 sumR, sumG, sumB;
+    __m256 zero = _mm256_setzero_ps();
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256i rgba;
+    GLuint l;
+
+    AVX2_LOAD_NORMALS(normal, nx, ny, nz);
+    if (sh->side != 0)
+    {
+        nx = _mm256_xor_ps(nx, AVX2_SIGN);
+        ny = _mm256_xor_ps(ny, AVX2_SIGN);
+        nz = _mm256_xor_ps(nz, AVX2_SIGN);
+    }
+
+    vx = AVX2_LOAD(vertex, 0);
+    vy = AVX2_LOAD(vertex, 1);
+    vz = AVX2_LOAD(vertex, 2);
+    vw = AVX2_LOAD(vertex, 3);
+    AVX2_TRANSPOSE4(vx, vy, vz, vw);
+
+    sumR = _mm256_set1_ps(sh->base[0]);
+    sumG = _mm256_set1_ps(sh->base[1]);
+    sumB = _mm256_set1_ps(sh->base[2]);
+
+    for (l = 0; l < lb->Count; l++)
+    {
+        GLfloat const (*ambient)[MAX_LIGHTS] = lb->Ambient[sh->side];
+        GLfloat const (*diffuse)[MAX_LIGHTS] = lb->Diffuse[sh->side];
+        __m256 lx, ly, lz, ndl, r, g, b;
+
+        if (sh->fast)
+        {
+            lx = _mm256_set1_ps(lb->Dx[l]);
+            ly = _mm256_set1_ps(lb->Dy[l]);
+            lz = _mm256_set1_ps(lb->Dz[l]);
+        }
+        else
+        {
+            lx = _mm256_set1_ps(lb->Px[l]);
+            ly = _mm256_set1_ps(lb->Py[l]);
+            lz = _mm256_set1_ps(lb->Pz[l]);
+        }
+
+        if (!sh->fast && lb->Positional[l])
+        {
+            __m256 len2, rsq, d, onLight, att;
+
+            lx = _mm256_sub_ps(lx, vx);
+            ly = _mm256_sub_ps(ly, vy);
+            lz = _mm256_sub_ps(lz, vz);
+            len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lx, lx), _mm256_mul_ps(ly, ly)),
+                                 _mm256_mul_ps(lz, lz));
+
+            //rsqrt and a Newton step, ~22 bits
+            rsq = _mm256_rsqrt_ps(_mm256_max_ps(len2, _mm256_set1_ps(1.0e-30f)));
+            rsq = _mm256_mul_ps(rsq, _mm256_sub_ps(_mm256_set1_ps(1.5f),
+                  _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), len2), _mm256_mul_ps(rsq, rsq))));
+            d = _mm256_mul_ps(len2, rsq);
+
+            //a light on the vertex isn't normalized
+            onLight = _mm256_cmp_ps(d, _mm256_set1_ps(0.0001f), _CMP_LE_OQ);
+            rsq = _mm256_or_ps(_mm256_andnot_ps(onLight, rsq), _mm256_and_ps(onLight, one));
+            lx = _mm256_mul_ps(lx, rsq);
+            ly = _mm256_mul_ps(ly, rsq);
+            lz = _mm256_mul_ps(lz, rsq);
+
+            att = _mm256_div_ps(one,
+                  _mm256_add_ps(_mm256_set1_ps(lb->K0[l]), _mm256_mul_ps(d,
+                  _mm256_add_ps(_mm256_set1_ps(lb->K1[l]), _mm256_mul_ps(d, _mm256_set1_ps(lb->K2[l]))))));
+
+            ndl = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, lx), _mm256_mul_ps(ny, ly)),
+                                _mm256_mul_ps(nz, lz));
+            ndl = _mm256_max_ps(ndl, zero);
+
+            r = _mm256_add_ps(_mm256_set1_ps(ambient[0][l]), _mm256_mul_ps(ndl, _mm256_set1_ps(diffuse[0][l])));
+            g = _mm256_add_ps(_mm256_set1_ps(ambient[1][l]), _mm256_mul_ps(ndl, _mm256_set1_ps(diffuse[1][l])));
+            b = _mm256_add_ps(_mm256_set1_ps(ambient[2][l]), _mm256_mul_ps(ndl, _mm256_set1_ps(diffuse[2][l])));
+            sumR = _mm256_add_ps(sumR, _mm256_mul_ps(att, r));
+            sumG = _mm256_add_ps(sumG, _mm256_mul_ps(att, g));
+            sumB = _mm256_add_ps(sumB, _mm256_mul_ps(att, b));
+            continue;
+        }
+
+        ndl = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, lx), _mm256_mul_ps(ny, ly)),
+                            _mm256_mul_ps(nz, lz));
+        ndl = _mm256_max_ps(ndl, zero);
+
+        r = _mm256_mul_ps(ndl, _mm256_set1_ps(diffuse[0][l]));
+        g = _mm256_mul_ps(ndl, _mm256_set1_ps(diffuse[1][l]));
+        b = _mm256_mul_ps(ndl, _mm256_set1_ps(diffuse[2][l]));
+        if (!sh->fast)
+        {
+            r = _mm256_add_ps(r, _mm256_set1_ps(ambient[0][l]));
+            g = _mm256_add_ps(g, _mm256_set1_ps(ambient[1][l]));
+            b = _mm256_add_ps(b, _mm256_set1_ps(ambient[2][l]));
+        }
+        sumR = _mm256_add_ps(sumR, r);
+        sumG = _mm256_add_ps(sumG, g);
+        sumB = _mm256_add_ps(sumB, b);
+    }
+
+    sumR = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(sumR, zero), one), _mm256_set1_ps(sh->scale[0]));
+    sumG = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(sumG, zero), one), _mm256_set1_ps(sh->scale[1]));
+    sumB = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(sumB, zero), one), _mm256_set1_ps(sh->scale[2]));
+
+    //round to nearest like FAST_TO_INT, and pack to r g b a bytes
+    rgba = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cvtps_epi32(sumR), _mm256_slli_epi32(_mm256_cvtps_epi32(sumG), 8)),
+        _mm256_or_si256(_mm256_slli_epi32(_mm256_cvtps_epi32(sumB), 16),
+                        _mm256_set1_epi32((int)((GLuint)sh->alpha << 24))));
+    _mm256_storeu_si256((__m256i*)color, rgba);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_shade_vertices
+    Description : AVX2 version of simd_sse2_shade_vertices.  the final
+                  (n % 8) vertices are handed to the SSE2 version
+    Inputs      : see simd_sse2_shade_vertices
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_AVX2 void simd_avx2_shade_vertices(
+    simd_shade const* sh, GLuint n,
+    GLfloat const* vertex, GLfloat const* normal, GLubyte* color)
+{
+    GLuint i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        avx2_shade8(sh, vertex + 4*i, normal + 3*i, color + 4*i);
+    }
+
+    if (i < n)
+    {
+        simd_sse2_shade_vertices(sh, n - i, vertex + 4*i, normal + 3*i, color + 4*i);
+    }
+}
+
+/* as sse2_normals4, 8 normals */
+static SIMD_AVX2 SIMD_INLINE void avx2_normals8(
+    GLuint mode, __m256 const mv[9], __m256 scale, GLfloat* v, GLfloat const* u)
+{
+    __m256 ux, uy, uz, tx, ty, tz, o0, o1, o2;
+
+    AVX2_LOAD_NORMALS(u, ux, uy, uz);
+    tx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ux, mv[0]), _mm256_mul_ps(uy, mv[1])), _mm256_mul_ps(uz, mv[2]));
+    ty = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ux, mv[3]), _mm256_mul_ps(uy, mv[4])), _mm256_mul_ps(uz, mv[5]));
+    tz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ux, mv[6]), _mm256_mul_ps(uy, mv[7])), _mm256_mul_ps(uz, mv[8]));
+
+    if (mode == SIMD_NORMALS_RESCALE)
+    {
+        tx = _mm256_mul_ps(tx, scale);
+        ty = _mm256_mul_ps(ty, scale);
+        tz = _mm256_mul_ps(tz, scale);
+    }
+    else if (mode == SIMD_NORMALS_NORMALIZE)
+    {
+        __m256 len2, rsq, tiny;
+
+        len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, tx), _mm256_mul_ps(ty, ty)),
+                             _mm256_mul_ps(tz, tz));
+
+        rsq = _mm256_rsqrt_ps(_mm256_max_ps(len2, _mm256_set1_ps(FLT_MIN)));
+        rsq = _mm256_mul_ps(rsq, _mm256_sub_ps(_mm256_set1_ps(1.5f),
+              _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), len2), _mm256_mul_ps(rsq, rsq))));
+        tiny = _mm256_cmp_ps(len2, _mm256_set1_ps(FLT_MIN), _CMP_LT_OQ);
+        rsq = _mm256_blendv_ps(rsq, _mm256_set1_ps(1.0f), tiny);
+
+        tx = _mm256_mul_ps(tx, rsq);
+        ty = _mm256_mul_ps(ty, rsq);
+        tz = _mm256_mul_ps(tz, rsq);
+    }
+
+    AVX2_PACK3(tx, ty, tz, o0, o1, o2);
+    _mm_storeu_ps(v + 0, _mm256_castps256_ps128(o0));
+    _mm_storeu_ps(v + 4, _mm256_castps256_ps128(o1));
+    _mm_storeu_ps(v + 8, _mm256_castps256_ps128(o2));
+    _mm_storeu_ps(v + 12, _mm256_extractf128_ps(o0, 1));
+    _mm_storeu_ps(v + 16, _mm256_extractf128_ps(o1, 1));
+    _mm_storeu_ps(v + 20, _mm256_extractf128_ps(o2, 1));
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_xform_normals
+    Description : AVX2 version of simd_sse2_xform_normals.  the final
+                  (n % 8) normals are handed to the SSE2 version
+    Inputs      : see simd_sse2_xform_normals
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_AVX2 void simd_avx2_xform_normals(
+    GLuint mode, GLuint n, GLfloat* v, GLfloat const* m, GLfloat const* u,
+    GLfloat scale)
+{
+    __m256 mv[9];
+    __m256 scalev = _mm256_set1_ps(scale);
+    GLuint i;
+
+    mv[0] = _mm256_set1_ps(m[0]); mv[1] = _mm256_set1_ps(m[1]); mv[2] = _mm256_set1_ps(m[2]);
+    mv[3] = _mm256_set1_ps(m[4]); mv[4] = _mm256_set1_ps(m[5]); mv[5] = _mm256_set1_ps(m[6]);
+    mv[6] = _mm256_set1_ps(m[8]); mv[7] = _mm256_set1_ps(m[9]); mv[8] = _mm256_set1_ps(m[10]);
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        avx2_normals8(mode, mv, scalev, v + 3*i, u + 3*i);
+    }
+
+    if (i < n)
+    {
+        simd_sse2_xform_normals(mode, n - i, v + 3*i, m, u + 3*i, scale);
+    }
+}
+
+/* floats o..o+3 of [n][6] boxes k and k + 4 */
+#define AVX2_LOAD_BOX(S, K, O) \
+    _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps((S) + 6*(K) + (O))), \
+                         _mm_loadu_ps((S) + 6*((K) + 4) + (O)), 1)
+
+/* as sse2_cull4, 8 boxes or spheres, box 0 in bit 0 */
+static SIMD_AVX2 SIMD_INLINE GLuint avx2_cull8(
+    GLuint shape, GLfloat const* s, __m256 const* pl)
+{
+    __m256 r0, r1, r2, r3, cx, cy, cz, ex, ey, ez, d, out;
+    GLuint k;
+
+    //boxes k and k + 4 share a row
+    if (shape == SIMD_CULL_SPHERES)
+    {
+        r0 = AVX2_LOAD(s, 0);
+        r1 = AVX2_LOAD(s, 1);
+        r2 = AVX2_LOAD(s, 2);
+        r3 = AVX2_LOAD(s, 3);
+        AVX2_TRANSPOSE4(r0, r1, r2, r3);
+        cx = r0;
+        cy = r1;
+        cz = r2;
+        ex = r3;
+        ey = ez = _mm256_setzero_ps();
+    }
+    else
+    {
+        __m256 half = _mm256_set1_ps(0.5f);
+        __m256 lx, ly, lz;
+
+        r0 = AVX2_LOAD_BOX(s, 0, 0);
+        r1 = AVX2_LOAD_BOX(s, 1, 0);
+        r2 = AVX2_LOAD_BOX(s, 2, 0);
+        r3 = AVX2_LOAD_BOX(s, 3, 0);
+        AVX2_TRANSPOSE4(r0, r1, r2, r3);
+        cx = r0;
+        cy = r1;
+        cz = r2;
+        lx = r3;
+        r0 = AVX2_LOAD_BOX(s, 0, 2);
+        r1 = AVX2_LOAD_BOX(s, 1, 2);
+        r2 = AVX2_LOAD_BOX(s, 2, 2);
+        r3 = AVX2_LOAD_BOX(s, 3, 2);
+        AVX2_TRANSPOSE4(r0, r1, r2, r3);
+        ly = r2;
+        lz = r3;
+
+        cx = _mm256_add_ps(cx, _mm256_mul_ps(lx, half));
+        cy = _mm256_add_ps(cy, _mm256_mul_ps(ly, half));
+        cz = _mm256_add_ps(cz, _mm256_mul_ps(lz, half));
+        ex = _mm256_andnot_ps(AVX2_SIGN, _mm256_mul_ps(lx, half));
+        ey = _mm256_andnot_ps(AVX2_SIGN, _mm256_mul_ps(ly, half));
+        ez = _mm256_andnot_ps(AVX2_SIGN, _mm256_mul_ps(lz, half));
+    }
+
+    out = _mm256_setzero_ps();
+    for (k = 0; k < 6; k++, pl += SIMD_CULL_PLANE)
+    {
+        d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(pl[0], cx), _mm256_mul_ps(pl[1], cy)), _mm256_mul_ps(pl[2], cz)), pl[3]);
+        if (shape == SIMD_CULL_SPHERES)
+        {
+            d = _mm256_add_ps(d, ex);
+        }
+        else
+        {
+            d = _mm256_add_ps(d, _mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(pl[4], ex), _mm256_mul_ps(pl[5], ey)), _mm256_mul_ps(pl[6], ez)));
+        }
+        out = _mm256_or_ps(out, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_LT_OQ));
+    }
+
+    return ~(GLuint)_mm256_movemask_ps(out) & 0xff;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_cull
+    Description : AVX2 version of simd_sse2_cull.  the final (n % 8) are
+                  handed to the SSE2 version
+    Inputs      : see simd_sse2_cull
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_AVX2 GLuint simd_avx2_cull(
+    GLuint shape, GLuint n, GLfloat const* s, GLfloat const planes[6][4],
+    GLuint* visible)
+{
+    __m256 pl[6 * SIMD_CULL_PLANE];
+    GLuint stride = (shape == SIMD_CULL_SPHERES) ? 4 : 6;
+    GLuint i, k, bits, count;
+
+    for (k = 0; k < 6; k++)
+    {
+        pl[SIMD_CULL_PLANE*k + 0] = _mm256_set1_ps(planes[k][0]);
+        pl[SIMD_CULL_PLANE*k + 1] = _mm256_set1_ps(planes[k][1]);
+        pl[SIMD_CULL_PLANE*k + 2] = _mm256_set1_ps(planes[k][2]);
+        pl[SIMD_CULL_PLANE*k + 3] = _mm256_set1_ps(planes[k][3]);
+        pl[SIMD_CULL_PLANE*k + 4] = _mm256_set1_ps(fabsf(planes[k][0]));
+        pl[SIMD_CULL_PLANE*k + 5] = _mm256_set1_ps(fabsf(planes[k][1]));
+        pl[SIMD_CULL_PLANE*k + 6] = _mm256_set1_ps(fabsf(planes[k][2]));
+    }
+
+    count = 0;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        bits = avx2_cull8(shape, s + stride*i, pl);
+        visible[i >> 5] |= bits << (i & 31);
+        count += sse2_nibble_bits[bits & 0xf] + sse2_nibble_bits[bits >> 4];
+    }
+
+    if (i < n)
+    {
+        GLfloat tmp[48];
+        GLuint rem = n - i;
+
+        memset(tmp, 0, sizeof(tmp));
+        memcpy(tmp, s + stride*i, stride*rem*sizeof(GLfloat));
+        bits = avx2_cull8(shape, tmp, pl) & ((1 << rem) - 1);
+        visible[i >> 5] |= bits << (i & 31);
+        count += sse2_nibble_bits[bits & 0xf] + sse2_nibble_bits[bits >> 4];
+    }
+
+    return count;
+}
+
+
+/*
+ * pixel format conversion, 16 pixels per block.  packs_epi32 works within
+ * 128-bit lanes, so the packed result is put back in order with a permute
+ */
+
+#define AVX2_PIX_MASK(M) _mm256_set1_epi32(M)
+
+static SIMD_AVX2 SIMD_INLINE __m256i avx2_pix_rgba8(GLuint dformat, __m256i p)
+{
+    __m256i r;
+
+    switch (dformat)
+    {
+    case PIX_ARGB8888:
+    case PIX_XRGB8888:
+        r = _mm256_or_si256(_mm256_or_si256(
+            _mm256_and_si256(p, AVX2_PIX_MASK((int)0xff00ff00)),
+            _mm256_and_si256(_mm256_srli_epi32(p, 16), AVX2_PIX_MASK(0xff))),
+            _mm256_slli_epi32(_mm256_and_si256(p, AVX2_PIX_MASK(0xff)), 16));
+        if (dformat == PIX_XRGB8888)
+        {
+            r = _mm256_and_si256(r, AVX2_PIX_MASK(0x00ffffff));
+        }
+        return r;
+    case PIX_RGB565:
+        return _mm256_or_si256(_mm256_or_si256(
+            _mm256_slli_epi32(_mm256_and_si256(p, AVX2_PIX_MASK(0xf8)), 8),
+            _mm256_and_si256(_mm256_srli_epi32(p, 5), AVX2_PIX_MASK(0x7e0))),
+            _mm256_and_si256(_mm256_srli_epi32(p, 19), AVX2_PIX_MASK(0x1f)));
+    case PIX_XRGB1555:
+        return _mm256_or_si256(_mm256_or_si256(
+            _mm256_slli_epi32(_mm256_and_si256(p, AVX2_PIX_MASK(0xf8)), 7),
+            _mm256_and_si256(_mm256_srli_epi32(p, 6), AVX2_PIX_MASK(0x3e0))),
+            _mm256_and_si256(_mm256_srli_epi32(p, 19), AVX2_PIX_MASK(0x1f)));
+    default:
+        return _mm256_or_si256(_mm256_or_si256(
+            _mm256_and_si256(_mm256_srli_epi32(p, 16), AVX2_PIX_MASK(0xf000)),
+            _mm256_slli_epi32(_mm256_and_si256(p, AVX2_PIX_MASK(0xf0)), 4)), _mm256_or_si256(
+            _mm256_and_si256(_mm256_srli_epi32(p, 8), AVX2_PIX_MASK(0xf0)),
+            _mm256_and_si256(_mm256_srli_epi32(p, 20), AVX2_PIX_MASK(0xf))));
+    }
+}
+
+static SIMD_AVX2 SIMD_INLINE __m256i avx2_pix_4444_16(GLuint dformat, __m256i s)
+{
+    GLint sh = (dformat == PIX_RGB565) ? 1 : 0;
+
+    return _mm256_or_si256(_mm256_or_si256(
+        _mm256_sll_epi16(_mm256_and_si256(s, _mm256_set1_epi16(0x0f00)), _mm_cvtsi32_si128(3 + sh)),
+        _mm256_sll_epi16(_mm256_and_si256(s, _mm256_set1_epi16(0x00f0)), _mm_cvtsi32_si128(2 + sh))),
+        _mm256_slli_epi16(_mm256_and_si256(s, _mm256_set1_epi16(0x000f)), 1));
+}
+
+static SIMD_AVX2 SIMD_INLINE __m256i avx2_pix_4444_32(GLuint dformat, __m256i u)
+{
+    __m256i r = _mm256_or_si256(_mm256_or_si256(
+        _mm256_slli_epi32(_mm256_and_si256(u, AVX2_PIX_MASK(0x0f00)), 12),
+        _mm256_slli_epi32(_mm256_and_si256(u, AVX2_PIX_MASK(0x00f0)), 8)),
+        _mm256_slli_epi32(_mm256_and_si256(u, AVX2_PIX_MASK(0x000f)), 4));
+    if (dformat == PIX_ARGB8888)
+    {
+        r = _mm256_or_si256(r, _mm256_slli_epi32(_mm256_and_si256(u, AVX2_PIX_MASK(0xf000)), 16));
+    }
+    return r;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_pix_row
+    Description : AVX2 version of simd_sse2_pix_row.  a remainder of 8 or
+                  more is handed to the SSE2 version
+    Inputs      : see simd_sse2_pix_row
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+SIMD_AVX2 GLsizei simd_avx2_pix_row(
+    GLuint dformat, GLvoid* dst, GLuint sformat, GLvoid const* src, GLsizei width)
+{
+    GLubyte* d = (GLubyte*)dst;
+    GLubyte const* s = (GLubyte const*)src;
+    GLsizei x;
+    __m256i a, b;
+
+    if (sformat == PIX_RGBA)
+    {
+        for (x = 0; x + 16 <= width; x += 16, s += 64)
+        {
+            a = avx2_pix_rgba8(dformat, _mm256_loadu_si256((__m256i const*)s));
+            b = avx2_pix_rgba8(dformat, _mm256_loadu_si256((__m256i const*)(s + 32)));
+            if (dformat <= PIX_XRGB8888)
+            {
+                _mm256_storeu_si256((__m256i*)(d + 4*x), a);
+                _mm256_storeu_si256((__m256i*)(d + 4*x + 32), b);
+            }
+            else
+            {
+                a = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+                b = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+                a = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+                _mm256_storeu_si256((__m256i*)(d + 2*x), a);
+            }
+        }
+    }
+    else
+    {
+        for (x = 0; x + 16 <= width; x += 16, s += 32)
+        {
+            if (dformat <= PIX_XRGB8888)
+            {
+                a = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i const*)s));
+                b = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i const*)(s + 16)));
+                _mm256_storeu_si256((__m256i*)(d + 4*x), avx2_pix_4444_32(dformat, a));
+                _mm256_storeu_si256((__m256i*)(d + 4*x + 32), avx2_pix_4444_32(dformat, b));
+            }
+            else
+            {
+                a = _mm256_loadu_si256((__m256i const*)s);
+                _mm256_storeu_si256((__m256i*)(d + 2*x), avx2_pix_4444_16(dformat, a));
+            }
+        }
+    }
+
+    if (x + 8 <= width)
+    {
+        GLuint sbytes = (sformat == PIX_RGBA) ? 4 : 2;
+        GLuint dbytes = (dformat <= PIX_XRGB8888) ? 4 : 2;
+        x += simd_sse2_pix_row(dformat, d + dbytes*x, sformat, (GLubyte const*)src + sbytes*x, width - x);
+    }
+
+    return x;
+}
+
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_pix_lerp
+    Description : AVX2 version of simd_sse2_pix_lerp, 32 bytes a block
+    Inputs      : see simd_sse2_pix_lerp
+    Outputs     :
+    Return      : the number of bytes done, a multiple of 32
+----------------------------------------------------------------------------*/
+SIMD_AVX2 GLsizei simd_avx2_pix_lerp(
+    GLubyte* dst, GLubyte const* a, GLubyte const* b, GLsizei n, GLint f)
+{
+    __m256i wa = _mm256_set1_epi16((short)(256 - f));
+    __m256i wb = _mm256_set1_epi16((short)f);
+    __m256i round = _mm256_set1_epi16(128);
+    __m256i z = _mm256_setzero_si256();
+    __m256i va, vb, lo, hi;
+    GLsizei i;
+
+    //unpack & packus both work within 128-bit lanes, so the order holds
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        va = _mm256_loadu_si256((__m256i const*)(a + i));
+        vb = _mm256_loadu_si256((__m256i const*)(b + i));
+        lo = _mm256_add_epi16(_mm256_add_epi16(
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(va, z), wa),
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, z), wb)), round);
+        hi = _mm256_add_epi16(_mm256_add_epi16(
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(va, z), wa),
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, z), wb)), round);
+        _mm256_storeu_si256((__m256i*)(dst + i),
+                            _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8)));
+    }
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_pix_accum
+    Description : AVX2 version of simd_sse2_pix_accum, 32 bytes a block
+    Inputs      : see simd_sse2_pix_accum
+    Outputs     :
+    Return      : the number of bytes done, a multiple of 32
+----------------------------------------------------------------------------*/
+SIMD_AVX2 GLsizei simd_avx2_pix_accum(
+    GLushort* acc, GLubyte const* row, GLsizei n, GLboolean first)
+{
+    __m256i lo, hi;
+    GLsizei i;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)(row + i)));
+        hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)(row + i + 16)));
+        if (!first)
+        {
+            lo = _mm256_add_epi16(lo, _mm256_loadu_si256((__m256i const*)(acc + i)));
+            hi = _mm256_add_epi16(hi, _mm256_loadu_si256((__m256i const*)(acc + i + 16)));
+        }
+        _mm256_storeu_si256((__m256i*)(acc + i), lo);
+        _mm256_storeu_si256((__m256i*)(acc + i + 16), hi);
+    }
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_pix_average
+    Description : AVX2 version of simd_sse2_pix_average, 32 bytes a block
+    Inputs      : see simd_sse2_pix_average
+    Outputs     :
+    Return      : the number of bytes done, a multiple of 32
+----------------------------------------------------------------------------*/
+SIMD_AVX2 GLsizei simd_avx2_pix_average(
+    GLubyte* dst, GLushort const* acc, GLsizei n, GLuint recip, GLuint bias)
+{
+    __m256i r = _mm256_set1_epi16((short)recip);
+    __m256i b = _mm256_set1_epi16((short)bias);
+    __m256i lo, hi;
+    GLsizei i;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        lo = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_loadu_si256((__m256i const*)(acc + i)), b), r);
+        hi = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_loadu_si256((__m256i const*)(acc + i + 16)), b), r);
+        _mm256_storeu_si256((__m256i*)(dst + i),
+                            _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_pix_mip_reduce
+    Description : AVX2 version of simd_sse2_pix_mip_reduce, 4 texels a block
+    Inputs      : see simd_sse2_pix_mip_reduce
+    Outputs     :
+    Return      : the number of texels done, a multiple of 4
+----------------------------------------------------------------------------*/
+SIMD_AVX2 GLsizei simd_avx2_pix_mip_reduce(
+    GLushort* dst, GLushort const* r0, GLushort const* r1, GLsizei n)
+{
+    __m256i two = _mm256_set1_epi16(2);
+    __m256i a, b;
+    GLsizei i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        a = _mm256_add_epi16(_mm256_loadu_si256((__m256i const*)(r0 + 8*i)),
+                             _mm256_loadu_si256((__m256i const*)(r1 + 8*i)));
+        b = _mm256_add_epi16(_mm256_loadu_si256((__m256i const*)(r0 + 8*i + 16)),
+                             _mm256_loadu_si256((__m256i const*)(r1 + 8*i + 16)));
+        //pairs 01 45 | 23 67, put back in order
+        a = _mm256_add_epi16(_mm256_unpacklo_epi64(a, b), _mm256_unpackhi_epi64(a, b));
+        a = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i*)(dst + 4*i), _mm256_srli_epi16(_mm256_add_epi16(a, two), 2));
+    }
+
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : simd_avx2_pix_srgb_decode
+    Description : RGBA bytes to 16 bit linear through a lookup table, 8
+                  channels a gather
+    Inputs      : src - 4n bytes
+                  n - number of texels
+                  table - 4 x 256 entries, one per channel, and a pad entry
+                          for the last gather's top half
+    Outputs     : dst - the texels
+    Return      : the number of texels done, a multiple of 4
+----------------------------------------------------------------------------*/
+SIMD_AVX2 GLsizei simd_avx2_pix_srgb_decode(
+    GLushort* dst, GLubyte const* src, GLsizei n, GLushort const* table)
+{
+    __m256i chan = _mm256_setr_epi32(0, 256, 512, 768, 0, 256, 512, 768);
+    __m256i low = _mm256_set1_epi32(0xffff);
+    __m256i lo, hi;
+    GLsizei i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        lo = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)(src + 4*i)));
+        hi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)(src + 4*i + 8)));
+        lo = _mm256_and_si256(_mm256_i32gather_epi32((int const*)table, _mm256_add_epi32(lo, chan), 2), low);
+        hi = _mm256_and_si256(_mm256_i32gather_epi32((int const*)table, _mm256_add_epi32(hi, chan), 2), low);
+        _mm256_storeu_si256((__m256i*)(dst + 4*i),
+                            _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    return i;
+}
+
+#else   /* !SIMD_X86 */
+
+GLuint get_cputype()
+{
+    return 0;
+}
+
+GLboolean get_cpummx()
+{
+    return GL_FALSE;
+}
+
+GLboolean get_cpukatmai()
+{
+    return GL_FALSE;
+}
+
+GLboolean get_cpusse2()
+{
+    return GL_FALSE;
+}
+
+GLboolean get_cpuavx2()
+{
+    return GL_FALSE;
+}
+
+#endif
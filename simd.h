@@ -0,0 +1,139 @@
+/*=============================================================================
+        Name    : simd.h
+        Purpose : portable SSE2 / AVX2 intrinsics versions of the rGL vertex
+                  transform & cliptest paths, and cpuid feature detection
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#ifndef _SIMD_H
+#define _SIMD_H
+
+#include "kgl.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+/* don't bother with the vector paths for fewer vertices than this */
+#define SIMD_THRESH 8
+
+/* parameters of the lighting kernels, set up by gl_color_shade_vertices and
+   gl_fast_color_shade_vertices from their scalar equivalents */
+typedef struct
+{
+    gl_light_block const* lights;
+    GLuint side;                //0 front, 1 back (normals negated)
+    GLboolean fast;             //every light directional, no per light ambient
+    GLfloat base[3];            //sums before the lights
+    GLfloat scale[3];           //applied after clamping the sums to [0, 1]
+    GLubyte alpha;
+} simd_shade;
+
+/* window = clip (/ w if divide) * scale + offset, for the fused kernels */
+typedef struct
+{
+    GLfloat scale[3];
+    GLfloat offset[3];
+    GLboolean divide;
+    GLfloat guard;              //x & y clip planes at +-guard * w
+} simd_viewport;
+
+/* scaling after the normal transform, chosen by gl_xform_normals_3fv */
+#define SIMD_NORMALS_PLAIN      0   //transform only
+#define SIMD_NORMALS_RESCALE    1   //one scale for the matrix (GL_RESCALE_NORMAL)
+#define SIMD_NORMALS_NORMALIZE  2   //per normal, rsqrt + Newton (GL_NORMALIZE)
+
+/* what simd_*_cull is handed, see rglCullBoxes / rglCullSpheres */
+#define SIMD_CULL_BOXES         0   //[n][6] x y z offsets, x y z lengths
+#define SIMD_CULL_SPHERES       1   //[n][4] x y z centre, radius
+
+GLuint get_cputype();
+GLboolean get_cpummx();
+GLboolean get_cpukatmai();
+GLboolean get_cpusse2();
+GLboolean get_cpuavx2();
+
+#if SIMD_X86
+void simd_sse2_transform_points3(
+    GLuint type, GLuint n, GLfloat* d, GLfloat const* m, GLfloat const* s);
+void simd_avx2_transform_points3(
+    GLuint type, GLuint n, GLfloat* d, GLfloat const* m, GLfloat const* s);
+
+void simd_sse2_project_and_cliptest(
+    GLuint type, GLuint n, GLfloat* d, GLfloat const* m, GLfloat const* s,
+    GLfloat guard, GLubyte* clipmask, GLubyte* ormask, GLubyte* andmask);
+void simd_avx2_project_and_cliptest(
+    GLuint type, GLuint n, GLfloat* d, GLfloat const* m, GLfloat const* s,
+    GLfloat guard, GLubyte* clipmask, GLubyte* ormask, GLubyte* andmask);
+
+void simd_sse2_transform_project_viewport(
+    GLuint type, GLuint n, GLfloat const* mvp, simd_viewport const* vp,
+    GLfloat const* obj, GLfloat* clip, GLfloat* win,
+    GLubyte* clipmask, GLubyte* ormask, GLubyte* andmask);
+void simd_avx2_transform_project_viewport(
+    GLuint type, GLuint n, GLfloat const* mvp, simd_viewport const* vp,
+    GLfloat const* obj, GLfloat* clip, GLfloat* win,
+    GLubyte* clipmask, GLubyte* ormask, GLubyte* andmask);
+
+void simd_sse2_xform_normals(
+    GLuint mode, GLuint n, GLfloat* v, GLfloat const* m, GLfloat const* u,
+    GLfloat scale);
+void simd_avx2_xform_normals(
+    GLuint mode, GLuint n, GLfloat* v, GLfloat const* m, GLfloat const* u,
+    GLfloat scale);
+
+GLuint simd_sse2_cull(
+    GLuint shape, GLuint n, GLfloat const* s, GLfloat const planes[6][4],
+    GLuint* visible);
+GLuint simd_avx2_cull(
+    GLuint shape, GLuint n, GLfloat const* s, GLfloat const planes[6][4],
+    GLuint* visible);
+
+GLsizei simd_sse2_pix_row(
+    GLuint dformat, GLvoid* dst, GLuint sformat, GLvoid const* src, GLsizei width);
+GLsizei simd_avx2_pix_row(
+    GLuint dformat, GLvoid* dst, GLuint sformat, GLvoid const* src, GLsizei width);
+
+GLsizei simd_sse2_pix_lerp(
+    GLubyte* dst, GLubyte const* a, GLubyte const* b, GLsizei n, GLint f);
+GLsizei simd_avx2_pix_lerp(
+    GLubyte* dst, GLubyte const* a, GLubyte const* b, GLsizei n, GLint f);
+GLsizei simd_sse2_pix_accum(
+    GLushort* acc, GLubyte const* row, GLsizei n, GLboolean first);
+GLsizei simd_avx2_pix_accum(
+    GLushort* acc, GLubyte const* row, GLsizei n, GLboolean first);
+GLsizei simd_sse2_pix_average(
+    GLubyte* dst, GLushort const* acc, GLsizei n, GLuint recip, GLuint bias);
+GLsizei simd_avx2_pix_average(
+    GLubyte* dst, GLushort const* acc, GLsizei n, GLuint recip, GLuint bias);
+GLsizei simd_sse2_pix_hlerp4(
+    GLubyte* dst, GLubyte const* row, GLint const* xi, GLushort const* xw, GLsizei n);
+GLsizei simd_sse2_pix_hlerp1(
+    GLubyte* dst, GLubyte const* row, GLint const* xi, GLushort const* xw, GLsizei n);
+void simd_sse2_pix_hbox4(
+    GLubyte* dst, GLubyte const* row, GLint const* xs, GLint const* xn,
+    GLint const* xr, GLint step, GLsizei n);
+GLsizei simd_sse2_pix_expand4444(GLubyte* dst, GLushort const* src, GLsizei n);
+GLsizei simd_sse2_pix_compress4444(GLushort* dst, GLubyte const* src, GLsizei n);
+GLsizei simd_sse2_pix_mip_reduce(
+    GLushort* dst, GLushort const* r0, GLushort const* r1, GLsizei n);
+GLsizei simd_avx2_pix_mip_reduce(
+    GLushort* dst, GLushort const* r0, GLushort const* r1, GLsizei n);
+GLsizei simd_avx2_pix_srgb_decode(
+    GLushort* dst, GLubyte const* src, GLsizei n, GLushort const* table);
+
+GLboolean simd_sse2_viewclip_polygon(
+    GLcontext* ctx, GLuint n, GLuint vlist[], GLuint* nOut);
+
+void simd_sse2_shade_vertices(
+    simd_shade const* sh, GLuint n,
+    GLfloat const* vertex, GLfloat const* normal, GLubyte* color);
+void simd_avx2_shade_vertices(
+    simd_shade const* sh, GLuint n,
+    GLfloat const* vertex, GLfloat const* normal, GLubyte* color);
+#endif
+
+#endif
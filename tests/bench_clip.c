@@ -0,0 +1,132 @@
+/*=============================================================================
+        Name    : bench_clip.c
+        Purpose : gl_viewclip_polygon on the scalar & SSE2 paths, ns per
+                  random 3-8 sided polygon straddling the view volume
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+#include "clip.h"
+
+#define POLYS   1000
+#define SIDES   8
+#define REPS    200
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static GLuint sides[POLYS];
+
+//a convex n-gon in a random plane of clip space, at VB slot first
+static void make_polygon(vertex_buffer* VB, GLuint first, GLuint n, GLfloat spread)
+{
+    GLfloat c[4], a[4], b[4];
+    GLuint i, k;
+
+    for (k = 0; k < 3; k++)
+    {
+        c[k] = test_randf(-1.5f, 1.5f);
+        a[k] = test_randf(-spread, spread);
+        b[k] = test_randf(-spread, spread);
+    }
+    c[3] = 1.0f + test_randf(-0.5f, 0.5f);
+    a[3] = test_randf(-0.3f, 0.3f) * spread;
+    b[3] = test_randf(-0.3f, 0.3f) * spread;
+
+    for (i = 0; i < n; i++)
+    {
+        double th = 2.0 * M_PI * (i + test_randf(-0.3f, 0.3f)) / n;
+        GLuint j = first + i;
+
+        for (k = 0; k < 4; k++)
+        {
+            VB->Clip[j][k] = (GLfloat)(c[k] + a[k] * cos(th) + b[k] * sin(th));
+            VB->Fcolor[j][k] = (GLubyte)test_rand();
+            VB->Bcolor[j][k] = (GLubyte)test_rand();
+        }
+        VB->TexCoord[j][0] = test_randf(-1.0f, 1.0f);
+        VB->TexCoord[j][1] = test_randf(-1.0f, 1.0f);
+        VB->Eye[j][2] = test_randf(-10.0f, 10.0f);
+    }
+}
+
+//ns per polygon, best of a few goes.  *out is the vertices left per polygon
+static double time_clip(GLcontext* ctx, GLboolean sse2, double* out)
+{
+    vertex_buffer* VB = ctx->VB;
+    GLuint list[VB_CLIP_VERTS + SIDES];
+    GLuint go, r, p, i, n, total = 0;
+    double t, best = 1e9;
+
+    ctx->CpuSSE2 = sse2;
+    for (go = 0; go < 5; go++)
+    {
+        total = 0;
+        t = test_now();
+        for (r = 0; r < REPS; r++)
+        {
+            for (p = 0; p < POLYS; p++)
+            {
+                for (i = 0; i < sides[p]; i++)
+                {
+                    list[i] = p * SIDES + i;
+                }
+                VB->Free = VB->Max;
+                n = gl_viewclip_polygon(ctx, sides[p], list);
+                total += n;
+            }
+        }
+        t = test_now() - t;
+        best = (t < best) ? t : best;
+    }
+    *out = (double)total / ((double)REPS * POLYS);
+    return best * 1e9 / ((double)REPS * POLYS);
+}
+
+int main(void)
+{
+    static GLfloat const spreads[2] = { 0.5f, 2.0f };
+    static char const* const sizeNames[2] = { "small", "large" };
+    static GLuint const masks[2] = { 0, CLIP_FCOLOR_BIT | CLIP_TEXTURE_BIT };
+    static char const* const maskNames[2] = { "no aux", "col+tex" };
+    GLcontext* ctx;
+    vertex_buffer* VB;
+    GLboolean sse2;
+    GLuint size, m, p;
+    double scalar, vector, out;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    VB = ctx->VB;
+    sse2 = ctx->CpuSSE2;
+    VB->EyeValid = GL_TRUE;
+
+    printf("%d polygons of 3-%d sides, best of 5, ns per polygon\n", POLYS, SIDES);
+    for (size = 0; size < 2; size++)
+    {
+        for (p = 0; p < POLYS; p++)
+        {
+            sides[p] = 3 + test_rand() % (SIDES - 2);
+            make_polygon(VB, p * SIDES, sides[p], spreads[size]);
+        }
+        for (m = 0; m < 2; m++)
+        {
+            ctx->ClipMask = masks[m];
+            scalar = time_clip(ctx, GL_FALSE, &out);
+            printf("%s, %-7s  scalar %6.1f", sizeNames[size], maskNames[m], scalar);
+            if (sse2)
+            {
+                vector = time_clip(ctx, GL_TRUE, &out);
+                printf("  SSE2 %6.1f", vector);
+            }
+            printf("  (%.1f vertices out)\n", out);
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->ClipMask = 0;
+
+    return test_done();
+}
@@ -0,0 +1,91 @@
+/*=============================================================================
+        Name    : bench_cull.c
+        Purpose : 10K bounding boxes a frame: rglIsClipped one at a time
+                  against rglCullBoxes' C, SSE2 & AVX2 paths
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+DLL unsigned char rglIsClipped(
+    GLfloat* collrectoffset,
+    GLfloat uplength, GLfloat rightlength, GLfloat forwardlength);
+
+#define N 10000
+#define REPS 15
+
+static GLfloat box[N][6];
+static GLuint vis[(N + 31) / 32];
+
+int main(void)
+{
+    static char const* const names[3] = { "C", "SSE2", "AVX2" };
+    GLcontext* ctx;
+    GLuint i, k, r, path, kept = 0, clipped = 0;
+    GLboolean sse2, avx2;
+    double t, best[4];
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+
+    for (i = 0; i < N; i++)
+    {
+        for (k = 0; k < 3; k++)
+        {
+            box[i][k] = test_randf(-200.0f, 200.0f);
+            box[i][k + 3] = test_randf(-30.0f, 30.0f);
+        }
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 300.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslatef(0.0f, 0.0f, -40.0f);
+    rglCullBoxes(N, &box[0][0], NULL, vis);
+
+    for (k = 0; k < 4; k++)
+    {
+        best[k] = 1e9;
+    }
+    for (r = 0; r < REPS; r++)
+    {
+        t = test_now();
+        for (i = 0; i < N; i++)
+        {
+            clipped += rglIsClipped(box[i], box[i][3], box[i][4], box[i][5]);
+        }
+        t = test_now() - t;
+        best[3] = MIN2(best[3], t);
+
+        for (path = 0; path < 3; path++)
+        {
+            if ((path >= 1 && !sse2) || (path == 2 && !avx2))
+            {
+                best[path] = 0.0;
+                continue;
+            }
+            ctx->CpuSSE2 = (GLboolean)(path >= 1);
+            ctx->CpuAVX2 = (GLboolean)(path == 2);
+            t = test_now();
+            kept += rglCullBoxes(N, &box[0][0], NULL, vis);
+            t = test_now() - t;
+            best[path] = MIN2(best[path], t);
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    printf("%d boxes, %u clipped, %u kept\n", N, clipped / REPS, kept / (REPS * 3));
+    printf("rglIsClipped  %8.3f ms\n", best[3] * 1e3);
+    for (path = 0; path < 3; path++)
+    {
+        printf("rglCullBoxes %-4s %5.3f ms\n", names[path], best[path] * 1e3);
+    }
+
+    return test_done();
+}
@@ -0,0 +1,175 @@
+/*=============================================================================
+        Name    : bench_fused.c
+        Purpose : the fused object -> window kernels against the staged
+                  transform, project & viewport passes, ns per vertex at
+                  several batch sizes
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "kvb.h"
+#include "simd.h"
+
+#define N_MAX   8192
+#define VERTS   (1 << 21)
+
+//kvb.c's, which has no header of its own
+void transform_points3(GLcontext* ctx, GLuint n, GLfloat vObj[][4], GLfloat vEye[][4]);
+void project_and_cliptest(GLcontext* ctx, GLuint n, GLfloat vEye[][4], GLfloat vClip[][4],
+                          GLubyte clipMask[], GLubyte* orMask, GLubyte* andMask);
+void viewport_map_vertices(GLcontext* ctx, GLuint n, GLfloat vClip[][4],
+                           GLubyte const clipMask[], GLfloat vWin[][3]);
+
+static GLuint const sizes[] = { 16, 64, 256, 1024, 8192 };
+
+static GLfloat obj[N_MAX][4], eye[N_MAX][4], clip[N_MAX][4], win[N_MAX][3];
+static GLubyte mask[N_MAX];
+
+static void staged(GLcontext* ctx, GLuint n)
+{
+    GLubyte orMask = 0, andMask = CLIP_ALL_BITS;
+
+    memset(mask, 0, n);
+    transform_points3(ctx, n, obj, eye);
+    project_and_cliptest(ctx, n, eye, clip, mask, &orMask, &andMask);
+    viewport_map_vertices(ctx, n, clip, orMask ? mask : NULL, win);
+}
+
+//as transform_project_viewport sets it up
+static void fused(GLcontext* ctx, GLuint n, GLboolean avx2)
+{
+    GLubyte orMask = 0, andMask = CLIP_ALL_BITS;
+    simd_viewport vp;
+
+    memset(mask, 0, n);
+    if (ctx->NewMask & NEW_MVP)
+    {
+        gl_update_mvp();
+    }
+    vp.scale[0] = ctx->Viewport.Sx;
+    vp.offset[0] = ctx->Viewport.Tx;
+    vp.scale[1] = ctx->Viewport.Sy;
+    vp.offset[1] = ctx->Viewport.Ty;
+    vp.scale[2] = ctx->ScaleDepthValues ? ctx->Viewport.Sz : 0.5f;
+    vp.offset[2] = ctx->ScaleDepthValues ? ctx->Viewport.Tz : 0.0f;
+    vp.divide = (GLboolean)!(ctx->ModelViewMatrixType != MATRIX_GENERAL &&
+                             (ctx->ProjectionMatrixType == MATRIX_ORTHO ||
+                              ctx->ProjectionMatrixType == MATRIX_IDENTITY));
+    vp.guard = ctx->GuardBand;
+    if (avx2)
+    {
+        simd_avx2_transform_project_viewport(
+            ctx->ModelViewProjectionMatrixType, n, ctx->ModelViewProjectionMatrix, &vp,
+            &obj[0][0], &clip[0][0], &win[0][0], mask, &orMask, &andMask);
+    }
+    else
+    {
+        simd_sse2_transform_project_viewport(
+            ctx->ModelViewProjectionMatrixType, n, ctx->ModelViewProjectionMatrix, &vp,
+            &obj[0][0], &clip[0][0], &win[0][0], mask, &orMask, &andMask);
+    }
+}
+
+//ns per vertex, best of a few goes at VERTS vertices each
+static double time_path(GLcontext* ctx, GLuint n, GLboolean fuse, GLboolean avx2)
+{
+    GLuint go, r, reps = VERTS / n;
+    double t, best = 1e9;
+
+    ctx->CpuAVX2 = avx2;
+    for (go = 0; go < 5; go++)
+    {
+        t = test_now();
+        for (r = 0; r < reps; r++)
+        {
+            if (fuse)
+            {
+                fused(ctx, n, avx2);
+            }
+            else
+            {
+                staged(ctx, n);
+            }
+        }
+        t = test_now() - t;
+        best = (t < best) ? t : best;
+    }
+    return best * 1e9 / ((double)reps * n);
+}
+
+int main(void)
+{
+    static char const* const sceneNames[3] = { "3d x perspective", "3d x ortho", "general x perspective" };
+    GLcontext* ctx;
+    GLboolean sse2, avx2;
+    GLuint scene, s, i;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+    if (!sse2)
+    {
+        printf("no SSE2, no fused path\n");
+        return test_done();
+    }
+
+    for (i = 0; i < N_MAX; i++)
+    {
+        obj[i][0] = test_randf(-115.0f, 115.0f);
+        obj[i][1] = test_randf(-100.0f, 100.0f);
+        obj[i][2] = test_randf(-100.0f, 100.0f);
+        obj[i][3] = 1.0f;
+    }
+
+    printf("ns per vertex, staged -> fused\n");
+    for (scene = 0; scene < 3; scene++)
+    {
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        if (scene != 1)
+        {
+            glTranslatef(0.0f, 0.0f, -300.0f);
+        }
+        glRotatef(30.0f, 0.3f, 1.0f, 0.2f);
+        if (scene == 2)
+        {
+            //a projective modelview, as some effects load
+            GLfloat m[16] = { 1.0f, 0.0f, 0.0f, 0.001f, 0.0f, 1.0f, 0.0f, 0.0f,
+                              0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+            glMultMatrixf(m);
+        }
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        if (scene == 1)
+        {
+            glOrtho(-150.0, 150.0, -100.0, 100.0, -500.0, 500.0);
+        }
+        else
+        {
+            glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 1000.0);
+        }
+        gl_update_modelview();
+        gl_update_projection();
+
+        printf("%s\n", sceneNames[scene]);
+        for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+        {
+            printf("  n %5u  SSE2 %6.3f -> %6.3f", sizes[s],
+                   time_path(ctx, sizes[s], GL_FALSE, GL_FALSE),
+                   time_path(ctx, sizes[s], GL_TRUE, GL_FALSE));
+            if (avx2)
+            {
+                printf("  AVX2 %6.3f -> %6.3f",
+                       time_path(ctx, sizes[s], GL_FALSE, GL_TRUE),
+                       time_path(ctx, sizes[s], GL_TRUE, GL_TRUE));
+            }
+            printf("\n");
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    return test_done();
+}
@@ -0,0 +1,127 @@
+/*=============================================================================
+        Name    : bench_light.c
+        Purpose : the lighting shaders at 8192 vertices on the scalar, SSE2
+                  & AVX2 paths, 1-3 directional & positional lights
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+
+#define N       8192
+#define REPS    100
+
+//kvb.c's, which has no header of its own
+void gl_color_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+void gl_fast_color_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+
+static char const* const pathNames[3] = { "scalar", "SSE2", "AVX2" };
+
+static GLfloat vertex[N][4], normal[N][3];
+static GLubyte color[N][4];
+
+static void lights(GLcontext* ctx, GLuint count, GLboolean positional)
+{
+    GLfloat p[4];
+    GLuint i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (i < count)
+        {
+            glEnable(GL_LIGHT0 + i);
+        }
+        else
+        {
+            glDisable(GL_LIGHT0 + i);
+        }
+        p[0] = positional ? 10.0f + i * 40.0f : 0.3f - i * 0.4f;
+        p[1] = positional ? 20.0f - i * 30.0f : 0.5f;
+        p[2] = positional ? -30.0f - i * 50.0f : 1.0f;
+        p[3] = positional ? 1.0f : 0.0f;
+        glLightfv(GL_LIGHT0 + i, GL_POSITION, p);
+        ctx->Light[i].ConstantAttenuation = 1.0f;
+        ctx->Light[i].LinearAttenuation = 0.002f * i;
+    }
+    gl_update_lighting(ctx);
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLboolean sse2, avx2, fast;
+    GLuint i, count, positional, path, r;
+    GLfloat x, y, z, l;
+    double t, best;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+
+    for (i = 0; i < N; i++)
+    {
+        x = test_randf(-1.0f, 1.0f);
+        y = test_randf(-1.0f, 1.0f);
+        z = test_randf(-1.0f, 1.0f);
+        l = (GLfloat)sqrt(x * x + y * y + z * z);
+        normal[i][0] = x / l;
+        normal[i][1] = y / l;
+        normal[i][2] = z / l;
+        vertex[i][0] = test_randf(-100.0f, 100.0f);
+        vertex[i][1] = test_randf(-100.0f, 100.0f);
+        vertex[i][2] = test_randf(-300.0f, 0.0f);
+        vertex[i][3] = 1.0f;
+    }
+    glEnable(GL_LIGHTING);
+
+    printf("%d vertices, best of %d, microseconds\n", N, REPS);
+    for (fast = 0; fast < 2; fast++)
+    {
+        for (count = 1; count <= 3; count++)
+        {
+            for (positional = 0; positional < 2; positional++)
+            {
+                //the fast shader treats every light as directional
+                if (fast && positional)
+                {
+                    continue;
+                }
+                lights(ctx, count, (GLboolean)positional);
+                printf("%u %-11s %-7s", count, positional ? "positional" : "directional",
+                       fast ? "fast" : "general");
+                for (path = 0; path < 3; path++)
+                {
+                    if ((path >= 1 && !sse2) || (path == 2 && !avx2))
+                    {
+                        continue;
+                    }
+                    ctx->CpuSSE2 = (GLboolean)(path >= 1);
+                    ctx->CpuAVX2 = (GLboolean)(path == 2);
+                    best = 1e9;
+                    for (r = 0; r < REPS; r++)
+                    {
+                        t = test_now();
+                        if (fast)
+                        {
+                            gl_fast_color_shade_vertices(ctx, 0, N, vertex, normal, color);
+                        }
+                        else
+                        {
+                            gl_color_shade_vertices(ctx, 0, N, vertex, normal, color);
+                        }
+                        t = test_now() - t;
+                        best = (t < best) ? t : best;
+                    }
+                    printf("  %s %6.1f", pathNames[path], best * 1e6);
+                }
+                printf("\n");
+            }
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    return test_done();
+}
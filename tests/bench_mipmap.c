@@ -0,0 +1,70 @@
+/*=============================================================================
+        Name    : bench_mipmap.c
+        Purpose : pix_mipmap throughput, level 0 MB/s for a square texture's
+                  whole chain on the C, SSE2 & AVX2 paths
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "pixconv.h"
+
+int main(void)
+{
+    static GLsizei const sizes[] = { 256, 1024, 2048 };
+    static char const* const paths[3] = { "C", "SSE2", "AVX2" };
+
+    GLcontext* ctx;
+    GLboolean sse2, avx2;
+    pix_arena arena = { NULL, 0 };
+    GLubyte *image, *chain;
+    GLuint s, path, r, reps;
+    GLsizei w, k;
+    double t, mb;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        w = sizes[s];
+        mb = 4.0 * w * w / 1048576.0;
+        reps = (w >= 2048) ? 5 : (w >= 1024) ? 20 : 300;
+        image = (GLubyte*)malloc(4 * w * w);
+        chain = (GLubyte*)malloc(pix_mip_bytes(w, w, NULL));
+        for (k = 0; k < 4 * w * w; k++)
+        {
+            image[k] = (GLubyte)test_rand();
+        }
+
+        printf("%4dx%-4d", w, w);
+        for (path = 0; path < 3; path++)
+        {
+            if ((path >= 1 && !sse2) || (path == 2 && !avx2))
+            {
+                continue;
+            }
+            ctx->CpuSSE2 = (GLboolean)(path >= 1);
+            ctx->CpuAVX2 = (GLboolean)(path == 2);
+            //once to size the arena
+            pix_mipmap(chain, image, w, w, &arena);
+            t = test_now();
+            for (r = 0; r < reps; r++)
+            {
+                pix_mipmap(chain, image, w, w, &arena);
+            }
+            t = (test_now() - t) / reps;
+            printf("  %s %5.2f ms/MB %5.0f MB/s", paths[path], t * 1e3 / mb, mb / t);
+        }
+        printf("\n");
+        free(image);
+        free(chain);
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    pix_arena_free(&arena);
+    return test_done();
+}
@@ -0,0 +1,142 @@
+/*=============================================================================
+        Name    : bench_mvp.c
+        Purpose : the cached modelview-projection product, on its own & in a
+                  UI frame (ortho, a translate per widget) and a ship frame
+                  (perspective, a push / place / draw / pop per ship)
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+#define REPS        1000000
+#define FRAMES      200
+#define WIDGETS     200
+#define WIDGET_QUADS 8
+#define SHIPS       100
+#define SHIP_TRIS   200
+
+static GLfloat shipTris[SHIP_TRIS * 3][3];
+
+//ns per gl_update_mvp, after whatever leaves NEW_MVP as dirty
+static double time_update(GLcontext* ctx, GLboolean dirty)
+{
+    GLuint r;
+    double t;
+
+    t = test_now();
+    for (r = 0; r < REPS; r++)
+    {
+        if (dirty)
+        {
+            ctx->NewMask |= NEW_MVP;
+        }
+        gl_update_mvp();
+    }
+    return (test_now() - t) * 1e9 / REPS;
+}
+
+//status text & buttons: a short run of quads per widget
+static void ui_frame(void)
+{
+    GLuint w, q;
+    GLfloat x;
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0.0, 640.0, 480.0, 0.0, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    for (w = 0; w < WIDGETS; w++)
+    {
+        glPushMatrix();
+        glTranslatef((GLfloat)(w % 20) * 30.0f, (GLfloat)(w / 20) * 40.0f, 0.0f);
+        glBegin(GL_QUADS);
+        for (q = 0; q < WIDGET_QUADS; q++)
+        {
+            x = (GLfloat)q * 3.0f;
+            glVertex2f(x, 0.0f);
+            glVertex2f(x + 3.0f, 0.0f);
+            glVertex2f(x + 3.0f, 8.0f);
+            glVertex2f(x, 8.0f);
+        }
+        glEnd();
+        glPopMatrix();
+    }
+}
+
+//every ship placed & turned on its own, then drawn through the fused pass
+static void ship_frame(void)
+{
+    GLuint s, v;
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 5000.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslatef(0.0f, 0.0f, -800.0f);
+    for (s = 0; s < SHIPS; s++)
+    {
+        glPushMatrix();
+        glTranslatef((GLfloat)(s % 10) * 60.0f - 300.0f, (GLfloat)(s / 10) * 50.0f - 250.0f, 0.0f);
+        glRotatef((GLfloat)s * 7.0f, 0.2f, 1.0f, 0.1f);
+        glBegin(GL_TRIANGLES);
+        for (v = 0; v < SHIP_TRIS * 3; v++)
+        {
+            glVertex3fv(shipTris[v]);
+        }
+        glEnd();
+        glPopMatrix();
+    }
+}
+
+static void time_frames(char const* name, void (*frame)(void), GLuint draws, GLuint verts)
+{
+    GLuint f;
+    double t;
+
+    frame();
+    glFlush();
+    t = test_now();
+    for (f = 0; f < FRAMES; f++)
+    {
+        frame();
+        glFlush();
+    }
+    t = (test_now() - t) / FRAMES;
+    printf("%-5s frame %7.1f us, %4u draws, %6u vertices, %5.1f ns per vertex\n",
+           name, t * 1e6, draws, verts, t * 1e9 / verts);
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLuint i;
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    for (i = 0; i < SHIP_TRIS * 3; i++)
+    {
+        shipTris[i][0] = test_randf(-20.0f, 20.0f);
+        shipTris[i][1] = test_randf(-20.0f, 20.0f);
+        shipTris[i][2] = test_randf(-20.0f, 20.0f);
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 5000.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslatef(0.0f, 0.0f, -800.0f);
+    glRotatef(30.0f, 0.2f, 1.0f, 0.1f);
+    gl_update_modelview();
+    gl_update_projection();
+    printf("gl_update_mvp: cached %.1f ns, rebuilt %.1f ns\n",
+           time_update(ctx, GL_FALSE), time_update(ctx, GL_TRUE));
+
+    time_frames("ui", ui_frame, WIDGETS, WIDGETS * WIDGET_QUADS * 4);
+    time_frames("ships", ship_frame, SHIPS, SHIPS * SHIP_TRIS * 3);
+
+    return test_done();
+}
@@ -0,0 +1,79 @@
+/*=============================================================================
+        Name    : bench_pixconv.c
+        Purpose : pix_convert throughput on a 1024x1024 texture, source MB/s
+                  for each conversion the drivers do on the C, SSE2 & AVX2
+                  paths
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "pixconv.h"
+
+#define SIZE 1024
+#define REPS 15
+
+int main(void)
+{
+    static char const* const names[PIX_FORMATS] =
+        { "RGBA", "ARGB8888", "XRGB8888", "RGB565", "XRGB1555", "ARGB4444", "INDEX8", "L8" };
+    static char const* const paths[3] = { "C", "SSE2", "AVX2" };
+    static GLuint const sformats[2] = { PIX_RGBA, PIX_ARGB4444 };
+
+    GLcontext* ctx;
+    GLboolean sse2, avx2;
+    GLubyte *src, *dst;
+    GLuint s, sformat, dformat, path, r, i;
+    double t, best;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+
+    src = (GLubyte*)malloc(SIZE * SIZE * 4);
+    dst = (GLubyte*)malloc(SIZE * SIZE * 4);
+    for (i = 0; i < SIZE * SIZE * 4; i++)
+    {
+        src[i] = (GLubyte)test_rand();
+    }
+
+    for (s = 0; s < 2; s++)
+    {
+        sformat = sformats[s];
+        for (dformat = PIX_ARGB8888; dformat <= PIX_ARGB4444; dformat++)
+        {
+            if (dformat == sformat)
+            {
+                continue;
+            }
+            printf("%-9s -> %-9s", names[sformat], names[dformat]);
+            for (path = 0; path < 3; path++)
+            {
+                if ((path >= 1 && !sse2) || (path == 2 && !avx2))
+                {
+                    continue;
+                }
+                ctx->CpuSSE2 = (GLboolean)(path >= 1);
+                ctx->CpuAVX2 = (GLboolean)(path == 2);
+                best = 1e9;
+                for (r = 0; r < REPS; r++)
+                {
+                    t = test_now();
+                    pix_convert(dformat, dst, SIZE * pix_bytes(dformat),
+                                sformat, src, SIZE * pix_bytes(sformat), SIZE, SIZE);
+                    t = test_now() - t;
+                    best = MIN2(best, t);
+                }
+                printf("  %s %6.0f MB/s", paths[path], SIZE * SIZE * pix_bytes(sformat) / best / 1.0e6);
+            }
+            printf("\n");
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    free(src);
+    free(dst);
+    return test_done();
+}
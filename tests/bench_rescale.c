@@ -0,0 +1,89 @@
+/*=============================================================================
+        Name    : bench_rescale.c
+        Purpose : pix_rescale throughput, source MB/s for the box & bilinear
+                  filters on the C, SSE2 & AVX2 paths, at the sizes texture
+                  uploads get resized between
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "pixconv.h"
+
+#define REPS 9
+
+int main(void)
+{
+    static GLsizei const cases[][5] =
+    {
+        { PIX_RGBA, 1024, 1024, 512, 512 },
+        { PIX_RGBA, 512, 512, 1024, 1024 },
+        { PIX_ARGB4444, 1024, 1024, 512, 512 },
+        { PIX_L8, 1024, 1024, 512, 512 },
+        { PIX_L8, 512, 512, 1024, 1024 },
+        { PIX_RGBA, 1024, 256, 256, 256 }
+    };
+    static char const* const paths[3] = { "C", "SSE2", "AVX2" };
+
+    GLcontext* ctx;
+    GLboolean sse2, avx2;
+    pix_arena arena = { NULL, 0 };
+    GLuint c, filter, path, r, format, bytes;
+    GLsizei sw, sh, dw, dh, i;
+    GLubyte *src, *dst;
+    double t, best;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+
+    for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        format = (GLuint)cases[c][0];
+        sw = cases[c][1];
+        sh = cases[c][2];
+        dw = cases[c][3];
+        dh = cases[c][4];
+        bytes = pix_bytes(format);
+        src = (GLubyte*)malloc(sw * sh * bytes);
+        dst = (GLubyte*)malloc(dw * dh * bytes);
+        for (i = 0; i < (GLsizei)(sw * sh * bytes); i++)
+        {
+            src[i] = (GLubyte)test_rand();
+        }
+
+        for (filter = PIX_BOX; filter <= PIX_BILINEAR; filter++)
+        {
+            printf("%-8s %4dx%-4d -> %4dx%-4d %-8s", (format == PIX_RGBA) ? "RGBA" :
+                   (format == PIX_L8) ? "L8" : "ARGB4444", sw, sh, dw, dh,
+                   (filter == PIX_BOX) ? "box" : "bilinear");
+            for (path = 0; path < 3; path++)
+            {
+                if ((path >= 1 && !sse2) || (path == 2 && !avx2))
+                {
+                    continue;
+                }
+                ctx->CpuSSE2 = (GLboolean)(path >= 1);
+                ctx->CpuAVX2 = (GLboolean)(path == 2);
+                best = 1e9;
+                for (r = 0; r < REPS; r++)
+                {
+                    t = test_now();
+                    pix_rescale(format, filter, dst, dw, dh, src, sw, sh, &arena);
+                    t = test_now() - t;
+                    best = MIN2(best, t);
+                }
+                printf("  %s %6.0f MB/s", paths[path], (double)sw * sh * bytes / best / 1.0e6);
+            }
+            printf("\n");
+        }
+        free(src);
+        free(dst);
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    pix_arena_free(&arena);
+    return test_done();
+}
@@ -0,0 +1,92 @@
+/*=============================================================================
+        Name    : bench_specpow.c
+        Purpose : the three spechack passes at 8192 vertices in each
+                  rglSpecPow mode, default exponents & two lights
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+
+#define N       8192
+#define REPS    200
+
+//kvb.c's, which has no header of its own
+void gl_spechack_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+void gl_spechack2_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+void gl_spechack3_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+
+static char const* const modeNames[3] = { "exact", "table", "approx" };
+static GLint const modes[3] = { RGL_SPECPOW_EXACT, RGL_SPECPOW_TABLE, RGL_SPECPOW_APPROX };
+
+static GLfloat vertex[N][4], normal[N][3];
+static GLubyte color[N][4];
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLfloat pos0[4] = { 0.3f, 0.2f, 1.0f, 0.0f };
+    GLfloat pos1[4] = { -0.5f, 0.2f, 1.0f, 0.0f };
+    GLfloat x, y, z, l;
+    GLuint i, pass, m, r;
+    double t, best;
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    for (i = 0; i < N; i++)
+    {
+        x = test_randf(-1.0f, 1.0f);
+        y = test_randf(-1.0f, 1.0f);
+        z = test_randf(0.0f, 1.0f);
+        l = (GLfloat)sqrt(x * x + y * y + z * z);
+        normal[i][0] = x / l;
+        normal[i][1] = y / l;
+        normal[i][2] = z / l;
+        vertex[i][0] = x * 100.0f;
+        vertex[i][1] = y * 100.0f;
+        vertex[i][2] = -200.0f - z * 50.0f;
+        vertex[i][3] = 1.0f;
+    }
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glLightfv(GL_LIGHT0, GL_POSITION, pos0);
+    glEnable(GL_LIGHT1);
+    glLightfv(GL_LIGHT1, GL_POSITION, pos1);
+    gl_update_lighting(ctx);
+
+    printf("%d vertices, best of %d, microseconds\n", N, REPS);
+    for (pass = 0; pass < 3; pass++)
+    {
+        printf("spechack%u", pass + 1);
+        for (m = 0; m < 3; m++)
+        {
+            rglSpecPow(modes[m]);
+            best = 1e9;
+            for (r = 0; r < REPS; r++)
+            {
+                memset(color, 255, sizeof(color));
+                t = test_now();
+                switch (pass)
+                {
+                case 0:
+                    gl_spechack_shade_vertices(ctx, 0, N, vertex, normal, color);
+                    break;
+                case 1:
+                    gl_spechack2_shade_vertices(ctx, 0, N, vertex, normal, color);
+                    break;
+                default:
+                    gl_spechack3_shade_vertices(ctx, 0, N, vertex, normal, color);
+                }
+                t = test_now() - t;
+                best = (t < best) ? t : best;
+            }
+            printf("  %s %7.1f", modeNames[m], best * 1e6);
+        }
+        printf("\n");
+    }
+    rglSpecPow(RGL_SPECPOW_TABLE);
+
+    return test_done();
+}
@@ -0,0 +1,82 @@
+/*=============================================================================
+        Name    : bench_sqrt.c
+        Purpose : ns per call of fsqrt, fsqrtf & frsqrt against libm, for
+                  whichever engine is built in (RGL_SQRT_TABLE)
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+#include "maths.h"
+
+#define N       4096
+#define PASSES  2000
+
+static GLfloat in[N];
+static volatile GLfloat sink;
+
+typedef GLfloat (*sqrt_func)(GLfloat);
+
+static GLfloat call_fsqrt(GLfloat x)
+{
+    return (GLfloat)fsqrt(x);
+}
+
+static GLfloat call_libm_sqrt(GLfloat x)
+{
+    return sqrtf(x);
+}
+
+static GLfloat call_libm_rsqrt(GLfloat x)
+{
+    return 1.0f / sqrtf(x);
+}
+
+//best of 5, ns per call
+static double time_func(sqrt_func f)
+{
+    double best = 1.0e9, t;
+    GLfloat sum;
+    GLuint rep, pass, i;
+
+    for (rep = 0; rep < 5; rep++)
+    {
+        sum = 0.0f;
+        t = test_now();
+        for (pass = 0; pass < PASSES; pass++)
+        {
+            for (i = 0; i < N; i++)
+            {
+                sum += f(in[i]);
+            }
+        }
+        t = test_now() - t;
+        sink = sum;
+        if (t < best)
+        {
+            best = t;
+        }
+    }
+    return best * 1.0e9 / ((double)N * (double)PASSES);
+}
+
+int main(void)
+{
+    GLuint i;
+
+    test_init();
+    for (i = 0; i < N; i++)
+    {
+        in[i] = test_randf(1.0e-2f, 1.0e2f);
+    }
+
+    printf("fsqrt engine: %s\n", RGL_SQRT_TABLE ? "table" : "libm / rsqrt");
+    printf("fsqrt        %5.2f ns\n", time_func(call_fsqrt));
+    printf("fsqrtf       %5.2f ns\n", time_func(fsqrtf));
+    printf("frsqrt       %5.2f ns\n", time_func(frsqrt));
+    printf("libm sqrtf   %5.2f ns\n", time_func(call_libm_sqrt));
+    printf("libm 1/sqrtf %5.2f ns\n", time_func(call_libm_rsqrt));
+
+    return test_done();
+}
@@ -0,0 +1,79 @@
+/*=============================================================================
+        Name    : bench_textures.c
+        Purpose : texture object bookkeeping at 1K to 50K textures: naming,
+                  binding, the walk every texture reload does, & deletion
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "hash.h"
+
+#define BIND_PASSES 20
+#define WALK_PASSES 100
+
+int main(void)
+{
+    static GLsizei const counts[] = { 1000, 10000, 50000 };
+    GLubyte texel[4] = { 255, 255, 255, 255 };
+    GLuint* names;
+    GLuint c, i, pass;
+    GLsizei n;
+    double t, tGen, tBind, tWalk, tDel;
+    size_t sum = 0;
+
+    test_init();
+
+    for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        n = counts[c];
+        names = (GLuint*)malloc(n * sizeof(GLuint));
+
+        //name & create them
+        t = test_now();
+        glGenTextures(n, names);
+        for (i = 0; i < (GLuint)n; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, names[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+        }
+        tGen = test_now() - t;
+
+        //bind in a scattered order, as a frame's draws do
+        t = test_now();
+        for (pass = 0; pass < BIND_PASSES; pass++)
+        {
+            for (i = 0; i < (GLuint)n; i++)
+            {
+                glBindTexture(GL_TEXTURE_2D, names[(i * 7919u) % n]);
+            }
+        }
+        tBind = (test_now() - t) / BIND_PASSES;
+
+        //every texture object, as a reload or shutdown walks them
+        t = test_now();
+        for (pass = 0; pass < WALK_PASSES; pass++)
+        {
+            hashtable* objs = rglGetTexobjs();
+            for (i = 0; i < HASH_COUNT(objs); i++)
+            {
+                sum += (size_t)HASH_DATA(objs, i);
+            }
+        }
+        tWalk = (test_now() - t) / WALK_PASSES;
+
+        t = test_now();
+        glDeleteTextures(n, names);
+        tDel = test_now() - t;
+
+        printf("%6d textures: create %6.1f ns  bind %5.1f ns  walk %7.1f us  delete %6.1f ns\n",
+               n, tGen * 1.0e9 / n, tBind * 1.0e9 / n, tWalk * 1.0e6, tDel * 1.0e9 / n);
+        free(names);
+    }
+    if (sum == 1)
+    {
+        printf("\n");
+    }
+
+    return test_done();
+}
@@ -0,0 +1,104 @@
+/*=============================================================================
+        Name    : bench_upload.c
+        Purpose : glTexImage2D over a Homeworld sized texture set, with the
+                  GL keeping its own copy of every image and without
+                  (RGL_TEXTURE_RETAIN off, zero-copy)
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+#define NTEX 640
+#define REPS 10
+
+/* mostly paletted ship & effect textures, RGBA backgrounds & effects,
+   RGBA16 UI pages and a few RGB */
+typedef struct
+{
+    GLenum   format;
+    GLsizei  width, height;
+    GLubyte* texels;
+} upload;
+
+static upload set[NTEX];
+static GLubyte palette[1024];
+
+static GLsizei upload_bytes(upload const* u)
+{
+    GLsizei bpp = (u->format == GL_COLOR_INDEX) ? 1 : (u->format == GL_RGBA16) ? 2 :
+                  (u->format == GL_RGB) ? 3 : 4;
+    return u->width * u->height * bpp;
+}
+
+int main(void)
+{
+    static GLsizei const sizes[8] = { 16, 32, 64, 64, 128, 128, 256, 256 };
+    GLuint names[NTEX];
+    GLuint i, r, mode;
+    GLsizei k;
+    upload* u;
+    double total = 0.0, t, best;
+
+    test_init();
+    for (k = 0; k < 1024; k++)
+    {
+        palette[k] = (GLubyte)test_rand();
+    }
+    for (i = 0; i < NTEX; i++)
+    {
+        u = &set[i];
+        r = test_rand() % 100;
+        u->format = (r < 50) ? GL_COLOR_INDEX : (r < 80) ? GL_RGBA : (r < 95) ? GL_RGBA16 : GL_RGB;
+        u->width = sizes[test_rand() % 8];
+        u->height = sizes[test_rand() % 8];
+        u->texels = (GLubyte*)malloc(upload_bytes(u));
+        for (k = 0; k < upload_bytes(u); k++)
+        {
+            u->texels[k] = (GLubyte)test_rand();
+        }
+        total += upload_bytes(u);
+    }
+    printf("%d textures, %.1f MB of texels\n", NTEX, total / 1048576.0);
+
+    glGenTextures(NTEX, names);
+    for (mode = 0; mode < 2; mode++)
+    {
+        if (mode == 0)
+        {
+            rglEnable(RGL_TEXTURE_RETAIN);
+        }
+        else
+        {
+            rglDisable(RGL_TEXTURE_RETAIN);
+        }
+        best = 1e9;
+        for (r = 0; r < REPS; r++)
+        {
+            t = test_now();
+            for (i = 0; i < NTEX; i++)
+            {
+                u = &set[i];
+                glBindTexture(GL_TEXTURE_2D, names[i]);
+                if (u->format == GL_COLOR_INDEX)
+                {
+                    glColorTable(GL_TEXTURE_2D, GL_RGBA, 256, GL_RGBA, GL_UNSIGNED_BYTE, palette);
+                }
+                glTexImage2D(GL_TEXTURE_2D, 0, u->format, u->width, u->height, 0,
+                             u->format, GL_UNSIGNED_BYTE, u->texels);
+            }
+            t = test_now() - t;
+            best = MIN2(best, t);
+        }
+        printf("%-9s %7.2f ms %6.0f MB/s, kept %.1f MB\n", (mode == 0) ? "retained" : "zero-copy",
+               best * 1e3, total / 1048576.0 / best, rglRetainedTextureBytes() / 1048576.0);
+    }
+    rglEnable(RGL_TEXTURE_RETAIN);
+
+    glDeleteTextures(NTEX, names);
+    for (i = 0; i < NTEX; i++)
+    {
+        free(set[i].texels);
+    }
+    return test_done();
+}
@@ -0,0 +1,151 @@
+/*=============================================================================
+        Name    : bench_xform.c
+        Purpose : transform_points3 & project_and_cliptest, ns per vertex
+                  for each matrix & projection type on the C, SSE2 & AVX2
+                  paths
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+#define N       1024
+#define REPS    2000
+
+//kvb.c's, which has no header of its own
+void transform_points3(GLcontext* ctx, GLuint n, GLfloat vObj[][4], GLfloat vEye[][4]);
+void project_and_cliptest(GLcontext* ctx, GLuint n, GLfloat vEye[][4], GLfloat vClip[][4],
+                          GLubyte clipMask[], GLubyte* orMask, GLubyte* andMask);
+
+static char const* const typeNames[8] =
+    { "", "identity", "2d no rot", "2d", "3d", "general", "ortho", "perspective" };
+static char const* const pathNames[3] = { "C", "SSE2", "AVX2" };
+
+static GLfloat obj[N][4], eye[N][4], clip[N][4];
+static GLubyte mask[N];
+
+//the GL's own matrix & type for each kind
+static void load(GLuint type)
+{
+    glLoadIdentity();
+    switch (type)
+    {
+    case MATRIX_2D_NO_ROT:
+        glTranslatef(3.0f, 2.0f, 0.0f);
+        glScalef(2.0f, 0.5f, 1.0f);
+        break;
+    case MATRIX_2D:
+        glTranslatef(3.0f, 2.0f, 0.0f);
+        glRotatef(30.0f, 0.0f, 0.0f, 1.0f);
+        break;
+    case MATRIX_3D:
+        glTranslatef(3.0f, 2.0f, -10.0f);
+        glRotatef(30.0f, 1.0f, 1.0f, 0.0f);
+        break;
+    case MATRIX_GENERAL:
+        glFrustum(-1.0, 1.0, -1.0, 1.0, 1.0, 100.0);
+        glRotatef(30.0f, 1.0f, 1.0f, 0.0f);
+        break;
+    case MATRIX_ORTHO:
+        glOrtho(-4.0, 4.0, -3.0, 3.0, -10.0, 10.0);
+        break;
+    case MATRIX_PERSPECTIVE:
+        glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 100.0);
+        break;
+    }
+}
+
+static GLboolean select_path(GLcontext* ctx, GLuint path, GLboolean sse2, GLboolean avx2)
+{
+    if ((path >= 1 && !sse2) || (path == 2 && !avx2))
+    {
+        return GL_FALSE;
+    }
+    ctx->CpuSSE2 = (GLboolean)(path >= 1);
+    ctx->CpuAVX2 = (GLboolean)(path == 2);
+    return GL_TRUE;
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLboolean sse2, avx2;
+    GLuint type, path, r, i;
+    GLubyte orMask, andMask;
+    double t;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+
+    for (i = 0; i < N; i++)
+    {
+        obj[i][0] = test_randf(-5.0f, 5.0f);
+        obj[i][1] = test_randf(-5.0f, 5.0f);
+        obj[i][2] = test_randf(-50.0f, -2.0f);
+        obj[i][3] = 1.0f;
+    }
+
+    printf("%d vertices, ns per vertex\n", N);
+    for (type = MATRIX_IDENTITY; type <= MATRIX_GENERAL; type++)
+    {
+        glMatrixMode(GL_MODELVIEW);
+        load(type);
+        gl_update_modelview();
+        printf("transform_points3    %-11s", typeNames[ctx->ModelViewMatrixType]);
+        for (path = 0; path < 3; path++)
+        {
+            if (!select_path(ctx, path, sse2, avx2))
+            {
+                continue;
+            }
+            t = test_now();
+            for (r = 0; r < REPS; r++)
+            {
+                transform_points3(ctx, N, obj, eye);
+            }
+            t = test_now() - t;
+            printf("  %s %6.3f", pathNames[path], t * 1e9 / ((double)N * REPS));
+        }
+        printf("\n");
+    }
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    gl_update_modelview();
+    transform_points3(ctx, N, obj, eye);
+    for (type = MATRIX_IDENTITY; type <= MATRIX_PERSPECTIVE; type++)
+    {
+        if (type > MATRIX_IDENTITY && type < MATRIX_GENERAL)
+        {
+            continue;
+        }
+        glMatrixMode(GL_PROJECTION);
+        load(type);
+        gl_update_projection();
+        printf("project_and_cliptest %-11s", typeNames[ctx->ProjectionMatrixType]);
+        for (path = 0; path < 3; path++)
+        {
+            if (!select_path(ctx, path, sse2, avx2))
+            {
+                continue;
+            }
+            t = test_now();
+            for (r = 0; r < REPS; r++)
+            {
+                orMask = 0;
+                andMask = CLIP_ALL_BITS;
+                memset(mask, 0, sizeof(mask));
+                project_and_cliptest(ctx, N, eye, clip, mask, &orMask, &andMask);
+            }
+            t = test_now() - t;
+            printf("  %s %6.3f", pathNames[path], t * 1e9 / ((double)N * REPS));
+        }
+        printf("\n");
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    return test_done();
+}
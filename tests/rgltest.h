@@ -0,0 +1,116 @@
+/*=============================================================================
+        Name    : rgltest.h
+        Purpose : what the tests & benchmarks share: a context on the null
+                  driver, checks that count failures rather than stop, and
+                  a timer.  each test is one .c, so everything here is
+                  static inline: a test that doesn't use a helper doesn't
+                  warn about it
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#ifndef _RGLTEST_H
+#define _RGLTEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kgl.h"
+#include "nulldrv.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static int testFailures = 0;
+
+//count a failure, with where and why, and carry on
+#define TEST_CHECK(c, ...) \
+    do \
+    { \
+        if (!(c)) \
+        { \
+            printf("%s:%d: FAIL %s: ", __FILE__, __LINE__, #c); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            testFailures++; \
+        } \
+    } while (0)
+
+//the GL's allocations come back full of 0xA5, so a read of memory nobody
+//wrote shows up as garbage rather than the zeroes a fresh page would have
+static inline void* test_alloc(GLint bytes, char* name, GLuint flags)
+{
+    void* p = malloc((size_t)bytes);
+    (void)name;
+    (void)flags;
+    if (p != NULL)
+    {
+        memset(p, 0xA5, (size_t)bytes);
+    }
+    return p;
+}
+
+static inline GLint test_free(void* p)
+{
+    free(p);
+    return 0;
+}
+
+//a 640x480 context on the null driver
+static inline void test_init(void)
+{
+    rglSetAllocs(test_alloc, test_free);
+    rglSelectDevice(NULL_DEVICE_NAME, "");
+    if (!rauxInitPosition(0, 0, 640, 480, 32))
+    {
+        printf("FAIL: couldn't make a null driver context\n");
+        exit(1);
+    }
+}
+
+//shut the context down & report.  returns main's exit code
+static inline int test_done(void)
+{
+    rglFeature(RGL_SHUTDOWN);
+    printf("%s (%d failures)\n", (testFailures == 0) ? "ok" : "FAILED", testFailures);
+    return (testFailures == 0) ? 0 : 1;
+}
+
+//seconds, from some fixed point
+static inline double test_now(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (freq.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + 1.0e-9 * (double)t.tv_nsec;
+#endif
+}
+
+//a repeatable stream of pseudo random numbers, the same on every platform
+static GLuint testSeed = 1;
+
+static inline GLuint test_rand(void)
+{
+    testSeed = testSeed * 1664525u + 1013904223u;
+    return testSeed >> 8;
+}
+
+//uniform in [lo, hi)
+static inline GLfloat test_randf(GLfloat lo, GLfloat hi)
+{
+    return lo + (hi - lo) * (GLfloat)(test_rand() & 0xFFFF) / 65536.0f;
+}
+
+#endif
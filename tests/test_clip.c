@@ -0,0 +1,139 @@
+/*=============================================================================
+        Name    : test_clip.c
+        Purpose : the SSE2 view volume clipper gives the scalar one's
+                  polygons bit for bit: vertex lists, clip coordinates,
+                  colours, texture coordinates & eye z
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+#include "clip.h"
+
+#define TRIALS 200000
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct
+{
+    GLfloat clip[4];
+    GLubyte fcolor[4], bcolor[4];
+    GLfloat texcoord[2];
+    GLfloat eyez;
+} clip_vertex;
+
+static void grab(vertex_buffer* VB, GLuint j, clip_vertex* v)
+{
+    memset(v, 0, sizeof(*v));
+    memcpy(v->clip, VB->Clip[j], sizeof(v->clip));
+    memcpy(v->fcolor, VB->Fcolor[j], sizeof(v->fcolor));
+    memcpy(v->bcolor, VB->Bcolor[j], sizeof(v->bcolor));
+    memcpy(v->texcoord, VB->TexCoord[j], sizeof(v->texcoord));
+    v->eyez = VB->Eye[j][2];
+}
+
+//a convex n-gon in a random plane of clip space
+static void make_polygon(vertex_buffer* VB, GLuint n, GLfloat spread)
+{
+    GLfloat c[4], a[4], b[4];
+    GLuint i, k;
+
+    for (k = 0; k < 3; k++)
+    {
+        c[k] = test_randf(-1.5f, 1.5f);
+        a[k] = test_randf(-spread, spread);
+        b[k] = test_randf(-spread, spread);
+    }
+    c[3] = 1.0f + test_randf(-0.5f, 0.5f);
+    a[3] = test_randf(-0.3f, 0.3f) * spread;
+    b[3] = test_randf(-0.3f, 0.3f) * spread;
+
+    for (i = 0; i < n; i++)
+    {
+        double th = 2.0 * M_PI * (i + test_randf(-0.3f, 0.3f)) / n;
+
+        for (k = 0; k < 4; k++)
+        {
+            VB->Clip[i][k] = (GLfloat)(c[k] + a[k] * cos(th) + b[k] * sin(th));
+            VB->Fcolor[i][k] = (GLubyte)test_rand();
+            VB->Bcolor[i][k] = (GLubyte)test_rand();
+        }
+        VB->TexCoord[i][0] = test_randf(-1.0f, 1.0f);
+        VB->TexCoord[i][1] = test_randf(-1.0f, 1.0f);
+        VB->Eye[i][2] = test_randf(-10.0f, 10.0f);
+        VB->VList[i] = i;
+    }
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    vertex_buffer* VB;
+    GLuint lists[2][VB_CLIP_VERTS + 8], counts[2];
+    clip_vertex out[2][VB_CLIP_VERTS + 8];
+    GLuint trial, pass, i, n, clipped = 0;
+    GLboolean sse2;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    VB = ctx->VB;
+    sse2 = ctx->CpuSSE2;
+    if (!sse2)
+    {
+        printf("no SSE2, nothing to compare\n");
+        return test_done();
+    }
+    VB->EyeValid = GL_TRUE;
+
+    for (trial = 0; trial < TRIALS; trial++)
+    {
+        n = 3 + test_rand() % 6;
+        make_polygon(VB, n, 0.2f + 2.0f * test_randf(0.0f, 1.0f));
+        ctx->ClipMask = test_rand() & (CLIP_FCOLOR_BIT | CLIP_BCOLOR_BIT | CLIP_TEXTURE_BIT);
+
+        for (pass = 0; pass < 2; pass++)
+        {
+            ctx->CpuSSE2 = (GLboolean)pass;
+            VB->Free = VB->Max;
+            memcpy(lists[pass], VB->VList, n * sizeof(GLuint));
+            counts[pass] = gl_viewclip_polygon(ctx, n, lists[pass]);
+            if (counts[pass] > VB_CLIP_VERTS)
+            {
+                break;
+            }
+            for (i = 0; i < counts[pass]; i++)
+            {
+                grab(VB, lists[pass][i], &out[pass][i]);
+            }
+        }
+        if (pass < 2)
+        {
+            TEST_CHECK(0, "trial %u: %u vertices out of %u", trial, counts[pass], n);
+            break;
+        }
+
+        clipped += (counts[0] != n || memcmp(lists[0], VB->VList, n * sizeof(GLuint)) != 0);
+        if (counts[0] < 3 && counts[1] < 3)
+        {
+            continue;
+        }
+        if (counts[0] != counts[1] ||
+            memcmp(lists[0], lists[1], counts[0] * sizeof(GLuint)) != 0 ||
+            memcmp(out[0], out[1], counts[0] * sizeof(clip_vertex)) != 0)
+        {
+            TEST_CHECK(0, "trial %u, %u sides, clip mask %u: %u vertices scalar, %u sse2",
+                       trial, n, ctx->ClipMask, counts[0], counts[1]);
+            break;
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->ClipMask = 0;
+
+    printf("%u polygons, %u clipped\n", trial, clipped);
+    TEST_CHECK(clipped > TRIALS / 4, "only %u polygons clipped", clipped);
+
+    return test_done();
+}
@@ -0,0 +1,128 @@
+/*=============================================================================
+        Name    : test_cull.c
+        Purpose : rglCullBoxes & rglCullSpheres: the C, SSE2 & AVX2 paths
+                  agree, and nothing rglIsClipped keeps is culled
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+DLL unsigned char rglIsClipped(
+    GLfloat* collrectoffset,
+    GLfloat uplength, GLfloat rightlength, GLfloat forwardlength);
+
+#define N 10000
+#define BIT(v, i) (((v)[(i) >> 5] >> ((i) & 31)) & 1)
+
+static GLfloat box[N][6], sph[N][4];
+static GLuint vis[3][(N + 31) / 32], svis[3][(N + 31) / 32];
+
+//C, SSE2, AVX2
+static void select_path(GLcontext* ctx, GLuint path, GLboolean sse2, GLboolean avx2)
+{
+    ctx->CpuSSE2 = (GLboolean)(sse2 && path >= 1);
+    ctx->CpuAVX2 = (GLboolean)(avx2 && path == 2);
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLuint pass, path, i, k, n, count[3], bv;
+    GLuint missed = 0, kept = 0, inside = 0;
+    GLboolean sse2, avx2;
+    GLfloat sb[6];
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+
+    for (pass = 0; pass < 4; pass++)
+    {
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        if (pass & 1)
+        {
+            glOrtho(-60.0, 60.0, -45.0, 45.0, -100.0, 100.0);
+        }
+        else
+        {
+            glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 300.0);
+        }
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        glRotatef(20.0f + pass * 37.0f, 0.3f, 1.0f, 0.2f);
+        glTranslatef(5.0f, -3.0f, -40.0f);
+        if (pass >= 2)
+        {
+            glScalef(1.5f, 0.7f, 1.2f);
+        }
+
+        for (i = 0; i < N; i++)
+        {
+            for (k = 0; k < 3; k++)
+            {
+                box[i][k] = test_randf(-200.0f, 200.0f);
+                box[i][k + 3] = test_randf(-30.0f, 30.0f);
+            }
+            for (k = 0; k < 3; k++)
+            {
+                sph[i][k] = box[i][k] + 0.5f * box[i][k + 3];
+            }
+            sph[i][3] = test_randf(0.0f, 20.0f);
+        }
+
+        //a count that isn't a multiple of the vector width
+        n = N - pass;
+        for (path = 0; path < 3; path++)
+        {
+            select_path(ctx, path, sse2, avx2);
+            memset(vis[path], 0, sizeof(vis[path]));
+            memset(svis[path], 0, sizeof(svis[path]));
+            count[path] = rglCullBoxes(n, &box[0][0], NULL, vis[path]);
+            rglCullSpheres(n, &sph[0][0], NULL, svis[path]);
+        }
+        select_path(ctx, 2, sse2, avx2);
+
+        TEST_CHECK(count[0] == count[1] && count[0] == count[2],
+                   "pass %u: %u boxes kept by C, %u by SSE2, %u by AVX2",
+                   pass, count[0], count[1], count[2]);
+        TEST_CHECK(memcmp(vis[0], vis[1], sizeof(vis[0])) == 0 &&
+                   memcmp(vis[0], vis[2], sizeof(vis[0])) == 0,
+                   "pass %u: box paths disagree", pass);
+        TEST_CHECK(memcmp(svis[0], svis[1], sizeof(svis[0])) == 0 &&
+                   memcmp(svis[0], svis[2], sizeof(svis[0])) == 0,
+                   "pass %u: sphere paths disagree", pass);
+
+        for (i = 0; i < n; i++)
+        {
+            //rglIsClipped leaves the matrix types to whoever drew last,
+            //rglCullBoxes above brought them up to date
+            if (!rglIsClipped(box[i], box[i][3], box[i][4], box[i][5]))
+            {
+                inside++;
+                missed += !BIT(vis[0], i);
+            }
+            kept += BIT(vis[0], i);
+
+            //a sphere is never kept when its bounding box is culled
+            for (k = 0; k < 3; k++)
+            {
+                sb[k] = sph[i][k] - sph[i][3];
+                sb[k + 3] = 2.0f * sph[i][3];
+            }
+            bv = 0;
+            rglCullBoxes(1, sb, NULL, &bv);
+            TEST_CHECK(!BIT(svis[0], i) || bv, "pass %u: sphere %u kept, its box culled", pass, i);
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    printf("%u boxes visible to rglIsClipped, %u kept by rglCullBoxes\n", inside, kept);
+    TEST_CHECK(missed == 0, "%u visible boxes culled", missed);
+    TEST_CHECK(inside > 1000 && kept < 4 * N - 1000, "%u visible, %u kept: too few of either", inside, kept);
+
+    return test_done();
+}
@@ -0,0 +1,105 @@
+/*=============================================================================
+        Name    : test_eyeclip.c
+        Purpose : clipping a textured polygon interpolates eye z only when
+                  the transform wrote eye coordinates for the batch
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+#define SENTINEL 1234.5f
+
+//fill the clipper's vertices' eye coordinates with SENTINEL
+static void mark_clip_verts(vertex_buffer* VB)
+{
+    GLuint i;
+
+    for (i = VB->Max; i < VB->Size; i++)
+    {
+        VB->Eye[i][0] = VB->Eye[i][1] = VB->Eye[i][2] = VB->Eye[i][3] = SENTINEL;
+    }
+}
+
+//how many of the clipper's vertices had their eye z written
+static GLuint written_clip_verts(vertex_buffer* VB)
+{
+    GLuint i, n = 0;
+
+    for (i = VB->Max; i < VB->Size; i++)
+    {
+        if (VB->Eye[i][2] != SENTINEL)
+        {
+            n++;
+        }
+    }
+    return n;
+}
+
+//4 textured triangles, enough for the SIMD path, the last one straddling x = 1
+static void draw_batch(void)
+{
+    GLuint i;
+    GLfloat x;
+
+    glBegin(GL_TRIANGLES);
+    for (i = 0; i < 4; i++)
+    {
+        x = (i == 3) ? 0.9f : -0.5f + 0.2f * (GLfloat)i;
+        glTexCoord2f(0.0f, 0.0f);
+        glVertex3f(x, -0.5f, -0.5f);
+        glTexCoord2f(1.0f, 0.0f);
+        glVertex3f(x + 0.3f, -0.5f, -0.5f);
+        glTexCoord2f(0.0f, 1.0f);
+        glVertex3f(x, -0.2f, -0.5f);
+    }
+    glEnd();
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLuint clipped, tex;
+    GLubyte texels[4 * 4 * 4] = { 0 };
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glRotatef(1.0f, 0.0f, 1.0f, 0.0f);      //a 3D modelview, as the fused pass needs
+
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+    glEnable(GL_TEXTURE_2D);
+
+    //fused transform: no eye coordinates, none interpolated
+    mark_clip_verts(ctx->VB);
+    clipped = rglClippedPolys();
+    draw_batch();
+    TEST_CHECK(rglClippedPolys() - clipped == 1, "%u polys clipped, 1 expected",
+               rglClippedPolys() - clipped);
+    if (ctx->CpuSSE2)
+    {
+        TEST_CHECK(!ctx->VB->EyeValid, "eye coordinates marked valid after the fused pass");
+        TEST_CHECK(written_clip_verts(ctx->VB) == 0, "%u clip vertices' eye z written from stale values",
+                   written_clip_verts(ctx->VB));
+    }
+
+    //lighting needs eye coordinates, so they're there to interpolate
+    glEnable(GL_LIGHTING);
+    mark_clip_verts(ctx->VB);
+    clipped = rglClippedPolys();
+    draw_batch();
+    TEST_CHECK(rglClippedPolys() - clipped == 1, "%u polys clipped with lighting, 1 expected",
+               rglClippedPolys() - clipped);
+    TEST_CHECK(ctx->VB->EyeValid, "eye coordinates not marked valid with lighting");
+    TEST_CHECK(written_clip_verts(ctx->VB) != 0, "no clip vertex's eye z interpolated with lighting");
+    glDisable(GL_LIGHTING);
+
+    glDeleteTextures(1, &tex);
+    return test_done();
+}
@@ -0,0 +1,133 @@
+/*=============================================================================
+        Name    : test_gbscene.c
+        Purpose : a fixed scene straddling the screen edges draws with fewer
+                  clipped polygons as rglGuardBand widens, through both the
+                  staged & fused transforms, and the time each band takes
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+#define TRIS    6000
+#define NEAR    300     //of them crossing the near plane, clipped at any band
+#define REPS    20
+
+static GLfloat const bands[] = { 1.0f, 1.25f, 1.5f, 2.0f, 4.0f, 8.0f };
+
+static GLfloat tris[TRIS][3][3];
+
+/* triangles a tenth to half the screen across, centred up to 3 screen
+   widths off centre at depths 5 to 100, so each band lets more through */
+static void make_scene(void)
+{
+    GLfloat cx, cy, cz, r;
+    GLuint t, v;
+
+    for (t = 0; t < TRIS; t++)
+    {
+        cz = test_randf(-100.0f, -5.0f);
+        cx = test_randf(-3.0f, 3.0f) * -cz;
+        cy = test_randf(-2.25f, 2.25f) * -cz;
+        r = test_randf(0.1f, 0.5f) * -cz;
+        for (v = 0; v < 3; v++)
+        {
+            tris[t][v][0] = cx + test_randf(-r, r);
+            tris[t][v][1] = cy + test_randf(-r, r);
+            tris[t][v][2] = cz + test_randf(-r, r) * 0.1f;
+        }
+    }
+
+    //one vertex in front of the near plane (at 1), near the middle
+    for (t = 0; t < NEAR; t++)
+    {
+        for (v = 0; v < 3; v++)
+        {
+            tris[t][v][2] = (v == 0) ? -0.5f : test_randf(-3.0f, -2.0f);
+            tris[t][v][0] = test_randf(-0.5f, 0.5f) * -tris[t][v][2];
+            tris[t][v][1] = test_randf(-0.5f, 0.5f) * -tris[t][v][2];
+        }
+    }
+}
+
+/* an identity modelview goes down the staged transform & cliptest, a 3D one
+   (the scene pushed back by dz, the camera with it) down the fused pass */
+static void draw_scene(GLfloat dz)
+{
+    GLuint t, v;
+
+    glLoadIdentity();
+    glTranslatef(0.0f, 0.0f, -dz);
+    glBegin(GL_TRIANGLES);
+    for (t = 0; t < TRIS; t++)
+    {
+        for (v = 0; v < 3; v++)
+        {
+            glVertex3f(tris[t][v][0], tris[t][v][1], tris[t][v][2] + dz);
+        }
+    }
+    glEnd();
+}
+
+int main(void)
+{
+    static char const* const passNames[2] = { "staged", "fused" };
+    GLcontext* ctx;
+    GLuint b, r, pass, clipped, last, first;
+    GLfloat dz;
+    double t, best;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    make_scene();
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 1000.0);
+    glMatrixMode(GL_MODELVIEW);
+    glFlush();
+
+    printf("%d triangles, %d across the near plane\n", TRIS, NEAR);
+    for (pass = 0; pass < 2; pass++)
+    {
+        dz = pass ? 10.0f : 0.0f;
+        last = TRIS + 1;
+        first = 0;
+        for (b = 0; b < sizeof(bands) / sizeof(bands[0]); b++)
+        {
+            rglGuardBand(bands[b]);
+            TEST_CHECK(ctx->GuardBand == bands[b], "guard band %g, %g asked for", ctx->GuardBand, bands[b]);
+
+            draw_scene(dz);
+            clipped = rglClippedPolys();
+            glFlush();
+
+            best = 1e9;
+            for (r = 0; r < REPS; r++)
+            {
+                t = test_now();
+                draw_scene(dz);
+                glFlush();
+                t = test_now() - t;
+                best = (t < best) ? t : best;
+            }
+            printf("%-6s band %5.2f  %5u clipped  %7.1f us\n", passNames[pass], bands[b], clipped, best * 1e6);
+
+            TEST_CHECK(clipped <= last, "%s band %g clipped %u, more than %u at the band before",
+                       passNames[pass], bands[b], clipped, last);
+            TEST_CHECK(clipped >= NEAR, "%s band %g clipped %u, but %d cross the near plane",
+                       passNames[pass], bands[b], clipped, NEAR);
+            if (b == 0)
+            {
+                first = clipped;
+            }
+            last = clipped;
+        }
+        //past 3 screen widths only the near plane is left to clip against
+        TEST_CHECK(last == NEAR && last < first, "%s clipped %u at the widest band, %u at 1",
+                   passNames[pass], last, first);
+    }
+
+    rglGuardBand(1.0f);
+    return test_done();
+}
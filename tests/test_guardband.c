@@ -0,0 +1,52 @@
+/*=============================================================================
+        Name    : test_guardband.c
+        Purpose : rglGuardBand is held to the guard band the driver reports,
+                  and off for a driver that reports none
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+int main(void)
+{
+    GLcontext* ctx;
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    //the null driver takes anything
+    TEST_CHECK(ctx->GuardBand == 1.0f, "guard band %g by default", ctx->GuardBand);
+    rglGuardBand(4.0f);
+    TEST_CHECK(ctx->GuardBand == 4.0f, "guard band %g, 4 asked for", ctx->GuardBand);
+
+    //a driver with none: the band stays off
+    gl_driver_guard_band(ctx, 0.0f, 0.0f, 0.0f, 0.0f);
+    TEST_CHECK(ctx->GuardBand == 1.0f, "guard band %g with none from the driver", ctx->GuardBand);
+    rglGuardBand(2.0f);
+    TEST_CHECK(ctx->GuardBand == 1.0f, "guard band %g with none from the driver", ctx->GuardBand);
+
+    //half the buffer past every edge of the 640x480 buffer: 2x for the full
+    //screen viewport
+    gl_driver_guard_band(ctx, -320.0f, -240.0f, 640.0f + 320.0f, 480.0f + 240.0f);
+    rglGuardBand(8.0f);
+    TEST_CHECK(ctx->GuardBand == 2.0f, "guard band %g, 2 expected", ctx->GuardBand);
+
+    //smaller viewports reach further, as far as their nearest edge allows
+    glViewport(320, 240, 320, 240);
+    TEST_CHECK(ctx->GuardBand == 3.0f, "guard band %g for a quarter viewport, 3 expected", ctx->GuardBand);
+    glViewport(480, 0, 160, 480);
+    TEST_CHECK(ctx->GuardBand == 2.0f, "guard band %g for an edge viewport, 2 expected", ctx->GuardBand);
+
+    //a smaller ask than the driver's is left be
+    glViewport(0, 0, 640, 480);
+    rglGuardBand(1.5f);
+    TEST_CHECK(ctx->GuardBand == 1.5f, "guard band %g, 1.5 asked for", ctx->GuardBand);
+
+    //a bad size is refused
+    rglGuardBand(0.5f);
+    TEST_CHECK(glGetError() == GL_INVALID_VALUE, "rglGuardBand(0.5) accepted");
+    TEST_CHECK(ctx->GuardBand == 1.5f, "guard band %g after a bad size", ctx->GuardBand);
+
+    return test_done();
+}
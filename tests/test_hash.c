@@ -0,0 +1,92 @@
+/*=============================================================================
+        Name    : test_hash.c
+        Purpose : the texture object hash table against a plain array under
+                  a random mix of inserts, removes & lookups, dense walk
+                  included
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "hash.h"
+
+#define KEYS 20000
+#define OPS  500000
+
+static void* reference[KEYS];
+
+static void* hash_alloc(GLint bytes)
+{
+    return malloc((size_t)bytes);
+}
+
+int main(void)
+{
+    hashtable* t;
+    GLuint i, key, count, op;
+    void* data;
+
+    test_init();
+    t = hashNewTable(hash_alloc, free);
+    TEST_CHECK(t != NULL, "no table");
+    if (t == NULL)
+    {
+        return test_done();
+    }
+
+    for (i = 0; i < OPS; i++)
+    {
+        key = 1 + test_rand() % (KEYS - 1);
+        op = test_rand() % 3;
+        if (op == 0)
+        {
+            data = (void*)(size_t)(i + 1);
+            hashInsert(t, key, data);
+            reference[key] = data;
+        }
+        else if (op == 1)
+        {
+            if (reference[key] != NULL)
+            {
+                hashRemove(t, key);
+                reference[key] = NULL;
+            }
+        }
+        else if (hashLookup(t, key) != reference[key])
+        {
+            TEST_CHECK(0, "key %u after %u operations", key, i);
+            break;
+        }
+    }
+
+    //every key, and the dense arrays
+    count = 0;
+    for (key = 1; key < KEYS; key++)
+    {
+        if (hashLookup(t, key) != reference[key])
+        {
+            TEST_CHECK(0, "key %u at the end", key);
+            break;
+        }
+        count += (reference[key] != NULL);
+    }
+    TEST_CHECK(HASH_COUNT(t) == count, "%u entries, %u expected", HASH_COUNT(t), count);
+    for (i = 0; i < HASH_COUNT(t); i++)
+    {
+        if (reference[HASH_KEY(t, i)] != HASH_DATA(t, i))
+        {
+            TEST_CHECK(0, "dense entry %u, key %u", i, HASH_KEY(t, i));
+            break;
+        }
+    }
+
+    //free key blocks don't overlap what's there
+    key = hashFindFreeKeyBlock(t, 16);
+    for (i = 0; i < 16; i++)
+    {
+        TEST_CHECK(hashLookup(t, key + i) == NULL, "free block key %u in use", key + i);
+    }
+
+    hashDeleteTable(t);
+    return test_done();
+}
@@ -0,0 +1,215 @@
+/*=============================================================================
+        Name    : test_light.c
+        Purpose : the SSE2 & AVX2 lighting kernels against the scalar shaders,
+                  1-3 directional & positional lights, both sides, & the
+                  fallback while a lighting update is pending
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+
+#define N       8192
+
+//kvb.c's, which has no header of its own
+void gl_color_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+void gl_fast_color_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+
+static GLfloat vertex[N][4], normal[N][3];
+static GLubyte color[N + 1][4], scalar[N][4];
+
+static void shade(GLcontext* ctx, GLboolean fast, GLuint side, GLuint n, GLubyte out[][4])
+{
+    if (fast)
+    {
+        gl_fast_color_shade_vertices(ctx, side, n, vertex, normal, out);
+    }
+    else
+    {
+        gl_color_shade_vertices(ctx, side, n, vertex, normal, out);
+    }
+}
+
+//largest byte difference from the scalar colours, or 256 for a write past n
+static GLint compare(GLuint n)
+{
+    GLint d, worst = 0;
+    GLuint i, k;
+
+    for (i = 0; i < n; i++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            d = abs((GLint)color[i][k] - (GLint)scalar[i][k]);
+            worst = (d > worst) ? d : worst;
+        }
+    }
+    return (color[n][0] != 0xCD) ? 256 : worst;
+}
+
+static void lights(GLcontext* ctx, GLuint count, GLboolean positional)
+{
+    GLfloat p[4];
+    GLuint i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (i < count)
+        {
+            glEnable(GL_LIGHT0 + i);
+        }
+        else
+        {
+            glDisable(GL_LIGHT0 + i);
+        }
+        if (positional)
+        {
+            p[0] = 10.0f + i * 40.0f;
+            p[1] = 20.0f - i * 30.0f;
+            p[2] = -30.0f - i * 50.0f;
+            p[3] = 1.0f;
+        }
+        else
+        {
+            p[0] = 0.3f - i * 0.4f;
+            p[1] = 0.5f;
+            p[2] = 1.0f;
+            p[3] = 0.0f;
+        }
+        glLightfv(GL_LIGHT0 + i, GL_POSITION, p);
+    }
+    gl_update_lighting(ctx);
+}
+
+int main(void)
+{
+    static GLfloat const ambient[4] = { 0.2f, 0.2f, 0.25f, 1.0f };
+    static GLfloat const matAmbient[4] = { 0.6f, 0.5f, 0.4f, 1.0f };
+    static GLfloat const matDiffuse[4] = { 0.8f, 0.7f, 0.9f, 0.8f };
+    GLcontext* ctx;
+    GLboolean sse2, avx2, fast;
+    GLuint i, count, positional, side, n, path;
+    GLfloat x, y, z, l, d[4], a[4];
+    GLint worst;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+    if (!sse2)
+    {
+        printf("no SSE2, nothing to compare\n");
+        return test_done();
+    }
+
+    for (i = 0; i < N; i++)
+    {
+        x = test_randf(-1.0f, 1.0f);
+        y = test_randf(-1.0f, 1.0f);
+        z = test_randf(-1.0f, 1.0f);
+        l = (GLfloat)sqrt(x * x + y * y + z * z);
+        normal[i][0] = x / l;
+        normal[i][1] = y / l;
+        normal[i][2] = z / l;
+        vertex[i][0] = test_randf(-100.0f, 100.0f);
+        vertex[i][1] = test_randf(-100.0f, 100.0f);
+        vertex[i][2] = test_randf(-300.0f, 0.0f);
+        vertex[i][3] = 1.0f;
+    }
+    //one right on light 0, where the light vector is 0
+    vertex[5][0] = 10.0f;
+    vertex[5][1] = 20.0f;
+    vertex[5][2] = -30.0f;
+
+    glEnable(GL_LIGHTING);
+    glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambient);
+    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, matAmbient);
+    glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, matDiffuse);
+    for (i = 0; i < 3; i++)
+    {
+        d[0] = 0.9f - 0.2f * i;
+        d[1] = 0.6f;
+        d[2] = 0.3f + 0.2f * i;
+        d[3] = 1.0f;
+        a[0] = 0.1f;
+        a[1] = 0.05f * i;
+        a[2] = 0.1f;
+        a[3] = 1.0f;
+        glLightfv(GL_LIGHT0 + i, GL_DIFFUSE, d);
+        glLightfv(GL_LIGHT0 + i, GL_AMBIENT, a);
+        //no GL entry for these
+        ctx->Light[i].ConstantAttenuation = 1.0f;
+        ctx->Light[i].LinearAttenuation = 0.002f * i;
+        ctx->Light[i].QuadraticAttenuation = 0.00001f;
+    }
+
+    for (count = 1; count <= 3; count++)
+    {
+        for (positional = 0; positional < 2; positional++)
+        {
+            lights(ctx, count, (GLboolean)positional);
+            for (fast = 0; fast < 2; fast++)
+            {
+                for (side = 0; side < 2; side++)
+                {
+                    //every tail length, then up to a full VB
+                    for (n = 1; n <= N; n = (n < 64) ? n + 1 : n * 2)
+                    {
+                        ctx->CpuSSE2 = GL_FALSE;
+                        ctx->CpuAVX2 = GL_FALSE;
+                        shade(ctx, fast, side, n, scalar);
+                        for (path = 1; path <= 2; path++)
+                        {
+                            if (path == 2 && !avx2)
+                            {
+                                continue;
+                            }
+                            ctx->CpuSSE2 = GL_TRUE;
+                            ctx->CpuAVX2 = (GLboolean)(path == 2);
+                            memset(color, 0xCD, sizeof(color));
+                            shade(ctx, fast, side, n, color);
+                            worst = compare(n);
+                            TEST_CHECK(worst <= 1, "%u %s lights, %s, side %u, n %u, %s: off by %d",
+                                       count, positional ? "positional" : "directional",
+                                       fast ? "fast" : "general", side, n,
+                                       (path == 2) ? "AVX2" : "SSE2", worst);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /* with an update pending the block is stale, so the shaders must light
+       the vertices themselves.  a wrecked block shows if they don't */
+    lights(ctx, 2, GL_TRUE);
+    ctx->CpuSSE2 = GL_FALSE;
+    ctx->CpuAVX2 = GL_FALSE;
+    shade(ctx, GL_FALSE, 0, N, scalar);
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+    memset(&ctx->LightBlock, 0, sizeof(ctx->LightBlock));
+    ctx->NewMask |= NEW_LIGHTING;
+    for (fast = 0; fast < 2; fast++)
+    {
+        if (fast)
+        {
+            ctx->CpuSSE2 = GL_FALSE;
+            ctx->CpuAVX2 = GL_FALSE;
+            shade(ctx, GL_TRUE, 0, N, scalar);
+            ctx->CpuSSE2 = sse2;
+            ctx->CpuAVX2 = avx2;
+        }
+        memset(color, 0xCD, sizeof(color));
+        shade(ctx, fast, 0, N, color);
+        TEST_CHECK(compare(N) == 0, "%s shader used a stale light block",
+                   fast ? "fast" : "general");
+    }
+    gl_update_lighting(ctx);
+
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+    return test_done();
+}
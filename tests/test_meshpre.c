@@ -0,0 +1,345 @@
+/*=============================================================================
+        Name    : test_meshpre.c
+        Purpose : RGL_MESH_PRETRANSFORM draws a lit, textured mesh exactly as
+                  the per triangle path does, transforming each of a batch's
+                  vertices once, and a batch past VB_MAX still draws whole
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "rglext.h"
+
+#define LOG_ON  "test_meshpre_on.log"
+#define LOG_OFF "test_meshpre_off.log"
+
+//rglext.c's mesh poly modes
+#define MPM_Flat            0
+#define MPM_Texture         1
+#define MPM_Smooth          2
+#define MPM_SmoothTexture   3
+
+#define NVERTS      200
+#define NPOLYS      300
+#define BATCH       75      //polys per material
+#define BIG_POLYS   3100    //one material, 3 vertices of its own each
+
+typedef struct
+{
+    GLfloat x, y, z;
+    GLint normal;
+} mesh_vertex;
+
+typedef struct
+{
+    GLint normal;
+    GLushort v[3];
+    GLushort material;
+    GLfloat tc[6];
+} mesh_poly;
+
+static mesh_vertex verts[3 * BIG_POLYS];
+static GLfloat normals[3 * BIG_POLYS][3];
+static mesh_poly polys[BIG_POLYS];
+static GLuint tex[4];
+static GLint meshMode;
+
+//material m: a texture & one of the 4 modes
+static void material(GLint m)
+{
+    static GLint const modes[4] = { MPM_SmoothTexture, MPM_Smooth, MPM_Texture, MPM_Flat };
+
+    glBindTexture(GL_TEXTURE_2D, tex[m & 3]);
+    meshMode = modes[m & 3];
+    glColor4ub(200, 100, 50, 255);
+}
+
+static GLubyte* read_log(char const* name, GLuint* size)
+{
+    FILE* f = fopen(name, "rb");
+    GLubyte* data;
+    long n;
+
+    if (f == NULL)
+    {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = (GLubyte*)malloc(n);
+    *size = (GLuint)fread(data, 1, n, f);
+    fclose(f);
+    return data;
+}
+
+static GLuint arg(GLubyte const* p, GLuint i)
+{
+    GLuint a;
+    memcpy(&a, p + 1 + 4 * i, 4);
+    return a;
+}
+
+/* the log's draws, each with the texture bound for it & its provoking
+   vertex zeroed: smooth shading doesn't use it and the two paths choose
+   differently.  state changes around the draws needn't line up.  returns
+   the bytes of draws written to out, or -1 for a record this doesn't know */
+static GLint draws(GLubyte const* log, GLuint size, GLubyte* out, GLint* tris)
+{
+    GLubyte const* p = log + 8;
+    GLubyte const* end = log + size;
+    GLubyte* q = out;
+    GLuint n, args, pv, texture = 0;
+
+    *tris = 0;
+    while (p < end)
+    {
+        pv = ~0u;
+        switch (*p)
+        {
+        case NULL_OP_TRIANGLE:
+            pv = 0;
+            args = 1 + 3 * NULL_VTX_BYTES / 4;
+            *tris += 1;
+            break;
+        case NULL_OP_TRIANGLE_ARRAY:
+            n = arg(p, 0);
+            pv = 1;
+            args = 2 + 3 * n * NULL_VTX_BYTES / 4;
+            *tris += n;
+            break;
+        case NULL_OP_QUAD:
+            pv = 0;
+            args = 1 + 4 * NULL_VTX_BYTES / 4;
+            *tris += 2;
+            break;
+        case NULL_OP_TRIANGLE_FAN:
+        case NULL_OP_TRIANGLE_STRIP:
+        case NULL_OP_POLYGON:
+            n = arg(p, 0);
+            pv = 1;
+            args = 2 + n * NULL_VTX_BYTES / 4;
+            *tris += n - 2;
+            break;
+        case NULL_OP_BIND_TEXTURE:
+            texture = arg(p, 0);
+            args = 1;
+            break;
+        case NULL_OP_TEX_ENV:
+        case NULL_OP_BEGIN:
+            args = 1;
+            break;
+        case NULL_OP_TEX_PARAM:
+            args = 2;
+            break;
+        case NULL_OP_SETUP_TRIANGLE:
+        case NULL_OP_SETUP_LINE:
+        case NULL_OP_SETUP_POINT:
+        case NULL_OP_SETUP_RASTER:
+        case NULL_OP_FLUSH:
+        case NULL_OP_FLUSH_BATCH:
+        case NULL_OP_END:
+        case NULL_OP_UPDATE_MODELVIEW:
+        case NULL_OP_UPDATE_PROJECTION:
+            args = 0;
+            break;
+        default:
+            printf("unexpected null driver op %u\n", *p);
+            return -1;
+        }
+        if (pv != ~0u)
+        {
+            memcpy(q, &texture, 4);
+            memcpy(q + 4, p, 1 + 4 * args);
+            memset(q + 4 + 1 + 4 * pv, 0, 4);
+            q += 4 + 1 + 4 * args;
+        }
+        p += 1 + 4 * args;
+    }
+    return (GLint)(q - out);
+}
+
+//the mesh drawn with the mode on & off, the same triangles both times
+static void draw_both(GLint nVerts, GLint nPolys, GLuint* unique, GLuint* referenced)
+{
+    GLubyte *on, *off, *drawsOn, *drawsOff;
+    GLuint sizeOn, sizeOff, mode;
+    GLint trisOn, trisOff, bytesOn, bytesOff;
+
+    for (mode = 0; mode < 2; mode++)
+    {
+        if (mode == 0)
+        {
+            rglEnable(RGL_MESH_PRETRANSFORM);
+        }
+        else
+        {
+            rglDisable(RGL_MESH_PRETRANSFORM);
+        }
+        //so the first material's texture shows up in the log
+        glBindTexture(GL_TEXTURE_2D, 0);
+        null_record((mode == 0) ? LOG_ON : LOG_OFF);
+        rglList(RGL_VERTEX_LIST, verts);
+        rglList(RGL_NORMAL_LIST, normals);
+        rglList(RGL_POLY_LIST, polys);
+        rglMeshRender((nVerts << 16) | nPolys, material, &meshMode);
+        glFlush();
+        null_record(NULL);
+        rglMeshStats(&unique[mode], &referenced[mode]);
+    }
+    rglEnable(RGL_MESH_PRETRANSFORM);
+
+    on = read_log(LOG_ON, &sizeOn);
+    off = read_log(LOG_OFF, &sizeOff);
+    TEST_CHECK(on != NULL && off != NULL, "no null driver logs");
+    if (on != NULL && off != NULL)
+    {
+        //a draw & its texture name take no more than the record did
+        drawsOn = (GLubyte*)malloc(2 * sizeOn);
+        drawsOff = (GLubyte*)malloc(2 * sizeOff);
+        bytesOn = draws(on, sizeOn, drawsOn, &trisOn);
+        bytesOff = draws(off, sizeOff, drawsOff, &trisOff);
+        printf("%d polys: %d triangles on, %d off\n", nPolys, trisOn, trisOff);
+        TEST_CHECK(bytesOn > 0 && bytesOff > 0, "couldn't read the logs");
+        TEST_CHECK(trisOn >= nPolys / 2 && trisOn == trisOff, "%d triangles on, %d off", trisOn, trisOff);
+        TEST_CHECK(bytesOn == bytesOff && memcmp(drawsOn, drawsOff, bytesOn) == 0,
+                   "%d polys: the draws differ", nPolys);
+        free(drawsOn);
+        free(drawsOff);
+    }
+    free(on);
+    free(off);
+    remove(LOG_ON);
+    remove(LOG_OFF);
+}
+
+int main(void)
+{
+    static GLubyte texels[64 * 64 * 4];
+    static GLubyte seen[NVERTS];
+    GLfloat light0[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+    GLfloat light1[4] = { -2.0f, 1.0f, 2.0f, 1.0f };
+    GLuint unique[2], referenced[2], want;
+    GLint i, k, b;
+    GLcontext* ctx;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    //one draw per triangle, so the logs line up triangle for triangle
+    rglDisable(RGL_INDEXED_TRIANGLES);
+
+    glGenTextures(4, tex);
+    for (i = 0; i < 4; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, tex[i]);
+        memset(texels, i * 40, sizeof(texels));
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 100.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslatef(0.0f, 0.0f, -3.0f);
+    glRotatef(30.0f, 0.0f, 1.0f, 0.0f);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glEnable(GL_LIGHT1);
+    glLightfv(GL_LIGHT0, GL_POSITION, light0);
+    glLightfv(GL_LIGHT1, GL_POSITION, light1);
+    glEnable(GL_TEXTURE_2D);
+
+    rglListSpec(RGL_VERTEX_LIST, RGL_SIZE, sizeof(mesh_vertex), 0);
+    rglListSpec(RGL_VERTEX_LIST, RGL_X, 0, 0);
+    rglListSpec(RGL_VERTEX_LIST, RGL_NORMAL, 12, 0);
+    rglListSpec(RGL_NORMAL_LIST, RGL_SIZE, 12, 0);
+    rglListSpec(RGL_NORMAL_LIST, RGL_X, 0, 0);
+    rglListSpec(RGL_POLY_LIST, RGL_SIZE, sizeof(mesh_poly), 0);
+    rglListSpec(RGL_POLY_LIST, RGL_NORMAL, 0, 0);
+    rglListSpec(RGL_POLY_LIST, RGL_VERTICES, 4, 0);
+    rglListSpec(RGL_POLY_LIST, RGL_MATERIAL, 10, 0);
+    rglListSpec(RGL_POLY_LIST, RGL_TEXCOORDS, 12, 0);
+
+    /* a 20x10 grid, some of it off screen so there's clipping.  polys share
+       vertices, with texcoords that go with the vertex, and come in 4
+       material batches: smooth textured, smooth, flat textured & flat */
+    for (i = 0; i < NVERTS; i++)
+    {
+        verts[i].x = (i % 20) * 0.15f - 1.5f;
+        verts[i].y = (i / 20) * 0.25f - 1.25f;
+        verts[i].z = test_randf(-0.3f, 0.3f);
+        verts[i].normal = i;
+        normals[i][0] = test_randf(-0.5f, 0.5f);
+        normals[i][1] = test_randf(-0.5f, 0.5f);
+        normals[i][2] = 1.0f;
+    }
+    for (i = 0; i < NPOLYS; i++)
+    {
+        polys[i].normal = i % NVERTS;
+        polys[i].v[0] = (GLushort)(i % NVERTS);
+        polys[i].v[1] = (GLushort)((i + 1) % NVERTS);
+        polys[i].v[2] = (GLushort)((i + 20) % NVERTS);
+        polys[i].material = (GLushort)(i / BATCH);
+        for (k = 0; k < 3; k++)
+        {
+            polys[i].tc[2 * k] = polys[i].v[k] * 0.01f;
+            polys[i].tc[2 * k + 1] = polys[i].v[k] * 0.02f;
+        }
+    }
+
+    draw_both(NVERTS, NPOLYS, unique, referenced);
+
+    //smooth batches share each vertex, flat ones (a normal per poly) don't
+    for (b = 0, want = 0; b < NPOLYS / BATCH; b++)
+    {
+        if (b == 2 || b == 3)
+        {
+            want += 3 * BATCH;
+            continue;
+        }
+        memset(seen, 0, sizeof(seen));
+        for (i = b * BATCH; i < (b + 1) * BATCH; i++)
+        {
+            for (k = 0; k < 3; k++)
+            {
+                want += !seen[polys[i].v[k]];
+                seen[polys[i].v[k]] = 1;
+            }
+        }
+    }
+    printf("unique %u of %u referenced\n", unique[0], referenced[0]);
+    TEST_CHECK(referenced[0] == 3 * NPOLYS && referenced[1] == 3 * NPOLYS,
+               "referenced %u on, %u off", referenced[0], referenced[1]);
+    TEST_CHECK(unique[0] == want, "unique %u, not %u", unique[0], want);
+    TEST_CHECK(unique[1] == 3 * NPOLYS, "unique %u with the mode off", unique[1]);
+
+    //a batch of more unique vertices than VB_MAX
+    for (i = 0; i < 3 * BIG_POLYS; i++)
+    {
+        verts[i].x = test_randf(-1.5f, 1.5f);
+        verts[i].y = test_randf(-1.5f, 1.5f);
+        verts[i].z = test_randf(-0.5f, 0.5f);
+        verts[i].normal = i;
+        normals[i][0] = 0.0f;
+        normals[i][1] = 0.0f;
+        normals[i][2] = 1.0f;
+    }
+    for (i = 0; i < BIG_POLYS; i++)
+    {
+        polys[i].normal = i;
+        polys[i].material = 0;
+        for (k = 0; k < 3; k++)
+        {
+            polys[i].v[k] = (GLushort)(3 * i + k);
+            polys[i].tc[2 * k] = test_randf(0.0f, 1.0f);
+            polys[i].tc[2 * k + 1] = test_randf(0.0f, 1.0f);
+        }
+    }
+    draw_both(3 * BIG_POLYS, BIG_POLYS, unique, referenced);
+    TEST_CHECK(unique[0] == 3 * BIG_POLYS && unique[0] > VB_MAX, "unique %u", unique[0]);
+    TEST_CHECK(ctx->VB->Max >= 3 * BIG_POLYS, "VB holds %u", ctx->VB->Max);
+
+    glDeleteTextures(4, tex);
+    return test_done();
+}
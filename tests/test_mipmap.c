@@ -0,0 +1,253 @@
+/*=============================================================================
+        Name    : test_mipmap.c
+        Purpose : mip chains: level counts & dimensions, each level within
+                  a step of a linear light reference, the paths agreeing,
+                  and glTexImage2D building & handing over the chain
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+#include "pixconv.h"
+
+#define MAX2(X, Y) ((X) > (Y) ? (X) : (Y))
+
+static double srgb_to_linear(double v)
+{
+    v /= 255.0;
+    return (v <= 0.04045) ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+}
+
+static double linear_to_srgb(double v)
+{
+    v = (v <= 0.0031308) ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+    return v * 255.0;
+}
+
+/* walk the chain in doubles, each level filtered from the linear one above
+   it.  returns the largest error in a byte, or -1 if a level's bytes run
+   past the chain's */
+static GLint check_chain(GLsizei w, GLsizei h, GLubyte const* image, GLubyte const* chain, GLsizei bytes)
+{
+    double *cur, *next, v;
+    GLubyte const* p = chain;
+    GLsizei nw, nh, x, y, x0, x1, y0, y1;
+    GLint c, want, err = 0;
+
+    cur = (double*)malloc(sizeof(double) * 4 * w * h);
+    for (x = 0; x < w * h; x++)
+    {
+        for (c = 0; c < 4; c++)
+        {
+            cur[4 * x + c] = (c < 3) ? srgb_to_linear(image[4 * x + c]) : image[4 * x + c] / 255.0;
+        }
+    }
+
+    while (w > 1 || h > 1)
+    {
+        nw = (w > 1) ? w / 2 : 1;
+        nh = (h > 1) ? h / 2 : 1;
+        if (p + 4 * nw * nh > chain + bytes)
+        {
+            err = -1;
+            break;
+        }
+        next = (double*)malloc(sizeof(double) * 4 * nw * nh);
+        for (y = 0; y < nh; y++)
+        {
+            for (x = 0; x < nw; x++)
+            {
+                //a side of 1 stays 1, an odd side drops its last texel
+                x0 = (w > 1) ? 2 * x : 0;
+                x1 = (w > 1) ? 2 * x + 1 : 0;
+                y0 = (h > 1) ? 2 * y : 0;
+                y1 = (h > 1) ? 2 * y + 1 : 0;
+                for (c = 0; c < 4; c++)
+                {
+                    v = (cur[4 * (y0 * w + x0) + c] + cur[4 * (y0 * w + x1) + c] +
+                         cur[4 * (y1 * w + x0) + c] + cur[4 * (y1 * w + x1) + c]) / 4.0;
+                    next[4 * (y * nw + x) + c] = v;
+                    want = (GLint)floor(((c < 3) ? linear_to_srgb(v) : v * 255.0) + 0.5);
+                    err = MAX2(err, abs(want - p[4 * (y * nw + x) + c]));
+                }
+            }
+        }
+        p += 4 * nw * nh;
+        free(cur);
+        cur = next;
+        w = nw;
+        h = nh;
+    }
+    free(cur);
+
+    if (err >= 0 && p != chain + bytes)
+    {
+        err = -1;
+    }
+    return err;
+}
+
+static void check_sizes(GLcontext* ctx, GLboolean sse2, GLboolean avx2, pix_arena* arena)
+{
+    static GLsizei const sizes[][2] =
+    {
+        { 1, 1 }, { 2, 1 }, { 1, 2 }, { 1, 64 }, { 64, 1 }, { 3, 5 }, { 7, 7 }, { 33, 17 },
+        { 64, 64 }, { 256, 128 }, { 128, 512 }, { 255, 257 }, { 1024, 1024 }
+    };
+    GLubyte *image, *chain[3];
+    GLuint s, path, levels, want;
+    GLsizei w, h, m, bytes, k;
+    GLint err;
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        w = sizes[s][0];
+        h = sizes[s][1];
+        bytes = pix_mip_bytes(w, h, &levels);
+
+        //floor(log2) of the longer side
+        for (m = MAX2(w, h), want = 0; m > 1; m >>= 1)
+        {
+            want++;
+        }
+        TEST_CHECK(levels == want, "%dx%d: %u levels", w, h, levels);
+
+        image = (GLubyte*)malloc(4 * w * h);
+        for (k = 0; k < 4 * w * h; k++)
+        {
+            image[k] = (GLubyte)test_rand();
+        }
+        for (path = 0; path < 3; path++)
+        {
+            ctx->CpuSSE2 = (GLboolean)(sse2 && path >= 1);
+            ctx->CpuAVX2 = (GLboolean)(avx2 && path == 2);
+            chain[path] = (GLubyte*)malloc(bytes + 1);
+            chain[path][bytes] = 0x5A;
+            TEST_CHECK(pix_mipmap(chain[path], image, w, h, (path == 1) ? NULL : arena),
+                       "%dx%d refused", w, h);
+            TEST_CHECK(chain[path][bytes] == 0x5A, "path %u %dx%d: overrun", path, w, h);
+        }
+        TEST_CHECK(memcmp(chain[0], chain[1], bytes) == 0 && memcmp(chain[0], chain[2], bytes) == 0,
+                   "%dx%d: paths disagree", w, h);
+
+        err = check_chain(w, h, image, chain[0], bytes);
+        TEST_CHECK(err >= 0 && err <= 1, "%dx%d: %s %d", w, h, (err < 0) ? "chain size" : "error", err);
+
+        for (path = 0; path < 3; path++)
+        {
+            free(chain[path]);
+        }
+        free(image);
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+}
+
+//the chain glTexImage2D keeps, level by level
+static void check_texture(GLuint name, GLsizei w, GLsizei h, GLubyte const* image, GLuint wantLevels)
+{
+    gl_texture_object* to = rglGetTexobj(name);
+    GLubyte* chain;
+    GLsizei lw, lh;
+    GLuint level;
+
+    TEST_CHECK(to->MipLevels == wantLevels, "texture %u: %u levels, not %u", name, to->MipLevels, wantLevels);
+    if (to->MipLevels != wantLevels || wantLevels == 0)
+    {
+        return;
+    }
+    for (level = 0; level <= wantLevels; level++)
+    {
+        TEST_CHECK(rglGetTexLevel(to, level, &lw, &lh) != NULL &&
+                   lw == MAX2(w >> level, 1) && lh == MAX2(h >> level, 1),
+                   "texture %u level %u: %dx%d", name, level, lw, lh);
+    }
+    TEST_CHECK(rglGetTexLevel(to, wantLevels + 1, &lw, &lh) == NULL, "texture %u: a level past the chain", name);
+
+    chain = (GLubyte*)malloc(pix_mip_bytes(w, h, NULL));
+    pix_mipmap(chain, image, w, h, NULL);
+    TEST_CHECK(memcmp(chain, to->Mips, pix_mip_bytes(w, h, NULL)) == 0, "texture %u: chain differs", name);
+    free(chain);
+}
+
+int main(void)
+{
+    static GLubyte image[4 * 64 * 32], rgb[3 * 64 * 32], expanded[4 * 64 * 32];
+    static GLubyte palette[1024], index[64 * 32];
+    GLcontext* ctx;
+    pix_arena arena = { NULL, 0 };
+    GLubyte checker[4 * 4 * 4], chain[4 * 4 + 4];
+    GLuint tex[3], uploads;
+    GLint k, v;
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    check_sizes(ctx, ctx->CpuSSE2, ctx->CpuAVX2, &arena);
+
+    //a checker of 0 & 255 is half as bright in linear light: 188, not 128.
+    //alpha is averaged as it is
+    for (k = 0; k < 16; k++)
+    {
+        v = ((k & 1) ^ ((k >> 2) & 1)) ? 255 : 0;
+        checker[4 * k] = checker[4 * k + 1] = checker[4 * k + 2] = checker[4 * k + 3] = (GLubyte)v;
+    }
+    pix_mipmap(chain, checker, 4, 4, &arena);
+    TEST_CHECK(chain[0] == 188 && chain[1] == 188 && chain[2] == 188, "checker colour %u", chain[0]);
+    TEST_CHECK(chain[3] == 127 || chain[3] == 128, "checker alpha %u", chain[3]);
+    TEST_CHECK(chain[16] == chain[0] && chain[19] == chain[3], "1x1 %u %u", chain[16], chain[19]);
+
+    for (k = 0; k < (GLint)sizeof(image); k++)
+    {
+        image[k] = (GLubyte)test_rand();
+    }
+    for (k = 0; k < 64 * 32; k++)
+    {
+        memcpy(rgb + 3 * k, image + 4 * k, 3);
+        index[k] = (GLubyte)test_rand();
+    }
+    for (k = 0; k < 1024; k++)
+    {
+        palette[k] = (GLubyte)test_rand();
+    }
+    glGenTextures(3, tex);
+
+    //no chain until a mipmap min filter asks for one, then every level
+    //goes to the driver
+    glBindTexture(GL_TEXTURE_2D, tex[0]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 64, 32, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    check_texture(tex[0], 64, 32, image, 0);
+    uploads = null_call_count(NULL_OP_TEX_IMG);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    check_texture(tex[0], 64, 32, image, 6);
+    TEST_CHECK(null_call_count(NULL_OP_TEX_IMG) - uploads == 7, "%u levels uploaded",
+               null_call_count(NULL_OP_TEX_IMG) - uploads);
+
+    //re-uploading rebuilds it
+    image[0] ^= 0xFF;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 64, 32, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    check_texture(tex[0], 64, 32, image, 6);
+
+    //paletted: the chain of the expanded image
+    glBindTexture(GL_TEXTURE_2D, tex[1]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glColorTable(GL_TEXTURE_2D, GL_RGBA, 256, GL_RGBA, GL_UNSIGNED_BYTE, palette);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_COLOR_INDEX, 64, 32, 0, GL_COLOR_INDEX, GL_UNSIGNED_BYTE, index);
+    for (k = 0; k < 64 * 32; k++)
+    {
+        memcpy(expanded + 4 * k, palette + 4 * index[k], 4);
+    }
+    check_texture(tex[1], 64, 32, expanded, 6);
+
+    //RGL_MIPMAPS chains everything, RGB included
+    rglEnable(RGL_MIPMAPS);
+    glBindTexture(GL_TEXTURE_2D, tex[2]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 64, 32, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    rglDisable(RGL_MIPMAPS);
+    TEST_CHECK(rglGetTexobj(tex[2])->MipLevels == 6, "RGL_MIPMAPS: %u levels", rglGetTexobj(tex[2])->MipLevels);
+
+    glDeleteTextures(3, tex);
+    pix_arena_free(&arena);
+    return test_done();
+}
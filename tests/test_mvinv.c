@@ -0,0 +1,179 @@
+/*=============================================================================
+        Name    : test_mvinv.c
+        Purpose : the modelview inverse carried on the matrix stack stays the
+                  inverse through random stack traffic, and a pop back to a
+                  parent doesn't invert it again
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "maths.h"
+
+#define STEPS   200000
+#define SHIPS   50
+#define TURRETS 3
+
+static GLfloat test_rand_unit(void)
+{
+    return test_randf(-1.0f, 1.0f);
+}
+
+//one random operation on the modelview stack
+static void random_op(GLint* depth)
+{
+    GLfloat m[16];
+    GLuint i;
+
+    switch (test_rand() % 8)
+    {
+    case 0:
+        if (*depth < 14)
+        {
+            glPushMatrix();
+            (*depth)++;
+        }
+        break;
+    case 1:
+        if (*depth > 0)
+        {
+            glPopMatrix();
+            (*depth)--;
+        }
+        break;
+    case 2:
+        glLoadIdentity();
+        break;
+    case 3:
+        for (i = 0; i < 16; i++)
+        {
+            m[i] = test_rand_unit();
+        }
+        if (test_rand() & 1)
+        {
+            m[3] = m[7] = m[11] = 0.0f;
+            m[15] = 1.0f;
+        }
+        else
+        {
+            m[15] += 2.0f;
+        }
+        glLoadMatrixf(m);
+        break;
+    case 4:
+        for (i = 0; i < 16; i++)
+        {
+            m[i] = test_rand_unit();
+        }
+        m[3] = m[7] = m[11] = 0.0f;
+        m[15] = 1.0f;
+        glMultMatrixf(m);
+        break;
+    case 5:
+        glTranslatef(test_rand_unit(), test_rand_unit(), test_rand_unit());
+        break;
+    case 6:
+        glRotatef(180.0f * test_rand_unit(), test_rand_unit(), test_rand_unit(), 1.0f);
+        break;
+    default:
+        //2D_NO_ROT
+        glLoadIdentity();
+        glTranslatef(test_rand_unit(), test_rand_unit(), 0.0f);
+        glScalef(2.0f, 3.0f, 1.0f);
+    }
+}
+
+static void lit_batch(void)
+{
+    GLuint i;
+
+    glBegin(GL_TRIANGLES);
+    for (i = 0; i < 12; i++)
+    {
+        glNormal3f(0.0f, 0.0f, 1.0f);
+        glVertex3f(test_rand_unit(), test_rand_unit(), -5.0f + test_rand_unit());
+    }
+    glEnd();
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLfloat fresh[16];
+    GLuint step, i, s, t, checked = 0, bad = 0, inverses;
+    GLint depth = 0;
+
+    test_init();
+    ctx = gl_get_context_ext();
+    glMatrixMode(GL_MODELVIEW);
+
+    /* whenever the context holds the inverse as current it has to be what
+       inverting the matrix now gives, bit for bit.  a lit draw (inverting
+       if need be) comes along every few steps, as in a game */
+    for (step = 0; step < STEPS; step++)
+    {
+        random_op(&depth);
+        if (ctx->NewMask & NEW_MODELVIEW)
+        {
+            gl_update_modelview();
+        }
+        if (!(ctx->NewMask & NEW_MODELVIEWINV))
+        {
+            invert_matrix_type(ctx->ModelViewMatrix, ctx->ModelViewMatrixType, fresh);
+            for (i = 0; i < 16 && ctx->ModelViewInv[i] == fresh[i]; i++)
+                ;
+            if (i < 16 && bad++ < 5)
+            {
+                printf("step %u (type %d, depth %d): inverse[%u] %g, fresh %g\n", step,
+                       ctx->ModelViewMatrixType, depth, i, ctx->ModelViewInv[i], fresh[i]);
+            }
+            checked++;
+        }
+        if (test_rand() % 3 == 0)
+        {
+            gl_invert_modelview();
+        }
+    }
+    TEST_CHECK(bad == 0, "%u of %u carried inverses stale", bad, checked);
+    TEST_CHECK(checked > STEPS / 5, "only %u of %u steps had a current inverse", checked, STEPS);
+    while (depth-- > 0)
+    {
+        glPopMatrix();
+    }
+
+    /* ships with turrets, the hull drawn again after each turret's pop.
+       only the hull & the turrets are inverted, not the parent after a pop */
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(-1.0, 1.0, -0.75, 0.75, 1.0, 1000.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslatef(0.0f, 0.0f, -50.0f);
+    glFlush();
+    TEST_CHECK(rglModelViewInverses() == 0, "glFlush didn't reset the count");
+    for (s = 0; s < SHIPS; s++)
+    {
+        glPushMatrix();
+        glTranslatef(20.0f * test_rand_unit(), 20.0f * test_rand_unit(), 20.0f * test_rand_unit());
+        glRotatef(180.0f * test_rand_unit(), test_rand_unit(), test_rand_unit(), 1.0f);
+        lit_batch();
+        for (t = 0; t < TURRETS; t++)
+        {
+            glPushMatrix();
+            glTranslatef(test_rand_unit(), test_rand_unit(), test_rand_unit());
+            glRotatef(90.0f * test_rand_unit(), 0.0f, 0.0f, 1.0f);
+            lit_batch();
+            glPopMatrix();
+            lit_batch();
+        }
+        glPopMatrix();
+    }
+    inverses = rglModelViewInverses();
+    TEST_CHECK(inverses == SHIPS * (1 + TURRETS), "%u inverses for %u ships, want %u",
+               inverses, SHIPS, SHIPS * (1 + TURRETS));
+    glFlush();
+
+    return test_done();
+}
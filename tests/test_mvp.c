@@ -0,0 +1,227 @@
+/*=============================================================================
+        Name    : test_mvp.c
+        Purpose : the cached modelview-projection product stays the product
+                  through random matrix stack traffic, and drawing picks up
+                  every change
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+#include "maths.h"
+
+#define STEPS 100000
+
+static GLuint drawChecks = 0;
+
+static GLfloat test_rand_unit(void)
+{
+    return test_randf(-1.0f, 1.0f);
+}
+
+//one random matrix operation on the modelview or projection stack
+static void random_op(GLuint mode, GLint depth[2])
+{
+    GLfloat m[16];
+    GLuint i;
+
+    glMatrixMode(mode ? GL_PROJECTION : GL_MODELVIEW);
+    switch (test_rand() % 8)
+    {
+    case 0:
+        if (depth[mode] < (mode ? 6 : 14))
+        {
+            glPushMatrix();
+            depth[mode]++;
+        }
+        break;
+    case 1:
+        if (depth[mode] > 0)
+        {
+            glPopMatrix();
+            depth[mode]--;
+        }
+        break;
+    case 2:
+        glLoadIdentity();
+        break;
+    case 3:
+        for (i = 0; i < 16; i++)
+        {
+            m[i] = test_rand_unit();
+        }
+        if (test_rand() & 1)
+        {
+            m[3] = m[7] = m[11] = 0.0f;
+            m[15] = 1.0f;
+        }
+        glLoadMatrixf(m);
+        break;
+    case 4:
+        for (i = 0; i < 16; i++)
+        {
+            m[i] = test_rand_unit();
+        }
+        m[3] = m[7] = m[11] = 0.0f;
+        m[15] = 1.0f;
+        glMultMatrixf(m);
+        break;
+    case 5:
+        glTranslatef(test_rand_unit(), test_rand_unit(), test_rand_unit());
+        break;
+    case 6:
+        glRotatef(180.0f * test_rand_unit(), test_rand_unit(), test_rand_unit(), 1.0f);
+        break;
+    default:
+        if (mode)
+        {
+            glLoadIdentity();
+            if (test_rand() & 1)
+            {
+                glFrustum(-1.0, 1.0, -1.0, 1.0, 1.0, 100.0);
+            }
+            else
+            {
+                glOrtho(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+            }
+        }
+        else
+        {
+            glScalef(2.0f, 2.0f, 2.0f);
+        }
+        break;
+    }
+}
+
+//the product & its classification against projection * modelview
+static GLboolean check_mvp(GLcontext* ctx, GLuint step)
+{
+    GLfloat ref[16];
+    GLfloat const* p = ctx->ModelViewProjectionMatrix;
+    GLint type = ctx->ModelViewProjectionMatrixType;
+    GLuint i;
+
+    mat4_mult(ref, ctx->ProjectionMatrix, ctx->ModelViewMatrix);
+    for (i = 0; i < 16; i++)
+    {
+        if (fabs(ref[i] - p[i]) > 1.0e-6 * (1.0 + fabs(ref[i])))
+        {
+            TEST_CHECK(0, "step %u element %u: %g, %g expected", step, i, p[i], ref[i]);
+            return GL_FALSE;
+        }
+    }
+    if ((type == MATRIX_3D || type == MATRIX_2D || type == MATRIX_2D_NO_ROT || type == MATRIX_ORTHO) &&
+        !(p[3] == 0.0f && p[7] == 0.0f && p[11] == 0.0f && p[15] == 1.0f))
+    {
+        TEST_CHECK(0, "step %u: type %d with a projective bottom row", step, type);
+        return GL_FALSE;
+    }
+    if (type == MATRIX_IDENTITY &&
+        !(ctx->ModelViewMatrixType == MATRIX_IDENTITY && ctx->ProjectionMatrixType == MATRIX_IDENTITY))
+    {
+        TEST_CHECK(0, "step %u: identity product of non-identity matrices", step);
+        return GL_FALSE;
+    }
+    if (ctx->NewMask & NEW_MVP)
+    {
+        TEST_CHECK(0, "step %u: NEW_MVP left set", step);
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+
+//c = m v, m column major as the GL keeps it
+static void transform(GLfloat c[4], GLfloat const m[16], GLfloat const v[4])
+{
+    GLuint i;
+
+    for (i = 0; i < 4; i++)
+    {
+        c[i] = m[i] * v[0] + m[4 + i] * v[1] + m[8 + i] * v[2] + m[12 + i] * v[3];
+    }
+}
+
+//draw a strip of vertices and compare their window x & y with the matrices'.
+//only when they're all in the view volume, so every one gets mapped
+static GLboolean check_draw(GLcontext* ctx, GLuint step)
+{
+    GLfloat obj[12][4], clip[12][4], m[16];
+    vertex_buffer* VB = ctx->VB;
+    GLuint i;
+
+    mat4_mult(m, ctx->ProjectionMatrix, ctx->ModelViewMatrix);
+    for (i = 0; i < 12; i++)
+    {
+        obj[i][0] = test_randf(-0.5f, 0.5f);
+        obj[i][1] = test_randf(-0.5f, 0.5f);
+        obj[i][2] = test_randf(-0.5f, 0.5f);
+        obj[i][3] = 1.0f;
+        transform(clip[i], m, obj[i]);
+        if (!(clip[i][3] > 1.0e-3f &&
+              fabs(clip[i][0]) < 0.99f * clip[i][3] &&
+              fabs(clip[i][1]) < 0.99f * clip[i][3] &&
+              fabs(clip[i][2]) < 0.99f * clip[i][3]))
+        {
+            return GL_TRUE;
+        }
+    }
+
+    glBegin(GL_TRIANGLE_STRIP);
+    for (i = 0; i < 12; i++)
+    {
+        glVertex3fv(obj[i]);
+    }
+    glEnd();
+
+    for (i = 0; i < 12; i++)
+    {
+        GLfloat wx = clip[i][0] / clip[i][3] * ctx->Viewport.Sx + ctx->Viewport.Tx;
+        GLfloat wy = clip[i][1] / clip[i][3] * ctx->Viewport.Sy + ctx->Viewport.Ty;
+
+        if (fabs(VB->Win[i][0] - wx) > 1.0e-3 * (1.0 + fabs(wx)) ||
+            fabs(VB->Win[i][1] - wy) > 1.0e-3 * (1.0 + fabs(wy)))
+        {
+            TEST_CHECK(0, "step %u vertex %u: window (%g, %g), (%g, %g) expected",
+                       step, i, VB->Win[i][0], VB->Win[i][1], wx, wy);
+            return GL_FALSE;
+        }
+    }
+    drawChecks++;
+    return GL_TRUE;
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLint depth[2] = { 0, 0 };
+    GLuint step;
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    for (step = 0; step < STEPS; step++)
+    {
+        random_op(test_rand() & 1, depth);
+        if (test_rand() % 3 != 0)
+        {
+            continue;
+        }
+        if (test_rand() % 8 == 0)
+        {
+            if (!check_draw(ctx, step))
+            {
+                break;
+            }
+        }
+        gl_update_mvp();
+        if (!check_mvp(ctx, step))
+        {
+            break;
+        }
+    }
+
+    printf("%u draws checked\n", drawChecks);
+    TEST_CHECK(drawChecks >= 100, "only %u draws in the view volume", drawChecks);
+    return test_done();
+}
@@ -0,0 +1,167 @@
+/*=============================================================================
+        Name    : test_normals.c
+        Purpose : the scalar, SSE2 & AVX2 normal transforms against a double
+                  precision reference, plain, rescaled & normalized, with
+                  ragged counts that mustn't write past the end
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+#include "simd.h"
+
+#define N       300
+#define TRIALS  1000
+#define SCALE   0.7f
+
+#define IMPL_SCALAR 0
+#define IMPL_SSE2   1
+#define IMPL_AVX2   2
+
+//the scalar rescale & normalize go through fsqrtf / frsqrt
+#if RGL_SQRT_TABLE
+#define SCALAR_SQRT_TOLERANCE 1.0e-4
+#else
+#define SCALAR_SQRT_TOLERANCE 1.0e-5
+#endif
+#define TOLERANCE 1.0e-5
+
+//kvb.c's, which has no header of its own
+void gl_xform_normals_3fv(GLuint n, GLfloat v[][3], GLfloat const m[16],
+                          GLfloat u[][3], GLboolean normalize, GLboolean rescale);
+
+static char const* implNames[3] = { "scalar", "sse2", "avx2" };
+static char const* modeNames[3] = { "plain", "rescale", "normalize" };
+
+//one implementation's normals for one mode
+static void xform(GLcontext* ctx, GLuint impl, GLuint mode, GLuint n,
+                  GLfloat v[][3], GLfloat const m[16], GLfloat u[][3])
+{
+    GLboolean sse2 = ctx->CpuSSE2, avx2 = ctx->CpuAVX2;
+
+    switch (impl)
+    {
+    case IMPL_SCALAR:
+        ctx->CpuSSE2 = ctx->CpuAVX2 = GL_FALSE;
+        gl_xform_normals_3fv(n, v, m, u, mode == SIMD_NORMALS_NORMALIZE,
+                             mode == SIMD_NORMALS_RESCALE);
+        ctx->CpuSSE2 = sse2;
+        ctx->CpuAVX2 = avx2;
+        break;
+#if SIMD_X86
+    case IMPL_SSE2:
+        simd_sse2_xform_normals(mode, n, &v[0][0], m, &u[0][0], SCALE);
+        break;
+    case IMPL_AVX2:
+        simd_avx2_xform_normals(mode, n, &v[0][0], m, &u[0][0], SCALE);
+        break;
+#endif
+    }
+}
+
+int main(void)
+{
+    static GLfloat u[N + 8][3], v[N + 8][3];
+    GLcontext* ctx;
+    GLfloat m[16];
+    GLuint trial, impl, mode, n, i, k, impls;
+    double worst[3][3] = { { 0.0 } };
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    //the scalar path skips an identity modelview
+    glMatrixMode(GL_MODELVIEW);
+    glRotatef(30.0f, 1.0f, 1.0f, 0.0f);
+    gl_update_modelview();
+
+    impls = !SIMD_X86 ? 1 : ctx->CpuAVX2 ? 3 : ctx->CpuSSE2 ? 2 : 1;
+
+    for (trial = 0; trial < TRIALS; trial++)
+    {
+        for (i = 0; i < 16; i++)
+        {
+            m[i] = test_randf(-3.0f, 3.0f);
+        }
+        n = (trial % 7 == 0) ? test_rand() % 20 : 1 + test_rand() % N;
+        for (i = 0; i < n + 8; i++)
+        {
+            for (k = 0; k < 3; k++)
+            {
+                u[i][k] = test_randf(-1.0f, 1.0f) * ((trial & 1) ? 1.0f : 100.0f);
+            }
+        }
+        if (trial % 5 == 0)
+        {
+            u[0][0] = u[0][1] = u[0][2] = 0.0f;
+        }
+
+        for (mode = 0; mode < 3; mode++)
+        {
+            //what the scalar rescale works out from the matrix
+            double mscale = 1.0 / sqrt((double)m[2]*m[2] + (double)m[6]*m[6] + (double)m[10]*m[10]);
+
+            for (impl = 0; impl < impls; impl++)
+            {
+                double scale = (mode != SIMD_NORMALS_RESCALE) ? 1.0 : (impl == IMPL_SCALAR) ? mscale : SCALE;
+
+                memcpy(v, u, sizeof(v));
+                xform(ctx, impl, mode, n, v, m, u);
+                for (i = n; i < n + 8; i++)
+                {
+                    if (memcmp(v[i], u[i], sizeof(v[i])) != 0)
+                    {
+                        TEST_CHECK(0, "%s %s wrote normal %u of %u", implNames[impl], modeNames[mode], i, n);
+                        break;
+                    }
+                }
+
+                for (i = 0; i < n; i++)
+                {
+                    double t[3], len, ref, e;
+
+                    for (k = 0; k < 3; k++)
+                    {
+                        t[k] = (double)u[i][0] * m[4*k] + (double)u[i][1] * m[4*k + 1] +
+                               (double)u[i][2] * m[4*k + 2];
+                    }
+                    len = sqrt(t[0]*t[0] + t[1]*t[1] + t[2]*t[2]);
+                    for (k = 0; k < 3; k++)
+                    {
+                        if (mode == SIMD_NORMALS_NORMALIZE)
+                        {
+                            //degenerate normals are left as transformed
+                            ref = (len > 1.0e-19) ? t[k] / len : t[k];
+                            e = fabs(v[i][k] - ref);
+                        }
+                        else
+                        {
+                            ref = t[k] * scale;
+                            e = fabs(v[i][k] - ref) / (len * scale + 1.0e-30);
+                        }
+                        if (e > worst[impl][mode])
+                        {
+                            worst[impl][mode] = e;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (impl = 0; impl < impls; impl++)
+    {
+        printf("%-6s plain %.2g, rescale %.2g, normalize %.2g\n", implNames[impl],
+               worst[impl][0], worst[impl][1], worst[impl][2]);
+        for (mode = 0; mode < 3; mode++)
+        {
+            double tolerance = (impl == IMPL_SCALAR && mode != SIMD_NORMALS_PLAIN)
+                             ? SCALAR_SQRT_TOLERANCE : TOLERANCE;
+            TEST_CHECK(worst[impl][mode] < tolerance, "%s %s off by %g",
+                       implNames[impl], modeNames[mode], worst[impl][mode]);
+        }
+    }
+
+    return test_done();
+}
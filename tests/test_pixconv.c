@@ -0,0 +1,233 @@
+/*=============================================================================
+        Name    : test_pixconv.c
+        Purpose : pix_convert, pix_convert_masks & pix_expand_index give the
+                  old per pixel blitters' results, byte for byte, on every
+                  path and at every row length, without writing past a row
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "pixconv.h"
+
+#define GUARD 0xCD
+
+static char const* const names[PIX_FORMATS] =
+    { "RGBA", "ARGB8888", "XRGB8888", "RGB565", "XRGB1555", "ARGB4444", "INDEX8", "L8" };
+
+//the d3d_blt_ loops' pixel, one at a time
+static GLuint reference(GLuint dformat, GLuint sformat, GLubyte const* p)
+{
+    GLuint r, g, b, a, s;
+
+    if (sformat == PIX_RGBA)
+    {
+        r = p[0];
+        g = p[1];
+        b = p[2];
+        a = p[3];
+        switch (dformat)
+        {
+        case PIX_ARGB8888:
+            return (a << 24) | (r << 16) | (g << 8) | b;
+        case PIX_XRGB8888:
+            return (r << 16) | (g << 8) | b;
+        case PIX_RGB565:
+            return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+        case PIX_XRGB1555:
+            return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+        case PIX_ARGB4444:
+            return ((a >> 4) << 12) | ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4);
+        }
+    }
+    else
+    {
+        s = p[0] | (p[1] << 8);
+        a = (s >> 12) & 15;
+        r = (s >> 8) & 15;
+        g = (s >> 4) & 15;
+        b = s & 15;
+        switch (dformat)
+        {
+        case PIX_ARGB8888:
+            return (a << 28) | (r << 20) | (g << 12) | (b << 4);
+        case PIX_XRGB8888:
+            return (r << 20) | (g << 12) | (b << 4);
+        case PIX_RGB565:
+            return (r << 12) | (g << 7) | (b << 1);
+        case PIX_XRGB1555:
+            return (r << 11) | (g << 6) | (b << 1);
+        case PIX_ARGB4444:
+            return s;
+        }
+    }
+    return 0;
+}
+
+static GLuint fetch(GLubyte const* p, GLuint bytes)
+{
+    return (bytes == 4) ? (p[0] | (p[1] << 8) | (p[2] << 16) | ((GLuint)p[3] << 24))
+                        : (GLuint)(p[0] | (p[1] << 8));
+}
+
+//every pixel against reference, and the pitch padding untouched
+static void check_image(char const* how, GLuint path, GLuint dformat, GLuint sformat,
+                        GLubyte const* dst, GLint dpitch, GLubyte const* src, GLint spitch,
+                        GLsizei width, GLsizei height)
+{
+    GLuint db = pix_bytes(dformat), sb = pix_bytes(sformat);
+    GLuint want, got;
+    GLint x, y, q;
+
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            want = reference(dformat, sformat, src + y * spitch + x * sb);
+            got = fetch(dst + y * dpitch + x * db, db);
+            if (want != got)
+            {
+                TEST_CHECK(want == got, "%s path %u %s -> %s, %dx%d at %d,%d: %08x",
+                           how, path, names[sformat], names[dformat], width, height, x, y, got);
+                return;
+            }
+        }
+        for (q = width * db; q < dpitch; q++)
+        {
+            if (dst[y * dpitch + q] != GUARD)
+            {
+                TEST_CHECK(dst[y * dpitch + q] == GUARD, "%s path %u %s -> %s, %dx%d: wrote past row %d",
+                           how, path, names[sformat], names[dformat], width, height, y);
+                return;
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    //pix_convert_masks' description of each of pix_convert's layouts
+    static GLint const bits[][4] =
+        { { 8, 8, 8, 8 }, { 8, 8, 8, 0 }, { 5, 6, 5, 0 }, { 5, 5, 5, 0 }, { 4, 4, 4, 4 } };
+    static GLint const shift[][4] =
+        { { 16, 8, 0, 24 }, { 16, 8, 0, 0 }, { 11, 5, 0, 0 }, { 10, 5, 0, 0 }, { 8, 4, 0, 12 } };
+    static GLuint const sformats[2] = { PIX_RGBA, PIX_ARGB4444 };
+    static GLubyte const texel[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+    GLcontext* ctx;
+    GLboolean sse2, avx2;
+    GLuint path, s, sformat, dformat, sb, db;
+    GLint width, height, spitch, dpitch, i, x, y;
+    GLubyte *src, *dst;
+    GLuint out[4], palette[256];
+    GLushort out16[64];
+    GLubyte index[37 * 3], rgba[64 * 4];
+    GLuint expanded[40 * 3];
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+
+    //a few known answers, so reference itself is held to something
+    pix_convert(PIX_ARGB8888, out, 4, PIX_RGBA, texel, 4, 1, 1);
+    TEST_CHECK(out[0] == 0x78123456, "RGBA -> ARGB8888 %08x", out[0]);
+    pix_convert(PIX_RGB565, out, 4, PIX_RGBA, texel, 4, 1, 1);
+    TEST_CHECK((out[0] & 0xFFFF) == 0x11AA, "RGBA -> RGB565 %04x", out[0] & 0xFFFF);
+    pix_convert(PIX_ARGB4444, out, 4, PIX_RGBA, texel, 4, 1, 1);
+    TEST_CHECK((out[0] & 0xFFFF) == 0x7135, "RGBA -> ARGB4444 %04x", out[0] & 0xFFFF);
+
+    for (path = 0; path < 3; path++)
+    {
+        ctx->CpuSSE2 = (GLboolean)(sse2 && path >= 1);
+        ctx->CpuAVX2 = (GLboolean)(avx2 && path == 2);
+
+        for (s = 0; s < 2; s++)
+        {
+            sformat = sformats[s];
+            sb = pix_bytes(sformat);
+            for (dformat = PIX_ARGB8888; dformat <= PIX_ARGB4444; dformat++)
+            {
+                db = pix_bytes(dformat);
+                //every row length through a couple of AVX2 widths, the
+                //vector loops' tails included, & padded pitches
+                for (width = 1; width < 70; width += 3)
+                {
+                    for (height = 1; height < 5; height += 2)
+                    {
+                        spitch = width * sb + (width % 3) * sb;
+                        dpitch = width * db + ((width % 5) + 1) * db;
+                        src = (GLubyte*)malloc(spitch * height);
+                        dst = (GLubyte*)malloc(dpitch * height);
+                        for (i = 0; i < spitch * height; i++)
+                        {
+                            src[i] = (GLubyte)test_rand();
+                        }
+
+                        memset(dst, GUARD, dpitch * height);
+                        TEST_CHECK(pix_convert(dformat, dst, dpitch, sformat, src, spitch, width, height),
+                                   "%s -> %s refused", names[sformat], names[dformat]);
+                        check_image("pix_convert", path, dformat, sformat,
+                                    dst, dpitch, src, spitch, width, height);
+
+                        memset(dst, GUARD, dpitch * height);
+                        pix_convert_masks(dst, dpitch, db, bits[dformat - 1], shift[dformat - 1],
+                                          sformat, src, spitch, width, height);
+                        check_image("pix_convert_masks", path, dformat, sformat,
+                                    dst, dpitch, src, spitch, width, height);
+
+                        free(src);
+                        free(dst);
+                    }
+                }
+            }
+        }
+
+        //a layout pix_convert doesn't know: A1R5G5B5 the generic way
+        {
+            static GLint const bits1555[4] = { 5, 5, 5, 1 };
+            static GLint const shift1555[4] = { 10, 5, 0, 15 };
+            GLuint want;
+
+            for (i = 0; i < 64 * 4; i++)
+            {
+                rgba[i] = (GLubyte)test_rand();
+            }
+            pix_convert_masks(out16, 64 * 2, 2, bits1555, shift1555, PIX_RGBA, rgba, 64 * 4, 64, 1);
+            for (x = 0; x < 64; x++)
+            {
+                want = ((rgba[4 * x] >> 3) << 10) | ((rgba[4 * x + 1] >> 3) << 5) |
+                       (rgba[4 * x + 2] >> 3) | ((rgba[4 * x + 3] >> 7) << 15);
+                if (out16[x] != want)
+                {
+                    TEST_CHECK(out16[x] == want, "path %u A1R5G5B5 at %d: %04x, not %04x",
+                               path, x, out16[x], want);
+                    break;
+                }
+            }
+        }
+
+        //a palette, 37 wide into a 40 texel pitch
+        for (i = 0; i < 256; i++)
+        {
+            palette[i] = test_rand() ^ (test_rand() << 16);
+        }
+        for (i = 0; i < 37 * 3; i++)
+        {
+            index[i] = (GLubyte)test_rand();
+        }
+        pix_expand_index(expanded, 40 * 4, 4, index, 37, palette, 37, 3);
+        for (y = 0; y < 3; y++)
+        {
+            for (x = 0; x < 37; x++)
+            {
+                TEST_CHECK(expanded[y * 40 + x] == palette[index[y * 37 + x]],
+                           "path %u index %d,%d", path, x, y);
+            }
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+
+    return test_done();
+}
@@ -0,0 +1,97 @@
+/*=============================================================================
+        Name    : test_raster.c
+        Purpose : the screen row tables & span scratch are sized to each
+                  context's buffer, from 320x200 to 8K, guard rows included
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+DLL void rglDeleteWindow(GLint);
+
+static void check_size(GLuint width, GLuint height)
+{
+    GLcontext* ctx;
+    GLint dims[2];
+    GLuint y, rows, pitch, bad = 0;
+    GLubyte *block, *end, *alpha;
+    GLushort* src;
+
+    rglSelectDevice(NULL_DEVICE_NAME, "");
+    if (!rauxInitPosition(0, 0, width, height, 16))
+    {
+        TEST_CHECK(0, "no %ux%u context", width, height);
+        return;
+    }
+    ctx = gl_get_context_ext();
+    rows = height + RASTER_GUARD_ROWS;
+    pitch = ctx->Buffer.Pitch / ctx->Buffer.ByteMult;
+
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, dims);
+    TEST_CHECK(dims[0] == (GLint)width && dims[1] == (GLint)height,
+               "%ux%u: GL_MAX_VIEWPORT_DIMS %dx%d", width, height, dims[0], dims[1]);
+    TEST_CHECK(ctx->MaxWidth == width && ctx->MaxHeight == height,
+               "%ux%u: tables for %ux%u", width, height, ctx->MaxWidth, ctx->MaxHeight);
+
+    //rows past the bottom alias row 1, for spans that step one too far
+    for (y = 0; y < rows; y++)
+    {
+        GLuint r = (y < height) ? y : 1;
+        bad += ctx->scrMult[y] != (GLint)(r * pitch);
+        bad += ctx->zMult[y] != (GLint)(r * width);
+        bad += ctx->scrMultByte[y] != (GLint)((y < height) ? (height - 1 - y) * ctx->Buffer.Pitch
+                                                           : ctx->Buffer.Pitch);
+    }
+    TEST_CHECK(bad == 0, "%ux%u: %u bad table entries", width, height, bad);
+
+    /* a full width span laid out as gl_mmx_blend_span does, 565 pixels then
+       8 byte aligned alphas, inside the block & clear of the tables.  (the
+       blender itself is MSVC inline asm, built only with rgl.sln) */
+    block = (GLubyte*)ctx->RasterTables;
+    end = block + 3 * rows * sizeof(GLint) + 3 * width + 16;
+    src = (GLushort*)ctx->SpanBuffer;
+    alpha = ctx->SpanBuffer + 2 * width;
+    while ((size_t)alpha & 7)
+    {
+        alpha++;
+    }
+    TEST_CHECK(((size_t)ctx->SpanBuffer & 7) == 0, "%ux%u: span scratch unaligned", width, height);
+    TEST_CHECK(ctx->SpanBuffer >= (GLubyte*)(ctx->scrMultByte + rows) && alpha + width <= end,
+               "%ux%u: span scratch outside its block", width, height);
+    for (y = 0; y < width; y++)
+    {
+        src[y] = (GLushort)FORM_RGB565(y & 255, 128, 255 - (y & 255));
+        alpha[y] = (GLubyte)y;
+    }
+    TEST_CHECK(ctx->scrMultByte[rows - 1] == (GLint)ctx->Buffer.Pitch, "%ux%u: the span overwrote the tables",
+               width, height);
+
+    //and something drawn corner to corner
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0.0, width, 0.0, height, -1.0, 1.0);
+    glBegin(GL_TRIANGLES);
+    glVertex3f(0.0f, 0.0f, 0.0f);
+    glVertex3f((GLfloat)width, 0.0f, 0.0f);
+    glVertex3f(0.0f, (GLfloat)height, 0.0f);
+    glEnd();
+    glFlush();
+    TEST_CHECK(glGetError() == GL_NO_ERROR, "%ux%u: GL error", width, height);
+
+    rglDeleteWindow(0);
+}
+
+int main(void)
+{
+    static GLuint const sizes[][2] =
+        { { 640, 480 }, { 320, 200 }, { 1920, 1080 }, { 5120, 1440 }, { 7680, 4320 }, { 320, 200 } };
+    GLuint i;
+
+    rglSetAllocs(test_alloc, test_free);
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        check_size(sizes[i][0], sizes[i][1]);
+    }
+    return test_done();
+}
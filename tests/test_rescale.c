@@ -0,0 +1,275 @@
+/*=============================================================================
+        Name    : test_rescale.c
+        Purpose : pix_rescale: the C, SSE2 & AVX2 paths agree byte for byte
+                  and stay inside the destination, and the box & bilinear
+                  filters hold a PSNR floor against a float reference
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+#include "pixconv.h"
+
+#define GUARD 0x5A
+
+//the filters in doubles, channels of a packed float image
+static void reference(GLuint filter, GLint channels, GLfloat* out, GLint dw, GLint dh,
+                      GLfloat const* in, GLint sw, GLint sh)
+{
+    GLint x, y, c, x0, x1, y0, y1, xx, yy;
+    double v, fx, fy, wx, wy;
+
+    for (y = 0; y < dh; y++)
+    {
+        for (x = 0; x < dw; x++)
+        {
+            for (c = 0; c < channels; c++)
+            {
+                v = 0.0;
+                if (filter == PIX_BILINEAR)
+                {
+                    fy = (y + 0.5) * sh / dh - 0.5;
+                    fx = (x + 0.5) * sw / dw - 0.5;
+                    fy = (fy < 0.0) ? 0.0 : fy;
+                    fx = (fx < 0.0) ? 0.0 : fx;
+                    y0 = (GLint)fy;
+                    x0 = (GLint)fx;
+                    wy = fy - y0;
+                    wx = fx - x0;
+                    if (y0 >= sh - 1)
+                    {
+                        y0 = sh - 1;
+                        wy = 0.0;
+                    }
+                    if (x0 >= sw - 1)
+                    {
+                        x0 = sw - 1;
+                        wx = 0.0;
+                    }
+                    y1 = MIN2(y0 + 1, sh - 1);
+                    x1 = MIN2(x0 + 1, sw - 1);
+                    v = (1.0 - wy) * ((1.0 - wx) * in[(y0 * sw + x0) * channels + c] +
+                                      wx * in[(y0 * sw + x1) * channels + c]) +
+                        wy * ((1.0 - wx) * in[(y1 * sw + x0) * channels + c] +
+                              wx * in[(y1 * sw + x1) * channels + c]);
+                }
+                else
+                {
+                    //the texels under the destination texel, or the one
+                    //under its centre when magnifying
+                    y0 = (y * sh) / dh;
+                    y1 = ((y + 1) * sh) / dh;
+                    if (dh >= sh)
+                    {
+                        y0 = ((2 * y + 1) * sh) / (2 * dh);
+                        y1 = y0 + 1;
+                    }
+                    x0 = (x * sw) / dw;
+                    x1 = ((x + 1) * sw) / dw;
+                    if (dw >= sw)
+                    {
+                        x0 = ((2 * x + 1) * sw) / (2 * dw);
+                        x1 = x0 + 1;
+                    }
+                    for (yy = y0; yy < y1; yy++)
+                    {
+                        for (xx = x0; xx < x1; xx++)
+                        {
+                            v += in[(yy * sw + xx) * channels + c];
+                        }
+                    }
+                    v /= (y1 - y0) * (x1 - x0);
+                }
+                out[(y * dw + x) * channels + c] = (GLfloat)v;
+            }
+        }
+    }
+}
+
+static double psnr(GLfloat const* a, GLfloat const* b, GLint n, double peak)
+{
+    double e = 0.0, d;
+    GLint i;
+
+    for (i = 0; i < n; i++)
+    {
+        d = a[i] - b[i];
+        e += d * d;
+    }
+    e /= n;
+    return (e == 0.0) ? 99.0 : 10.0 * log10(peak * peak / e);
+}
+
+//smooth, with a little noise, as texture art is
+static void make_image(GLubyte* p, GLint w, GLint h)
+{
+    GLint x, y, c;
+    double v;
+
+    for (y = 0; y < h; y++)
+    {
+        for (x = 0; x < w; x++)
+        {
+            for (c = 0; c < 4; c++)
+            {
+                v = 128.0 + 90.0 * sin(x * 0.07 * (c + 1) + y * 0.05) * cos(y * 0.031 * (c + 2)) +
+                    (GLint)(test_rand() % 21) - 10;
+                p[(y * w + x) * 4 + c] = (GLubyte)((v < 0.0) ? 0.0 : (v > 255.0) ? 255.0 : v);
+            }
+        }
+    }
+}
+
+static void check_paths(GLcontext* ctx, GLboolean sse2, GLboolean avx2, pix_arena* arena)
+{
+    static GLuint const formats[] = { PIX_RGBA, PIX_ARGB4444, PIX_L8, PIX_INDEX8, PIX_RGB565 };
+    static GLsizei const sizes[][4] =
+    {
+        { 64, 64, 32, 32 }, { 37, 23, 11, 7 }, { 100, 60, 256, 128 }, { 17, 9, 40, 50 },
+        { 1, 1, 9, 9 }, { 9, 9, 1, 1 }, { 300, 5, 7, 300 }, { 64, 32, 33, 65 },
+        { 2, 2, 3, 3 }, { 513, 3, 2, 1 }
+    };
+    GLuint f, filter, s, path, bytes;
+    GLsizei sw, sh, dw, dh, i, n;
+    GLubyte *src, *out[3];
+
+    for (f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        bytes = pix_bytes(formats[f]);
+        for (filter = PIX_NEAREST; filter <= PIX_BILINEAR; filter++)
+        {
+            for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+            {
+                sw = sizes[s][0];
+                sh = sizes[s][1];
+                dw = sizes[s][2];
+                dh = sizes[s][3];
+                n = dw * dh * bytes;
+                src = (GLubyte*)malloc(sw * sh * bytes);
+                for (i = 0; i < (GLsizei)(sw * sh * bytes); i++)
+                {
+                    src[i] = (GLubyte)test_rand();
+                }
+                for (path = 0; path < 3; path++)
+                {
+                    ctx->CpuSSE2 = (GLboolean)(sse2 && path >= 1);
+                    ctx->CpuAVX2 = (GLboolean)(avx2 && path == 2);
+                    out[path] = (GLubyte*)malloc(n + 1);
+                    out[path][n] = GUARD;
+                    //every other size with the arena, the rest without
+                    TEST_CHECK(pix_rescale(formats[f], filter, out[path], dw, dh, src, sw, sh,
+                                           (s & 1) ? arena : NULL),
+                               "format %u filter %u %dx%d -> %dx%d refused",
+                               formats[f], filter, sw, sh, dw, dh);
+                    TEST_CHECK(out[path][n] == GUARD, "path %u format %u filter %u %dx%d -> %dx%d: overrun",
+                               path, formats[f], filter, sw, sh, dw, dh);
+                }
+                TEST_CHECK(memcmp(out[0], out[1], n) == 0 && memcmp(out[0], out[2], n) == 0,
+                           "format %u filter %u %dx%d -> %dx%d: paths disagree",
+                           formats[f], filter, sw, sh, dw, dh);
+                for (path = 0; path < 3; path++)
+                {
+                    free(out[path]);
+                }
+                free(src);
+            }
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+}
+
+static void check_psnr(GLuint format, GLuint filter, GLsizei sw, GLsizei sh, GLsizei dw, GLsizei dh,
+                       double floor, pix_arena* arena)
+{
+    GLubyte *src = (GLubyte*)malloc(sw * sh * 4), *out = (GLubyte*)malloc(dw * dh * 4);
+    GLfloat *fsrc = (GLfloat*)malloc(sw * sh * 4 * sizeof(GLfloat));
+    GLfloat *fref = (GLfloat*)malloc(dw * dh * 4 * sizeof(GLfloat));
+    GLfloat *fout = (GLfloat*)malloc(dw * dh * 4 * sizeof(GLfloat));
+    GLushort *src16 = (GLushort*)src, *out16 = (GLushort*)out;
+    GLint i, c;
+    double peak, db;
+
+    make_image(src, sw, sh);
+    if (format == PIX_ARGB4444)
+    {
+        //4 bit channels, b g r a from the bottom
+        for (i = 0; i < sw * sh; i++)
+        {
+            src16[i] = (GLushort)((src[4 * i] >> 4) | ((src[4 * i + 1] >> 4) << 4) |
+                                  ((src[4 * i + 2] >> 4) << 8) | ((src[4 * i + 3] >> 4) << 12));
+        }
+        for (i = 0; i < sw * sh; i++)
+        {
+            for (c = 0; c < 4; c++)
+            {
+                fsrc[4 * i + c] = (GLfloat)((src16[i] >> (4 * c)) & 15);
+            }
+        }
+        peak = 15.0;
+    }
+    else
+    {
+        for (i = 0; i < sw * sh * 4; i++)
+        {
+            fsrc[i] = src[i];
+        }
+        peak = 255.0;
+    }
+
+    reference(filter, 4, fref, dw, dh, fsrc, sw, sh);
+    pix_rescale(format, filter, out, dw, dh, src, sw, sh, arena);
+    for (i = 0; i < dw * dh; i++)
+    {
+        for (c = 0; c < 4; c++)
+        {
+            fout[4 * i + c] = (format == PIX_ARGB4444) ? (GLfloat)((out16[i] >> (4 * c)) & 15)
+                                                       : (GLfloat)out[4 * i + c];
+        }
+    }
+    db = psnr(fref, fout, dw * dh * 4, peak);
+    printf("%-8s %3dx%-3d -> %3dx%-3d %-8s %5.1f dB\n", (format == PIX_ARGB4444) ? "ARGB4444" : "RGBA",
+           sw, sh, dw, dh, (filter == PIX_BOX) ? "box" : "bilinear", db);
+    TEST_CHECK(db >= floor, "%dx%d -> %dx%d filter %u: %.1f dB, under %.1f", sw, sh, dw, dh, filter, db, floor);
+
+    free(src);
+    free(out);
+    free(fsrc);
+    free(fref);
+    free(fout);
+}
+
+int main(void)
+{
+    static GLsizei const cases[][4] =
+    {
+        { 256, 256, 128, 128 }, { 256, 256, 64, 64 }, { 256, 128, 128, 128 },
+        { 200, 150, 256, 256 }, { 64, 64, 256, 256 }, { 256, 256, 100, 75 }
+    };
+    GLcontext* ctx;
+    pix_arena arena = { NULL, 0 };
+    GLuint c, filter;
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    check_paths(ctx, ctx->CpuSSE2, ctx->CpuAVX2, &arena);
+
+    //within rounding of the reference: 8 bit channels are good to about
+    //half a step, 50 dB; 4 bit ones to 32 dB of their 15
+    for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        for (filter = PIX_BOX; filter <= PIX_BILINEAR; filter++)
+        {
+            check_psnr(PIX_RGBA, filter, cases[c][0], cases[c][1], cases[c][2], cases[c][3], 50.0, &arena);
+        }
+    }
+    for (filter = PIX_BOX; filter <= PIX_BILINEAR; filter++)
+    {
+        check_psnr(PIX_ARGB4444, filter, 256, 256, 128, 128, 32.0, &arena);
+    }
+
+    pix_arena_free(&arena);
+    return test_done();
+}
@@ -0,0 +1,158 @@
+/*=============================================================================
+        Name    : test_specpow.c
+        Purpose : rglSpecPow's table & approx modes against libm pow over
+                  [0, 1], & the spechack passes' bytes against the exact mode
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include "rgltest.h"
+#include "kvb.h"
+
+#define SAMPLES (1 << 20)
+#define N       4096
+
+//kvb.c's, which has no header of its own
+void gl_spechack_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+void gl_spechack2_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+void gl_spechack3_shade_vertices(GLcontext*, GLuint, GLuint, GLfloat[][4], GLfloat[][3], GLubyte[][4]);
+
+static GLfloat const exps[] = { 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 11.0f, 20.0f, 32.0f, 64.0f, 128.0f };
+
+static GLfloat vertex[N][4], normal[N][3];
+static GLubyte color[N][4], exact[N][4];
+
+/* the lerp's error goes as exp^2 / SPEC_TABLE_SIZE^2 (1.8e-3 at 128); the
+   polynomials hold 4e-6 throughout.  both are well under an alpha step */
+static double bound(GLint mode, GLfloat e)
+{
+    if (mode == RGL_SPECPOW_TABLE && e >= 1.0f)
+    {
+        return 1.5e-7 * e * e + 1e-6;
+    }
+    return 5e-6;
+}
+
+static void check_eval(GLcontext* ctx, GLint mode, char const* name)
+{
+    GLuint k, i;
+    double err, worst, x;
+
+    rglSpecPow(mode);
+    for (k = 0; k < sizeof(exps) / sizeof(exps[0]); k++)
+    {
+        rglSpecExp(0, exps[k]);
+        worst = 0.0;
+        for (i = 1; i <= SAMPLES; i++)
+        {
+            x = (double)i / SAMPLES;
+            err = fabs((double)gl_spec_power(ctx, 0, (GLfloat)x) - pow(x, exps[k]));
+            worst = (err > worst) ? err : worst;
+        }
+        TEST_CHECK(worst <= bound(mode, exps[k]), "%s ^%g: error %.3g over %.3g",
+                   name, exps[k], worst, bound(mode, exps[k]));
+
+        //spechack2 doesn't clamp, the table mode hands x > 1 to pow
+        x = 1.25;
+        err = fabs((double)gl_spec_power(ctx, 0, (GLfloat)x) - pow(x, exps[k])) / pow(x, exps[k]);
+        TEST_CHECK(err <= 1e-5, "%s ^%g: 1.25 off by %.3g", name, exps[k], err);
+    }
+    rglSpecExp(0, -1.0f);
+}
+
+static void shade(GLcontext* ctx, GLuint pass)
+{
+    GLuint i;
+
+    for (i = 0; i < N; i++)
+    {
+        color[i][0] = color[i][1] = color[i][2] = color[i][3] = 255;
+    }
+    switch (pass)
+    {
+    case 0:
+        gl_spechack_shade_vertices(ctx, 0, N, vertex, normal, color);
+        break;
+    case 1:
+        gl_spechack2_shade_vertices(ctx, 0, N, vertex, normal, color);
+        break;
+    default:
+        gl_spechack3_shade_vertices(ctx, 0, N, vertex, normal, color);
+    }
+}
+
+static void check_passes(GLcontext* ctx)
+{
+    static GLint const modes[2] = { RGL_SPECPOW_TABLE, RGL_SPECPOW_APPROX };
+    GLuint pass, m, i, k;
+    GLint d, worst;
+
+    for (pass = 0; pass < 3; pass++)
+    {
+        rglSpecPow(RGL_SPECPOW_EXACT);
+        shade(ctx, pass);
+        memcpy(exact, color, sizeof(exact));
+        for (m = 0; m < 2; m++)
+        {
+            rglSpecPow(modes[m]);
+            shade(ctx, pass);
+            worst = 0;
+            for (i = 0; i < N; i++)
+            {
+                for (k = 0; k < 4; k++)
+                {
+                    d = abs((GLint)color[i][k] - (GLint)exact[i][k]);
+                    worst = (d > worst) ? d : worst;
+                }
+            }
+            TEST_CHECK(worst <= 1, "spechack%u mode %d: bytes off by %d", pass + 1, modes[m], worst);
+        }
+    }
+}
+
+int main(void)
+{
+    GLcontext* ctx;
+    GLfloat pos0[4] = { 0.3f, 0.2f, 1.0f, 0.0f };
+    GLfloat pos1[4] = { -0.5f, 0.2f, 1.0f, 0.0f };
+    GLfloat x, y, z, l;
+    GLuint i;
+
+    test_init();
+    ctx = gl_get_context_ext();
+
+    check_eval(ctx, RGL_SPECPOW_TABLE, "table");
+    check_eval(ctx, RGL_SPECPOW_APPROX, "approx");
+
+    rglSpecPow(RGL_SPECPOW_APPROX);
+    rglSpecPow(12345);
+    TEST_CHECK(glGetError() == GL_INVALID_ENUM, "a bad mode isn't an error");
+    TEST_CHECK(ctx->SpecularPow == RGL_SPECPOW_APPROX, "a bad mode changed the mode");
+
+    //unit normals facing the eye, 2 lights for spechack2
+    for (i = 0; i < N; i++)
+    {
+        x = test_randf(-1.0f, 1.0f);
+        y = test_randf(-1.0f, 1.0f);
+        z = test_randf(0.0f, 1.0f);
+        l = (GLfloat)sqrt(x * x + y * y + z * z);
+        normal[i][0] = x / l;
+        normal[i][1] = y / l;
+        normal[i][2] = z / l;
+        vertex[i][0] = x * 100.0f;
+        vertex[i][1] = y * 100.0f;
+        vertex[i][2] = -200.0f - z * 50.0f;
+        vertex[i][3] = 1.0f;
+    }
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glLightfv(GL_LIGHT0, GL_POSITION, pos0);
+    glEnable(GL_LIGHT1);
+    glLightfv(GL_LIGHT1, GL_POSITION, pos1);
+    gl_update_lighting(ctx);
+    check_passes(ctx);
+
+    rglSpecPow(RGL_SPECPOW_TABLE);
+    return test_done();
+}
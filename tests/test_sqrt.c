@@ -0,0 +1,62 @@
+/*=============================================================================
+        Name    : test_sqrt.c
+        Purpose : fsqrt, fsqrtf & frsqrt against libm over the ranges the
+                  lighting feeds them, for whichever engine is built in
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <math.h>
+#include <float.h>
+#include "rgltest.h"
+#include "maths.h"
+
+#if RGL_SQRT_TABLE
+#define SQRT_TOLERANCE 1.0e-4       //the table's ~14 bits
+#else
+#define SQRT_TOLERANCE 1.0e-5       //rsqrtss or the bit trick, with Newton
+#endif
+
+//worst relative error of each function over [lo, hi], stepped geometrically
+static void check_range(double lo, double hi, GLuint steps)
+{
+    double ratio = pow(hi / lo, 1.0 / (double)steps);
+    double x, ref, e, eSqrt = 0.0, eSqrtf = 0.0, eRsqrt = 0.0;
+    GLuint i;
+
+    for (i = 0, x = lo; i <= steps; i++, x *= ratio)
+    {
+        GLfloat xf = (GLfloat)x;
+
+        ref = sqrt((double)xf);
+        e = fabs(fsqrt(xf) - ref) / ref;
+        eSqrt = (e > eSqrt) ? e : eSqrt;
+        e = fabs(fsqrtf(xf) - ref) / ref;
+        eSqrtf = (e > eSqrtf) ? e : eSqrtf;
+        e = fabs(frsqrt(xf) * ref - 1.0);
+        eRsqrt = (e > eRsqrt) ? e : eRsqrt;
+    }
+    printf("[%g, %g]: fsqrt %.2g, fsqrtf %.2g, frsqrt %.2g\n", lo, hi, eSqrt, eSqrtf, eRsqrt);
+    TEST_CHECK(eSqrt < SQRT_TOLERANCE, "fsqrt off by %g in [%g, %g]", eSqrt, lo, hi);
+    TEST_CHECK(eSqrtf < SQRT_TOLERANCE, "fsqrtf off by %g in [%g, %g]", eSqrtf, lo, hi);
+    TEST_CHECK(eRsqrt < SQRT_TOLERANCE, "frsqrt off by %g in [%g, %g]", eRsqrt, lo, hi);
+}
+
+int main(void)
+{
+    test_init();
+    printf("fsqrt engine: %s\n", RGL_SQRT_TABLE ? "table" : "libm / rsqrt");
+
+    //normal lengths, then light distances squared
+    check_range(1.0e-2, 1.0e2, 200000);
+    check_range(1.0e-8, 1.0e16, 200000);
+
+    //below FLT_MIN the float ones give 0
+    TEST_CHECK(frsqrt(0.0f) == 0.0f, "frsqrt(0) = %g", frsqrt(0.0f));
+    TEST_CHECK(frsqrt(FLT_MIN * 0.5f) == 0.0f, "frsqrt(denormal) = %g", frsqrt(FLT_MIN * 0.5f));
+    TEST_CHECK(frsqrt(-1.0f) == 0.0f, "frsqrt(-1) = %g", frsqrt(-1.0f));
+    TEST_CHECK(fsqrtf(0.0f) == 0.0f, "fsqrtf(0) = %g", fsqrtf(0.0f));
+    TEST_CHECK(fsqrt(0.0) == 0.0, "fsqrt(0) = %g", fsqrt(0.0));
+
+    return test_done();
+}
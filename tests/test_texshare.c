@@ -0,0 +1,267 @@
+/*=============================================================================
+        Name    : test_texshare.c
+        Purpose : RGL_TEXTURE_SHARE: duplicate uploads share one image & device
+                  texture, the share is released with its last user, and a
+                  share without texels is confirmed by its second hash
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+#define NIMG 64             //distinct images
+#define NTEX 256            //uploads of them
+
+typedef struct
+{
+    GLenum   format;
+    GLsizei  width, height;
+    GLubyte* texels;
+    GLubyte* palette;
+} image;
+
+static image pool[NIMG];
+static GLuint which[NTEX];
+static GLubyte palettes[2][4 * 256];
+
+static GLuint image_bytes(image const* im)
+{
+    GLuint n = (GLuint)(im->width * im->height);
+
+    switch (im->format)
+    {
+    case GL_COLOR_INDEX:
+        return n;
+    case GL_RGBA16:
+        return 2 * n;
+    case GL_RGB:
+        return 3 * n;
+    default:
+        return 4 * n;
+    }
+}
+
+static void upload(GLuint name, image const* im)
+{
+    glBindTexture(GL_TEXTURE_2D, name);
+    if (im->format == GL_COLOR_INDEX)
+    {
+        glColorTable(GL_TEXTURE_2D, GL_RGBA, 256, GL_RGBA, GL_UNSIGNED_BYTE, im->palette);
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, im->format, im->width, im->height, 0,
+                 im->format, GL_UNSIGNED_BYTE, im->texels);
+}
+
+//does the texture hold the image, RGB widened to RGBA as the GL keeps it
+static GLboolean same_image(gl_texture_object const* to, image const* im)
+{
+    static GLubyte rgba[4 * 64 * 64];
+    GLubyte const* expect = im->texels;
+    GLuint n = image_bytes(im), i;
+
+    if (to == NULL || to->Data == NULL)
+    {
+        return GL_FALSE;
+    }
+    if (im->format == GL_RGB)
+    {
+        for (i = 0; i < (GLuint)(im->width * im->height); i++)
+        {
+            rgba[4*i + 0] = im->texels[3*i + 0];
+            rgba[4*i + 1] = im->texels[3*i + 1];
+            rgba[4*i + 2] = im->texels[3*i + 2];
+            rgba[4*i + 3] = 255;
+        }
+        expect = rgba;
+        n = 4 * im->width * im->height;
+    }
+    return memcmp(to->Data, expect, n) == 0;
+}
+
+//a pool of images in the formats Homeworld uploads, two of them the same
+//indices with different palettes, and a list of uploads with duplicates
+static void make_images(void)
+{
+    static GLsizei const sizes[] = { 8, 16, 32, 64 };
+    GLuint i, j, k, r;
+
+    for (k = 0; k < 4 * 256; k++)
+    {
+        palettes[0][k] = (GLubyte)test_rand();
+        palettes[1][k] = (GLubyte)test_rand();
+    }
+    for (i = 0; i < NIMG; i++)
+    {
+        image* im = &pool[i];
+
+        r = test_rand() % 100;
+        im->format = (r < 50) ? GL_COLOR_INDEX : (r < 80) ? GL_RGBA : (r < 95) ? GL_RGBA16 : GL_RGB;
+        im->width = sizes[test_rand() % 4];
+        im->height = sizes[test_rand() % 4];
+        im->palette = palettes[0];
+        im->texels = (GLubyte*)malloc(image_bytes(im));
+        for (k = 0; k < image_bytes(im); k++)
+        {
+            im->texels[k] = (GLubyte)test_rand();
+        }
+    }
+
+    for (i = 0; i < NIMG && pool[i].format != GL_COLOR_INDEX; i++) ;
+    for (j = i + 1; j < NIMG && pool[j].format != GL_COLOR_INDEX; j++) ;
+    if (j < NIMG)
+    {
+        pool[j].width = pool[i].width;
+        pool[j].height = pool[i].height;
+        pool[j].texels = (GLubyte*)realloc(pool[j].texels, image_bytes(&pool[i]));
+        memcpy(pool[j].texels, pool[i].texels, image_bytes(&pool[i]));
+        pool[j].palette = palettes[1];
+    }
+
+    for (i = 0; i < NTEX; i++)
+    {
+        which[i] = (i < NIMG) ? i : test_rand() % NIMG;
+    }
+}
+
+int main(void)
+{
+    GLuint names[NTEX], order[NTEX];
+    GLuint i, k, lookups, hits, texImg, texShare;
+
+    test_init();
+    make_images();
+    rglEnable(RGL_TEXTURE_SHARE);
+
+    //one pass of uploads: a lookup each, a hit for every duplicate
+    lookups = rglSharedTextureLookups();
+    hits = rglSharedTextureHits();
+    texImg = null_call_count(NULL_OP_TEX_IMG);
+    texShare = null_call_count(NULL_OP_TEX_SHARE);
+    glGenTextures(NTEX, names);
+    for (i = 0; i < NTEX; i++)
+    {
+        upload(names[i], &pool[which[i]]);
+    }
+    lookups = rglSharedTextureLookups() - lookups;
+    hits = rglSharedTextureHits() - hits;
+    TEST_CHECK(lookups == NTEX, "%u lookups, %d expected", lookups, NTEX);
+    TEST_CHECK(hits == NTEX - NIMG, "%u hits, %d expected", hits, NTEX - NIMG);
+    TEST_CHECK(null_call_count(NULL_OP_TEX_SHARE) - texShare == hits, "%u tex_share calls",
+               null_call_count(NULL_OP_TEX_SHARE) - texShare);
+    TEST_CHECK(null_call_count(NULL_OP_TEX_IMG) - texImg == NIMG, "%u tex_img calls, %d expected",
+               null_call_count(NULL_OP_TEX_IMG) - texImg, NIMG);
+    for (i = 0; i < NTEX; i++)
+    {
+        gl_texture_object* to = rglGetTexobj(names[i]);
+        TEST_CHECK(same_image(to, &pool[which[i]]), "texture %u's image", i);
+        TEST_CHECK(to->Share != NULL && to->DataBytes == 0, "texture %u not sharing", i);
+    }
+
+    //delete in a random order, the survivors' images intact throughout
+    for (i = 0; i < NTEX; i++)
+    {
+        order[i] = i;
+    }
+    for (i = NTEX - 1; i > 0; i--)
+    {
+        GLuint j = test_rand() % (i + 1), t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (i = 0; i < NTEX; i++)
+    {
+        glDeleteTextures(1, &names[order[i]]);
+        if ((i & 15) != 15)
+        {
+            continue;
+        }
+        for (k = i + 1; k < NTEX; k++)
+        {
+            if (!same_image(rglGetTexobj(names[order[k]]), &pool[which[order[k]]]))
+            {
+                TEST_CHECK(0, "texture %u's image after %u deletes", order[k], i + 1);
+                break;
+            }
+        }
+    }
+    TEST_CHECK(rglRetainedTextureBytes() == 0, "%u bytes kept after deleting all",
+               rglRetainedTextureBytes());
+    TEST_CHECK(rglSharedTextureBytes() == 0, "%u bytes shared after deleting all",
+               rglSharedTextureBytes());
+
+    //a re-upload & a lazy mip chain take a texture off its share, and no other
+    {
+        GLuint t[3];
+        gl_texture_object *a, *b, *c;
+        image const* im = &pool[1];
+
+        glGenTextures(3, t);
+        for (i = 0; i < 3; i++)
+        {
+            upload(t[i], im);
+        }
+        a = rglGetTexobj(t[0]);
+        b = rglGetTexobj(t[1]);
+        c = rglGetTexobj(t[2]);
+        TEST_CHECK(a->Share == b->Share && b->Share == c->Share && a->Share->Refs == 3,
+                   "3 users of one share");
+
+        upload(t[1], &pool[2]);
+        TEST_CHECK(b->Share != a->Share && a->Share->Refs == 2, "re-upload left on its share");
+        TEST_CHECK(same_image(b, &pool[2]) && same_image(a, im), "images after a re-upload");
+
+        glBindTexture(GL_TEXTURE_2D, t[2]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        TEST_CHECK(c->Share == NULL && c->Data != a->Data && same_image(c, im),
+                   "mip chain didn't unshare");
+        TEST_CHECK(a->Share->Refs == 1 && a->Share->Users == a, "share's users after unsharing");
+
+        glDeleteTextures(3, t);
+        TEST_CHECK(rglRetainedTextureBytes() == 0, "%u bytes kept", rglRetainedTextureBytes());
+    }
+
+    //zero-copy: the null driver doesn't keep texels, so shares are matched
+    //by their hashes, both of which have to agree
+    {
+        GLuint t[3];
+        gl_texture_object* to;
+
+        rglDisable(RGL_TEXTURE_RETAIN);
+        glGenTextures(3, t);
+        upload(t[0], &pool[3]);
+        to = rglGetTexobj(t[0]);
+        TEST_CHECK(to->Share != NULL && to->Share->Data == NULL, "zero-copy share kept texels");
+
+        hits = rglSharedTextureHits();
+        upload(t[1], &pool[3]);
+        TEST_CHECK(rglSharedTextureHits() - hits == 1, "zero-copy duplicate not shared");
+
+        //a key that matches but a check that doesn't, as a collision would
+        to->Share->Check ^= 1;
+        hits = rglSharedTextureHits();
+        upload(t[2], &pool[3]);
+        TEST_CHECK(rglSharedTextureHits() == hits, "shared on the key alone");
+        TEST_CHECK(rglGetTexobj(t[2])->Share != to->Share, "shared on the key alone");
+
+        rglEnable(RGL_TEXTURE_RETAIN);
+        //leave them for shutdown to release
+    }
+
+    //share off: nothing looked up
+    {
+        GLuint t;
+
+        rglDisable(RGL_TEXTURE_SHARE);
+        lookups = rglSharedTextureLookups();
+        glGenTextures(1, &t);
+        upload(t, &pool[0]);
+        TEST_CHECK(rglSharedTextureLookups() == lookups && rglGetTexobj(t)->Share == NULL,
+                   "looked up with RGL_TEXTURE_SHARE off");
+    }
+
+    for (i = 0; i < NIMG; i++)
+    {
+        free(pool[i].texels);
+    }
+    return test_done();
+}
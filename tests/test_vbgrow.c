@@ -0,0 +1,62 @@
+/*=============================================================================
+        Name    : test_vbgrow.c
+        Purpose : the vertex buffer growing in the middle of a primitive
+                  keeps what's already in it, clip flags included
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+
+#define TRIANGLES 3000      //9000 vertices, past the VB's starting 8192
+
+//a run of small on-screen triangles with one far off to the right
+static void draw_batch(GLuint offscreen)
+{
+    GLuint i;
+    GLfloat x;
+
+    glBegin(GL_TRIANGLES);
+    for (i = 0; i < TRIANGLES; i++)
+    {
+        x = (i == offscreen) ? 5.0f : (GLfloat)(i % 50) / 50.0f - 0.5f;
+        glVertex3f(x, -0.5f, 0.0f);
+        glVertex3f(x + 0.01f, -0.5f, 0.0f);
+        glVertex3f(x, -0.49f, 0.0f);
+    }
+    glEnd();
+}
+
+int main(void)
+{
+    GLuint clipped, growths;
+
+    test_init();
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    //the offscreen triangle before the growth, then after it
+    growths = rglVertexBufferGrowths();
+    clipped = rglClippedPolys();
+    draw_batch(TRIANGLES / 2);
+    TEST_CHECK(rglVertexBufferGrowths() == growths + 1, "grew %u times",
+               rglVertexBufferGrowths() - growths);
+    TEST_CHECK(rglClippedPolys() - clipped == 1, "%u polys clipped, 1 expected",
+               rglClippedPolys() - clipped);
+
+    clipped = rglClippedPolys();
+    draw_batch(TRIANGLES - 1);
+    TEST_CHECK(rglClippedPolys() - clipped == 1, "%u polys clipped after the VB grew, 1 expected",
+               rglClippedPolys() - clipped);
+
+    //the same in a VB started small, which grows several times
+    rglVertexBufferSize(64);
+    clipped = rglClippedPolys();
+    draw_batch(10);
+    TEST_CHECK(rglClippedPolys() - clipped == 1, "%u polys clipped from a 64 vertex VB, 1 expected",
+               rglClippedPolys() - clipped);
+
+    return test_done();
+}
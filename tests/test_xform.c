@@ -0,0 +1,212 @@
+/*=============================================================================
+        Name    : test_xform.c
+        Purpose : the SSE2 & AVX2 transform_points3 & project_and_cliptest
+                  kernels against the C_MATH loops, bit for bit, for every
+                  matrix & projection type and every count around the
+                  vector widths
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include "rgltest.h"
+#include "simd.h"
+
+#define MAXN    (SIMD_THRESH * 2 + 3)
+#define TRIALS  200
+
+//kvb.c's, which has no header of its own
+void transform_points3(GLcontext* ctx, GLuint n, GLfloat vObj[][4], GLfloat vEye[][4]);
+void project_and_cliptest(GLcontext* ctx, GLuint n, GLfloat vEye[][4], GLfloat vClip[][4],
+                          GLubyte clipMask[], GLubyte* orMask, GLubyte* andMask);
+
+static char const* const typeNames[8] =
+    { "", "identity", "2d no rot", "2d", "3d", "general", "ortho", "perspective" };
+
+//a random matrix with the shape its type promises
+static void make_matrix(GLuint type, GLfloat m[16])
+{
+    GLuint i;
+
+    for (i = 0; i < 16; i++)
+    {
+        m[i] = test_randf(-2.0f, 2.0f);
+    }
+    switch (type)
+    {
+    case MATRIX_IDENTITY:
+        for (i = 0; i < 16; i++)
+        {
+            m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+        }
+        break;
+    case MATRIX_2D_NO_ROT:
+        m[1] = m[4] = 0.0f;
+        //fall through
+    case MATRIX_2D:
+        m[2] = m[6] = m[8] = m[9] = m[14] = 0.0f;
+        m[10] = 1.0f;
+        //fall through
+    case MATRIX_3D:
+        m[3] = m[7] = m[11] = 0.0f;
+        m[15] = 1.0f;
+        break;
+    case MATRIX_ORTHO:
+        m[1] = m[2] = m[3] = m[4] = m[6] = m[7] = m[8] = m[9] = m[11] = 0.0f;
+        m[15] = 1.0f;
+        break;
+    case MATRIX_PERSPECTIVE:
+        m[1] = m[2] = m[3] = m[4] = m[6] = m[7] = m[12] = m[13] = m[15] = 0.0f;
+        m[11] = -1.0f;
+        break;
+    }
+}
+
+static void fill(GLfloat v[][4], GLubyte mask[], GLboolean w)
+{
+    GLuint i, k;
+
+    for (i = 0; i < MAXN + 8; i++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            v[i][k] = test_randf(-3.0f, 3.0f);
+        }
+        v[i][3] = w ? test_randf(0.25f, 2.0f) : 1.0f;
+        //bits that were there before, which the test ors into
+        mask[i] = (GLubyte)(test_rand() & CLIP_USER_BIT);
+    }
+}
+
+int main(void)
+{
+    static GLfloat const guards[2] = { 1.0f, 2.5f };
+    static GLfloat obj[MAXN + 8][4], eye[3][MAXN + 8][4], clip[3][MAXN + 8][4];
+    static GLubyte mask[3][MAXN + 8], seed[MAXN + 8];
+    GLcontext* ctx;
+    GLboolean sse2, avx2;
+    GLuint type, n, trial, path, paths, g, checks = 0;
+    GLubyte orMask[3], andMask[3];
+    GLfloat m[16];
+
+    test_init();
+    ctx = gl_get_context_ext();
+    sse2 = ctx->CpuSSE2;
+    avx2 = ctx->CpuAVX2;
+    paths = !SIMD_X86 ? 1 : avx2 ? 3 : sse2 ? 2 : 1;
+    if (paths == 1)
+    {
+        printf("no SSE2, nothing to compare\n");
+        return test_done();
+    }
+    ctx->CpuSSE2 = ctx->CpuAVX2 = GL_FALSE;
+
+    //object -> eye
+    for (type = MATRIX_IDENTITY; type <= MATRIX_GENERAL; type++)
+    {
+        for (n = 1; n <= MAXN; n++)
+        {
+            for (trial = 0; trial < TRIALS; trial++)
+            {
+                make_matrix(type, ctx->ModelViewMatrix);
+                ctx->ModelViewMatrixType = type;
+                fill(obj, seed, GL_FALSE);
+                for (path = 0; path < 3; path++)
+                {
+                    memset(eye[path], 0xA5, sizeof(eye[path]));
+                }
+
+                transform_points3(ctx, n, obj, eye[0]);
+#if SIMD_X86
+                //the kernels take the types the C loops can't do better
+                if (type == MATRIX_GENERAL || type == MATRIX_3D)
+                {
+                    simd_sse2_transform_points3(type, n, &eye[1][0][0], ctx->ModelViewMatrix, &obj[0][0]);
+                    if (paths == 3)
+                    {
+                        simd_avx2_transform_points3(type, n, &eye[2][0][0], ctx->ModelViewMatrix, &obj[0][0]);
+                    }
+                }
+                else
+#endif
+                {
+                    memcpy(eye[1], eye[0], sizeof(eye[0]));
+                    memcpy(eye[2], eye[0], sizeof(eye[0]));
+                }
+                for (path = 1; path < paths; path++)
+                {
+                    checks++;
+                    //the whole array, so a write past n shows too
+                    if (memcmp(eye[0], eye[path], sizeof(eye[0])) != 0)
+                    {
+                        TEST_CHECK(0, "transform_points3 %s, %u vertices: path %u differs",
+                                   typeNames[type], n, path);
+                        trial = TRIALS;
+                        n = MAXN;
+                    }
+                }
+            }
+        }
+    }
+
+    //eye -> clip, with & without a guard band
+    for (type = MATRIX_IDENTITY; type <= MATRIX_PERSPECTIVE; type++)
+    {
+        if (type > MATRIX_IDENTITY && type < MATRIX_GENERAL)
+        {
+            continue;
+        }
+        for (g = 0; g < 2; g++)
+        {
+            for (n = 1; n <= MAXN; n++)
+            {
+                for (trial = 0; trial < TRIALS; trial++)
+                {
+                    make_matrix(type, m);
+                    memcpy(ctx->ProjectionMatrix, m, sizeof(m));
+                    ctx->ProjectionMatrixType = type;
+                    ctx->GuardBand = guards[g];
+                    fill(eye[0], seed, GL_TRUE);
+                    for (path = 0; path < 3; path++)
+                    {
+                        memset(clip[path], 0xA5, sizeof(clip[path]));
+                        memcpy(mask[path], seed, sizeof(seed));
+                        orMask[path] = (GLubyte)(test_rand() & CLIP_USER_BIT);
+                        andMask[path] = CLIP_ALL_BITS;
+                    }
+                    orMask[1] = orMask[2] = orMask[0];
+
+                    project_and_cliptest(ctx, n, eye[0], clip[0], mask[0], &orMask[0], &andMask[0]);
+#if SIMD_X86
+                    simd_sse2_project_and_cliptest(type, n, &clip[1][0][0], m, &eye[0][0][0],
+                                                   guards[g], mask[1], &orMask[1], &andMask[1]);
+                    if (paths == 3)
+                    {
+                        simd_avx2_project_and_cliptest(type, n, &clip[2][0][0], m, &eye[0][0][0],
+                                                       guards[g], mask[2], &orMask[2], &andMask[2]);
+                    }
+#endif
+                    for (path = 1; path < paths; path++)
+                    {
+                        checks++;
+                        if (memcmp(clip[0], clip[path], sizeof(clip[0])) != 0 ||
+                            memcmp(mask[0], mask[path], sizeof(mask[0])) != 0 ||
+                            orMask[0] != orMask[path] || andMask[0] != andMask[path])
+                        {
+                            TEST_CHECK(0, "project_and_cliptest %s, guard %g, %u vertices: path %u differs",
+                                       typeNames[type], guards[g], n, path);
+                            trial = TRIALS;
+                            n = MAXN;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    ctx->CpuSSE2 = sse2;
+    ctx->CpuAVX2 = avx2;
+    ctx->GuardBand = 1.0f;
+    ctx->NewMask |= NEW_MODELVIEW | NEW_PROJECTION;
+
+    printf("%u comparisons\n", checks);
+    return test_done();
+}
@@ -0,0 +1,771 @@
+/*=============================================================================
+        Name    : rglreplay.c
+        Purpose : replays a trace captured with RGL_TRACE / rglTraceCapture
+                  against the null driver and reports frames/s, triangles/s
+                  and the time spent in each entry point
+
+        usage   : rglreplay [-n] [-t] [-m] [-M] [-z] [-s] [-b vertices] [-p mode]
+                  [-g size] trace.bin
+                  -n  don't time individual entry points (the timer calls
+                      otherwise add their own overhead to the frame and
+                      triangle rates)
+                  -t  hand the driver one triangle at a time instead of
+                      indexed triangle lists (RGL_INDEXED_TRIANGLES off), to
+                      compare draw calls and vertex bytes per frame
+                  -m  transform every poly corner of rglMeshRender meshes
+                      separately (RGL_MESH_PRETRANSFORM off)
+                  -M  build a mip chain for every texture uploaded
+                      (RGL_MIPMAPS on), to time generating them
+                  -z  hand the driver textures straight from the trace
+                      (RGL_TEXTURE_RETAIN off), to compare upload time and
+                      the texture memory the GL keeps
+                  -s  share identical texture images between texture
+                      objects (RGL_TEXTURE_SHARE on), to see how many
+                      uploads are duplicates and the bytes that saves
+                  -b  starting vertex buffer capacity (default VB_MAX), to
+                      compare capacities; the VB still grows as needed
+                  -p  specular power mode for the spechack shaders, exact,
+                      table (the default) or approx (see rglSpecPow)
+                  -g  guard band size (see rglGuardBand), overriding any in
+                      the trace, to compare clipped polygons and time
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kgl.h"
+#include "rglext.h"
+#include "nulldrv.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+typedef struct
+{
+    GLuint const* pc;           //next record
+    GLuint const* end;
+} cursor;
+
+static cursor replay;
+
+static GLboolean timeOps = GL_TRUE;
+static GLboolean indexedTriangles = GL_TRUE;
+static GLboolean meshPretransform = GL_TRUE;
+static GLboolean mipmaps = GL_FALSE;
+static GLboolean texRetain = GL_TRUE;
+static GLboolean texShare = GL_FALSE;
+static GLuint vbSize = 0;
+static GLint specPow = 0;
+static GLfloat guardBand = 0.0f;
+static GLboolean initialized = GL_FALSE;
+
+static double opTime[TRACE_OP_COUNT];
+static GLuint opCalls[TRACE_OP_COUNT];
+
+//setup isn't part of the frame rate
+static double initTime = 0.0;
+
+static GLuint frames = 0;
+static double triangles = 0.0;
+static double culled = 0.0;
+static double materialSwitches = 0.0;
+static double inverses = 0.0;
+static double clipped = 0.0;
+
+//rglMeshStats, summed over every mesh
+static double meshUnique = 0.0;
+static double meshReferenced = 0.0;
+
+//mesh poly mode handed to rglMeshRender, updated by the recorded callbacks
+static GLint meshPolyMode;
+
+//glVertexPointer's array, refilled by each glArrayElement
+static GLfloat arrayElement[4];
+static GLint arraySize = 3;
+
+/*-----------------------------------------------------------------------------
+    timing
+-----------------------------------------------------------------------------*/
+
+static double now(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (freq.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + 1.0e-9 * (double)t.tv_nsec;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    trace file
+-----------------------------------------------------------------------------*/
+
+static GLuint const* map_trace(char const* filename, size_t* size)
+{
+#ifdef _WIN32
+    FILE* in;
+    GLuint* data;
+    long len;
+
+    in = fopen(filename, "rb");
+    if (in == NULL)
+    {
+        return NULL;
+    }
+    fseek(in, 0, SEEK_END);
+    len = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    data = (GLuint*)malloc(len + 4);
+    if (data == NULL || fread(data, 1, len, in) != (size_t)len)
+    {
+        fclose(in);
+        free(data);
+        return NULL;
+    }
+    fclose(in);
+    *size = (size_t)len;
+    return data;
+#else
+    struct stat st;
+    void* data;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    //private + writable: the GL keeps pointers into client memory (palettes,
+    //vertex arrays), and one or two paths write through them
+    data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return (GLuint const*)data;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    argument decoding
+-----------------------------------------------------------------------------*/
+
+static GLfloat F(GLuint u)
+{
+    GLfloat f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static GLdouble D(GLuint const* a)
+{
+    GLdouble d;
+    memcpy(&d, a, sizeof(d));
+    return d;
+}
+
+//a block of client memory; advances *a past it
+static GLvoid const* block(GLuint const** a)
+{
+    GLuint bytes = (*a)[0];
+    GLvoid const* data = (bytes != 0) ? (GLvoid const*)(*a + 1) : NULL;
+    *a += 1 + TRACE_WORDS(bytes);
+    return data;
+}
+
+static void init_position(GLuint width, GLuint height, GLuint depth)
+{
+    double t0;
+
+    if (initialized)
+    {
+        return;
+    }
+
+    t0 = now();
+    rglSelectDevice(NULL_DEVICE_NAME, "");
+    if (!rauxInitPosition(0, 0, width, height, depth))
+    {
+        fprintf(stderr, "rglreplay: couldn't init %ux%ux%u\n", width, height, depth);
+        exit(1);
+    }
+    if (!indexedTriangles)
+    {
+        rglDisable(RGL_INDEXED_TRIANGLES);
+    }
+    if (!meshPretransform)
+    {
+        rglDisable(RGL_MESH_PRETRANSFORM);
+    }
+    if (mipmaps)
+    {
+        rglEnable(RGL_MIPMAPS);
+    }
+    if (!texRetain)
+    {
+        rglDisable(RGL_TEXTURE_RETAIN);
+    }
+    if (texShare)
+    {
+        rglEnable(RGL_TEXTURE_SHARE);
+    }
+    if (vbSize != 0 && rglVertexBufferSize(vbSize) != vbSize)
+    {
+        fprintf(stderr, "rglreplay: couldn't allocate a %u vertex buffer\n", vbSize);
+        exit(1);
+    }
+    if (specPow != 0)
+    {
+        rglSpecPow(specPow);
+    }
+    if (guardBand != 0.0f)
+    {
+        rglGuardBand(guardBand);
+    }
+    null_reset_counts();
+    initTime = now() - t0;
+    initialized = GL_TRUE;
+}
+
+static void replay_until(GLuint stop);
+
+static void mesh_callback(GLint material)
+{
+    //the trace has MeshMaterial, the callback's calls, MeshMaterialEnd
+    replay_until(TRACE_MeshMaterialEnd);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : replay_op
+    Description : make one recorded call
+    Inputs      : op - the entry point
+                  a - its payload
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void replay_op(GLuint op, GLuint const* a)
+{
+    GLvoid const* data;
+    GLvoid const* data2;
+    GLvoid const* data3;
+    GLsizei n;
+
+    switch (op)
+    {
+    case TRACE_InitPosition:
+        init_position(a[0], a[1], a[2]);
+        break;
+    case TRACE_Flush:
+        triangles += rglNumPolys();
+        culled += rglCulledPolys();
+        materialSwitches += rglMaterialSwitches();
+        inverses += rglModelViewInverses();
+        clipped += rglClippedPolys();
+        frames++;
+        glFlush();
+        break;
+
+    case TRACE_MatrixMode:   glMatrixMode(a[0]); break;
+    case TRACE_PushMatrix:   glPushMatrix(); break;
+    case TRACE_PopMatrix:    glPopMatrix(); break;
+    case TRACE_PushAttrib:   glPushAttrib(a[0]); break;
+    case TRACE_PopAttrib:    glPopAttrib(); break;
+    case TRACE_LoadIdentity: glLoadIdentity(); break;
+    case TRACE_LoadMatrixf:  glLoadMatrixf((GLfloat const*)a); break;
+    case TRACE_MultMatrixf:  glMultMatrixf((GLfloat const*)a); break;
+    case TRACE_Scalef:       glScalef(F(a[0]), F(a[1]), F(a[2])); break;
+    case TRACE_Rotatef:      glRotatef(F(a[0]), F(a[1]), F(a[2]), F(a[3])); break;
+    case TRACE_Translatef:   glTranslatef(F(a[0]), F(a[1]), F(a[2])); break;
+    case TRACE_Frustum:
+        glFrustum(D(a), D(a + 2), D(a + 4), D(a + 6), D(a + 8), D(a + 10));
+        break;
+    case TRACE_Ortho:
+        glOrtho(D(a), D(a + 2), D(a + 4), D(a + 6), D(a + 8), D(a + 10));
+        break;
+    case TRACE_Viewport:     glViewport(a[0], a[1], a[2], a[3]); break;
+    case TRACE_DepthRange:   glDepthRange(D(a), D(a + 2)); break;
+
+    case TRACE_Begin:        glBegin(a[0]); break;
+    case TRACE_End:          glEnd(); break;
+    case TRACE_Vertex3f:     glVertex3f(F(a[0]), F(a[1]), F(a[2])); break;
+    case TRACE_Vertex4fv:    glVertex4fv((GLfloat const*)a); break;
+    case TRACE_Normal3f:     glNormal3f(F(a[0]), F(a[1]), F(a[2])); break;
+    case TRACE_Color4f:      glColor4f(F(a[0]), F(a[1]), F(a[2]), F(a[3])); break;
+    case TRACE_Color4ub:
+        glColor4ub((GLubyte)a[0], (GLubyte)a[1], (GLubyte)a[2], (GLubyte)a[3]);
+        break;
+    case TRACE_TexCoord2f:   glTexCoord2f(F(a[0]), F(a[1])); break;
+
+    case TRACE_Enable:       glEnable(a[0]); break;
+    case TRACE_Disable:      glDisable(a[0]); break;
+    case TRACE_CullFace:     glCullFace(a[0]); break;
+    case TRACE_ShadeModel:   glShadeModel(a[0]); break;
+    case TRACE_DepthFunc:    glDepthFunc(a[0]); break;
+    case TRACE_DepthMask:    glDepthMask((GLboolean)a[0]); break;
+    case TRACE_ColorMask:
+        glColorMask((GLboolean)a[0], (GLboolean)a[1], (GLboolean)a[2]);
+        break;
+    case TRACE_BlendFunc:    glBlendFunc(a[0], a[1]); break;
+    case TRACE_AlphaFunc:    glAlphaFunc(a[0], F(a[1])); break;
+    case TRACE_PolygonMode:  glPolygonMode(a[0], a[1]); break;
+    case TRACE_Hint:         glHint(a[0], a[1]); break;
+    case TRACE_LineWidth:    glLineWidth(F(a[0])); break;
+    case TRACE_PointSize:    glPointSize(F(a[0])); break;
+    case TRACE_LineStipple:  glLineStipple(a[0], (GLushort)a[1]); break;
+    case TRACE_Scissor:      glScissor(a[0], a[1], a[2], a[3]); break;
+
+    case TRACE_Materialfv:   glMaterialfv(a[0], a[1], (GLfloat const*)(a + 2)); break;
+    case TRACE_Lightfv:      glLightfv(a[0], a[1], (GLfloat const*)(a + 2)); break;
+    case TRACE_LightModelf:  glLightModelf(a[0], F(a[1])); break;
+    case TRACE_LightModeli:  glLightModeli(a[0], a[1]); break;
+    case TRACE_LightModelfv: glLightModelfv(a[1], (GLfloat const*)(a + 2)); break;
+    case TRACE_Fogi:         glFogi(a[0], a[1]); break;
+    case TRACE_Fogf:         glFogf(a[0], F(a[1])); break;
+    case TRACE_Fogfv:        glFogfv(a[1], (GLfloat const*)(a + 2)); break;
+    case TRACE_ClipPlane:
+    {
+        GLdouble equation[4];
+        memcpy(equation, a + 1, sizeof(equation));
+        glClipPlane(a[0], equation);
+        break;
+    }
+
+    case TRACE_Clear:        glClear(a[0]); break;
+    case TRACE_ClearColor:   glClearColor(F(a[0]), F(a[1]), F(a[2]), F(a[3])); break;
+    case TRACE_ClearDepth:   glClearDepth(D(a)); break;
+    case TRACE_SuperClear:   glSuperClear(); break;
+
+    case TRACE_GenTextures:
+    {
+        //names come out of the same allocator in the same order, so the
+        //trace's glBindTexture calls still line up
+        GLuint* names;
+        n = (GLsizei)a[0];
+        if (n <= 0)
+        {
+            break;
+        }
+        names = (GLuint*)malloc(n * sizeof(GLuint));
+        glGenTextures(n, names);
+        if (names[0] != a[2])
+        {
+            fprintf(stderr, "rglreplay: glGenTextures returned %u, trace has %u\n",
+                    names[0], a[2]);
+        }
+        free(names);
+        break;
+    }
+    case TRACE_DeleteTextures:
+    {
+        GLuint const* b = a + 1;
+        data = block(&b);
+        if (data != NULL)
+        {
+            glDeleteTextures((GLsizei)a[0], (GLuint const*)data);
+        }
+        break;
+    }
+    case TRACE_BindTexture:     glBindTexture(a[0], a[1]); break;
+    case TRACE_TexParameteri:   glTexParameteri(a[0], a[1], a[2]); break;
+    case TRACE_TexEnvi:         glTexEnvi(a[0], a[1], a[2]); break;
+    case TRACE_TexImage2D:
+    {
+        GLuint const* b = a + 8;
+        data = block(&b);
+        glTexImage2D(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], data);
+        break;
+    }
+    case TRACE_ColorTable:
+    case TRACE_LitColorTable:
+    {
+        GLuint const* b = a + 5;
+        data = block(&b);
+        if (op == TRACE_ColorTable)
+        {
+            glColorTable(a[0], a[1], a[2], a[3], a[4], data);
+        }
+        else
+        {
+            glLitColorTable(a[0], a[1], a[2], a[3], a[4], data);
+        }
+        break;
+    }
+    case TRACE_PixelTransferf:  glPixelTransferf(a[0], F(a[1])); break;
+    case TRACE_PixelStorei:     glPixelStorei(a[0], a[1]); break;
+
+    case TRACE_RasterPos2f:     glRasterPos2f(F(a[0]), F(a[1])); break;
+    case TRACE_RasterPos4f:     glRasterPos4f(F(a[0]), F(a[1]), F(a[2]), F(a[3])); break;
+    case TRACE_Bitmap:
+    {
+        GLuint const* b = a + 6;
+        data = block(&b);
+        glBitmap(a[0], a[1], F(a[2]), F(a[3]), F(a[4]), F(a[5]), (GLubyte const*)data);
+        break;
+    }
+    case TRACE_DrawPixels:
+    {
+        GLuint const* b = a + 4;
+        data = block(&b);
+        glDrawPixels(a[0], a[1], a[2], a[3], data);
+        break;
+    }
+    case TRACE_DrawPitchedPixels:
+    {
+        GLuint const* b = a + 7;
+        data = block(&b);
+        rglDrawPitchedPixels(a[0], a[1], a[2], a[3], a[4], a[5], a[6], data);
+        break;
+    }
+
+    case TRACE_InterleavedArrays:
+        //the array itself comes with each draw
+        glInterleavedArrays(a[0], a[1], NULL);
+        break;
+    case TRACE_VertexPointer:
+        arraySize = a[0];
+        glVertexPointer(a[0], a[1], a[2], arrayElement);
+        break;
+    case TRACE_ArrayElement:
+        memcpy(arrayElement, a, sizeof(arrayElement));
+        glVertexPointer(arraySize, GL_FLOAT, 0, arrayElement);
+        glArrayElement(0);
+        break;
+    case TRACE_DrawArrays:
+    {
+        GLuint const* b = a + 4;
+        data = block(&b);
+        glInterleavedArrays(a[3], 0, data);
+        glDrawArrays(a[0], a[1], a[2]);
+        break;
+    }
+    case TRACE_DrawElements:
+    {
+        GLuint const* b = a + 4;
+        data = block(&b);
+        data2 = block(&b);
+        glInterleavedArrays(a[3], 0, data2);
+        glDrawElements(a[0], a[1], a[2], data);
+        break;
+    }
+
+    case TRACE_Feature:
+        switch (a[0])
+        {
+        case RGL_SCREENSHOT:
+        case RGL_MULTISHOT_START:
+        case RGL_MULTISHOT_END:
+        case RGL_SHUTDOWN:
+        case RGL_NEXT_RENDERER:
+        case RGL_REINIT_RENDERER:
+            break;
+        default:
+            rglFeature(a[0]);
+        }
+        break;
+    case TRACE_rglEnable:       rglEnable(a[0]); break;
+    case TRACE_rglDisable:      rglDisable(a[0]); break;
+    case TRACE_SpecExp:         rglSpecExp(a[0], F(a[1])); break;
+    case TRACE_LightingAdjust:  rglLightingAdjust(F(a[0])); break;
+    case TRACE_GuardBand:
+        if (guardBand == 0.0f)
+        {
+            rglGuardBand(F(a[0]));
+        }
+        break;
+
+    case TRACE_ListSpec:        rglListSpec(a[0], a[1], a[2], a[3]); break;
+    case TRACE_MeshRender:
+    {
+        GLuint const* b = a + 2;
+        data = block(&b);
+        data2 = block(&b);
+        data3 = block(&b);
+        rglList(RGL_VERTEX_LIST, data);
+        rglList(RGL_NORMAL_LIST, data2);
+        rglList(RGL_POLY_LIST, data3);
+        meshPolyMode = (GLint)a[1];
+        rglMeshRender((GLint)a[0], mesh_callback, &meshPolyMode);
+        {
+            GLuint unique, referenced;
+            rglMeshStats(&unique, &referenced);
+            meshUnique += unique;
+            meshReferenced += referenced;
+        }
+        break;
+    }
+    case TRACE_MeshMaterial:
+        break;
+    case TRACE_MeshMaterialEnd:
+        meshPolyMode = (GLint)a[0];
+        break;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : replay_until
+    Description : replay records up to and including the first with op stop,
+                  or to the end of the trace
+    Inputs      : stop - the op to stop after, or TRACE_OP_COUNT
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void replay_until(GLuint stop)
+{
+    GLuint code, op, words;
+    GLuint const* args;
+    double t0;
+
+    while (replay.pc < replay.end)
+    {
+        code = *replay.pc++;
+        op = code & 0xff;
+        words = code >> 8;
+        args = replay.pc;
+        replay.pc += words;
+
+        if (replay.pc > replay.end)
+        {
+            fprintf(stderr, "rglreplay: truncated record (%s)\n", trace_op_name(op));
+            replay.pc = replay.end;
+            return;
+        }
+        if (op >= TRACE_OP_COUNT)
+        {
+            continue;
+        }
+        if (!initialized && op != TRACE_InitPosition)
+        {
+            //trace started before rauxInitPosition was seen; assume the usual
+            init_position(640, 480, 16);
+        }
+
+        opCalls[op]++;
+        if (timeOps)
+        {
+            t0 = now();
+            replay_op(op, args);
+            opTime[op] += now() - t0;
+        }
+        else
+        {
+            replay_op(op, args);
+        }
+
+        if (op == stop)
+        {
+            return;
+        }
+    }
+}
+
+static int by_time(void const* a, void const* b)
+{
+    double ta = opTime[*(GLuint const*)a];
+    double tb = opTime[*(GLuint const*)b];
+    return (ta < tb) ? 1 : (ta > tb) ? -1 : 0;
+}
+
+static void report(double elapsed)
+{
+    GLuint order[TRACE_OP_COUNT];
+    GLuint i, op;
+
+    printf("frames      %u\n", frames);
+    printf("triangles   %.0f (%.0f culled)\n", triangles, culled);
+    if (frames != 0)
+    {
+        printf("draws/frame %.1f\n", (double)null_draw_calls() / frames);
+        printf("vtx KB/frame %.1f\n", null_vertex_bytes() / (1024.0 * frames));
+        printf("materials/frame %.1f\n", materialSwitches / frames);
+        printf("inverses/frame %.1f\n", inverses / frames);
+        printf("clipped polys/frame %.1f\n", clipped / frames);
+    }
+    if (meshReferenced > 0.0)
+    {
+        printf("mesh verts  %.0f referenced, %.0f transformed (%.1f%%)\n",
+               meshReferenced, meshUnique, 100.0 * meshUnique / meshReferenced);
+    }
+    printf("vb size     %u (grew %u times)\n", rglVertexBufferSize(0), rglVertexBufferGrowths());
+    printf("tex KB kept %.1f\n", rglRetainedTextureBytes() / 1024.0);
+    if (rglSharedTextureLookups() != 0)
+    {
+        printf("tex shared  %u of %u uploads (%.1f%%), KB saved %.1f\n",
+               rglSharedTextureHits(), rglSharedTextureLookups(),
+               100.0 * rglSharedTextureHits() / rglSharedTextureLookups(),
+               rglSharedTextureBytes() / 1024.0);
+    }
+    printf("time        %.3f s\n", elapsed);
+    if (elapsed > 0.0)
+    {
+        printf("frames/s    %.1f\n", frames / elapsed);
+        printf("tris/s      %.0f\n", triangles / elapsed);
+    }
+
+    if (!timeOps)
+    {
+        return;
+    }
+
+    for (i = 0; i < TRACE_OP_COUNT; i++)
+    {
+        order[i] = i;
+    }
+    qsort(order, TRACE_OP_COUNT, sizeof(order[0]), by_time);
+
+    printf("\n%-20s %10s %12s %10s %6s\n", "entry point", "calls", "total ms", "ns/call", "%");
+    for (i = 0; i < TRACE_OP_COUNT; i++)
+    {
+        op = order[i];
+        if (opCalls[op] == 0 || op == TRACE_InitPosition)
+        {
+            continue;
+        }
+        printf("%-20s %10u %12.3f %10.1f %6.1f\n",
+               trace_op_name(op), opCalls[op],
+               1.0e3 * opTime[op],
+               1.0e9 * opTime[op] / opCalls[op],
+               (elapsed > 0.0) ? 100.0 * opTime[op] / elapsed : 0.0);
+    }
+    printf("(MeshRender includes the calls made from its material callbacks)\n");
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: rglreplay [-n] [-t] [-m] [-M] [-z] [-s] [-b vertices] [-p exact|table|approx] [-g size] trace.bin\n");
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    GLuint const* trace;
+    char const* filename = NULL;
+    size_t size;
+    int i;
+    double t0, elapsed;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0)
+        {
+            timeOps = GL_FALSE;
+        }
+        else if (strcmp(argv[i], "-t") == 0)
+        {
+            indexedTriangles = GL_FALSE;
+        }
+        else if (strcmp(argv[i], "-m") == 0)
+        {
+            meshPretransform = GL_FALSE;
+        }
+        else if (strcmp(argv[i], "-M") == 0)
+        {
+            mipmaps = GL_TRUE;
+        }
+        else if (strcmp(argv[i], "-z") == 0)
+        {
+            texRetain = GL_FALSE;
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            texShare = GL_TRUE;
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            vbSize = (GLuint)strtoul(argv[++i], NULL, 10);
+            if (vbSize == 0)
+            {
+                usage();
+            }
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "exact") == 0)
+            {
+                specPow = RGL_SPECPOW_EXACT;
+            }
+            else if (strcmp(argv[i], "table") == 0)
+            {
+                specPow = RGL_SPECPOW_TABLE;
+            }
+            else if (strcmp(argv[i], "approx") == 0)
+            {
+                specPow = RGL_SPECPOW_APPROX;
+            }
+            else
+            {
+                usage();
+            }
+        }
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            guardBand = (GLfloat)strtod(argv[++i], NULL);
+            if (!(guardBand >= 1.0f))
+            {
+                usage();
+            }
+        }
+        else if (argv[i][0] == '-' || filename != NULL)
+        {
+            usage();
+        }
+        else
+        {
+            filename = argv[i];
+        }
+    }
+    if (filename == NULL)
+    {
+        usage();
+    }
+
+    trace = map_trace(filename, &size);
+    if (trace == NULL)
+    {
+        fprintf(stderr, "rglreplay: couldn't read %s\n", filename);
+        return 1;
+    }
+    if (size < 8 || trace[0] != TRACE_MAGIC || trace[1] != TRACE_VERSION)
+    {
+        fprintf(stderr, "rglreplay: %s isn't a version %d trace\n", filename, TRACE_VERSION);
+        return 1;
+    }
+
+    rglSetAllocs((MemAllocFunc)malloc, (MemFreeFunc)free);
+
+    replay.pc = trace + 2;
+    replay.end = trace + size / sizeof(GLuint);
+
+    t0 = now();
+    replay_until(TRACE_OP_COUNT);
+    elapsed = now() - t0 - initTime;
+
+    report(elapsed);
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*=============================================================================
+        Name    : trace.c
+        Purpose : capture of the GL entry points to a compact binary trace.
+                  the entry points in kgl.c / rglext.c call in here (guarded
+                  by TRACING) with their arguments and whatever client memory
+                  they read, so a trace can be replayed without the game.
+                  see trace.h for the format
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "kgl.h"
+#include "trace.h"
+
+GLboolean traceRecording = GL_FALSE;
+
+static FILE* traceFile = NULL;
+
+//> 0 while inside an entry point that calls other entry points
+static GLint traceDepth = 0;
+
+#define TRACE_NAME(name) #name,
+static char const* traceOpNames[TRACE_OP_COUNT] =
+{
+    TRACE_OPS(TRACE_NAME)
+};
+#undef TRACE_NAME
+
+/*-----------------------------------------------------------------------------
+    Name        : trace_capture
+    Description : start or stop capturing.  a trace started after
+                  rauxInitPosition begins with the current buffer size, but
+                  state set before that point (textures, matrices) is lost,
+                  so capture is best started with RGL_TRACE at init
+    Inputs      : filename - the trace file, or NULL to stop
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void trace_capture(char const* filename)
+{
+    GLuint header[2];
+    GLcontext* ctx = gl_get_context_ext();
+
+    if (traceFile != NULL)
+    {
+        fclose(traceFile);
+        traceFile = NULL;
+        traceRecording = GL_FALSE;
+    }
+
+    if (filename == NULL || filename[0] == '\0')
+    {
+        return;
+    }
+
+    traceFile = fopen(filename, "wb");
+    if (traceFile == NULL)
+    {
+        gl_problem(ctx, "trace: couldn't open trace file");
+        return;
+    }
+
+    header[0] = TRACE_MAGIC;
+    header[1] = TRACE_VERSION;
+    fwrite(header, sizeof(header), 1, traceFile);
+
+    traceRecording = (GLboolean)(traceDepth == 0);
+
+    if (ctx != NULL && ctx->Buffer.Width != 0)
+    {
+        trace_op(TRACE_InitPosition, 3,
+                 ctx->Buffer.Width, ctx->Buffer.Height, ctx->Buffer.Depth);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : trace_suspend, trace_resume
+    Description : bracket an entry point's calls to other entry points so
+                  only the outermost call is recorded
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void trace_suspend(void)
+{
+    traceDepth++;
+    traceRecording = GL_FALSE;
+}
+
+void trace_resume(void)
+{
+    traceDepth--;
+    traceRecording = (GLboolean)(traceDepth == 0 && traceFile != NULL);
+}
+
+//a record's header word
+void trace_record(GLuint op, GLuint words)
+{
+    GLuint code = op | (words << 8);
+
+    fwrite(&code, sizeof(code), 1, traceFile);
+
+    if (op == TRACE_Flush)
+    {
+        //keep whole frames on disk if the game goes down mid-trace
+        fflush(traceFile);
+    }
+}
+
+void trace_words(GLuint n, GLuint const* words)
+{
+    fwrite(words, sizeof(GLuint), n, traceFile);
+}
+
+//byte count, then data padded to a word
+void trace_block(GLvoid const* data, GLuint bytes)
+{
+    static GLubyte const pad[4] = { 0, 0, 0, 0 };
+
+    if (data == NULL)
+    {
+        bytes = 0;
+    }
+
+    fwrite(&bytes, sizeof(bytes), 1, traceFile);
+    if (bytes != 0)
+    {
+        fwrite(data, 1, bytes, traceFile);
+    }
+    fwrite(pad, 1, 4*TRACE_WORDS(bytes) - bytes, traceFile);
+}
+
+//a record of n 32bit scalars
+void trace_op(GLuint op, GLuint n, ...)
+{
+    GLuint args[16];
+    GLuint i;
+    va_list ap;
+
+    va_start(ap, n);
+    for (i = 0; i < n; i++)
+    {
+        args[i] = va_arg(ap, GLuint);
+    }
+    va_end(ap);
+
+    trace_record(op, n);
+    trace_words(n, args);
+}
+
+//a record of n doubles
+void trace_op_doubles(GLuint op, GLuint n, ...)
+{
+    GLdouble args[8];
+    GLuint i;
+    va_list ap;
+
+    va_start(ap, n);
+    for (i = 0; i < n; i++)
+    {
+        args[i] = va_arg(ap, GLdouble);
+    }
+    va_end(ap);
+
+    trace_record(op, 2*n);
+    trace_words(2*n, (GLuint const*)args);
+}
+
+//target, pname and the parameters an *fv call reads for pname
+void trace_op_fv(GLuint op, GLuint target, GLenum pname, GLfloat const* params)
+{
+    GLuint n = trace_param_count(pname);
+
+    trace_record(op, 2 + n);
+    trace_words(1, &target);
+    trace_words(1, &pname);
+    trace_words(n, (GLuint const*)params);
+}
+
+//n 32bit scalars, then a block of client memory
+void trace_op_block(GLuint op, GLvoid const* data, GLuint bytes, GLuint n, ...)
+{
+    GLuint args[16];
+    GLuint i;
+    va_list ap;
+
+    va_start(ap, n);
+    for (i = 0; i < n; i++)
+    {
+        args[i] = va_arg(ap, GLuint);
+    }
+    va_end(ap);
+
+    if (data == NULL)
+    {
+        bytes = 0;
+    }
+
+    trace_record(op, n + TRACE_BLOCK_WORDS(bytes));
+    trace_words(n, args);
+    trace_block(data, bytes);
+}
+
+GLuint trace_float(GLfloat f)
+{
+    GLuint u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+//number of floats read by the *fv calls for pname
+GLuint trace_param_count(GLenum pname)
+{
+    switch (pname)
+    {
+    case GL_AMBIENT:
+    case GL_DIFFUSE:
+    case GL_SPECULAR:
+    case GL_EMISSION:
+    case GL_AMBIENT_AND_DIFFUSE:
+    case GL_POSITION:
+    case GL_LIGHT_MODEL_AMBIENT:
+    case GL_FOG_COLOR:
+        return 4;
+    case GL_SPOT_DIRECTION:
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+//bytes of UNSIGNED_BYTE pixel data in an image of the given format
+GLuint trace_image_size(GLenum format, GLsizei width, GLsizei height)
+{
+    GLuint n = (GLuint)(width * height);
+
+    switch (format)
+    {
+    case GL_COLOR_INDEX:
+        return n;
+    case GL_RGBA16:
+        return 2*n;
+    case GL_RGB:
+        return 3*n;
+    default:
+        return 4*n;
+    }
+}
+
+char const* trace_op_name(GLuint op)
+{
+    return (op < TRACE_OP_COUNT) ? traceOpNames[op] : "?";
+}
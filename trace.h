@@ -0,0 +1,140 @@
+/*=============================================================================
+        Name    : trace.h
+        Purpose : capture of the GL entry points to a compact binary trace,
+                  for offline replay (see tools/rglreplay.c)
+
+Copyright Relic Entertainment, Inc.  All rights reserved.
+=============================================================================*/
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "kgl.h"
+
+/* file header: TRACE_MAGIC, TRACE_VERSION, then records.
+   a record is one 32bit word, op | (payload words << 8), followed by the
+   payload.  scalars are 32 bits each (floats as their bit pattern),
+   doubles 64; blocks of client memory are written as a byte count and the
+   bytes, padded out to a word */
+#define TRACE_MAGIC   0x54524752        /* "RGRT" */
+#define TRACE_VERSION 1
+
+#define TRACE_WORDS(bytes) (((bytes) + 3) >> 2)
+#define TRACE_BLOCK_WORDS(bytes) (1 + TRACE_WORDS(bytes))
+
+#define TRACE_OPS(OP) \
+    OP(InitPosition)            /* width, height, depth */ \
+    OP(Flush) \
+    OP(MatrixMode)              /* mode */ \
+    OP(PushMatrix) \
+    OP(PopMatrix) \
+    OP(PushAttrib)              /* attrib */ \
+    OP(PopAttrib) \
+    OP(LoadIdentity) \
+    OP(LoadMatrixf)             /* m[16] */ \
+    OP(MultMatrixf)             /* m[16] */ \
+    OP(Scalef)                  /* x, y, z */ \
+    OP(Rotatef)                 /* angle, x, y, z */ \
+    OP(Translatef)              /* x, y, z */ \
+    OP(Frustum)                 /* 6 doubles */ \
+    OP(Ortho)                   /* 6 doubles */ \
+    OP(Viewport)                /* x, y, width, height */ \
+    OP(DepthRange)              /* 2 doubles */ \
+    OP(Begin)                   /* mode */ \
+    OP(End) \
+    OP(Vertex3f)                /* x, y, z */ \
+    OP(Vertex4fv)               /* x, y, z, w */ \
+    OP(Normal3f)                /* x, y, z */ \
+    OP(Color4f)                 /* r, g, b, a */ \
+    OP(Color4ub)                /* r, g, b, a */ \
+    OP(TexCoord2f)              /* s, t */ \
+    OP(Enable)                  /* cap */ \
+    OP(Disable)                 /* cap */ \
+    OP(CullFace)                /* mode */ \
+    OP(ShadeModel)              /* mode */ \
+    OP(DepthFunc)               /* func */ \
+    OP(DepthMask)               /* flag */ \
+    OP(ColorMask)               /* r, g, b */ \
+    OP(BlendFunc)               /* sfactor, dfactor */ \
+    OP(AlphaFunc)               /* func, ref */ \
+    OP(PolygonMode)             /* face, mode */ \
+    OP(Hint)                    /* target, mode */ \
+    OP(LineWidth)               /* width */ \
+    OP(PointSize)               /* size */ \
+    OP(LineStipple)             /* factor, pattern */ \
+    OP(Scissor)                 /* x, y, width, height */ \
+    OP(Materialfv)              /* face, pname, 1 or 4 params */ \
+    OP(Lightfv)                 /* light, pname, 1, 3 or 4 params */ \
+    OP(LightModelf)             /* pname, param */ \
+    OP(LightModeli)             /* pname, param */ \
+    OP(LightModelfv)            /* 0, pname, 1 or 4 params */ \
+    OP(Fogi)                    /* pname, param */ \
+    OP(Fogf)                    /* pname, param */ \
+    OP(Fogfv)                   /* 0, pname, 1 or 4 params */ \
+    OP(ClipPlane)               /* plane, 4 doubles */ \
+    OP(Clear)                   /* mask */ \
+    OP(ClearColor)              /* r, g, b, a */ \
+    OP(ClearDepth)              /* 1 double */ \
+    OP(SuperClear) \
+    OP(GenTextures)             /* n, n names as generated */ \
+    OP(DeleteTextures)          /* n, n names */ \
+    OP(BindTexture)             /* target, name */ \
+    OP(TexParameteri)           /* target, pname, param */ \
+    OP(TexEnvi)                 /* target, pname, param */ \
+    OP(TexImage2D)              /* target, level, internalFormat, width, height, border, format, type, block */ \
+    OP(ColorTable)              /* target, internalformat, length, format, type, block */ \
+    OP(LitColorTable)           /* target, internalformat, length, format, type, block */ \
+    OP(PixelTransferf)          /* pname, param */ \
+    OP(PixelStorei)             /* pname, param */ \
+    OP(RasterPos2f)             /* x, y */ \
+    OP(RasterPos4f)             /* x, y, z, w */ \
+    OP(Bitmap)                  /* width, height, xorig, yorig, xmove, ymove, block */ \
+    OP(DrawPixels)              /* width, height, format, type, block */ \
+    OP(DrawPitchedPixels)       /* x0, y0, x1, y1, width, height, pitch, block */ \
+    OP(InterleavedArrays)       /* format, stride */ \
+    OP(VertexPointer)           /* size, type, stride */ \
+    OP(ArrayElement)            /* 4 floats, the element as it was read */ \
+    OP(DrawArrays)              /* mode, first, count, format, block */ \
+    OP(DrawElements)            /* mode, count, type, format, count indices, block */ \
+    OP(Feature)                 /* feature */ \
+    OP(rglEnable)               /* cap */ \
+    OP(rglDisable)              /* cap */ \
+    OP(SpecExp)                 /* index, exp */ \
+    OP(LightingAdjust)          /* adj */ \
+    OP(ListSpec)                /* pname, param, n, format */ \
+    OP(MeshRender)              /* n, mode, vertex block, normal block, poly block */ \
+    OP(MeshMaterial)            /* material, then the callback's calls */ \
+    OP(MeshMaterialEnd)         /* mode after the callback */ \
+    OP(GuardBand)               /* size */
+
+#define TRACE_ENUM(name) TRACE_##name,
+enum
+{
+    TRACE_OPS(TRACE_ENUM)
+    TRACE_OP_COUNT
+};
+#undef TRACE_ENUM
+
+//TRUE while a trace is open and we're not inside another entry point
+extern GLboolean traceRecording;
+
+#define TRACING traceRecording
+
+void trace_capture(char const* filename);
+void trace_suspend(void);
+void trace_resume(void);
+
+void trace_op(GLuint op, GLuint n, ...);
+void trace_op_doubles(GLuint op, GLuint n, ...);
+void trace_op_fv(GLuint op, GLuint target, GLenum pname, GLfloat const* params);
+void trace_op_block(GLuint op, GLvoid const* data, GLuint bytes, GLuint n, ...);
+void trace_record(GLuint op, GLuint words);
+void trace_words(GLuint n, GLuint const* words);
+void trace_block(GLvoid const* data, GLuint bytes);
+GLuint trace_float(GLfloat f);
+
+GLuint trace_param_count(GLenum pname);
+GLuint trace_image_size(GLenum format, GLsizei width, GLsizei height);
+char const* trace_op_name(GLuint op);
+
+#endif